@@ -34,10 +34,11 @@
 
 #include "cso_cache.h"
 #include "cso_hash.h"
+#include "cso_open_hash.h"
 
 
 struct cso_cache {
-   struct cso_hash *hashes[CSO_CACHE_MAX];
+   struct cso_open_hash *hashes[CSO_CACHE_MAX];
    int    max_size;
 
    cso_sanitize_callback sanitize_cb;
@@ -80,9 +81,9 @@ unsigned cso_construct_key(void *item, int item_size)
    return hash_key((item), item_size);
 }
 
-static INLINE struct cso_hash *_cso_hash_for_type(struct cso_cache *sc, enum cso_cache_type type)
+static INLINE struct cso_open_hash *_cso_hash_for_type(struct cso_cache *sc, enum cso_cache_type type)
 {
-   struct cso_hash *hash;
+   struct cso_open_hash *hash;
    hash = sc->hashes[type];
    return hash;
 }
@@ -153,7 +154,7 @@ static INLINE void delete_cso(void *state, enum cso_cache_type type)
 
 
 static INLINE void sanitize_hash(struct cso_cache *sc,
-                                 struct cso_hash *hash,
+                                 struct cso_open_hash *hash,
                                  enum cso_cache_type type,
                                  int max_size)
 {
@@ -162,44 +163,47 @@ static INLINE void sanitize_hash(struct cso_cache *sc,
 }
 
 
-static INLINE void sanitize_cb(struct cso_hash *hash, enum cso_cache_type type,
+static INLINE void sanitize_cb(struct cso_open_hash *hash,
+                               enum cso_cache_type type,
                                int max_size, void *user_data)
 {
    /* if we're approach the maximum size, remove fourth of the entries
     * otherwise every subsequent call will go through the same */
-   int hash_size = cso_hash_size(hash);
+   int hash_size = cso_open_hash_size(hash);
    int max_entries = (max_size > hash_size) ? max_size : hash_size;
    int to_remove =  (max_size < max_entries) * max_entries/4;
+   unsigned slot = cso_open_hash_next(hash, 0);
    if (hash_size > max_size)
       to_remove += hash_size - max_size;
-   while (to_remove) {
+   while (to_remove && slot < hash->size) {
       /*remove elements until we're good */
       /*fixme: currently we pick the nodes to remove at random*/
-      struct cso_hash_iter iter = cso_hash_first_node(hash);
-      void  *cso = cso_hash_take(hash, cso_hash_iter_key(iter));
+      void *cso = cso_open_hash_data(hash, slot);
+      cso_open_hash_erase(hash, slot);
       delete_cso(cso, type);
       --to_remove;
+      slot = cso_open_hash_next(hash, slot + 1);
    }
 }
 
-struct cso_hash_iter
+boolean
 cso_insert_state(struct cso_cache *sc,
                  unsigned hash_key, enum cso_cache_type type,
                  void *state)
 {
-   struct cso_hash *hash = _cso_hash_for_type(sc, type);
+   struct cso_open_hash *hash = _cso_hash_for_type(sc, type);
    sanitize_hash(sc, hash, type, sc->max_size);
 
-   return cso_hash_insert(hash, hash_key, state);
+   return cso_open_hash_insert(hash, hash_key, state);
 }
 
-struct cso_hash_iter
+void *
 cso_find_state(struct cso_cache *sc,
                unsigned hash_key, enum cso_cache_type type)
 {
-   struct cso_hash *hash = _cso_hash_for_type(sc, type);
+   struct cso_open_hash *hash = _cso_hash_for_type(sc, type);
 
-   return cso_hash_find(hash, hash_key);
+   return cso_open_hash_find(hash, hash_key, NULL, 0);
 }
 
 
@@ -222,25 +226,20 @@ void *cso_hash_find_data_from_template( struct cso_hash *hash,
 }
 
 
-struct cso_hash_iter cso_find_state_template(struct cso_cache *sc,
-                                             unsigned hash_key, enum cso_cache_type type,
-                                             void *templ, unsigned size)
+void *cso_find_state_template(struct cso_cache *sc,
+                              unsigned hash_key, enum cso_cache_type type,
+                              const void *templ, unsigned size)
 {
-   struct cso_hash_iter iter = cso_find_state(sc, hash_key, type);
-   while (!cso_hash_iter_is_null(iter)) {
-      void *iter_data = cso_hash_iter_data(iter);
-      if (!memcmp(iter_data, templ, size))
-         return iter;
-      iter = cso_hash_iter_next(iter);
-   }
-   return iter;
+   struct cso_open_hash *hash = _cso_hash_for_type(sc, type);
+
+   return cso_open_hash_find(hash, hash_key, templ, size);
 }
 
 void * cso_take_state(struct cso_cache *sc,
                       unsigned hash_key, enum cso_cache_type type)
 {
-   struct cso_hash *hash = _cso_hash_for_type(sc, type);
-   return cso_hash_take(hash, hash_key);
+   struct cso_open_hash *hash = _cso_hash_for_type(sc, type);
+   return cso_open_hash_take(hash, hash_key);
 }
 
 struct cso_cache *cso_cache_create(void)
@@ -251,8 +250,15 @@ struct cso_cache *cso_cache_create(void)
       return NULL;
 
    sc->max_size           = 4096;
-   for (i = 0; i < CSO_CACHE_MAX; i++)
-      sc->hashes[i] = cso_hash_create();
+   for (i = 0; i < CSO_CACHE_MAX; i++) {
+      sc->hashes[i] = cso_open_hash_create();
+      if (!sc->hashes[i]) {
+         while (i--)
+            cso_open_hash_delete(sc->hashes[i]);
+         FREE(sc);
+         return NULL;
+      }
+   }
 
    sc->sanitize_cb        = sanitize_cb;
    sc->sanitize_data      = 0;
@@ -263,13 +269,12 @@ struct cso_cache *cso_cache_create(void)
 void cso_for_each_state(struct cso_cache *sc, enum cso_cache_type type,
                         cso_state_callback func, void *user_data)
 {
-   struct cso_hash *hash = _cso_hash_for_type(sc, type);
-   struct cso_hash_iter iter;
+   struct cso_open_hash *hash = _cso_hash_for_type(sc, type);
+   unsigned slot;
 
-   iter = cso_hash_first_node(hash);
-   while (!cso_hash_iter_is_null(iter)) {
-      void *state = cso_hash_iter_data(iter);
-      iter = cso_hash_iter_next(iter);
+   for (slot = cso_open_hash_next(hash, 0); slot < hash->size;
+        slot = cso_open_hash_next(hash, slot + 1)) {
+      void *state = cso_open_hash_data(hash, slot);
       if (state) {
          func(state, user_data);
       }
@@ -292,7 +297,7 @@ void cso_cache_delete(struct cso_cache *sc)
    cso_for_each_state(sc, CSO_VELEMENTS, delete_velements, 0);
 
    for (i = 0; i < CSO_CACHE_MAX; i++)
-      cso_hash_delete(sc->hashes[i]);
+      cso_open_hash_delete(sc->hashes[i]);
 
    FREE(sc);
 }
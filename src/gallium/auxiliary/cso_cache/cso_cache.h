@@ -76,9 +76,8 @@
 #include "pipe/p_context.h"
 #include "pipe/p_state.h"
 
-/* cso_hash.h is necessary for cso_hash_iter, as MSVC requires structures
- * returned by value to be fully defined */
 #include "cso_hash.h"
+#include "cso_open_hash.h"
 
 
 #ifdef	__cplusplus
@@ -96,7 +95,7 @@ enum cso_cache_type {
 
 typedef void (*cso_state_callback)(void *ctx, void *obj);
 
-typedef void (*cso_sanitize_callback)(struct cso_hash *hash,
+typedef void (*cso_sanitize_callback)(struct cso_open_hash *hash,
                                       enum cso_cache_type type,
                                       int max_size,
                                       void *user_data);
@@ -152,14 +151,14 @@ void cso_cache_set_sanitize_callback(struct cso_cache *sc,
                                      cso_sanitize_callback cb,
                                      void *user_data);
 
-struct cso_hash_iter cso_insert_state(struct cso_cache *sc,
-                                      unsigned hash_key, enum cso_cache_type type,
-                                      void *state);
-struct cso_hash_iter cso_find_state(struct cso_cache *sc,
-                                    unsigned hash_key, enum cso_cache_type type);
-struct cso_hash_iter cso_find_state_template(struct cso_cache *sc,
-                                             unsigned hash_key, enum cso_cache_type type,
-                                             void *templ, unsigned size);
+boolean cso_insert_state(struct cso_cache *sc,
+                         unsigned hash_key, enum cso_cache_type type,
+                         void *state);
+void *cso_find_state(struct cso_cache *sc,
+                     unsigned hash_key, enum cso_cache_type type);
+void *cso_find_state_template(struct cso_cache *sc,
+                              unsigned hash_key, enum cso_cache_type type,
+                              const void *templ, unsigned size);
 void cso_for_each_state(struct cso_cache *sc, enum cso_cache_type type,
                         cso_state_callback func, void *user_data);
 void * cso_take_state(struct cso_cache *sc, unsigned hash_key,
@@ -211,27 +211,27 @@ static INLINE boolean delete_cso(struct cso_context *ctx,
 }
 
 static INLINE void
-sanitize_hash(struct cso_hash *hash, enum cso_cache_type type,
+sanitize_hash(struct cso_open_hash *hash, enum cso_cache_type type,
               int max_size, void *user_data)
 {
    struct cso_context *ctx = (struct cso_context *)user_data;
    /* if we're approach the maximum size, remove fourth of the entries
     * otherwise every subsequent call will go through the same */
-   int hash_size = cso_hash_size(hash);
+   int hash_size = cso_open_hash_size(hash);
    int max_entries = (max_size > hash_size) ? max_size : hash_size;
    int to_remove =  (max_size < max_entries) * max_entries/4;
-   struct cso_hash_iter iter = cso_hash_first_node(hash);
+   unsigned slot = cso_open_hash_next(hash, 0);
    if (hash_size > max_size)
       to_remove += hash_size - max_size;
-   while (to_remove) {
+   while (to_remove && slot < hash->size) {
       /*remove elements until we're good */
       /*fixme: currently we pick the nodes to remove at random*/
-      void *cso = cso_hash_iter_data(iter);
+      void *cso = cso_open_hash_data(hash, slot);
       if (delete_cso(ctx, cso, type)) {
-         iter = cso_hash_erase(hash, iter);
+         cso_open_hash_erase(hash, slot);
          --to_remove;
-      } else
-         iter = cso_hash_iter_next(iter);
+      }
+      slot = cso_open_hash_next(hash, slot + 1);
    }
 }
 
@@ -376,17 +376,17 @@ enum pipe_error cso_set_blend(struct cso_context *ctx,
                               const struct pipe_blend_state *templ)
 {
    unsigned key_size, hash_key;
-   struct cso_hash_iter iter;
+   void *cached;
    void *handle;
 
    key_size = templ->independent_blend_enable ?
       sizeof(struct pipe_blend_state) :
       (char *)&(templ->rt[1]) - (char *)templ;
    hash_key = cso_construct_key((void*)templ, key_size);
-   iter = cso_find_state_template(ctx->cache, hash_key, CSO_BLEND,
-                                  (void*)templ, key_size);
+   cached = cso_find_state_template(ctx->cache, hash_key, CSO_BLEND,
+                                    templ, key_size);
 
-   if (cso_hash_iter_is_null(iter)) {
+   if (!cached) {
       struct cso_blend *cso = MALLOC(sizeof(struct cso_blend));
       if (!cso)
          return PIPE_ERROR_OUT_OF_MEMORY;
@@ -397,8 +397,7 @@ enum pipe_error cso_set_blend(struct cso_context *ctx,
       cso->delete_state = (cso_state_callback)ctx->pipe->delete_blend_state;
       cso->context = ctx->pipe;
 
-      iter = cso_insert_state(ctx->cache, hash_key, CSO_BLEND, cso);
-      if (cso_hash_iter_is_null(iter)) {
+      if (!cso_insert_state(ctx->cache, hash_key, CSO_BLEND, cso)) {
          FREE(cso);
          return PIPE_ERROR_OUT_OF_MEMORY;
       }
@@ -406,7 +405,7 @@ enum pipe_error cso_set_blend(struct cso_context *ctx,
       handle = cso->data;
    }
    else {
-      handle = ((struct cso_blend *)cso_hash_iter_data(iter))->data;
+      handle = ((struct cso_blend *)cached)->data;
    }
 
    if (ctx->blend != handle) {
@@ -439,13 +438,12 @@ cso_set_depth_stencil_alpha(struct cso_context *ctx,
 {
    unsigned key_size = sizeof(struct pipe_depth_stencil_alpha_state);
    unsigned hash_key = cso_construct_key((void*)templ, key_size);
-   struct cso_hash_iter iter = cso_find_state_template(ctx->cache,
-                                                       hash_key,
-                                                       CSO_DEPTH_STENCIL_ALPHA,
-                                                       (void*)templ, key_size);
+   void *cached = cso_find_state_template(ctx->cache, hash_key,
+                                          CSO_DEPTH_STENCIL_ALPHA,
+                                          templ, key_size);
    void *handle;
 
-   if (cso_hash_iter_is_null(iter)) {
+   if (!cached) {
       struct cso_depth_stencil_alpha *cso =
          MALLOC(sizeof(struct cso_depth_stencil_alpha));
       if (!cso)
@@ -458,9 +456,8 @@ cso_set_depth_stencil_alpha(struct cso_context *ctx,
          (cso_state_callback)ctx->pipe->delete_depth_stencil_alpha_state;
       cso->context = ctx->pipe;
 
-      iter = cso_insert_state(ctx->cache, hash_key,
-                              CSO_DEPTH_STENCIL_ALPHA, cso);
-      if (cso_hash_iter_is_null(iter)) {
+      if (!cso_insert_state(ctx->cache, hash_key,
+                            CSO_DEPTH_STENCIL_ALPHA, cso)) {
          FREE(cso);
          return PIPE_ERROR_OUT_OF_MEMORY;
       }
@@ -468,8 +465,7 @@ cso_set_depth_stencil_alpha(struct cso_context *ctx,
       handle = cso->data;
    }
    else {
-      handle = ((struct cso_depth_stencil_alpha *)
-                cso_hash_iter_data(iter))->data;
+      handle = ((struct cso_depth_stencil_alpha *)cached)->data;
    }
 
    if (ctx->depth_stencil != handle) {
@@ -502,13 +498,11 @@ enum pipe_error cso_set_rasterizer(struct cso_context *ctx,
 {
    unsigned key_size = sizeof(struct pipe_rasterizer_state);
    unsigned hash_key = cso_construct_key((void*)templ, key_size);
-   struct cso_hash_iter iter = cso_find_state_template(ctx->cache,
-                                                       hash_key,
-                                                       CSO_RASTERIZER,
-                                                       (void*)templ, key_size);
+   void *cached = cso_find_state_template(ctx->cache, hash_key,
+                                          CSO_RASTERIZER, templ, key_size);
    void *handle = NULL;
 
-   if (cso_hash_iter_is_null(iter)) {
+   if (!cached) {
       struct cso_rasterizer *cso = MALLOC(sizeof(struct cso_rasterizer));
       if (!cso)
          return PIPE_ERROR_OUT_OF_MEMORY;
@@ -519,8 +513,7 @@ enum pipe_error cso_set_rasterizer(struct cso_context *ctx,
          (cso_state_callback)ctx->pipe->delete_rasterizer_state;
       cso->context = ctx->pipe;
 
-      iter = cso_insert_state(ctx->cache, hash_key, CSO_RASTERIZER, cso);
-      if (cso_hash_iter_is_null(iter)) {
+      if (!cso_insert_state(ctx->cache, hash_key, CSO_RASTERIZER, cso)) {
          FREE(cso);
          return PIPE_ERROR_OUT_OF_MEMORY;
       }
@@ -528,7 +521,7 @@ enum pipe_error cso_set_rasterizer(struct cso_context *ctx,
       handle = cso->data;
    }
    else {
-      handle = ((struct cso_rasterizer *)cso_hash_iter_data(iter))->data;
+      handle = ((struct cso_rasterizer *)cached)->data;
    }
 
    if (ctx->rasterizer != handle) {
@@ -860,7 +853,7 @@ cso_set_vertex_elements(struct cso_context *ctx,
 {
    struct u_vbuf *vbuf = ctx->vbuf;
    unsigned key_size, hash_key;
-   struct cso_hash_iter iter;
+   void *cached;
    void *handle;
    struct cso_velems_state velems_state;
 
@@ -879,10 +872,10 @@ cso_set_vertex_elements(struct cso_context *ctx,
    memcpy(velems_state.velems, states,
           sizeof(struct pipe_vertex_element) * count);
    hash_key = cso_construct_key((void*)&velems_state, key_size);
-   iter = cso_find_state_template(ctx->cache, hash_key, CSO_VELEMENTS,
-                                  (void*)&velems_state, key_size);
+   cached = cso_find_state_template(ctx->cache, hash_key, CSO_VELEMENTS,
+                                    &velems_state, key_size);
 
-   if (cso_hash_iter_is_null(iter)) {
+   if (!cached) {
       struct cso_velements *cso = MALLOC(sizeof(struct cso_velements));
       if (!cso)
          return PIPE_ERROR_OUT_OF_MEMORY;
@@ -894,8 +887,7 @@ cso_set_vertex_elements(struct cso_context *ctx,
          (cso_state_callback) ctx->pipe->delete_vertex_elements_state;
       cso->context = ctx->pipe;
 
-      iter = cso_insert_state(ctx->cache, hash_key, CSO_VELEMENTS, cso);
-      if (cso_hash_iter_is_null(iter)) {
+      if (!cso_insert_state(ctx->cache, hash_key, CSO_VELEMENTS, cso)) {
          FREE(cso);
          return PIPE_ERROR_OUT_OF_MEMORY;
       }
@@ -903,7 +895,7 @@ cso_set_vertex_elements(struct cso_context *ctx,
       handle = cso->data;
    }
    else {
-      handle = ((struct cso_velements *)cso_hash_iter_data(iter))->data;
+      handle = ((struct cso_velements *)cached)->data;
    }
 
    if (ctx->velements != handle) {
@@ -1026,12 +1018,11 @@ single_sampler(struct cso_context *ctx,
    if (templ != NULL) {
       unsigned key_size = sizeof(struct pipe_sampler_state);
       unsigned hash_key = cso_construct_key((void*)templ, key_size);
-      struct cso_hash_iter iter =
-         cso_find_state_template(ctx->cache,
-                                 hash_key, CSO_SAMPLER,
-                                 (void *) templ, key_size);
+      void *cached = cso_find_state_template(ctx->cache,
+                                             hash_key, CSO_SAMPLER,
+                                             templ, key_size);
 
-      if (cso_hash_iter_is_null(iter)) {
+      if (!cached) {
          struct cso_sampler *cso = MALLOC(sizeof(struct cso_sampler));
          if (!cso)
             return PIPE_ERROR_OUT_OF_MEMORY;
@@ -1042,8 +1033,7 @@ single_sampler(struct cso_context *ctx,
             (cso_state_callback) ctx->pipe->delete_sampler_state;
          cso->context = ctx->pipe;
 
-         iter = cso_insert_state(ctx->cache, hash_key, CSO_SAMPLER, cso);
-         if (cso_hash_iter_is_null(iter)) {
+         if (!cso_insert_state(ctx->cache, hash_key, CSO_SAMPLER, cso)) {
             FREE(cso);
             return PIPE_ERROR_OUT_OF_MEMORY;
          }
@@ -1051,7 +1041,7 @@ single_sampler(struct cso_context *ctx,
          handle = cso->data;
       }
       else {
-         handle = ((struct cso_sampler *)cso_hash_iter_data(iter))->data;
+         handle = ((struct cso_sampler *)cached)->data;
       }
    }
 
@@ -1409,6 +1399,18 @@ cso_draw_vbo(struct cso_context *cso,
    }
 }
 
+/**
+ * Tell u_vbuf that the buffer contents changed, so index ranges it computed
+ * from it can't be reused.  NULL means all buffers.
+ */
+void
+cso_invalidate_index_ranges(struct cso_context *cso,
+                            struct pipe_resource *buffer)
+{
+   if (cso->vbuf)
+      u_vbuf_invalidate_index_ranges(cso->vbuf, buffer);
+}
+
 void
 cso_draw_arrays(struct cso_context *cso, uint mode, uint start, uint count)
 {
@@ -228,6 +228,10 @@ void
 cso_draw_vbo(struct cso_context *cso,
              const struct pipe_draw_info *info);
 
+void
+cso_invalidate_index_ranges(struct cso_context *cso,
+                            struct pipe_resource *buffer);
+
 void
 cso_draw_arrays_instanced(struct cso_context *cso, uint mode,
                           uint start, uint count,
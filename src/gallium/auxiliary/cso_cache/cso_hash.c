@@ -439,3 +439,33 @@ boolean cso_hash_contains(struct cso_hash *hash, unsigned key)
    struct cso_node **node = cso_hash_find_node(hash, key);
    return (*node != hash->data.e);
 }
+
+void *cso_hash_find_data_from_key(struct cso_hash *hash, unsigned hash_key,
+                                  const void *key, unsigned offset,
+                                  unsigned size)
+{
+   struct cso_hash_iter iter = cso_hash_find(hash, hash_key);
+   while (!cso_hash_iter_is_null(iter) &&
+          cso_hash_iter_key(iter) == hash_key) {
+      void *data = cso_hash_iter_data(iter);
+      if (memcmp((const char *) data + offset, key, size) == 0)
+         return data;
+      iter = cso_hash_iter_next(iter);
+   }
+   return NULL;
+}
+
+boolean cso_hash_erase_data(struct cso_hash *hash, unsigned hash_key,
+                            void *data)
+{
+   struct cso_hash_iter iter = cso_hash_find(hash, hash_key);
+   while (!cso_hash_iter_is_null(iter) &&
+          cso_hash_iter_key(iter) == hash_key) {
+      if (cso_hash_iter_data(iter) == data) {
+         cso_hash_erase(hash, iter);
+         return TRUE;
+      }
+      iter = cso_hash_iter_next(iter);
+   }
+   return FALSE;
+}
@@ -121,6 +121,24 @@ void *cso_hash_find_data_from_template( struct cso_hash *hash,
 				        void *templ,
 				        int size );
 
+/**
+ * Like cso_hash_find_data_from_template, for data which holds its key
+ * \p offset bytes in, as shader variants do.
+ */
+void *cso_hash_find_data_from_key( struct cso_hash *hash,
+                                   unsigned hash_key,
+                                   const void *key,
+                                   unsigned offset,
+                                   unsigned size );
+
+/**
+ * Removes the entry with the given key and data from the hash.
+ * Returns true if it was there.
+ */
+boolean cso_hash_erase_data( struct cso_hash *hash,
+                             unsigned hash_key,
+                             void *data );
+
 
 #ifdef	__cplusplus
 }
@@ -0,0 +1,334 @@
+/**************************************************************************
+ *
+ * Copyright 2026 agent
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+#include "pipe/p_config.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+
+#include "cso_open_hash.h"
+
+#if defined(PIPE_ARCH_SSE)
+#include <emmintrin.h>
+#endif
+
+
+/* Tags of unused slots have the top bit set */
+#define TAG_EMPTY   0x80
+#define TAG_DELETED 0xfe
+
+#define INVALID_SLOT ~0u
+
+
+/**
+ * The keys are often weak hashes (cso_construct_key() xors the words of
+ * the state), so mix them before picking the group and tag.
+ */
+static INLINE unsigned
+mix_key(unsigned key)
+{
+   key ^= key >> 16;
+   key *= 0x85ebca6b;
+   key ^= key >> 13;
+   key *= 0xc2b2ae35;
+   key ^= key >> 16;
+   return key;
+}
+
+
+#if !defined(PIPE_ARCH_SSE)
+
+#define BYTES_LO 0x0101010101010101ULL
+#define BYTES_HI 0x8080808080808080ULL
+
+/** Gather the top bits of the bytes of a word into a bitmask */
+static INLINE unsigned
+byte_mask(uint64_t hi)
+{
+   return ((hi & BYTES_HI) >> 7) * 0x0102040810204080ULL >> 56;
+}
+
+static INLINE void
+load_group(const uint8_t *tags, uint64_t words[2])
+{
+   memcpy(words, tags, 2 * sizeof(uint64_t));
+   words[0] = util_le64_to_cpu(words[0]);
+   words[1] = util_le64_to_cpu(words[1]);
+}
+
+#endif
+
+
+/** Bitmask of the slots of the group with the given tag */
+static INLINE unsigned
+group_match(const uint8_t *tags, uint8_t tag)
+{
+#if defined(PIPE_ARCH_SSE)
+   __m128i group = _mm_load_si128((const __m128i *)tags);
+   return _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(tag)));
+#else
+   /* Eight tags at a time: find the zero bytes of the xor with the tag.
+    * A borrow can also flag the byte above a match if it is the tag plus
+    * one.  The keys are compared anyway, and no tag is TAG_EMPTY + 1, so
+    * looking for empty slots stays exact.
+    */
+   uint64_t words[2];
+   unsigned mask = 0, i;
+
+   load_group(tags, words);
+   for (i = 0; i < 2; i++) {
+      uint64_t x = words[i] ^ (BYTES_LO * tag);
+      mask |= byte_mask((x - BYTES_LO) & ~x) << (i * 8);
+   }
+   return mask;
+#endif
+}
+
+
+/** Bitmask of the unused (empty or deleted) slots of the group */
+static INLINE unsigned
+group_match_free(const uint8_t *tags)
+{
+#if defined(PIPE_ARCH_SSE)
+   return _mm_movemask_epi8(_mm_load_si128((const __m128i *)tags));
+#else
+   uint64_t words[2];
+
+   load_group(tags, words);
+   return byte_mask(words[0]) | byte_mask(words[1]) << 8;
+#endif
+}
+
+
+static boolean
+alloc_slots(struct cso_open_hash *hash, unsigned size)
+{
+   hash->tags = align_malloc(size, CSO_OPEN_HASH_GROUP);
+   hash->keys = MALLOC(size * sizeof *hash->keys);
+   hash->data = MALLOC(size * sizeof *hash->data);
+   if (!hash->tags || !hash->keys || !hash->data) {
+      align_free(hash->tags);
+      FREE(hash->keys);
+      FREE(hash->data);
+      return FALSE;
+   }
+
+   memset(hash->tags, TAG_EMPTY, size);
+   hash->size = size;
+   hash->count = 0;
+   hash->used = 0;
+   return TRUE;
+}
+
+
+struct cso_open_hash *
+cso_open_hash_create(void)
+{
+   struct cso_open_hash *hash = CALLOC_STRUCT(cso_open_hash);
+   if (!hash)
+      return NULL;
+
+   if (!alloc_slots(hash, CSO_OPEN_HASH_GROUP)) {
+      FREE(hash);
+      return NULL;
+   }
+
+   return hash;
+}
+
+
+void
+cso_open_hash_delete(struct cso_open_hash *hash)
+{
+   if (!hash)
+      return;
+
+   align_free(hash->tags);
+   FREE(hash->keys);
+   FREE(hash->data);
+   FREE(hash);
+}
+
+
+static unsigned
+find_slot(const struct cso_open_hash *hash, unsigned key,
+          const void *templ, unsigned templ_size)
+{
+   const unsigned group_mask = hash->size / CSO_OPEN_HASH_GROUP - 1;
+   const unsigned h = mix_key(key);
+   const uint8_t tag = h & 0x7f;
+   unsigned group = (h >> 7) & group_mask;
+   unsigned i;
+
+   /* Triangular probing visits every group once */
+   for (i = 0; i <= group_mask; i++) {
+      const unsigned base = group * CSO_OPEN_HASH_GROUP;
+      const uint8_t *tags = hash->tags + base;
+      unsigned match = group_match(tags, tag);
+
+      while (match) {
+         const unsigned slot = base + u_bit_scan(&match);
+
+         if (hash->keys[slot] == key &&
+             (!templ || !memcmp(hash->data[slot], templ, templ_size)))
+            return slot;
+      }
+
+      /* The entry would have been put in this group's empty slot */
+      if (group_match(tags, TAG_EMPTY))
+         break;
+
+      group = (group + i + 1) & group_mask;
+   }
+
+   return INVALID_SLOT;
+}
+
+
+void *
+cso_open_hash_find(const struct cso_open_hash *hash, unsigned key,
+                   const void *templ, unsigned templ_size)
+{
+   unsigned slot = find_slot(hash, key, templ, templ_size);
+
+   return slot != INVALID_SLOT ? hash->data[slot] : NULL;
+}
+
+
+/**
+ * Put an entry in the first unused slot of its probe sequence.
+ */
+static void
+insert_slot(struct cso_open_hash *hash, unsigned key, void *data)
+{
+   const unsigned group_mask = hash->size / CSO_OPEN_HASH_GROUP - 1;
+   const unsigned h = mix_key(key);
+   unsigned group = (h >> 7) & group_mask;
+   unsigned i;
+
+   for (i = 0; i <= group_mask; i++) {
+      const unsigned base = group * CSO_OPEN_HASH_GROUP;
+      unsigned free_slots = group_match_free(hash->tags + base);
+
+      if (free_slots) {
+         const unsigned slot = base + ffs(free_slots) - 1;
+
+         if (hash->tags[slot] == TAG_EMPTY)
+            hash->used++;
+         hash->count++;
+         hash->tags[slot] = h & 0x7f;
+         hash->keys[slot] = key;
+         hash->data[slot] = data;
+         return;
+      }
+
+      group = (group + i + 1) & group_mask;
+   }
+
+   /* The load factor guarantees unused slots */
+   assert(0);
+}
+
+
+static boolean
+rehash(struct cso_open_hash *hash, unsigned size)
+{
+   struct cso_open_hash old = *hash;
+   unsigned slot;
+
+   if (!alloc_slots(hash, size)) {
+      *hash = old;
+      return FALSE;
+   }
+
+   for (slot = cso_open_hash_next(&old, 0); slot < old.size;
+        slot = cso_open_hash_next(&old, slot + 1))
+      insert_slot(hash, old.keys[slot], old.data[slot]);
+
+   align_free(old.tags);
+   FREE(old.keys);
+   FREE(old.data);
+   return TRUE;
+}
+
+
+boolean
+cso_open_hash_insert(struct cso_open_hash *hash, unsigned key, void *data)
+{
+   /* Keep at least an eighth of the slots empty so lookups of missing
+    * entries end early.
+    */
+   if ((hash->used + 1) * 8 > hash->size * 7) {
+      /* Grow, unless this is mostly deleted slots */
+      unsigned size = (hash->count + 1) * 2 > hash->size ?
+                      hash->size * 2 : hash->size;
+
+      if (!rehash(hash, size))
+         return FALSE;
+   }
+
+   insert_slot(hash, key, data);
+   return TRUE;
+}
+
+
+void
+cso_open_hash_erase(struct cso_open_hash *hash, unsigned slot)
+{
+   uint8_t *tags = hash->tags + slot / CSO_OPEN_HASH_GROUP *
+                   CSO_OPEN_HASH_GROUP;
+
+   assert(slot < hash->size && !(hash->tags[slot] & 0x80));
+
+   /* If the group has an empty slot it was never full, so no lookup probed
+    * past it and the slot can become empty again.
+    */
+   if (group_match(tags, TAG_EMPTY)) {
+      hash->tags[slot] = TAG_EMPTY;
+      hash->used--;
+   }
+   else {
+      hash->tags[slot] = TAG_DELETED;
+   }
+
+   hash->count--;
+}
+
+
+void *
+cso_open_hash_take(struct cso_open_hash *hash, unsigned key)
+{
+   unsigned slot = find_slot(hash, key, NULL, 0);
+   void *data;
+
+   if (slot == INVALID_SLOT)
+      return NULL;
+
+   data = hash->data[slot];
+   cso_open_hash_erase(hash, slot);
+   return data;
+}
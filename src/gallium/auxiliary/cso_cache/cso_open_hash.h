@@ -0,0 +1,126 @@
+/**************************************************************************
+ *
+ * Copyright 2026 agent
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Open addressing hash table.
+ *
+ * Unlike cso_hash there is no allocation per entry: the slots are arrays of
+ * one byte tags, the keys (hashes computed by the caller) and the data
+ * pointers.  Slots are probed in groups of CSO_OPEN_HASH_GROUP, comparing
+ * all the tags of a group at once, so most lookups touch one cache line of
+ * tags plus the matching entry.
+ *
+ * Like with cso_hash several entries can have the same key; lookups compare
+ * the start of the data with a template to tell them apart.
+ */
+
+#ifndef CSO_OPEN_HASH_H
+#define CSO_OPEN_HASH_H
+
+#include "pipe/p_compiler.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+
+#define CSO_OPEN_HASH_GROUP 16
+
+
+struct cso_open_hash {
+   unsigned size;      /**< number of slots, power of two */
+   unsigned count;     /**< number of entries */
+   unsigned used;      /**< number of entries and deleted slots */
+
+   uint8_t *tags;      /**< low 7 bits of the hash, or empty/deleted */
+   unsigned *keys;
+   void **data;
+};
+
+
+struct cso_open_hash *cso_open_hash_create(void);
+void cso_open_hash_delete(struct cso_open_hash *hash);
+
+/**
+ * Find an entry with the given key whose data starts with templ, or any
+ * entry with the key if templ is NULL.
+ */
+void *cso_open_hash_find(const struct cso_open_hash *hash, unsigned key,
+                         const void *templ, unsigned templ_size);
+
+/**
+ * Add an entry.  Returns FALSE if out of memory.
+ */
+boolean cso_open_hash_insert(struct cso_open_hash *hash, unsigned key,
+                             void *data);
+
+/**
+ * Remove the entry in the given slot.  Other entries do not move, so this
+ * can be used while iterating.
+ */
+void cso_open_hash_erase(struct cso_open_hash *hash, unsigned slot);
+
+/**
+ * Remove an entry with the given key and return its data.
+ */
+void *cso_open_hash_take(struct cso_open_hash *hash, unsigned key);
+
+
+/**
+ * Return the first used slot at or after the given one, or hash->size.
+ *
+ *   for (slot = cso_open_hash_next(hash, 0); slot < hash->size;
+ *        slot = cso_open_hash_next(hash, slot + 1))
+ *      ... cso_open_hash_data(hash, slot) ...
+ */
+static INLINE unsigned
+cso_open_hash_next(const struct cso_open_hash *hash, unsigned slot)
+{
+   while (slot < hash->size && (hash->tags[slot] & 0x80))
+      slot++;
+   return slot;
+}
+
+static INLINE void *
+cso_open_hash_data(const struct cso_open_hash *hash, unsigned slot)
+{
+   return hash->data[slot];
+}
+
+static INLINE unsigned
+cso_open_hash_size(const struct cso_open_hash *hash)
+{
+   return hash->count;
+}
+
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif /* CSO_OPEN_HASH_H */
@@ -1064,6 +1064,20 @@ draw_collect_pipeline_statistics(struct draw_context *draw,
    draw->collect_statistics = enable;
 }
 
+/**
+ * Returns the number of vertex shader variants which were rebuilt
+ * with full optimization because they were hot (see DRAW_TIERED_JIT).
+ */
+uint64_t
+draw_get_shader_hot_recompiles(const struct draw_context *draw)
+{
+#ifdef HAVE_LLVM
+   if (draw->llvm)
+      return draw->llvm->nr_hot_recompiles;
+#endif
+   return 0;
+}
+
 /**
  * Computes clipper invocation statistics.
  *
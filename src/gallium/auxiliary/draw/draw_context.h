@@ -296,4 +296,7 @@ draw_get_shader_param_no_llvm(unsigned shader, enum pipe_shader_cap param);
 boolean
 draw_get_option_use_llvm(void);
 
+uint64_t
+draw_get_shader_hot_recompiles(const struct draw_context *draw);
+
 #endif /* DRAW_CONTEXT_H */
@@ -730,6 +730,11 @@ draw_create_geometry_shader(struct draw_context *draw,
       gs = &llvm_gs->base;
 
       make_empty_list(&llvm_gs->variants);
+      llvm_gs->variants_hash = cso_hash_create();
+      if (!llvm_gs->variants_hash) {
+         FREE(llvm_gs);
+         return NULL;
+      }
    } else
 #endif
    {
@@ -743,6 +748,10 @@ draw_create_geometry_shader(struct draw_context *draw,
    gs->state = *state;
    gs->state.tokens = tgsi_dup_tokens(state->tokens);
    if (!gs->state.tokens) {
+#ifdef HAVE_LLVM
+      if (use_llvm)
+         cso_hash_delete(llvm_gs->variants_hash);
+#endif
       FREE(gs);
       return NULL;
    }
@@ -877,6 +886,7 @@ void draw_delete_geometry_shader(struct draw_context *draw,
       }
 
       assert(shader->variants_cached == 0);
+      cso_hash_delete(shader->variants_hash);
 
       if (dgs->llvm_prim_lengths) {
          unsigned i;
@@ -44,13 +44,16 @@
 #include "gallivm/lp_bld_printf.h"
 #include "gallivm/lp_bld_intr.h"
 #include "gallivm/lp_bld_init.h"
+#include "gallivm/lp_bld_cache.h"
 #include "gallivm/lp_bld_type.h"
 #include "gallivm/lp_bld_pack.h"
 #include "gallivm/lp_bld_format.h"
 
 #include "tgsi/tgsi_exec.h"
 #include "tgsi/tgsi_dump.h"
+#include "tgsi/tgsi_parse.h"
 
+#include "util/u_debug.h"
 #include "util/u_math.h"
 #include "util/u_pointer.h"
 #include "util/u_string.h"
@@ -60,6 +63,9 @@
 #define DEBUG_STORE 0
 
 
+DEBUG_GET_ONCE_BOOL_OPTION(draw_tiered_jit, "DRAW_TIERED_JIT", FALSE)
+
+
 static void
 draw_llvm_generate(struct draw_llvm *llvm, struct draw_llvm_variant *var,
                    boolean elts);
@@ -507,6 +513,8 @@ draw_llvm_create(struct draw_context *draw, LLVMContextRef context)
    llvm->nr_gs_variants = 0;
    make_empty_list(&llvm->gs_variants_list);
 
+   llvm->tiered = debug_get_option_draw_tiered_jit();
+
    return llvm;
 
 fail:
@@ -531,38 +539,108 @@ draw_llvm_destroy(struct draw_llvm *llvm)
 
 
 /**
- * Create LLVM-generated code for a vertex shader.
+ * Name of the vertex shader function.  When the module goes to the gallivm
+ * cache the name must be the same in every process.
  */
-struct draw_llvm_variant *
-draw_llvm_create_variant(struct draw_llvm *llvm,
-                         unsigned num_inputs,
-                         const struct draw_llvm_variant_key *key)
+static void
+get_vs_func_name(const struct draw_llvm_variant *variant, boolean elts,
+                 char *func_name, size_t size)
 {
-   struct draw_llvm_variant *variant;
-   struct llvm_vertex_shader *shader =
-      llvm_vertex_shader(llvm->draw->vs.vertex_shader);
-   LLVMTypeRef vertex_header;
-   char module_name[64];
+   if (gallivm_cache_active(variant->gallivm)) {
+      util_snprintf(func_name, size, "draw_llvm_vs_%s",
+                    elts ? "elts" : "linear");
+   }
+   else {
+      util_snprintf(func_name, size, "draw_llvm_vs_variant%u_%s",
+                    variant->shader->variants_cached,
+                    elts ? "elts" : "linear");
+   }
+}
 
-   variant = MALLOC(sizeof *variant +
-                    shader->variant_key_size -
-                    sizeof variant->key);
-   if (variant == NULL)
-      return NULL;
 
-   variant->llvm = llvm;
-   variant->shader = shader;
+/**
+ * Look the vertex shader variant up in the gallivm cache, and if found get
+ * its functions from there.
+ */
+static boolean
+draw_llvm_load_cached_variant(struct draw_llvm *llvm,
+                              struct draw_llvm_variant *variant,
+                              unsigned num_inputs)
+{
+   struct gallivm_state *gallivm = variant->gallivm;
+   struct llvm_vertex_shader *shader = variant->shader;
+   const struct tgsi_token *tokens = shader->base.state.tokens;
+   char func_name[64];
+
+   gallivm_cache_key_add(gallivm, tokens,
+                         tgsi_num_tokens(tokens) * sizeof(struct tgsi_token));
+   gallivm_cache_key_add(gallivm, &variant->key, shader->variant_key_size);
+   gallivm_cache_key_add(gallivm, &num_inputs, sizeof num_inputs);
+   /* the fetch code is generated for all the bound vertex elements */
+   gallivm_cache_key_add(gallivm, llvm->draw->pt.vertex_element,
+                         llvm->draw->pt.nr_vertex_elements *
+                         sizeof(struct pipe_vertex_element));
+
+   if (!gallivm_cache_lookup(gallivm))
+      return FALSE;
+
+   /* No IR, this just loads the cached object code */
+   gallivm_compile_module(gallivm);
+
+   get_vs_func_name(variant, FALSE, func_name, sizeof func_name);
+   variant->jit_func = (draw_jit_vert_func)
+         gallivm_cache_jit_function(gallivm, func_name);
+
+   get_vs_func_name(variant, TRUE, func_name, sizeof func_name);
+   variant->jit_func_elts = (draw_jit_vert_func_elts)
+         gallivm_cache_jit_function(gallivm, func_name);
+
+   return variant->jit_func && variant->jit_func_elts;
+}
+
+
+/**
+ * Build the code of a vertex shader variant at the given optimization level,
+ * from the cache if possible.
+ * \return FALSE if out of memory or the code could not be generated.
+ */
+static boolean
+compile_variant(struct draw_llvm *llvm,
+                struct draw_llvm_variant *variant,
+                enum gallivm_opt_level opt_level)
+{
+   LLVMTypeRef vertex_header;
+   char module_name[64];
 
    util_snprintf(module_name, sizeof(module_name), "draw_llvm_vs_variant%u",
                  variant->shader->variants_cached);
 
    variant->gallivm = gallivm_create(module_name, llvm->context);
+   if (!variant->gallivm)
+      return FALSE;
 
-   create_jit_types(variant);
+   variant->gallivm->opt_level = opt_level;
+   variant->opt_level = opt_level;
 
-   memcpy(&variant->key, key, shader->variant_key_size);
+   if (draw_llvm_load_cached_variant(llvm, variant, variant->num_inputs)) {
+      gallivm_free_ir(variant->gallivm);
+      return TRUE;
+   }
 
-   vertex_header = create_jit_vertex_header(variant->gallivm, num_inputs);
+   if (gallivm_cache_active(variant->gallivm) &&
+       variant->gallivm->compiled) {
+      /* Bad cache entry, generate the code from scratch */
+      gallivm_destroy(variant->gallivm);
+      variant->gallivm = gallivm_create(module_name, llvm->context);
+      if (!variant->gallivm)
+         return FALSE;
+      variant->gallivm->opt_level = opt_level;
+   }
+
+   create_jit_types(variant);
+
+   vertex_header = create_jit_vertex_header(variant->gallivm,
+                                            variant->num_inputs);
 
    variant->vertex_header_ptr_type = LLVMPointerType(vertex_header, 0);
 
@@ -579,6 +657,39 @@ draw_llvm_create_variant(struct draw_llvm *llvm,
 
    gallivm_free_ir(variant->gallivm);
 
+   return variant->jit_func && variant->jit_func_elts;
+}
+
+
+/**
+ * Create LLVM-generated code for a vertex shader.
+ */
+struct draw_llvm_variant *
+draw_llvm_create_variant(struct draw_llvm *llvm,
+                         unsigned num_inputs,
+                         const struct draw_llvm_variant_key *key)
+{
+   struct draw_llvm_variant *variant;
+   struct llvm_vertex_shader *shader =
+      llvm_vertex_shader(llvm->draw->vs.vertex_shader);
+
+   variant = MALLOC(sizeof *variant +
+                    shader->variant_key_size -
+                    sizeof variant->key);
+   if (variant == NULL)
+      return NULL;
+
+   variant->llvm = llvm;
+   variant->shader = shader;
+   variant->num_inputs = num_inputs;
+   variant->nr_invocations = 0;
+
+   memcpy(&variant->key, key, shader->variant_key_size);
+
+   /* With tiering, only variants which turn out to be hot get optimized */
+   compile_variant(llvm, variant,
+                   llvm->tiered ? GALLIVM_OPT_FAST : GALLIVM_OPT_DEFAULT);
+
    variant->list_item_global.base = variant;
    variant->list_item_local.base = variant;
    /*variant->no = */shader->variants_created++;
@@ -588,6 +699,42 @@ draw_llvm_create_variant(struct draw_llvm *llvm,
 }
 
 
+/**
+ * Rebuild a hot vertex shader variant with full optimization.
+ *
+ * The code is generated from the current draw state, so this must only be
+ * called while the variant is the one matching that state, i.e. between
+ * the middle end's prepare and the end of the draw.  The old code is kept
+ * if the new one can't be built.
+ */
+void
+draw_llvm_optimize_variant(struct draw_llvm_variant *variant)
+{
+   struct draw_llvm *llvm = variant->llvm;
+   struct gallivm_state *old_gallivm = variant->gallivm;
+   draw_jit_vert_func old_jit_func = variant->jit_func;
+   draw_jit_vert_func_elts old_jit_func_elts = variant->jit_func_elts;
+
+   if (variant->opt_level != GALLIVM_OPT_FAST)
+      return;
+
+   if (compile_variant(llvm, variant, GALLIVM_OPT_DEFAULT)) {
+      gallivm_destroy(old_gallivm);
+   }
+   else {
+      if (variant->gallivm)
+         gallivm_destroy(variant->gallivm);
+      variant->gallivm = old_gallivm;
+      variant->jit_func = old_jit_func;
+      variant->jit_func_elts = old_jit_func_elts;
+   }
+
+   /* Don't try again either way */
+   variant->opt_level = GALLIVM_OPT_DEFAULT;
+   llvm->nr_hot_recompiles++;
+}
+
+
 static void
 generate_vs(struct draw_llvm_variant *variant,
             LLVMBuilderRef builder,
@@ -1539,8 +1686,7 @@ draw_llvm_generate(struct draw_llvm *llvm, struct draw_llvm_variant *variant,
 
    memset(&system_values, 0, sizeof(system_values));
 
-   util_snprintf(func_name, sizeof(func_name), "draw_llvm_vs_variant%u_%s",
-                 variant->shader->variants_cached, elts ? "elts" : "linear");
+   get_vs_func_name(variant, elts, func_name, sizeof func_name);
 
    i = 0;
    arg_types[i++] = get_context_ptr_type(variant);       /* context */
@@ -1999,6 +2145,8 @@ draw_llvm_destroy_variant(struct draw_llvm_variant *variant)
 
    gallivm_destroy(variant->gallivm);
 
+   cso_hash_erase_data(variant->shader->variants_hash, variant->key_hash,
+                       variant);
    remove_from_list(&variant->list_item_local);
    variant->shader->variants_cached--;
    remove_from_list(&variant->list_item_global);
@@ -2059,6 +2207,55 @@ generate_mask_value(struct draw_gs_llvm_variant *variant,
    return mask_val;
 }
 
+/**
+ * Name of the geometry shader function, see get_vs_func_name().
+ */
+static void
+get_gs_func_name(const struct draw_gs_llvm_variant *variant,
+                 char *func_name, size_t size)
+{
+   if (gallivm_cache_active(variant->gallivm)) {
+      util_snprintf(func_name, size, "draw_llvm_gs");
+   }
+   else {
+      util_snprintf(func_name, size, "draw_llvm_gs_variant%u",
+                    variant->shader->variants_cached);
+   }
+}
+
+
+/**
+ * Look the geometry shader variant up in the gallivm cache, and if found get
+ * its function from there.
+ */
+static boolean
+draw_gs_llvm_load_cached_variant(struct draw_gs_llvm_variant *variant,
+                                 unsigned num_outputs)
+{
+   struct gallivm_state *gallivm = variant->gallivm;
+   struct llvm_geometry_shader *shader = variant->shader;
+   const struct tgsi_token *tokens = shader->base.state.tokens;
+   char func_name[64];
+
+   gallivm_cache_key_add(gallivm, tokens,
+                         tgsi_num_tokens(tokens) * sizeof(struct tgsi_token));
+   gallivm_cache_key_add(gallivm, &variant->key, shader->variant_key_size);
+   gallivm_cache_key_add(gallivm, &num_outputs, sizeof num_outputs);
+
+   if (!gallivm_cache_lookup(gallivm))
+      return FALSE;
+
+   /* No IR, this just loads the cached object code */
+   gallivm_compile_module(gallivm);
+
+   get_gs_func_name(variant, func_name, sizeof func_name);
+   variant->jit_func = (draw_gs_jit_func)
+         gallivm_cache_jit_function(gallivm, func_name);
+
+   return variant->jit_func != NULL;
+}
+
+
 static void
 draw_gs_llvm_generate(struct draw_llvm *llvm,
                       struct draw_gs_llvm_variant *variant)
@@ -2090,8 +2287,7 @@ draw_gs_llvm_generate(struct draw_llvm *llvm,
 
    memset(&system_values, 0, sizeof(system_values));
 
-   util_snprintf(func_name, sizeof(func_name), "draw_llvm_gs_variant%u",
-                 variant->shader->variants_cached);
+   get_gs_func_name(variant, func_name, sizeof func_name);
 
    assert(variant->vertex_header_ptr_type);
 
@@ -2226,22 +2422,34 @@ draw_gs_llvm_create_variant(struct draw_llvm *llvm,
 
    variant->gallivm = gallivm_create(module_name, llvm->context);
 
-   create_gs_jit_types(variant);
-
    memcpy(&variant->key, key, shader->variant_key_size);
 
-   vertex_header = create_jit_vertex_header(variant->gallivm, num_outputs);
+   if (draw_gs_llvm_load_cached_variant(variant, num_outputs)) {
+      gallivm_free_ir(variant->gallivm);
+   }
+   else {
+      if (gallivm_cache_active(variant->gallivm) &&
+          variant->gallivm->compiled) {
+         /* Bad cache entry, generate the code from scratch */
+         gallivm_destroy(variant->gallivm);
+         variant->gallivm = gallivm_create(module_name, llvm->context);
+      }
 
-   variant->vertex_header_ptr_type = LLVMPointerType(vertex_header, 0);
+      create_gs_jit_types(variant);
 
-   draw_gs_llvm_generate(llvm, variant);
+      vertex_header = create_jit_vertex_header(variant->gallivm, num_outputs);
 
-   gallivm_compile_module(variant->gallivm);
+      variant->vertex_header_ptr_type = LLVMPointerType(vertex_header, 0);
 
-   variant->jit_func = (draw_gs_jit_func)
-         gallivm_jit_function(variant->gallivm, variant->function);
+      draw_gs_llvm_generate(llvm, variant);
 
-   gallivm_free_ir(variant->gallivm);
+      gallivm_compile_module(variant->gallivm);
+
+      variant->jit_func = (draw_gs_jit_func)
+            gallivm_jit_function(variant->gallivm, variant->function);
+
+      gallivm_free_ir(variant->gallivm);
+   }
 
    variant->list_item_global.base = variant;
    variant->list_item_local.base = variant;
@@ -2258,6 +2466,8 @@ draw_gs_llvm_destroy_variant(struct draw_gs_llvm_variant *variant)
 
    gallivm_destroy(variant->gallivm);
 
+   cso_hash_erase_data(variant->shader->variants_hash, variant->key_hash,
+                       variant);
    remove_from_list(&variant->list_item_local);
    variant->shader->variants_cached--;
    remove_from_list(&variant->list_item_global);
@@ -33,10 +33,12 @@
 #include "draw/draw_vs.h"
 #include "draw/draw_gs.h"
 
+#include "gallivm/lp_bld_init.h"
 #include "gallivm/lp_bld_sample.h"
 #include "gallivm/lp_bld_limits.h"
 
 #include "pipe/p_context.h"
+#include "cso_cache/cso_hash.h"
 #include "util/simple_list.h"
 
 
@@ -409,6 +411,13 @@ struct draw_llvm_variant
    struct draw_llvm_variant_list_item list_item_global;
    struct draw_llvm_variant_list_item list_item_local;
 
+   unsigned key_hash;
+   unsigned num_inputs;
+   enum gallivm_opt_level opt_level;
+
+   /** Number of vertices shaded, for tiered compilation */
+   unsigned nr_invocations;
+
    /* key is variable-sized, must be last */
    struct draw_llvm_variant_key key;
 };
@@ -435,6 +444,8 @@ struct draw_gs_llvm_variant
    struct draw_gs_llvm_variant_list_item list_item_global;
    struct draw_gs_llvm_variant_list_item list_item_local;
 
+   unsigned key_hash;
+
    /* key is variable-sized, must be last */
    struct draw_gs_llvm_variant_key key;
 };
@@ -444,8 +455,10 @@ struct llvm_vertex_shader {
 
    unsigned variant_key_size;
    struct draw_llvm_variant_list_item variants;
+   struct cso_hash *variants_hash;   /**< the variants again, by key_hash */
    unsigned variants_created;
    unsigned variants_cached;
+   unsigned variants_evicted;
 };
 
 struct llvm_geometry_shader {
@@ -453,6 +466,7 @@ struct llvm_geometry_shader {
 
    unsigned variant_key_size;
    struct draw_gs_llvm_variant_list_item variants;
+   struct cso_hash *variants_hash;   /**< the variants again, by key_hash */
    unsigned variants_created;
    unsigned variants_cached;
 };
@@ -472,6 +486,10 @@ struct draw_llvm {
 
    struct draw_gs_llvm_variant_list_item gs_variants_list;
    int nr_gs_variants;
+
+   /** Build vertex shader variants quickly first, see DRAW_TIERED_JIT */
+   boolean tiered;
+   uint64_t nr_hot_recompiles;
 };
 
 
@@ -501,6 +519,9 @@ draw_llvm_create_variant(struct draw_llvm *llvm,
                          unsigned num_vertex_header_attribs,
                          const struct draw_llvm_variant_key *key);
 
+void
+draw_llvm_optimize_variant(struct draw_llvm_variant *variant);
+
 void
 draw_llvm_destroy_variant(struct draw_llvm_variant *variant);
 
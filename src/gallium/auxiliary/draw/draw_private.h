@@ -104,6 +104,9 @@ struct vertex_header {
 /* maximum number of shader variants we can cache */
 #define DRAW_MAX_SHADER_VARIANTS 128
 
+/* vertices shaded before a variant is optimized, with DRAW_TIERED_JIT */
+#define DRAW_HOT_VARIANT_VERTICES (64 * 1024)
+
 /**
  * Private context for the drawing module.
  */
@@ -159,6 +162,9 @@ struct draw_context
 
       boolean rebind_parameters;
 
+      /** Incremented for every draw_pt_arrays() call */
+      unsigned draw_serial;
+
       struct {
          struct draw_pt_middle_end *fetch_emit;
          struct draw_pt_middle_end *fetch_shade_emit;
@@ -146,6 +146,7 @@ draw_pt_arrays(struct draw_context *draw,
       draw->pt.rebind_parameters = FALSE;
    }
 
+   draw->pt.draw_serial++;
    frontend->run( frontend, start, count );
 
    return TRUE;
@@ -25,9 +25,11 @@
  *
  **************************************************************************/
 
+#include "util/u_hash.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/u_prim.h"
+#include "util/u_queue.h"
 #include "draw/draw_context.h"
 #include "draw/draw_gs.h"
 #include "draw/draw_vbuf.h"
@@ -39,6 +41,60 @@
 #include "gallivm/lp_bld_init.h"
 
 
+/** Maximum number of threads shading vertices besides the calling thread */
+#define LLVM_MAX_VS_THREADS 8
+
+/** Fewest vertices worth handing to another thread */
+#define LLVM_VS_JOB_MIN_VERTICES 128
+
+
+/** Ways of the post-transform vertex cache */
+#define LLVM_VERTEX_CACHE_WAYS 4
+
+DEBUG_GET_ONCE_BOOL_OPTION(draw_vertex_cache_stats, "DRAW_VERTEX_CACHE_STATS", FALSE)
+
+
+struct llvm_middle_end;
+
+/**
+ * Vertex fetch and shading of a slice of the vertices of a draw.
+ */
+struct llvm_vs_job {
+   struct util_queue_job base;
+   struct llvm_middle_end *fpme;
+   const struct draw_fetch_info *fetch_info;
+   struct vertex_header *verts;  /**< output of the whole draw */
+   unsigned start;               /**< first vertex of the slice */
+   unsigned count;
+   unsigned clipped;             /**< result */
+};
+
+
+/**
+ * Set-associative cache of shaded vertices, indexed by vertex element.
+ *
+ * vsplit only shares vertices within a segment, so meshes with poor index
+ * locality shade many vertices over and over.  This keeps the shader
+ * outputs for the whole draw instead.
+ */
+struct llvm_vertex_cache {
+   unsigned num_sets;      /**< 0 if the cache is disabled */
+   unsigned vertex_size;   /**< size of the entries */
+   unsigned draw_serial;   /**< draw the entries belong to */
+   unsigned *tags;         /**< element of each entry, ~0 if unused */
+   ubyte *next_way;        /**< round robin replacement, per set */
+   ubyte *data;
+
+   /** Scratch space for the misses of a segment, grown as needed */
+   unsigned miss_capacity;
+   unsigned *miss_elts;    /**< elements missed */
+   unsigned *miss_slots;   /**< where they go in the segment */
+   ubyte *miss_verts;      /**< their shaded vertices */
+
+   uint64_t hits, misses;
+};
+
+
 struct llvm_middle_end {
    struct draw_pt_middle_end base;
    struct draw_context *draw;
@@ -56,6 +112,13 @@ struct llvm_middle_end {
 
    struct draw_llvm *llvm;
    struct draw_llvm_variant *current_variant;
+
+   /** Worker threads sharing the vertex shading of big draws */
+   unsigned num_vs_threads;
+   struct util_queue vs_queue;
+   struct llvm_vs_job vs_jobs[LLVM_MAX_VS_THREADS];
+
+   struct llvm_vertex_cache vertex_cache;
 };
 
 
@@ -73,23 +136,19 @@ llvm_middle_end_prepare_gs(struct llvm_middle_end *fpme)
    struct draw_context *draw = fpme->draw;
    struct draw_geometry_shader *gs = draw->gs.geometry_shader;
    struct draw_gs_llvm_variant_key *key;
-   struct draw_gs_llvm_variant *variant = NULL;
-   struct draw_gs_llvm_variant_list_item *li;
+   struct draw_gs_llvm_variant *variant;
    struct llvm_geometry_shader *shader = llvm_geometry_shader(gs);
    char store[DRAW_GS_LLVM_MAX_VARIANT_KEY_SIZE];
+   unsigned key_hash;
    unsigned i;
 
    key = draw_gs_llvm_make_variant_key(fpme->llvm, store);
+   key_hash = util_hash_crc32(key, shader->variant_key_size);
 
-   /* Search shader's list of variants for the key */
-   li = first_elem(&shader->variants);
-   while (!at_end(&shader->variants, li)) {
-      if (memcmp(&li->base->key, key, shader->variant_key_size) == 0) {
-         variant = li->base;
-         break;
-      }
-      li = next_elem(li);
-   }
+   /* Search shader's variants for the key */
+   variant = cso_hash_find_data_from_key(shader->variants_hash, key_hash, key,
+                                         offsetof(struct draw_gs_llvm_variant, key),
+                                         shader->variant_key_size);
 
    if (variant) {
       /* found the variant, move to head of global list (for LRU) */
@@ -121,6 +180,8 @@ llvm_middle_end_prepare_gs(struct llvm_middle_end *fpme)
       variant = draw_gs_llvm_create_variant(fpme->llvm, gs->info.num_outputs, key);
 
       if (variant) {
+         variant->key_hash = key_hash;
+         cso_hash_insert(shader->variants_hash, key_hash, variant);
          insert_at_head(&shader->variants, &variant->list_item_local);
          insert_at_head(&fpme->llvm->gs_variants_list,
                         &variant->list_item_global);
@@ -132,6 +193,131 @@ llvm_middle_end_prepare_gs(struct llvm_middle_end *fpme)
    gs->current_variant = variant;
 }
 
+static void
+llvm_vertex_cache_invalidate(struct llvm_vertex_cache *cache)
+{
+   memset(cache->tags, 0xff,
+          cache->num_sets * LLVM_VERTEX_CACHE_WAYS * sizeof *cache->tags);
+}
+
+
+static void
+llvm_vertex_cache_free_scratch(struct llvm_vertex_cache *cache)
+{
+   FREE(cache->miss_elts);
+   FREE(cache->miss_verts);
+   cache->miss_elts = NULL;
+   cache->miss_slots = NULL;
+   cache->miss_verts = NULL;
+   cache->miss_capacity = 0;
+}
+
+
+/**
+ * Make the scratch space hold the misses of a count element segment.  It
+ * is only reallocated for a bigger segment or a new vertex size, so in
+ * practice once per middle end.
+ */
+static boolean
+llvm_vertex_cache_reserve(struct llvm_vertex_cache *cache,
+                          unsigned count)
+{
+   /* The shader writes whole vectors of vertices */
+   const unsigned capacity = align(count, lp_native_vector_width / 32);
+
+   if (capacity <= cache->miss_capacity)
+      return TRUE;
+
+   llvm_vertex_cache_free_scratch(cache);
+
+   cache->miss_elts = MALLOC(capacity * 2 * sizeof(unsigned));
+   cache->miss_verts = MALLOC(capacity * cache->vertex_size);
+   if (!cache->miss_elts || !cache->miss_verts) {
+      llvm_vertex_cache_free_scratch(cache);
+      return FALSE;
+   }
+
+   cache->miss_slots = cache->miss_elts + capacity;
+   cache->miss_capacity = capacity;
+   return TRUE;
+}
+
+
+/**
+ * Make the entries vertex_size big.  The cache gets disabled if that fails.
+ */
+static void
+llvm_vertex_cache_resize(struct llvm_vertex_cache *cache,
+                         unsigned vertex_size)
+{
+   unsigned num_entries = cache->num_sets * LLVM_VERTEX_CACHE_WAYS;
+
+   if (cache->vertex_size != vertex_size) {
+      llvm_vertex_cache_free_scratch(cache);
+      FREE(cache->data);
+      cache->data = MALLOC(num_entries * vertex_size);
+      if (!cache->data) {
+         FREE(cache->tags);
+         FREE(cache->next_way);
+         cache->tags = NULL;
+         cache->next_way = NULL;
+         cache->num_sets = 0;
+         return;
+      }
+      cache->vertex_size = vertex_size;
+   }
+
+   /* The shader or its state may have changed */
+   llvm_vertex_cache_invalidate(cache);
+}
+
+
+static void
+llvm_vertex_cache_init(struct llvm_vertex_cache *cache,
+                       unsigned num_entries)
+{
+   memset(cache, 0, sizeof *cache);
+
+   if (num_entries < LLVM_VERTEX_CACHE_WAYS)
+      return;
+
+   cache->num_sets = util_next_power_of_two(num_entries) /
+                     LLVM_VERTEX_CACHE_WAYS;
+   cache->tags = MALLOC(cache->num_sets * LLVM_VERTEX_CACHE_WAYS *
+                        sizeof *cache->tags);
+   cache->next_way = CALLOC(cache->num_sets, sizeof *cache->next_way);
+   if (!cache->tags || !cache->next_way) {
+      FREE(cache->tags);
+      FREE(cache->next_way);
+      cache->tags = NULL;
+      cache->next_way = NULL;
+      cache->num_sets = 0;
+      return;
+   }
+
+   llvm_vertex_cache_invalidate(cache);
+}
+
+
+static void
+llvm_vertex_cache_destroy(struct llvm_vertex_cache *cache)
+{
+   if (debug_get_option_draw_vertex_cache_stats() &&
+       cache->num_sets && (cache->hits || cache->misses)) {
+      debug_printf("draw: vertex cache: %llu hits, %llu misses (%.1f%% hits)\n",
+                   (unsigned long long) cache->hits,
+                   (unsigned long long) cache->misses,
+                   100.0 * cache->hits / (cache->hits + cache->misses));
+   }
+
+   llvm_vertex_cache_free_scratch(cache);
+   FREE(cache->tags);
+   FREE(cache->next_way);
+   FREE(cache->data);
+   memset(cache, 0, sizeof *cache);
+}
+
+
 /**
  * Prepare/validate middle part of the vertex pipeline.
  * NOTE: if you change this function, also look at the non-LLVM
@@ -191,29 +377,29 @@ llvm_middle_end_prepare( struct draw_pt_middle_end *middle,
     */
    fpme->vertex_size = sizeof(struct vertex_header) + nr * 4 * sizeof(float);
 
+   if (fpme->vertex_cache.num_sets)
+      llvm_vertex_cache_resize(&fpme->vertex_cache, fpme->vertex_size);
+
    /* return even number */
    *max_vertices = *max_vertices & ~1;
 
    /* Find/create the vertex shader variant */
    {
       struct draw_llvm_variant_key *key;
-      struct draw_llvm_variant *variant = NULL;
-      struct draw_llvm_variant_list_item *li;
+      struct draw_llvm_variant *variant;
       struct llvm_vertex_shader *shader = llvm_vertex_shader(vs);
       char store[DRAW_LLVM_MAX_VARIANT_KEY_SIZE];
+      unsigned key_hash;
       unsigned i;
 
       key = draw_llvm_make_variant_key(fpme->llvm, store);
+      key_hash = util_hash_crc32(key, shader->variant_key_size);
 
-      /* Search shader's list of variants for the key */
-      li = first_elem(&shader->variants);
-      while (!at_end(&shader->variants, li)) {
-         if (memcmp(&li->base->key, key, shader->variant_key_size) == 0) {
-            variant = li->base;
-            break;
-         }
-         li = next_elem(li);
-      }
+      /* Search shader's variants for the key */
+      variant = cso_hash_find_data_from_key(shader->variants_hash, key_hash,
+                                            key,
+                                            offsetof(struct draw_llvm_variant, key),
+                                            shader->variant_key_size);
 
       if (variant) {
          /* found the variant, move to head of global list (for LRU) */
@@ -238,6 +424,7 @@ llvm_middle_end_prepare( struct draw_pt_middle_end *middle,
                item = last_elem(&fpme->llvm->vs_variants_list);
                assert(item);
                assert(item->base);
+               item->base->shader->variants_evicted++;
                draw_llvm_destroy_variant(item->base);
             }
          }
@@ -245,6 +432,8 @@ llvm_middle_end_prepare( struct draw_pt_middle_end *middle,
          variant = draw_llvm_create_variant(fpme->llvm, nr, key);
 
          if (variant) {
+            variant->key_hash = key_hash;
+            cso_hash_insert(shader->variants_hash, key_hash, variant);
             insert_at_head(&shader->variants, &variant->list_item_local);
             insert_at_head(&fpme->llvm->vs_variants_list,
                            &variant->list_item_global);
@@ -328,6 +517,204 @@ emit(struct pt_emit *emit,
 }
 
 
+/**
+ * Fetch and shade vertices [start, start + count) of the draw, writing them
+ * to the same place in verts as shading all vertices at once would.
+ * \return clipped flag
+ */
+static unsigned
+llvm_middle_end_shade(struct llvm_middle_end *fpme,
+                      const struct draw_fetch_info *fetch_info,
+                      struct vertex_header *verts,
+                      unsigned start, unsigned count)
+{
+   struct draw_context *draw = fpme->draw;
+   struct vertex_header *out = (struct vertex_header *)
+      ((char *) verts + start * fpme->vertex_size);
+
+   if (fetch_info->linear)
+      return fpme->current_variant->jit_func( &fpme->llvm->jit_context,
+                                       out,
+                                       draw->pt.user.vbuffer,
+                                       fetch_info->start + start,
+                                       count,
+                                       fpme->vertex_size,
+                                       draw->pt.vertex_buffer,
+                                       draw->instance_id,
+                                       draw->start_index,
+                                       draw->start_instance);
+   else
+      return fpme->current_variant->jit_func_elts( &fpme->llvm->jit_context,
+                                            out,
+                                            draw->pt.user.vbuffer,
+                                            fetch_info->elts + start,
+                                            draw->pt.user.eltMax,
+                                            count,
+                                            fpme->vertex_size,
+                                            draw->pt.vertex_buffer,
+                                            draw->instance_id,
+                                            draw->pt.user.eltBias,
+                                            draw->start_instance);
+}
+
+
+static void
+llvm_vs_job_execute(struct util_queue_job *_job)
+{
+   struct llvm_vs_job *job = (struct llvm_vs_job *) _job;
+
+   job->clipped = llvm_middle_end_shade(job->fpme, job->fetch_info, job->verts,
+                                        job->start, job->count);
+}
+
+
+/**
+ * Fetch and shade all vertices of the draw.
+ *
+ * Big draws are cut into slices which the worker threads and the calling
+ * thread shade concurrently.  Each slice is written to its place in verts,
+ * so the vertices end up in submission order and primitive assembly, the
+ * pipeline and emit run unchanged once all slices are done.
+ * \return clipped flag
+ */
+static unsigned
+llvm_middle_end_shade_all(struct llvm_middle_end *fpme,
+                          const struct draw_fetch_info *fetch_info,
+                          struct vertex_header *verts)
+{
+   const unsigned vector_length = lp_native_vector_width / 32;
+   unsigned count = fetch_info->count;
+   unsigned num_jobs, slice, i;
+   unsigned clipped;
+
+   num_jobs = MIN2(fpme->num_vs_threads, count / LLVM_VS_JOB_MIN_VERTICES);
+   if (!num_jobs)
+      return llvm_middle_end_shade(fpme, fetch_info, verts, 0, count);
+
+   /* Slices start at a whole vector, so that the padding the shader writes
+    * after the last vertex of a slice doesn't overwrite the next one.
+    */
+   slice = align((count + num_jobs) / (num_jobs + 1), vector_length);
+
+   for (i = 0; i < num_jobs; i++) {
+      struct llvm_vs_job *job = &fpme->vs_jobs[i];
+      unsigned start = (i + 1) * slice;
+
+      if (start >= count)
+         break;
+
+      job->fpme = fpme;
+      job->fetch_info = fetch_info;
+      job->verts = verts;
+      job->start = start;
+      job->count = MIN2(slice, count - start);
+      util_queue_add_job(&fpme->vs_queue, &job->base, llvm_vs_job_execute);
+   }
+   num_jobs = i;
+
+   clipped = llvm_middle_end_shade(fpme, fetch_info, verts, 0,
+                                   MIN2(slice, count));
+
+   for (i = 0; i < num_jobs; i++) {
+      util_queue_wait_job(&fpme->vs_queue, &fpme->vs_jobs[i].base);
+      clipped |= fpme->vs_jobs[i].clipped;
+   }
+
+   return clipped;
+}
+
+
+/**
+ * Fetch and shade the vertices of an indexed segment, taking the ones which
+ * were already shaded earlier in the draw from the vertex cache.
+ * \return clipped flag
+ */
+static unsigned
+llvm_middle_end_shade_cached(struct llvm_middle_end *fpme,
+                             const struct draw_fetch_info *fetch_info,
+                             struct vertex_header *verts)
+{
+   struct llvm_vertex_cache *cache = &fpme->vertex_cache;
+   const unsigned vertex_size = fpme->vertex_size;
+   const unsigned count = fetch_info->count;
+   struct draw_fetch_info miss_info;
+   unsigned *miss_elts, *miss_slots;
+   struct vertex_header *miss_verts;
+   unsigned num_misses = 0;
+   unsigned clipped = 0;
+   unsigned i, way;
+
+   assert(cache->vertex_size == vertex_size);
+
+   if (cache->draw_serial != fpme->draw->pt.draw_serial) {
+      llvm_vertex_cache_invalidate(cache);
+      cache->draw_serial = fpme->draw->pt.draw_serial;
+   }
+
+   if (!llvm_vertex_cache_reserve(cache, count))
+      return llvm_middle_end_shade_all(fpme, fetch_info, verts);
+   miss_elts = cache->miss_elts;
+   miss_slots = cache->miss_slots;
+   miss_verts = (struct vertex_header *) cache->miss_verts;
+
+   for (i = 0; i < count; i++) {
+      const unsigned elt = fetch_info->elts[i];
+      const unsigned set = elt & (cache->num_sets - 1);
+      const unsigned *tags = &cache->tags[set * LLVM_VERTEX_CACHE_WAYS];
+
+      for (way = 0; way < LLVM_VERTEX_CACHE_WAYS; way++) {
+         if (tags[way] == elt && elt != DRAW_MAX_FETCH_IDX)
+            break;
+      }
+
+      if (way < LLVM_VERTEX_CACHE_WAYS) {
+         struct vertex_header *vert = (struct vertex_header *)
+            ((char *) verts + i * vertex_size);
+
+         memcpy(vert,
+                cache->data + (set * LLVM_VERTEX_CACHE_WAYS + way) * vertex_size,
+                vertex_size);
+         if (vert->clipmask)
+            clipped = 1;
+      }
+      else {
+         miss_elts[num_misses] = elt;
+         miss_slots[num_misses] = i;
+         num_misses++;
+      }
+   }
+
+   cache->hits += count - num_misses;
+   cache->misses += num_misses;
+
+   if (!num_misses)
+      return clipped;
+
+   miss_info = *fetch_info;
+   miss_info.elts = miss_elts;
+   miss_info.count = num_misses;
+   clipped |= llvm_middle_end_shade_all(fpme, &miss_info, miss_verts);
+
+   for (i = 0; i < num_misses; i++) {
+      const unsigned elt = miss_elts[i];
+      const unsigned set = elt & (cache->num_sets - 1);
+      const char *vert = (const char *) miss_verts + i * vertex_size;
+
+      memcpy((char *) verts + miss_slots[i] * vertex_size, vert, vertex_size);
+
+      if (elt != DRAW_MAX_FETCH_IDX) {
+         way = cache->next_way[set];
+         cache->next_way[set] = (way + 1) % LLVM_VERTEX_CACHE_WAYS;
+         cache->tags[set * LLVM_VERTEX_CACHE_WAYS + way] = elt;
+         memcpy(cache->data + (set * LLVM_VERTEX_CACHE_WAYS + way) * vertex_size,
+                vert, vertex_size);
+      }
+   }
+
+   return clipped;
+}
+
+
 static void
 llvm_pipeline_generic(struct draw_pt_middle_end *middle,
                       const struct draw_fetch_info *fetch_info,
@@ -365,29 +752,19 @@ llvm_pipeline_generic(struct draw_pt_middle_end *middle,
       draw->statistics.vs_invocations += fetch_info->count;
    }
 
-   if (fetch_info->linear)
-      clipped = fpme->current_variant->jit_func( &fpme->llvm->jit_context,
-                                       llvm_vert_info.verts,
-                                       draw->pt.user.vbuffer,
-                                       fetch_info->start,
-                                       fetch_info->count,
-                                       fpme->vertex_size,
-                                       draw->pt.vertex_buffer,
-                                       draw->instance_id,
-                                       draw->start_index,
-                                       draw->start_instance);
+   if (fpme->current_variant->opt_level == GALLIVM_OPT_FAST &&
+       fpme->current_variant->nr_invocations >= DRAW_HOT_VARIANT_VERTICES) {
+      /* The draw state still matches the variant here */
+      draw_llvm_optimize_variant(fpme->current_variant);
+   }
+   fpme->current_variant->nr_invocations += fetch_info->count;
+
+   if (fpme->vertex_cache.num_sets && !fetch_info->linear)
+      clipped = llvm_middle_end_shade_cached(fpme, fetch_info,
+                                             llvm_vert_info.verts);
    else
-      clipped = fpme->current_variant->jit_func_elts( &fpme->llvm->jit_context,
-                                            llvm_vert_info.verts,
-                                            draw->pt.user.vbuffer,
-                                            fetch_info->elts,
-                                            draw->pt.user.eltMax,
-                                            fetch_info->count,
-                                            fpme->vertex_size,
-                                            draw->pt.vertex_buffer,
-                                            draw->instance_id,
-                                            draw->pt.user.eltBias,
-                                            draw->start_instance);
+      clipped = llvm_middle_end_shade_all(fpme, fetch_info,
+                                          llvm_vert_info.verts);
 
    /* Finished with fetch and vs:
     */
@@ -567,6 +944,9 @@ llvm_middle_end_destroy(struct draw_pt_middle_end *middle)
 {
    struct llvm_middle_end *fpme = llvm_middle_end(middle);
 
+   util_queue_destroy(&fpme->vs_queue);
+   llvm_vertex_cache_destroy(&fpme->vertex_cache);
+
    if (fpme->fetch)
       draw_pt_fetch_destroy( fpme->fetch );
 
@@ -627,6 +1007,17 @@ draw_pt_fetch_pipeline_or_emit_llvm(struct draw_context *draw)
 
    fpme->current_variant = NULL;
 
+   fpme->num_vs_threads = debug_get_num_option("DRAW_VS_THREADS", 0);
+   fpme->num_vs_threads = MIN2(fpme->num_vs_threads, LLVM_MAX_VS_THREADS);
+   if (fpme->num_vs_threads &&
+       !util_queue_init(&fpme->vs_queue, fpme->num_vs_threads))
+      fpme->num_vs_threads = 0;
+   if (fpme->num_vs_threads)
+      fpme->num_vs_threads = fpme->vs_queue.num_threads;
+
+   llvm_vertex_cache_init(&fpme->vertex_cache,
+                          debug_get_num_option("DRAW_VERTEX_CACHE", 0));
+
    return &fpme->base;
 
  fail:
@@ -75,6 +75,7 @@ vs_llvm_delete( struct draw_vertex_shader *dvs )
    }
 
    assert(shader->variants_cached == 0);
+   cso_hash_delete(shader->variants_hash);
    FREE((void*) dvs->state.tokens);
    FREE( dvs );
 }
@@ -89,9 +90,16 @@ draw_create_vs_llvm(struct draw_context *draw,
    if (vs == NULL)
       return NULL;
 
+   vs->variants_hash = cso_hash_create();
+   if (!vs->variants_hash) {
+      FREE(vs);
+      return NULL;
+   }
+
    /* we make a private copy of the tokens */
    vs->base.state.tokens = tgsi_dup_tokens(state->tokens);
    if (!vs->base.state.tokens) {
+      cso_hash_delete(vs->variants_hash);
       FREE(vs);
       return NULL;
    }
@@ -0,0 +1,491 @@
+/**************************************************************************
+ *
+ * Copyright 2026 agent
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Persistent on-disk cache of compiled gallivm modules.
+ *
+ * Each module is identified by the SHA-1 of the data the caller feeds with
+ * gallivm_cache_key_add() (typically the TGSI tokens and the variant key),
+ * plus everything else which influences code generation here: optimization
+ * level, LLVM version, CPU features and name, vector width, debug flags and
+ * the build of this library itself.  The entry is the MCJIT object file prefixed by a small
+ * header, stored in $GALLIVM_CACHE_DIR/<sha1>.
+ *
+ * On a hit MCJIT is handed the object file and neither IR generation nor code
+ * generation takes place; functions are then looked up by name, so callers
+ * must give their functions names which do not depend on process state.
+ *
+ * Modules which embed host pointers in the code (see
+ * lp_build_const_int_pointer) are never written to the cache.
+ */
+
+
+#include "pipe/p_config.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_debug.h"
+#include "util/u_memory.h"
+#include "util/u_string.h"
+#include "lp_bld_debug.h"
+#include "lp_bld_init.h"
+#include "lp_bld_misc.h"
+#include "lp_bld_type.h"
+#include "lp_bld_cache.h"
+
+/*
+ * Needs MCJIT (always used as of LLVM 3.6), a SHA-1 implementation, and
+ * POSIX file system functions.
+ */
+#if HAVE_LLVM >= 0x0306 && defined(ENABLE_SHADER_CACHE) && defined(PIPE_OS_UNIX)
+#define GALLIVM_HAVE_CACHE 1
+#else
+#define GALLIVM_HAVE_CACHE 0
+#endif
+
+#if GALLIVM_HAVE_CACHE
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#ifdef HAVE_DLADDR
+#include <dlfcn.h>
+#endif
+
+#include "util/mesa-sha1.h"
+
+
+/* Bump whenever the file format changes */
+#define GALLIVM_CACHE_VERSION 1
+
+#define GALLIVM_CACHE_MAGIC 0x4d564c47 /* "GLVM" */
+
+
+struct gallivm_cache_header
+{
+   uint32_t magic;
+   uint32_t version;
+   uint32_t nr_instrs;
+   uint32_t size;    /**< size of the object file which follows */
+};
+
+
+struct gallivm_cache
+{
+   struct mesa_sha1 *sha1;
+
+   /** Set by gallivm_cache_lookup() */
+   char filename[PATH_MAX];
+   boolean active;
+
+   /** The object file, if found in the cache */
+   void *data;
+   struct gallivm_cache_header header;
+
+   struct lp_object_cache *object_cache;
+};
+
+
+static const char *
+get_cache_dir(void)
+{
+   static boolean first = TRUE;
+   static const char *dir;
+   if (first) {
+      first = FALSE;
+      dir = debug_get_option("GALLIVM_CACHE_DIR", NULL);
+   }
+   return dir;
+}
+
+
+/**
+ * Identify the build of the code generating the IR, as changes to it
+ * invalidate all cache entries.  We use the modification time of the
+ * library we are part of.
+ */
+static void
+add_build_id(struct mesa_sha1 *sha1)
+{
+#ifdef HAVE_DLADDR
+   Dl_info info;
+   struct stat st;
+
+   if (dladdr((void *)gallivm_cache_lookup, &info) &&
+       info.dli_fname &&
+       stat(info.dli_fname, &st) == 0) {
+      _mesa_sha1_update(sha1, &st.st_mtime, sizeof st.st_mtime);
+      return;
+   }
+#endif
+   _mesa_sha1_update(sha1, __DATE__ __TIME__, sizeof __DATE__ __TIME__);
+}
+
+
+/**
+ * Fold in everything besides the caller's data which affects the code we
+ * generate.
+ */
+static void
+add_environment(struct mesa_sha1 *sha1)
+{
+   struct util_cpu_caps caps = util_cpu_caps;
+   unsigned llvm_version = HAVE_LLVM;
+   unsigned version = GALLIVM_CACHE_VERSION;
+   unsigned debug_flags = gallivm_debug;
+   char cpu_name[64];
+
+   /* Not relevant to code generation */
+   caps.nr_cpus = 0;
+
+   memset(cpu_name, 0, sizeof cpu_name);
+   lp_get_host_cpu_name(cpu_name, sizeof cpu_name);
+
+   _mesa_sha1_update(sha1, &version, sizeof version);
+   _mesa_sha1_update(sha1, &llvm_version, sizeof llvm_version);
+#ifdef LLVM_VERSION_PATCH
+   {
+      unsigned llvm_patch = LLVM_VERSION_PATCH;
+      _mesa_sha1_update(sha1, &llvm_patch, sizeof llvm_patch);
+   }
+#endif
+   _mesa_sha1_update(sha1, &caps, sizeof caps);
+   _mesa_sha1_update(sha1, cpu_name, sizeof cpu_name);
+   _mesa_sha1_update(sha1, &lp_native_vector_width,
+                     sizeof lp_native_vector_width);
+   _mesa_sha1_update(sha1, &debug_flags, sizeof debug_flags);
+   add_build_id(sha1);
+}
+
+
+static void *
+read_entry(const char *filename, struct gallivm_cache_header *header)
+{
+   FILE *f;
+   void *data = NULL;
+
+   f = fopen(filename, "rb");
+   if (!f)
+      return NULL;
+
+   if (fread(header, sizeof *header, 1, f) != 1 ||
+       header->magic != GALLIVM_CACHE_MAGIC ||
+       header->version != GALLIVM_CACHE_VERSION ||
+       header->size == 0) {
+      goto out;
+   }
+
+   data = MALLOC(header->size);
+   if (data && fread(data, header->size, 1, f) != 1) {
+      FREE(data);
+      data = NULL;
+   }
+
+out:
+   fclose(f);
+   return data;
+}
+
+
+/**
+ * Write the entry to a temporary file first, and rename it in place, so
+ * that concurrent processes never see partial entries.
+ */
+static void
+write_entry(const char *filename,
+            const struct gallivm_cache_header *header,
+            const void *data)
+{
+   char tmpname[PATH_MAX];
+   FILE *f;
+   boolean ok;
+
+   util_snprintf(tmpname, sizeof tmpname, "%s.%u.tmp",
+                 filename, (unsigned) getpid());
+
+   f = fopen(tmpname, "wb");
+   if (!f)
+      return;
+
+   ok = fwrite(header, sizeof *header, 1, f) == 1 &&
+        fwrite(data, header->size, 1, f) == 1;
+   ok = fclose(f) == 0 && ok;
+
+   if (!ok || rename(tmpname, filename) != 0)
+      unlink(tmpname);
+}
+
+
+/**
+ * Add data identifying the module about to be built to the cache key.
+ */
+void
+gallivm_cache_key_add(struct gallivm_state *gallivm,
+                      const void *data, size_t size)
+{
+   struct gallivm_cache *cache = gallivm->cache;
+
+   if (!cache) {
+      if (!get_cache_dir())
+         return;
+
+      cache = CALLOC_STRUCT(gallivm_cache);
+      if (!cache)
+         return;
+
+      cache->sha1 = _mesa_sha1_init();
+      if (!cache->sha1) {
+         FREE(cache);
+         return;
+      }
+
+      gallivm->cache = cache;
+   }
+
+   assert(!cache->active);
+   if (cache->sha1)
+      _mesa_sha1_update(cache->sha1, data, size);
+}
+
+
+/**
+ * Finish the cache key and look the module up.
+ * \return TRUE if the module was found, in which case the caller should not
+ * build any IR but call gallivm_compile_module() directly and get the
+ * functions with gallivm_cache_jit_function().
+ */
+boolean
+gallivm_cache_lookup(struct gallivm_state *gallivm)
+{
+   struct gallivm_cache *cache = gallivm->cache;
+   const char *dir = get_cache_dir();
+   unsigned char sha1[20];
+   char sha1_str[41];
+
+   if (!cache || !cache->sha1)
+      return FALSE;
+
+   _mesa_sha1_update(cache->sha1, &gallivm->opt_level,
+                     sizeof gallivm->opt_level);
+   add_environment(cache->sha1);
+   _mesa_sha1_final(cache->sha1, sha1);
+   cache->sha1 = NULL;
+   _mesa_sha1_format(sha1_str, sha1);
+
+   if (mkdir(dir, 0755) != 0 && errno != EEXIST)
+      return FALSE;
+
+   util_snprintf(cache->filename, sizeof cache->filename, "%s/%s",
+                 dir, sha1_str);
+   cache->active = TRUE;
+
+   cache->data = read_entry(cache->filename, &cache->header);
+
+   if (gallivm_debug & GALLIVM_DEBUG_PERF) {
+      debug_printf("cache %s for module %s\n",
+                   cache->data ? "hit" : "miss",
+                   lp_get_module_id(gallivm->module));
+   }
+
+   return cache->data != NULL;
+}
+
+
+/**
+ * Whether the module will be looked up in or written to the cache, i.e.,
+ * whether function names must not depend on process state.
+ */
+boolean
+gallivm_cache_active(const struct gallivm_state *gallivm)
+{
+   return gallivm->cache && gallivm->cache->active;
+}
+
+
+/**
+ * Get a function from a module loaded from the cache.
+ */
+func_pointer
+gallivm_cache_jit_function(struct gallivm_state *gallivm,
+                           const char *name)
+{
+   void *code;
+
+   assert(gallivm->compiled);
+   assert(gallivm->engine);
+   assert(gallivm->cache && gallivm->cache->data);
+
+   code = lp_get_function_address(gallivm->engine, name);
+
+   return pointer_to_func(code);
+}
+
+
+/**
+ * Number of IR instructions of a module loaded from the cache.
+ */
+unsigned
+gallivm_cache_nr_instrs(const struct gallivm_state *gallivm)
+{
+   assert(gallivm->cache && gallivm->cache->data);
+   return gallivm->cache->header.nr_instrs;
+}
+
+
+/**
+ * Called by gallivm_compile_module() once the MCJIT engine exists.
+ */
+void
+gallivm_cache_attach(struct gallivm_state *gallivm)
+{
+   struct gallivm_cache *cache = gallivm->cache;
+
+   if (!cache || !cache->active)
+      return;
+
+   cache->object_cache = lp_create_object_cache(cache->data,
+                                                cache->header.size);
+   if (cache->object_cache)
+      lp_set_object_cache(gallivm->engine, cache->object_cache);
+}
+
+
+/**
+ * Called by gallivm_free_ir(), after the functions were JIT'ed but while the
+ * IR is still around, to write the object file MCJIT produced.
+ */
+void
+gallivm_cache_store(struct gallivm_state *gallivm)
+{
+   struct gallivm_cache *cache = gallivm->cache;
+   struct gallivm_cache_header header;
+   const void *obj;
+   size_t size;
+
+   if (!cache || !cache->active || !cache->object_cache ||
+       cache->data || gallivm->uncacheable)
+      return;
+
+   obj = lp_object_cache_get_compiled(cache->object_cache, &size);
+   if (!obj || size > ~(uint32_t)0)
+      return;
+
+   header.magic = GALLIVM_CACHE_MAGIC;
+   header.version = GALLIVM_CACHE_VERSION;
+   header.nr_instrs = lp_build_count_ir_module(gallivm->module);
+   header.size = (uint32_t) size;
+
+   write_entry(cache->filename, &header, obj);
+}
+
+
+/**
+ * Free the cache state.  Must be done after the engine was destroyed.
+ */
+void
+gallivm_cache_destroy(struct gallivm_state *gallivm)
+{
+   struct gallivm_cache *cache = gallivm->cache;
+   unsigned char sha1[20];
+
+   if (!cache)
+      return;
+
+   assert(!gallivm->engine);
+
+   if (cache->sha1)
+      _mesa_sha1_final(cache->sha1, sha1);
+   if (cache->object_cache)
+      lp_free_object_cache(cache->object_cache);
+   FREE(cache->data);
+   FREE(cache);
+   gallivm->cache = NULL;
+}
+
+
+#else /* !GALLIVM_HAVE_CACHE */
+
+
+void
+gallivm_cache_key_add(struct gallivm_state *gallivm,
+                      const void *data, size_t size)
+{
+}
+
+
+boolean
+gallivm_cache_lookup(struct gallivm_state *gallivm)
+{
+   return FALSE;
+}
+
+
+boolean
+gallivm_cache_active(const struct gallivm_state *gallivm)
+{
+   return FALSE;
+}
+
+
+func_pointer
+gallivm_cache_jit_function(struct gallivm_state *gallivm,
+                           const char *name)
+{
+   assert(0);
+   return NULL;
+}
+
+
+unsigned
+gallivm_cache_nr_instrs(const struct gallivm_state *gallivm)
+{
+   assert(0);
+   return 0;
+}
+
+
+void
+gallivm_cache_attach(struct gallivm_state *gallivm)
+{
+}
+
+
+void
+gallivm_cache_store(struct gallivm_state *gallivm)
+{
+}
+
+
+void
+gallivm_cache_destroy(struct gallivm_state *gallivm)
+{
+}
+
+
+#endif /* !GALLIVM_HAVE_CACHE */
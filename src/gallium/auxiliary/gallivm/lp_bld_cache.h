@@ -0,0 +1,92 @@
+/**************************************************************************
+ *
+ * Copyright 2026 agent
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Persistent on-disk cache of compiled gallivm modules.
+ *
+ * Usage:
+ *
+ *    gallivm = gallivm_create(...);
+ *    gallivm_cache_key_add(gallivm, tokens, tokens_size);
+ *    gallivm_cache_key_add(gallivm, key, key_size);
+ *    if (gallivm_cache_lookup(gallivm)) {
+ *       gallivm_compile_module(gallivm);
+ *       func = gallivm_cache_jit_function(gallivm, "name");
+ *    }
+ *    else {
+ *       ... build IR, naming functions deterministically if
+ *       gallivm_cache_active(gallivm) ...
+ *       gallivm_compile_module(gallivm);
+ *       func = gallivm_jit_function(gallivm, value);
+ *    }
+ *    gallivm_free_ir(gallivm);   <-- writes the cache entry on a miss
+ *
+ * The cache is only enabled when the GALLIVM_CACHE_DIR environment variable
+ * is set.
+ */
+
+
+#ifndef LP_BLD_CACHE_H
+#define LP_BLD_CACHE_H
+
+
+#include "pipe/p_compiler.h"
+#include "util/u_pointer.h"
+
+
+struct gallivm_state;
+
+
+void
+gallivm_cache_key_add(struct gallivm_state *gallivm,
+                      const void *data, size_t size);
+
+boolean
+gallivm_cache_lookup(struct gallivm_state *gallivm);
+
+boolean
+gallivm_cache_active(const struct gallivm_state *gallivm);
+
+func_pointer
+gallivm_cache_jit_function(struct gallivm_state *gallivm,
+                           const char *name);
+
+unsigned
+gallivm_cache_nr_instrs(const struct gallivm_state *gallivm);
+
+void
+gallivm_cache_attach(struct gallivm_state *gallivm);
+
+void
+gallivm_cache_store(struct gallivm_state *gallivm);
+
+void
+gallivm_cache_destroy(struct gallivm_state *gallivm);
+
+
+#endif /* !LP_BLD_CACHE_H */
@@ -37,6 +37,7 @@
 #include "lp_bld_debug.h"
 #include "lp_bld_misc.h"
 #include "lp_bld_init.h"
+#include "lp_bld_cache.h"
 
 #include <llvm-c/Analysis.h>
 #include <llvm-c/Transforms/Scalar.h>
@@ -99,8 +100,7 @@ enum LLVM_CodeGenOpt_Level {
 
 
 /**
- * Create the LLVM (optimization) pass manager and install
- * relevant optimization passes.
+ * Create the LLVM (optimization) pass manager.
  * \return  TRUE for success, FALSE for failure
  */
 static boolean
@@ -122,7 +122,26 @@ create_pass_manager(struct gallivm_state *gallivm)
    LLVMSetDataLayout(gallivm->module, td_str);
    free(td_str);
 
-   if ((gallivm_debug & GALLIVM_DEBUG_NO_OPT) == 0) {
+   return TRUE;
+}
+
+
+/**
+ * Install the optimization passes according to the module's optimization
+ * level.  This is deferred until the module is compiled so that the level
+ * can be chosen after creating the gallivm_state.
+ */
+static void
+add_optimization_passes(struct gallivm_state *gallivm)
+{
+   enum gallivm_opt_level opt_level = gallivm->opt_level;
+
+   if (gallivm_debug & GALLIVM_DEBUG_NO_OPT)
+      opt_level = GALLIVM_OPT_NONE;
+
+   switch (opt_level) {
+   case GALLIVM_OPT_DEFAULT:
+   case GALLIVM_OPT_AGGRESSIVE:
       /* These are the passes currently listed in llvm-c/Transforms/Scalar.h,
        * but there are more on SVN.
        * TODO: Add more passes.
@@ -135,15 +154,32 @@ create_pass_manager(struct gallivm_state *gallivm)
       LLVMAddConstantPropagationPass(gallivm->passmgr);
       LLVMAddInstructionCombiningPass(gallivm->passmgr);
       LLVMAddGVNPass(gallivm->passmgr);
-   }
-   else {
+      if (opt_level == GALLIVM_OPT_AGGRESSIVE) {
+         /* Clean up after GVN, which often exposes more dead code and
+          * redundant loads/stores.
+          */
+         LLVMAddDeadStoreEliminationPass(gallivm->passmgr);
+         LLVMAddAggressiveDCEPass(gallivm->passmgr);
+         LLVMAddInstructionCombiningPass(gallivm->passmgr);
+         LLVMAddCFGSimplificationPass(gallivm->passmgr);
+      }
+      break;
+   case GALLIVM_OPT_FAST:
+      /* Only the cheap local cleanups, which still remove most of the
+       * redundancy in the IR we generate.
+       */
+      LLVMAddPromoteMemoryToRegisterPass(gallivm->passmgr);
+      LLVMAddEarlyCSEPass(gallivm->passmgr);
+      LLVMAddCFGSimplificationPass(gallivm->passmgr);
+      break;
+   case GALLIVM_OPT_NONE:
+   default:
       /* We need at least this pass to prevent the backends to fail in
        * unexpected ways.
        */
       LLVMAddPromoteMemoryToRegisterPass(gallivm->passmgr);
+      break;
    }
-
-   return TRUE;
 }
 
 
@@ -159,6 +195,9 @@ gallivm_free_ir(struct gallivm_state *gallivm)
    }
 
    if (gallivm->engine) {
+      /* Persist the generated code while the IR is still around */
+      gallivm_cache_store(gallivm);
+
       /* This will already destroy any associated module */
       LLVMDisposeExecutionEngine(gallivm->engine);
    } else if (gallivm->module) {
@@ -214,7 +253,21 @@ init_gallivm_engine(struct gallivm_state *gallivm)
          optlevel = None;
       }
       else {
-         optlevel = Default;
+         switch (gallivm->opt_level) {
+         case GALLIVM_OPT_NONE:
+            optlevel = None;
+            break;
+         case GALLIVM_OPT_FAST:
+            optlevel = Less;
+            break;
+         case GALLIVM_OPT_AGGRESSIVE:
+            optlevel = Aggressive;
+            break;
+         case GALLIVM_OPT_DEFAULT:
+         default:
+            optlevel = Default;
+            break;
+         }
       }
 
       ret = lp_build_create_jit_compiler_for_module(&gallivm->engine,
@@ -377,12 +430,13 @@ lp_build_init(void)
    /* AMD Bulldozer AVX's throughput is the same as SSE2; and because using
     * 8-wide vector needs more floating ops than 4-wide (due to padding), it is
     * actually more efficient to use 4-wide vectors on this processor.
+    * Later AMD parts with AVX2 don't have this problem.
     *
     * See also:
     * - http://www.anandtech.com/show/4955/the-bulldozer-review-amd-fx8150-tested/2
     */
    if (util_cpu_caps.has_avx &&
-       util_cpu_caps.has_intel) {
+       (util_cpu_caps.has_intel || util_cpu_caps.has_avx2)) {
       lp_native_vector_width = 256;
    } else {
       /* Leave it at 128, even when no SIMD extensions are available.
@@ -404,6 +458,7 @@ lp_build_init(void)
        */
       util_cpu_caps.has_avx = 0;
       util_cpu_caps.has_avx2 = 0;
+      util_cpu_caps.has_avx512f = 0;
    }
 
 #ifdef PIPE_ARCH_PPC_64
@@ -472,6 +527,7 @@ gallivm_destroy(struct gallivm_state *gallivm)
 {
    gallivm_free_ir(gallivm);
    gallivm_free_code(gallivm);
+   gallivm_cache_destroy(gallivm);
    FREE(gallivm);
 }
 
@@ -522,6 +578,7 @@ gallivm_compile_module(struct gallivm_state *gallivm)
       time_begin = os_time_get();
 
    /* Run optimization passes */
+   add_optimization_passes(gallivm);
    LLVMInitializeFunctionPassManager(gallivm->passmgr);
    func = LLVMGetFirstFunction(gallivm->module);
    while (func) {
@@ -552,6 +609,7 @@ gallivm_compile_module(struct gallivm_state *gallivm)
    if (!init_gallivm_engine(gallivm)) {
       assert(0);
    }
+   gallivm_cache_attach(gallivm);
 #endif
    assert(gallivm->engine);
 
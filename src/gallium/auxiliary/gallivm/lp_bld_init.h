@@ -36,6 +36,18 @@
 #include <llvm-c/ExecutionEngine.h>
 
 
+/**
+ * How much effort gallivm_compile_module() puts into optimizing the code.
+ */
+enum gallivm_opt_level
+{
+   GALLIVM_OPT_DEFAULT = 0,   /**< IR optimization passes and -O2 codegen */
+   GALLIVM_OPT_NONE,          /**< quick compile, no optimization at all */
+   GALLIVM_OPT_FAST,          /**< cheap IR cleanups and -O1 codegen */
+   GALLIVM_OPT_AGGRESSIVE     /**< more IR passes and -O3 codegen */
+};
+
+
 struct gallivm_state
 {
    LLVMModuleRef module;
@@ -47,6 +59,9 @@ struct gallivm_state
    LLVMMCJITMemoryManagerRef memorymgr;
    struct lp_generated_code *code;
    unsigned compiled;
+   enum gallivm_opt_level opt_level;
+   struct gallivm_cache *cache;   /**< see lp_bld_cache.c */
+   boolean uncacheable;           /**< code embeds host pointers */
 };
 
 
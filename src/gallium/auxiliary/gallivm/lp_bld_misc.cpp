@@ -60,6 +60,10 @@
 #else
 #include <llvm/ExecutionEngine/SectionMemoryManager.h>
 #endif
+#if HAVE_LLVM >= 0x0306
+#include <llvm/ExecutionEngine/ObjectCache.h>
+#include <llvm/Support/MemoryBuffer.h>
+#endif
 #include <llvm/Support/CommandLine.h>
 #include <llvm/Support/Host.h>
 #include <llvm/Support/PrettyStackTrace.h>
@@ -73,6 +77,8 @@
 #include "pipe/p_config.h"
 #include "util/u_debug.h"
 #include "util/u_cpu_detect.h"
+#include "util/u_memory.h"
+#include "util/u_string.h"
 
 #include "lp_bld_misc.h"
 
@@ -473,6 +479,14 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
       if (util_cpu_caps.has_f16c) {
          MAttrs.push_back("+f16c");
       }
+      if (util_cpu_caps.has_avx2) {
+         MAttrs.push_back("+avx2");
+      }
+#if HAVE_LLVM >= 0x0304
+      if (util_cpu_caps.has_avx512f) {
+         MAttrs.push_back("+avx512f");
+      }
+#endif
       builder.setMAttrs(MAttrs);
    }
 
@@ -559,3 +573,153 @@ lp_free_memory_manager(LLVMMCJITMemoryManagerRef memorymgr)
 {
    delete reinterpret_cast<BaseMemoryManager*>(memorymgr);
 }
+
+
+#if HAVE_LLVM >= 0x0306
+
+/**
+ * Object cache handed to MCJIT.
+ *
+ * It holds at most one object file per module: either one previously
+ * loaded from disk, which makes MCJIT skip code generation, or the one MCJIT
+ * just generated, which the caller can then persist.  The file I/O itself is
+ * done on the C side (see lp_bld_cache.c).
+ */
+struct lp_object_cache : public llvm::ObjectCache {
+   llvm::StringRef Cached;
+   void *Compiled;
+   size_t CompiledSize;
+
+   lp_object_cache(const void *data, size_t size) :
+      Cached((const char *)data, size),
+      Compiled(NULL),
+      CompiledSize(0)
+   {
+   }
+
+   ~lp_object_cache()
+   {
+      FREE(Compiled);
+   }
+
+   virtual void notifyObjectCompiled(const llvm::Module *M,
+                                     llvm::MemoryBufferRef Obj)
+   {
+      store(Obj.getBufferStart(), Obj.getBufferSize());
+   }
+
+   virtual std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module *M)
+   {
+      if (Cached.empty())
+         return nullptr;
+      return llvm::MemoryBuffer::getMemBufferCopy(Cached, M->getModuleIdentifier());
+   }
+
+   void store(const char *data, size_t size)
+   {
+      FREE(Compiled);
+      Compiled = MALLOC(size);
+      CompiledSize = Compiled ? size : 0;
+      if (Compiled)
+         memcpy(Compiled, data, size);
+   }
+};
+
+#endif /* HAVE_LLVM >= 0x0306 */
+
+
+/**
+ * Create an object cache.  If data is not NULL it is the object file which
+ * will be returned to MCJIT instead of generating code; the memory must stay
+ * valid until the cache is destroyed.
+ * Returns NULL if object caching is not supported by this LLVM version.
+ */
+extern "C"
+struct lp_object_cache *
+lp_create_object_cache(const void *data, size_t size)
+{
+#if HAVE_LLVM >= 0x0306
+   return new lp_object_cache(data, size);
+#else
+   return NULL;
+#endif
+}
+
+
+/**
+ * Attach the object cache to an MCJIT engine.  Must be done before any
+ * code is generated.
+ */
+extern "C"
+void
+lp_set_object_cache(LLVMExecutionEngineRef EE, struct lp_object_cache *cache)
+{
+#if HAVE_LLVM >= 0x0306
+   llvm::unwrap(EE)->setObjectCache(cache);
+#endif
+}
+
+
+/**
+ * Get the object file generated by MCJIT, if any.
+ */
+extern "C"
+const void *
+lp_object_cache_get_compiled(struct lp_object_cache *cache, size_t *size)
+{
+#if HAVE_LLVM >= 0x0306
+   *size = cache->CompiledSize;
+   return cache->Compiled;
+#else
+   *size = 0;
+   return NULL;
+#endif
+}
+
+
+extern "C"
+void
+lp_free_object_cache(struct lp_object_cache *cache)
+{
+#if HAVE_LLVM >= 0x0306
+   delete cache;
+#endif
+}
+
+
+/**
+ * Look up a function by name.  Unlike LLVMGetPointerToGlobal this works
+ * for functions whose IR is not available, i.e., which were loaded from an
+ * object file.
+ */
+extern "C"
+void *
+lp_get_function_address(LLVMExecutionEngineRef EE, const char *name)
+{
+#if HAVE_LLVM >= 0x0306
+   llvm::ExecutionEngine *JIT = llvm::unwrap(EE);
+
+   /*
+    * MCJIT only generates (or loads) the object for a module when asked for
+    * one of the module's symbols, which it finds by looking at the IR.  So
+    * make sure the object is loaded first.
+    */
+   JIT->finalizeObject();
+   return (void *)(uintptr_t)JIT->getFunctionAddress(name);
+#else
+   return NULL;
+#endif
+}
+
+
+/**
+ * Name of the host CPU as seen by LLVM, which determines the instructions
+ * the code generator may use (see lp_build_create_jit_compiler_for_module).
+ */
+extern "C"
+void
+lp_get_host_cpu_name(char *buf, size_t size)
+{
+   std::string Name = llvm::sys::getHostCPUName().str();
+   util_snprintf(buf, size, "%s", Name.c_str());
+}
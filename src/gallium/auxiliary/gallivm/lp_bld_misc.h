@@ -40,6 +40,7 @@ extern "C" {
 
 
 struct lp_generated_code;
+struct lp_object_cache;
 
 
 extern void
@@ -68,6 +69,24 @@ lp_get_default_memory_manager();
 extern void
 lp_free_memory_manager(LLVMMCJITMemoryManagerRef memorymgr);
 
+extern struct lp_object_cache *
+lp_create_object_cache(const void *data, size_t size);
+
+extern void
+lp_set_object_cache(LLVMExecutionEngineRef EE, struct lp_object_cache *cache);
+
+extern const void *
+lp_object_cache_get_compiled(struct lp_object_cache *cache, size_t *size);
+
+extern void
+lp_free_object_cache(struct lp_object_cache *cache);
+
+extern void *
+lp_get_function_address(LLVMExecutionEngineRef EE, const char *name);
+
+extern void
+lp_get_host_cpu_name(char *buf, size_t size);
+
 #ifdef __cplusplus
 }
 #endif
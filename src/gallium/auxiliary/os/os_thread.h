@@ -85,6 +85,25 @@ static INLINE int pipe_thread_destroy( pipe_thread thread )
    return thrd_detach( thread );
 }
 
+/**
+ * Restrict the calling thread to run on the given CPU only.
+ * Returns FALSE if not supported on this platform or if it failed.
+ */
+static INLINE boolean pipe_thread_pin_to_cpu( unsigned cpu )
+{
+#if defined(HAVE_PTHREAD) && defined(PIPE_OS_LINUX) && defined(CPU_SET)
+   cpu_set_t set;
+
+   CPU_ZERO(&set);
+   CPU_SET(cpu, &set);
+
+   return pthread_setaffinity_np(pthread_self(), sizeof set, &set) == 0;
+#else
+   (void) cpu;
+   return FALSE;
+#endif
+}
+
 
 /* pipe_mutex
  */
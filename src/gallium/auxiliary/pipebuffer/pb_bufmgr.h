@@ -158,6 +158,7 @@ pb_slab_range_manager_create(struct pb_manager *provider,
  * Time-based buffer cache.
  *
  * This manager keeps a cache of destroyed buffers during a time interval. 
+ * The buffers are kept in buckets by size, see pb_cache_manager_get_stats().
  */
 struct pb_manager *
 pb_cache_manager_create(struct pb_manager *provider, 
@@ -166,6 +167,22 @@ pb_cache_manager_create(struct pb_manager *provider,
                         unsigned bypass_usage,
                         uint64_t maximum_cache_size);
 
+#define PB_CACHE_NUM_BUCKETS 32
+
+struct pb_cache_bucket_stats
+{
+   uint64_t hits;        /**< allocations served from the bucket */
+   uint64_t misses;      /**< allocations of this size served by the provider */
+   uint64_t busy;        /**< searches stopped by a busy buffer */
+   uint64_t expired;     /**< buffers released after the caching interval */
+   unsigned num_buffers; /**< buffers currently in the bucket */
+   uint64_t size;        /**< bytes currently in the bucket */
+};
+
+void
+pb_cache_manager_get_stats(struct pb_manager *mgr,
+                           struct pb_cache_bucket_stats *stats);
+
 
 struct pb_fence_ops;
 
@@ -39,6 +39,7 @@
 #include "os/os_thread.h"
 #include "util/u_memory.h"
 #include "util/u_double_list.h"
+#include "util/u_math.h"
 #include "util/u_time.h"
 
 #include "pb_buffer.h"
@@ -67,10 +68,24 @@ struct pb_cache_buffer
    /** Caching time interval */
    int64_t start, end;
 
+   /** Bucket the buffer is cached in */
+   unsigned bucket;
+
    struct list_head head;
 };
 
 
+/**
+ * Unused buffers whose size has the same most significant bit.  The list is
+ * in LRU order: buffers are added at the tail, so the head expires first.
+ */
+struct pb_cache_bucket
+{
+   struct list_head delayed;
+   struct pb_cache_bucket_stats stats;
+};
+
+
 struct pb_cache_manager
 {
    struct pb_manager base;
@@ -80,11 +95,17 @@ struct pb_cache_manager
    
    pipe_mutex mutex;
    
-   struct list_head delayed;
+   struct pb_cache_bucket buckets[PB_CACHE_NUM_BUCKETS];
+   uint32_t nonempty_buckets;  /**< bitmask */
    pb_size numDelayed;
    float size_factor;
+   /** ceil(log2(size_factor)): how many buckets above the first to search */
+   unsigned bucket_span;
    unsigned bypass_usage;
    uint64_t cache_size, max_cache_size;
+
+   /** When expired buffers will be looked for next */
+   int64_t next_expiry_check;
 };
 
 
@@ -105,47 +126,114 @@ pb_cache_manager(struct pb_manager *mgr)
 
 
 /**
- * Actually destroy the buffer.
+ * Take a buffer off its bucket.  The buffer still needs to be destroyed or
+ * put back with pb_cache_buffer_relink().
  */
 static INLINE void
-_pb_cache_buffer_destroy(struct pb_cache_buffer *buf)
+pb_cache_buffer_unlink(struct pb_cache_buffer *buf)
 {
    struct pb_cache_manager *mgr = buf->mgr;
+   struct pb_cache_bucket *bucket = &mgr->buckets[buf->bucket];
 
    LIST_DEL(&buf->head);
+   if (LIST_IS_EMPTY(&bucket->delayed))
+      mgr->nonempty_buckets &= ~(1u << buf->bucket);
+   assert(bucket->stats.num_buffers);
+   --bucket->stats.num_buffers;
+   bucket->stats.size -= buf->base.size;
    assert(mgr->numDelayed);
    --mgr->numDelayed;
    mgr->cache_size -= buf->base.size;
-   assert(!pipe_is_referenced(&buf->base.reference));
-   pb_reference(&buf->buffer, NULL);
-   FREE(buf);
 }
 
 
 /**
- * Free as many cache buffers from the list head as possible. 
+ * Put a buffer taken by pb_cache_buffer_unlink() back in its bucket, at its
+ * place in LRU order.
+ */
+static INLINE void
+pb_cache_buffer_relink(struct pb_cache_buffer *buf)
+{
+   struct pb_cache_manager *mgr = buf->mgr;
+   struct pb_cache_bucket *bucket = &mgr->buckets[buf->bucket];
+   struct list_head *pos = bucket->delayed.prev;
+
+   while (pos != &bucket->delayed &&
+          LIST_ENTRY(struct pb_cache_buffer, pos, head)->start > buf->start)
+      pos = pos->prev;
+
+   LIST_ADD(&buf->head, pos);
+   mgr->nonempty_buckets |= 1u << buf->bucket;
+   ++bucket->stats.num_buffers;
+   bucket->stats.size += buf->base.size;
+   ++mgr->numDelayed;
+   mgr->cache_size += buf->base.size;
+}
+
+
+/**
+ * Actually destroy the buffers of a list of unlinked buffers.
+ *
+ * This is called without the manager mutex held, so that the provider isn't
+ * serialized by it.
+ */
+static void
+pb_cache_buffer_list_destroy(struct list_head *list)
+{
+   struct pb_cache_buffer *buf, *next;
+
+   LIST_FOR_EACH_ENTRY_SAFE(buf, next, list, head) {
+      assert(!pipe_is_referenced(&buf->base.reference));
+      pb_reference(&buf->buffer, NULL);
+      FREE(buf);
+   }
+}
+
+
+/**
+ * Bucket of a buffer of the given size.
+ */
+static INLINE unsigned
+pb_cache_bucket_index(pb_size size)
+{
+   return size ? util_logbase2(size) : 0;
+}
+
+
+/**
+ * Move the expired cache buffers to the expired list.
+ *
+ * This only looks at the buffers once per quarter of the caching interval,
+ * instead of every time a buffer is released, and only at the heads of the
+ * buckets' LRU lists.
  */
 static void
-_pb_cache_buffer_list_check_free(struct pb_cache_manager *mgr)
+_pb_cache_buffer_list_check_free(struct pb_cache_manager *mgr,
+                                 struct list_head *expired)
 {
-   struct list_head *curr, *next;
-   struct pb_cache_buffer *buf;
+   uint32_t mask = mgr->nonempty_buckets;
    int64_t now;
    
    now = os_time_get();
+   if (now < mgr->next_expiry_check)
+      return;
+   mgr->next_expiry_check = now + mgr->usecs / 4;
    
-   curr = mgr->delayed.next;
-   next = curr->next;
-   while(curr != &mgr->delayed) {
-      buf = LIST_ENTRY(struct pb_cache_buffer, curr, head);
-
-      if(!os_time_timeout(buf->start, buf->end, now))
-	 break;
-	 
-      _pb_cache_buffer_destroy(buf);
-
-      curr = next; 
-      next = curr->next;
+   while (mask) {
+      unsigned i = u_bit_scan(&mask);
+      struct pb_cache_bucket *bucket = &mgr->buckets[i];
+
+      while (!LIST_IS_EMPTY(&bucket->delayed)) {
+         struct pb_cache_buffer *buf =
+            LIST_ENTRY(struct pb_cache_buffer, bucket->delayed.next, head);
+
+         if(!os_time_timeout(buf->start, buf->end, now))
+            break;
+
+         ++bucket->stats.expired;
+         pb_cache_buffer_unlink(buf);
+         LIST_ADDTAIL(&buf->head, expired);
+      }
    }
 }
 
@@ -155,26 +243,35 @@ pb_cache_buffer_destroy(struct pb_buffer *_buf)
 {
    struct pb_cache_buffer *buf = pb_cache_buffer(_buf);   
    struct pb_cache_manager *mgr = buf->mgr;
+   struct list_head expired;
+
+   LIST_INITHEAD(&expired);
 
    pipe_mutex_lock(mgr->mutex);
    assert(!pipe_is_referenced(&buf->base.reference));
    
-   _pb_cache_buffer_list_check_free(mgr);
+   _pb_cache_buffer_list_check_free(mgr, &expired);
 
    /* Directly release any buffer that exceeds the limit. */
    if (mgr->cache_size + buf->base.size > mgr->max_cache_size) {
-      pb_reference(&buf->buffer, NULL);
-      FREE(buf);
       pipe_mutex_unlock(mgr->mutex);
+      LIST_ADDTAIL(&buf->head, &expired);
+      pb_cache_buffer_list_destroy(&expired);
       return;
    }
 
    buf->start = os_time_get();
    buf->end = buf->start + mgr->usecs;
-   LIST_ADDTAIL(&buf->head, &mgr->delayed);
+   buf->bucket = pb_cache_bucket_index(buf->base.size);
+   LIST_ADDTAIL(&buf->head, &mgr->buckets[buf->bucket].delayed);
+   mgr->nonempty_buckets |= 1u << buf->bucket;
+   ++mgr->buckets[buf->bucket].stats.num_buffers;
+   mgr->buckets[buf->bucket].stats.size += buf->base.size;
    ++mgr->numDelayed;
    mgr->cache_size += buf->base.size;
    pipe_mutex_unlock(mgr->mutex);
+
+   pb_cache_buffer_list_destroy(&expired);
 }
 
 
@@ -235,40 +332,120 @@ pb_cache_buffer_vtbl = {
 };
 
 
-static INLINE int
+/**
+ * Whether a cached buffer can be used for an allocation, busy state aside.
+ */
+static INLINE boolean
 pb_cache_is_buffer_compat(struct pb_cache_buffer *buf,  
                           pb_size size,
                           const struct pb_desc *desc)
 {
-   if (desc->usage & buf->mgr->bypass_usage)
-      return 0;
-
    if(buf->base.size < size)
-      return 0;
+      return FALSE;
 
    /* be lenient with size */
-   if(buf->base.size > (unsigned) (buf->mgr->size_factor * size))
-      return 0;
+   if((double) buf->base.size > (double) buf->mgr->size_factor * size)
+      return FALSE;
    
    if(!pb_check_alignment(desc->alignment, buf->base.alignment))
-      return 0;
+      return FALSE;
    
    if(!pb_check_usage(desc->usage, buf->base.usage))
-      return 0;
+      return FALSE;
+
+   return TRUE;
+}
 
-   if (buf->mgr->provider->is_buffer_busy) {
-      if (buf->mgr->provider->is_buffer_busy(buf->mgr->provider, buf->buffer))
-         return -1;
-   } else {
+
+/**
+ * Whether a cached buffer is idle.  The buffer must be unlinked, as this
+ * is called without the manager mutex held.
+ */
+static INLINE boolean
+pb_cache_is_buffer_idle(struct pb_cache_buffer *buf)
+{
+   if (buf->mgr->provider->is_buffer_busy)
+      return !buf->mgr->provider->is_buffer_busy(buf->mgr->provider,
+                                                 buf->buffer);
+   else {
       void *ptr = pb_map(buf->buffer, PB_USAGE_DONTBLOCK, NULL);
 
       if (!ptr)
-         return -1;
+         return FALSE;
 
       pb_unmap(buf->buffer);
+      return TRUE;
+   }
+}
+
+
+/**
+ * Find a cached buffer which is compatible and idle, and take it off the
+ * cache.
+ *
+ * Only the buckets which can hold buffers between size and
+ * size_factor * size are searched.  Within a bucket the oldest buffers are
+ * tried first, and the search of a bucket stops at the first busy buffer,
+ * as the younger ones are most likely busy too.
+ *
+ * The mutex is not held while testing whether a buffer is busy, as that may
+ * be a kernel call: the candidate is unlinked first, and put back if busy.
+ */
+static struct pb_cache_buffer *
+pb_cache_manager_find_buffer(struct pb_cache_manager *mgr,
+                             pb_size size,
+                             const struct pb_desc *desc)
+{
+   unsigned first = pb_cache_bucket_index(size);
+   unsigned last = MIN2(first + mgr->bucket_span, PB_CACHE_NUM_BUCKETS - 1);
+   unsigned next = first;
+
+   pipe_mutex_lock(mgr->mutex);
+
+   for (;;) {
+      struct pb_cache_buffer *buf = NULL;
+      uint32_t mask;
+
+      mask = mgr->nonempty_buckets >> next;
+      mask &= last - next < 31 ? (2u << (last - next)) - 1 : ~0u;
+
+      while (mask && !buf) {
+         unsigned i = next + u_bit_scan(&mask);
+         struct pb_cache_buffer *candidate;
+
+         LIST_FOR_EACH_ENTRY(candidate, &mgr->buckets[i].delayed, head) {
+            if (pb_cache_is_buffer_compat(candidate, size, desc)) {
+               buf = candidate;
+               break;
+            }
+         }
+      }
+
+      if (!buf)
+         break;
+
+      pb_cache_buffer_unlink(buf);
+      pipe_mutex_unlock(mgr->mutex);
+
+      if (pb_cache_is_buffer_idle(buf)) {
+         pipe_mutex_lock(mgr->mutex);
+         ++mgr->buckets[buf->bucket].stats.hits;
+         pipe_mutex_unlock(mgr->mutex);
+         return buf;
+      }
+
+      pipe_mutex_lock(mgr->mutex);
+      ++mgr->buckets[buf->bucket].stats.busy;
+      pb_cache_buffer_relink(buf);
+
+      if (buf->bucket == last)
+         break;
+      next = buf->bucket + 1;
    }
 
-   return 1;
+   ++mgr->buckets[first].stats.misses;
+   pipe_mutex_unlock(mgr->mutex);
+   return NULL;
 }
 
 
@@ -278,63 +455,16 @@ pb_cache_manager_create_buffer(struct pb_manager *_mgr,
                                const struct pb_desc *desc)
 {
    struct pb_cache_manager *mgr = pb_cache_manager(_mgr);
-   struct pb_cache_buffer *buf;
-   struct pb_cache_buffer *curr_buf;
-   struct list_head *curr, *next;
-   int64_t now;
-   int ret = 0;
+   struct pb_cache_buffer *buf = NULL;
 
-   pipe_mutex_lock(mgr->mutex);
+   if (!(desc->usage & mgr->bypass_usage))
+      buf = pb_cache_manager_find_buffer(mgr, size, desc);
 
-   buf = NULL;
-   curr = mgr->delayed.next;
-   next = curr->next;
-   
-   /* search in the expired buffers, freeing them in the process */
-   now = os_time_get();
-   while(curr != &mgr->delayed) {
-      curr_buf = LIST_ENTRY(struct pb_cache_buffer, curr, head);
-      if(!buf && (ret = pb_cache_is_buffer_compat(curr_buf, size, desc) > 0))
-         buf = curr_buf;
-      else if(os_time_timeout(curr_buf->start, curr_buf->end, now))
-         _pb_cache_buffer_destroy(curr_buf);
-      else
-         /* This buffer (and all hereafter) are still hot in cache */
-         break;
-      if (ret == -1)
-         break;
-      curr = next; 
-      next = curr->next;
-   }
-
-   /* keep searching in the hot buffers */
-   if(!buf && ret != -1) {
-      while(curr != &mgr->delayed) {
-         curr_buf = LIST_ENTRY(struct pb_cache_buffer, curr, head);
-         ret = pb_cache_is_buffer_compat(curr_buf, size, desc);
-         if (ret > 0) {
-            buf = curr_buf;
-            break;
-         }
-         if (ret == -1)
-            break;
-         /* no need to check the timeout here */
-         curr = next;
-         next = curr->next;
-      }
-   }
-   
    if(buf) {
-      mgr->cache_size -= buf->base.size;
-      LIST_DEL(&buf->head);
-      --mgr->numDelayed;
-      pipe_mutex_unlock(mgr->mutex);
       /* Increase refcount */
       pipe_reference_init(&buf->base.reference, 1);
       return &buf->base;
    }
-   
-   pipe_mutex_unlock(mgr->mutex);
 
    buf = CALLOC_STRUCT(pb_cache_buffer);
    if(!buf)
@@ -374,19 +504,23 @@ static void
 pb_cache_manager_flush(struct pb_manager *_mgr)
 {
    struct pb_cache_manager *mgr = pb_cache_manager(_mgr);
-   struct list_head *curr, *next;
-   struct pb_cache_buffer *buf;
+   struct list_head expired;
+   unsigned i;
+
+   LIST_INITHEAD(&expired);
 
    pipe_mutex_lock(mgr->mutex);
-   curr = mgr->delayed.next;
-   next = curr->next;
-   while(curr != &mgr->delayed) {
-      buf = LIST_ENTRY(struct pb_cache_buffer, curr, head);
-      _pb_cache_buffer_destroy(buf);
-      curr = next; 
-      next = curr->next;
+   for (i = 0; i < PB_CACHE_NUM_BUCKETS; i++) {
+      struct pb_cache_buffer *buf, *next;
+
+      LIST_FOR_EACH_ENTRY_SAFE(buf, next, &mgr->buckets[i].delayed, head) {
+         pb_cache_buffer_unlink(buf);
+         LIST_ADDTAIL(&buf->head, &expired);
+      }
    }
    pipe_mutex_unlock(mgr->mutex);
+
+   pb_cache_buffer_list_destroy(&expired);
    
    assert(mgr->provider->flush);
    if(mgr->provider->flush)
@@ -401,6 +535,24 @@ pb_cache_manager_destroy(struct pb_manager *mgr)
    FREE(mgr);
 }
 
+
+/**
+ * Get the hit/miss statistics and the contents of all buckets.
+ * Bucket i holds buffers of at least 2^i and less than 2^(i+1) bytes.
+ */
+void
+pb_cache_manager_get_stats(struct pb_manager *_mgr,
+                           struct pb_cache_bucket_stats *stats)
+{
+   struct pb_cache_manager *mgr = pb_cache_manager(_mgr);
+   unsigned i;
+
+   pipe_mutex_lock(mgr->mutex);
+   for (i = 0; i < PB_CACHE_NUM_BUCKETS; i++)
+      stats[i] = mgr->buckets[i].stats;
+   pipe_mutex_unlock(mgr->mutex);
+}
+
 /**
  * Create a caching buffer manager
  *
@@ -423,6 +575,7 @@ pb_cache_manager_create(struct pb_manager *provider,
                         uint64_t maximum_cache_size)
 {
    struct pb_cache_manager *mgr;
+   unsigned i;
 
    if(!provider)
       return NULL;
@@ -437,8 +590,12 @@ pb_cache_manager_create(struct pb_manager *provider,
    mgr->provider = provider;
    mgr->usecs = usecs;
    mgr->size_factor = size_factor;
+   while (mgr->bucket_span < PB_CACHE_NUM_BUCKETS - 1 &&
+          (float) (1u << mgr->bucket_span) < size_factor)
+      ++mgr->bucket_span;
    mgr->bypass_usage = bypass_usage;
-   LIST_INITHEAD(&mgr->delayed);
+   for (i = 0; i < PB_CACHE_NUM_BUCKETS; i++)
+      LIST_INITHEAD(&mgr->buckets[i].delayed);
    mgr->numDelayed = 0;
    mgr->max_cache_size = maximum_cache_size;
    pipe_mutex_init(mgr->mutex);
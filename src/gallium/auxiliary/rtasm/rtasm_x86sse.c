@@ -1508,6 +1508,114 @@ void sse2_rcpss( struct x86_function *p,
    emit_modrm( p, dst, src );
 }
 
+/***********************************************************************
+ * VEX encoded instructions
+ */
+
+enum vex_map {
+   VEX_MAP_0F = 1,
+   VEX_MAP_0F38 = 2,
+   VEX_MAP_0F3A = 3
+};
+
+enum vex_prefix {
+   VEX_PREFIX_NONE,
+   VEX_PREFIX_66,
+   VEX_PREFIX_F3,
+   VEX_PREFIX_F2
+};
+
+/* Emit the VEX prefix.  vvvv is the index of the extra source register,
+ * or 0 if the instruction has none.  No extended registers, so the R, X and
+ * B bits are always set.
+ */
+static void emit_vex( struct x86_function *p,
+                      enum vex_map map,
+                      enum vex_prefix pp,
+                      unsigned l256,
+                      unsigned w,
+                      unsigned vvvv )
+{
+   unsigned char vl_pp = ((~vvvv & 0xf) << 3) | (l256 << 2) | pp;
+
+   if (map == VEX_MAP_0F && !w) {
+      emit_2ub(p, 0xc5, 0x80 | vl_pp);
+   }
+   else {
+      emit_3ub(p, 0xc4, 0xe0 | map, (w << 7) | vl_pp);
+   }
+
+   if (l256)
+      p->need_vzeroupper = 1;
+}
+
+void avx_vzeroupper( struct x86_function *p )
+{
+   DUMP();
+   emit_3ub(p, 0xc5, 0xf8, 0x77);
+   p->need_vzeroupper = 0;
+}
+
+void avx_vmovups256( struct x86_function *p,
+                     struct x86_reg dst,
+                     struct x86_reg src )
+{
+   DUMP_RR( dst, src );
+   emit_vex(p, VEX_MAP_0F, VEX_PREFIX_NONE, 1, 0, 0);
+   emit_op_modrm(p, 0x10, 0x11, dst, src);
+}
+
+static void avx2_shift_var( struct x86_function *p,
+                            unsigned char op,
+                            struct x86_reg dst,
+                            struct x86_reg src0,
+                            struct x86_reg src1 )
+{
+   DUMP_RR( dst, src1 );
+   assert(src0.mod == mod_REG && src0.file == file_XMM);
+   emit_vex(p, VEX_MAP_0F38, VEX_PREFIX_66, 0, 0, src0.idx);
+   emit_1ub(p, op);
+   emit_modrm(p, dst, src1);
+}
+
+/* dst = src0 << src1, per dword */
+void avx2_vpsllvd( struct x86_function *p,
+                   struct x86_reg dst,
+                   struct x86_reg src0,
+                   struct x86_reg src1 )
+{
+   avx2_shift_var(p, 0x47, dst, src0, src1);
+}
+
+/* dst = src0 >> src1, per dword, shifting in zeros */
+void avx2_vpsrlvd( struct x86_function *p,
+                   struct x86_reg dst,
+                   struct x86_reg src0,
+                   struct x86_reg src1 )
+{
+   avx2_shift_var(p, 0x45, dst, src0, src1);
+}
+
+/* dst = src0 >> src1, per dword, shifting in the sign bit */
+void avx2_vpsravd( struct x86_function *p,
+                   struct x86_reg dst,
+                   struct x86_reg src0,
+                   struct x86_reg src1 )
+{
+   avx2_shift_var(p, 0x46, dst, src0, src1);
+}
+
+/* Convert the four half floats in the low 64 bits of src */
+void f16c_vcvtph2ps( struct x86_function *p,
+                     struct x86_reg dst,
+                     struct x86_reg src )
+{
+   DUMP_RR( dst, src );
+   emit_vex(p, VEX_MAP_0F38, VEX_PREFIX_66, 0, 0, 0);
+   emit_1ub(p, 0x13);
+   emit_modrm(p, dst, src);
+}
+
 /***********************************************************************
  * x87 instructions
  */
@@ -2164,6 +2272,12 @@ static void x86_init_func_common( struct x86_function *p )
       p->caps |= X86_SSE3;
    if(util_cpu_caps.has_sse4_1)
       p->caps |= X86_SSE4_1;
+   if(util_cpu_caps.has_avx)
+      p->caps |= X86_AVX;
+   if(util_cpu_caps.has_avx2)
+      p->caps |= X86_AVX2;
+   if(util_cpu_caps.has_f16c)
+      p->caps |= X86_F16C;
    p->csr = p->store;
    DUMP_START();
 }
@@ -47,6 +47,9 @@ struct x86_reg {
 #define X86_SSE2 8
 #define X86_SSE3 0x10
 #define X86_SSE4_1 0x20
+#define X86_AVX 0x40
+#define X86_AVX2 0x80
+#define X86_F16C 0x100
 
 struct x86_function {
    unsigned caps;
@@ -57,6 +60,7 @@ struct x86_function {
    unsigned stack_offset:16;
    unsigned need_emms:8;
    int x87_stack:8;
+   unsigned need_vzeroupper:1;
 
    unsigned char error_overflow[4];
 };
@@ -270,6 +274,20 @@ void sse2_pshuflw( struct x86_function *p, struct x86_reg dst, struct x86_reg sr
 void sse2_pshufhw( struct x86_function *p, struct x86_reg dst, struct x86_reg src, uint8_t imm );
 void sse2_pshufd( struct x86_function *p, struct x86_reg dst, struct x86_reg src, uint8_t imm );
 
+/* VEX encoded instructions.  Operands must be registers 0..7 and memory
+ * references based on them.  The 256-bit forms operate on the ymm register
+ * with the index of the given XMM register.
+ */
+void avx_vzeroupper( struct x86_function *p );
+void avx_vmovups256( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
+void avx2_vpsllvd( struct x86_function *p, struct x86_reg dst, struct x86_reg src0,
+                   struct x86_reg src1 );
+void avx2_vpsrlvd( struct x86_function *p, struct x86_reg dst, struct x86_reg src0,
+                   struct x86_reg src1 );
+void avx2_vpsravd( struct x86_function *p, struct x86_reg dst, struct x86_reg src0,
+                   struct x86_reg src1 );
+void f16c_vcvtph2ps( struct x86_function *p, struct x86_reg dst, struct x86_reg src );
+
 void sse_prefetchnta( struct x86_function *p, struct x86_reg ptr);
 void sse_prefetch0( struct x86_function *p, struct x86_reg ptr);
 void sse_prefetch1( struct x86_function *p, struct x86_reg ptr);
@@ -31,10 +31,10 @@
 #include "translate_cache.h"
 
 #include "cso_cache/cso_cache.h"
-#include "cso_cache/cso_hash.h"
+#include "cso_cache/cso_open_hash.h"
 
 struct translate_cache {
-   struct cso_hash *hash;
+   struct cso_open_hash *hash;
 };
 
 struct translate_cache * translate_cache_create( void )
@@ -44,18 +44,23 @@ struct translate_cache * translate_cache_create( void )
       return NULL;
    }
 
-   cache->hash = cso_hash_create();
+   cache->hash = cso_open_hash_create();
+   if (cache->hash == NULL) {
+      FREE(cache);
+      return NULL;
+   }
    return cache;
 }
 
 
 static INLINE void delete_translates(struct translate_cache *cache)
 {
-   struct cso_hash *hash = cache->hash;
-   struct cso_hash_iter iter = cso_hash_first_node(hash);
-   while (!cso_hash_iter_is_null(iter)) {
-      struct translate *state = (struct translate*)cso_hash_iter_data(iter);
-      iter = cso_hash_iter_next(iter);
+   struct cso_open_hash *hash = cache->hash;
+   unsigned slot;
+   for (slot = cso_open_hash_next(hash, 0); slot < hash->size;
+        slot = cso_open_hash_next(hash, slot + 1)) {
+      struct translate *state =
+         (struct translate*)cso_open_hash_data(hash, slot);
       if (state) {
          state->release(state);
       }
@@ -65,7 +70,7 @@ static INLINE void delete_translates(struct translate_cache *cache)
 void translate_cache_destroy(struct translate_cache *cache)
 {
    delete_translates(cache);
-   cso_hash_delete(cache->hash);
+   cso_open_hash_delete(cache->hash);
    FREE(cache);
 }
 
@@ -92,14 +97,16 @@ struct translate * translate_cache_find(struct translate_cache *cache,
 {
    unsigned hash_key = create_key(key);
    struct translate *translate = (struct translate*)
-      cso_hash_find_data_from_template(cache->hash,
-                                       hash_key,
-                                       key, sizeof(*key));
+      cso_open_hash_find(cache->hash, hash_key, key, sizeof(*key));
 
    if (!translate) {
       /* create/insert */
       translate = translate_create(key);
-      cso_hash_insert(cache->hash, hash_key, translate);
+      if (translate &&
+          !cso_open_hash_insert(cache->hash, hash_key, translate)) {
+         translate->release(translate);
+         translate = NULL;
+      }
    }
 
    return translate;
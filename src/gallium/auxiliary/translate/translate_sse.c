@@ -101,6 +101,13 @@ struct translate_sse
    struct x86_function *func;
 
      PIPE_ALIGN_VAR(16) float consts[NUM_CONSTS][4];
+
+   /* Per element shift counts and scale for unpacking packed formats */
+   struct {
+      PIPE_ALIGN_VAR(16) int32_t shl[4];
+      PIPE_ALIGN_VAR(16) int32_t shr[4];
+      PIPE_ALIGN_VAR(16) float scale[4];
+   } packed[TRANSLATE_MAX_ATTRIBS];
    int8_t reg_to_const[16];
    int8_t const_to_reg[NUM_CONSTS];
 
@@ -444,10 +451,16 @@ emit_memcpy(struct translate_sse *p, struct x86_reg dst, struct x86_reg src,
          emit_store64(p, x86_make_disp(dst, 16), dataGPR, dataXMM2);
          break;
       case 32:
-         emit_mov128(p, dataXMM, src);
-         emit_mov128(p, dataXMM2, x86_make_disp(src, 16));
-         emit_mov128(p, dst, dataXMM);
-         emit_mov128(p, x86_make_disp(dst, 16), dataXMM2);
+         if (x86_target_caps(p->func) & X86_AVX) {
+            avx_vmovups256(p->func, dataXMM, src);
+            avx_vmovups256(p->func, dst, dataXMM);
+         }
+         else {
+            emit_mov128(p, dataXMM, src);
+            emit_mov128(p, dataXMM2, x86_make_disp(src, 16));
+            emit_mov128(p, dst, dataXMM);
+            emit_mov128(p, x86_make_disp(dst, 16), dataXMM2);
+         }
          break;
       default:
          assert(0);
@@ -455,6 +468,108 @@ emit_memcpy(struct translate_sse *p, struct x86_reg dst, struct x86_reg src,
    }
 }
 
+/**
+ * Whether the input is a packed format (like R10G10B10A2) which can be
+ * unpacked with AVX2 variable shifts.
+ */
+static boolean
+is_packed_format(struct translate_sse *p,
+                 const struct util_format_description *desc)
+{
+   unsigned i;
+
+   if (!(x86_target_caps(p->func) & X86_AVX2))
+      return FALSE;
+
+   if (desc->layout != UTIL_FORMAT_LAYOUT_PLAIN || desc->is_array ||
+       desc->block.width != 1 || desc->block.height != 1 ||
+       desc->block.bits > 32)
+      return FALSE;
+
+   if (desc->channel[0].type != UTIL_FORMAT_TYPE_UNSIGNED &&
+       desc->channel[0].type != UTIL_FORMAT_TYPE_SIGNED)
+      return FALSE;
+
+   for (i = 0; i < desc->nr_channels; ++i) {
+      if (desc->channel[i].type != desc->channel[0].type ||
+          desc->channel[i].normalized != desc->channel[0].normalized ||
+          desc->channel[i].pure_integer ||
+          desc->channel[i].size >= 32)
+         return FALSE;
+   }
+
+   return TRUE;
+}
+
+
+/**
+ * Load a packed format, unpacking each channel into a float lane.  Lanes
+ * past the input channels are zero.
+ */
+static void
+emit_load_packed(struct translate_sse *p,
+                 const struct translate_element *a,
+                 const struct util_format_description *desc,
+                 struct x86_reg data, struct x86_reg src)
+{
+   const unsigned elem = a - p->translate.key.element;
+   unsigned i;
+
+   for (i = 0; i < 4; ++i) {
+      if (i < desc->nr_channels) {
+         const unsigned size = desc->channel[i].size;
+
+         /* move the channel to the top bits, then back down */
+         p->packed[elem].shl[i] = 32 - desc->channel[i].shift - size;
+         p->packed[elem].shr[i] = 32 - size;
+         if (desc->channel[i].type == UTIL_FORMAT_TYPE_SIGNED)
+            p->packed[elem].scale[i] = 1.0f / ((1 << (size - 1)) - 1);
+         else
+            p->packed[elem].scale[i] = 1.0f / ((1 << size) - 1);
+      }
+      else {
+         p->packed[elem].shl[i] = 32;
+         p->packed[elem].shr[i] = 32;
+         p->packed[elem].scale[i] = 0.0f;
+      }
+   }
+
+   emit_load_sse2(p, data, src, desc->block.bits >> 3);
+   sse2_pshufd(p->func, data, data, SHUF(X, X, X, X));
+   avx2_vpsllvd(p->func, data, data,
+                x86_make_disp(p->machine_EDI,
+                              get_offset(p, &p->packed[elem].shl[0])));
+   if (desc->channel[0].type == UTIL_FORMAT_TYPE_SIGNED)
+      avx2_vpsravd(p->func, data, data,
+                   x86_make_disp(p->machine_EDI,
+                                 get_offset(p, &p->packed[elem].shr[0])));
+   else
+      avx2_vpsrlvd(p->func, data, data,
+                   x86_make_disp(p->machine_EDI,
+                                 get_offset(p, &p->packed[elem].shr[0])));
+   sse2_cvtdq2ps(p->func, data, data);
+   if (desc->channel[0].normalized)
+      sse_mulps(p->func, data,
+                x86_make_disp(p->machine_EDI,
+                              get_offset(p, &p->packed[elem].scale[0])));
+}
+
+
+/**
+ * Whether two channels have the same type and size.  Unlike a memcmp() of
+ * the descriptions this ignores the shift, which differs for every channel.
+ */
+static boolean
+same_channel_type(const struct util_format_channel_description *a,
+                  const struct util_format_channel_description *b)
+{
+   return a->type == b->type &&
+          a->normalized == b->normalized &&
+          a->pure_integer == b->pure_integer &&
+          a->size == b->size;
+}
+
+
 static boolean
 translate_attr_convert(struct translate_sse *p,
                        const struct translate_element *a,
@@ -471,30 +586,29 @@ translate_attr_convert(struct translate_sse *p,
         UTIL_FORMAT_SWIZZLE_NONE, UTIL_FORMAT_SWIZZLE_NONE };
    unsigned needed_chans = 0;
    unsigned imms[2] = { 0, 0x3f800000 };
+   boolean packed;
 
    if (a->output_format == PIPE_FORMAT_NONE
        || a->input_format == PIPE_FORMAT_NONE)
       return FALSE;
 
-   if (input_desc->channel[0].size & 7)
+   packed = is_packed_format(p, input_desc);
+
+   if ((input_desc->channel[0].size & 7) && !packed)
       return FALSE;
 
    if (input_desc->colorspace != output_desc->colorspace)
       return FALSE;
 
-   for (i = 1; i < input_desc->nr_channels; ++i) {
-      if (memcmp
-          (&input_desc->channel[i], &input_desc->channel[0],
-           sizeof(input_desc->channel[0])))
+   for (i = 1; i < input_desc->nr_channels && !packed; ++i) {
+      if (!same_channel_type(&input_desc->channel[i], &input_desc->channel[0]))
          return FALSE;
    }
 
    for (i = 1; i < output_desc->nr_channels; ++i) {
-      if (memcmp
-          (&output_desc->channel[i], &output_desc->channel[0],
-           sizeof(output_desc->channel[0]))) {
+      if (!same_channel_type(&output_desc->channel[i],
+                             &output_desc->channel[0]))
          return FALSE;
-      }
    }
 
    for (i = 0; i < output_desc->nr_channels; ++i) {
@@ -522,7 +636,15 @@ translate_attr_convert(struct translate_sse *p,
             id_swizzle = FALSE;
       }
 
-      if (needed_chans > 0) {
+      if (needed_chans > 0 && packed) {
+         emit_load_packed(p, a, input_desc, dataXMM, src);
+
+         if (!id_swizzle) {
+            sse_shufps(p->func, dataXMM, dataXMM,
+                       SHUF(swizzle[0], swizzle[1], swizzle[2], swizzle[3]));
+         }
+      }
+      else if (needed_chans > 0) {
          switch (input_desc->channel[0].type) {
          case UTIL_FORMAT_TYPE_UNSIGNED:
             if (!(x86_target_caps(p->func) & X86_SSE2))
@@ -626,6 +748,14 @@ translate_attr_convert(struct translate_sse *p,
 
             break;
          case UTIL_FORMAT_TYPE_FLOAT:
+            if (input_desc->channel[0].size == 16) {
+               if (!(x86_target_caps(p->func) & X86_F16C))
+                  return FALSE;
+               /* zero padding converts to 0.0 */
+               emit_load_sse2(p, dataXMM, src, input_desc->nr_channels * 2);
+               f16c_vcvtph2ps(p->func, dataXMM, dataXMM);
+               break;
+            }
             if (input_desc->channel[0].size != 32
                 && input_desc->channel[0].size != 64) {
                return FALSE;
@@ -1420,6 +1550,11 @@ build_vertex_emit(struct translate_sse *p,
     */
    x86_fixup_fwd_jump(p->func, fixup);
 
+   /* Avoid AVX to SSE transition penalties in the caller
+    */
+   if (p->func->need_vzeroupper)
+      avx_vzeroupper(p->func);
+
    /* Pop regs and return
     */
    if (x86_target(p->func) != X86_64_STD_ABI) {
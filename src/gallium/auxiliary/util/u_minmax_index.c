@@ -0,0 +1,324 @@
+/**************************************************************************
+ *
+ * Copyright 2026 agent
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Smallest and largest index of an index buffer range.
+ *
+ * Restart indices are skipped.  If there are no other indices the minimum is
+ * ~0 and the maximum is 0.
+ */
+
+#include "pipe/p_config.h"
+#include "util/u_debug.h"
+#include "util/u_math.h"
+#include "util/u_minmax_index.h"
+
+#if defined(PIPE_ARCH_SSE)
+#include "util/u_sse.h"
+#endif
+
+
+#define MINMAX_LOOP(type)                                               \
+   do {                                                                 \
+      const type *p = (const type *) indices;                           \
+      if (primitive_restart) {                                          \
+         for (i = 0; i < count; i++) {                                  \
+            if (p[i] != restart_index) {                                \
+               if (p[i] > max) max = p[i];                              \
+               if (p[i] < min) min = p[i];                              \
+            }                                                           \
+         }                                                              \
+      }                                                                 \
+      else {                                                            \
+         for (i = 0; i < count; i++) {                                  \
+            if (p[i] > max) max = p[i];                                 \
+            if (p[i] < min) min = p[i];                                 \
+         }                                                              \
+      }                                                                 \
+   } while (0)
+
+
+/**
+ * Plain C version.
+ */
+void
+util_get_minmax_index_c(const void *indices,
+                        unsigned index_size,
+                        unsigned count,
+                        boolean primitive_restart,
+                        unsigned restart_index,
+                        unsigned *out_min_index,
+                        unsigned *out_max_index)
+{
+   unsigned min = ~0U;
+   unsigned max = 0;
+   unsigned i;
+
+   switch (index_size) {
+   case 4:
+      MINMAX_LOOP(uint32_t);
+      break;
+   case 2:
+      MINMAX_LOOP(uint16_t);
+      break;
+   case 1:
+      MINMAX_LOOP(uint8_t);
+      break;
+   default:
+      assert(0);
+      min = 0;
+   }
+
+   *out_min_index = min;
+   *out_max_index = max;
+}
+
+
+#if defined(PIPE_ARCH_SSE)
+
+/**
+ * Pick a where mask is set and b elsewhere.
+ */
+static INLINE __m128i
+minmax_select(__m128i mask, __m128i a, __m128i b)
+{
+   return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+
+/*
+ * SSE2 has no unsigned 16 and 32 bit min/max, so the indices are flipped
+ * into the signed range first by toggling the sign bit.
+ */
+
+static void
+minmax_uint32_sse2(const uint32_t *p, unsigned count,
+                   boolean primitive_restart, unsigned restart_index,
+                   unsigned *out_min, unsigned *out_max)
+{
+   const __m128i bias = _mm_set1_epi32(0x80000000);
+   const __m128i restart = _mm_set1_epi32(restart_index);
+   __m128i vmin = _mm_set1_epi32(0x7fffffff);
+   __m128i vmax = bias;
+   __m128i found = _mm_setzero_si128();
+   uint32_t min4[4], max4[4], found4[4];
+   unsigned min = ~0U, max = 0;
+   unsigned i, n = count & ~3;
+
+   for (i = 0; i < n; i += 4) {
+      __m128i v = _mm_loadu_si128((const __m128i *) (p + i));
+      __m128i vb = _mm_xor_si128(v, bias);
+      __m128i vmin_in = vb, vmax_in = vb;
+
+      if (primitive_restart) {
+         __m128i skip = _mm_cmpeq_epi32(v, restart);
+         vmin_in = minmax_select(skip, vmin, vb);
+         vmax_in = minmax_select(skip, vmax, vb);
+         found = _mm_or_si128(found, _mm_xor_si128(skip, _mm_set1_epi32(-1)));
+      }
+
+      vmin = minmax_select(_mm_cmpgt_epi32(vmin, vmin_in), vmin_in, vmin);
+      vmax = minmax_select(_mm_cmpgt_epi32(vmax_in, vmax), vmax_in, vmax);
+   }
+
+   _mm_storeu_si128((__m128i *) min4, _mm_xor_si128(vmin, bias));
+   _mm_storeu_si128((__m128i *) max4, _mm_xor_si128(vmax, bias));
+   _mm_storeu_si128((__m128i *) found4, found);
+
+   if (n && (!primitive_restart ||
+             (found4[0] | found4[1] | found4[2] | found4[3]))) {
+      for (i = 0; i < 4; i++) {
+         min = MIN2(min, min4[i]);
+         max = MAX2(max, max4[i]);
+      }
+   }
+
+   for (i = n; i < count; i++) {
+      if (primitive_restart && p[i] == restart_index)
+         continue;
+      min = MIN2(min, p[i]);
+      max = MAX2(max, p[i]);
+   }
+
+   *out_min = min;
+   *out_max = max;
+}
+
+
+static void
+minmax_uint16_sse2(const uint16_t *p, unsigned count,
+                   boolean primitive_restart, unsigned restart_index,
+                   unsigned *out_min, unsigned *out_max)
+{
+   const __m128i bias = _mm_set1_epi16((short) 0x8000);
+   const __m128i restart = _mm_set1_epi16((short) restart_index);
+   __m128i vmin = _mm_set1_epi16(0x7fff);
+   __m128i vmax = bias;
+   __m128i found = _mm_setzero_si128();
+   uint16_t min8[8], max8[8];
+   unsigned min = ~0U, max = 0;
+   unsigned i, n = count & ~7;
+
+   /* A restart index which does not fit can never match */
+   if (restart_index > 0xffff)
+      primitive_restart = FALSE;
+
+   for (i = 0; i < n; i += 8) {
+      __m128i v = _mm_loadu_si128((const __m128i *) (p + i));
+      __m128i vb = _mm_xor_si128(v, bias);
+
+      if (primitive_restart) {
+         __m128i skip = _mm_cmpeq_epi16(v, restart);
+         vmin = _mm_min_epi16(vmin, minmax_select(skip, vmin, vb));
+         vmax = _mm_max_epi16(vmax, minmax_select(skip, vmax, vb));
+         found = _mm_or_si128(found, _mm_xor_si128(skip, _mm_set1_epi32(-1)));
+      }
+      else {
+         vmin = _mm_min_epi16(vmin, vb);
+         vmax = _mm_max_epi16(vmax, vb);
+      }
+   }
+
+   _mm_storeu_si128((__m128i *) min8, _mm_xor_si128(vmin, bias));
+   _mm_storeu_si128((__m128i *) max8, _mm_xor_si128(vmax, bias));
+
+   if (n && (!primitive_restart ||
+             _mm_movemask_epi8(found) != 0)) {
+      for (i = 0; i < 8; i++) {
+         min = MIN2(min, min8[i]);
+         max = MAX2(max, max8[i]);
+      }
+   }
+
+   for (i = n; i < count; i++) {
+      if (primitive_restart && p[i] == restart_index)
+         continue;
+      min = MIN2(min, p[i]);
+      max = MAX2(max, p[i]);
+   }
+
+   *out_min = min;
+   *out_max = max;
+}
+
+
+static void
+minmax_uint8_sse2(const uint8_t *p, unsigned count,
+                  boolean primitive_restart, unsigned restart_index,
+                  unsigned *out_min, unsigned *out_max)
+{
+   const __m128i restart = _mm_set1_epi8((char) restart_index);
+   __m128i vmin = _mm_set1_epi8((char) 0xff);
+   __m128i vmax = _mm_setzero_si128();
+   __m128i found = _mm_setzero_si128();
+   uint8_t min16[16], max16[16];
+   unsigned min = ~0U, max = 0;
+   unsigned i, n = count & ~15;
+
+   if (restart_index > 0xff)
+      primitive_restart = FALSE;
+
+   for (i = 0; i < n; i += 16) {
+      __m128i v = _mm_loadu_si128((const __m128i *) (p + i));
+
+      if (primitive_restart) {
+         __m128i skip = _mm_cmpeq_epi8(v, restart);
+         vmin = _mm_min_epu8(vmin, _mm_or_si128(v, skip));
+         vmax = _mm_max_epu8(vmax, _mm_andnot_si128(skip, v));
+         found = _mm_or_si128(found, _mm_xor_si128(skip, _mm_set1_epi32(-1)));
+      }
+      else {
+         vmin = _mm_min_epu8(vmin, v);
+         vmax = _mm_max_epu8(vmax, v);
+      }
+   }
+
+   _mm_storeu_si128((__m128i *) min16, vmin);
+   _mm_storeu_si128((__m128i *) max16, vmax);
+
+   if (n && (!primitive_restart ||
+             _mm_movemask_epi8(found) != 0)) {
+      for (i = 0; i < 16; i++) {
+         min = MIN2(min, min16[i]);
+         max = MAX2(max, max16[i]);
+      }
+   }
+
+   for (i = n; i < count; i++) {
+      if (primitive_restart && p[i] == restart_index)
+         continue;
+      min = MIN2(min, p[i]);
+      max = MAX2(max, p[i]);
+   }
+
+   *out_min = min;
+   *out_max = max;
+}
+
+#endif /* PIPE_ARCH_SSE */
+
+
+/**
+ * Compute the smallest and largest of count indices, skipping restart_index
+ * if primitive_restart is set.
+ */
+void
+util_get_minmax_index(const void *indices,
+                      unsigned index_size,
+                      unsigned count,
+                      boolean primitive_restart,
+                      unsigned restart_index,
+                      unsigned *out_min_index,
+                      unsigned *out_max_index)
+{
+#if defined(PIPE_ARCH_SSE)
+   switch (index_size) {
+   case 4:
+      minmax_uint32_sse2((const uint32_t *) indices, count,
+                         primitive_restart, restart_index,
+                         out_min_index, out_max_index);
+      return;
+   case 2:
+      minmax_uint16_sse2((const uint16_t *) indices, count,
+                         primitive_restart, restart_index,
+                         out_min_index, out_max_index);
+      return;
+   case 1:
+      minmax_uint8_sse2((const uint8_t *) indices, count,
+                        primitive_restart, restart_index,
+                        out_min_index, out_max_index);
+      return;
+   default:
+      break;
+   }
+#endif
+
+   util_get_minmax_index_c(indices, index_size, count,
+                           primitive_restart, restart_index,
+                           out_min_index, out_max_index);
+}
@@ -0,0 +1,68 @@
+/**************************************************************************
+ *
+ * Copyright 2026 agent
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Smallest and largest index of an index buffer range.
+ */
+
+#ifndef U_MINMAX_INDEX_H
+#define U_MINMAX_INDEX_H
+
+
+#include "pipe/p_compiler.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+void
+util_get_minmax_index(const void *indices,
+                      unsigned index_size,
+                      unsigned count,
+                      boolean primitive_restart,
+                      unsigned restart_index,
+                      unsigned *out_min_index,
+                      unsigned *out_max_index);
+
+void
+util_get_minmax_index_c(const void *indices,
+                        unsigned index_size,
+                        unsigned count,
+                        boolean primitive_restart,
+                        unsigned restart_index,
+                        unsigned *out_min_index,
+                        unsigned *out_max_index);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* U_MINMAX_INDEX_H */
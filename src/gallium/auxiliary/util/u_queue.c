@@ -0,0 +1,218 @@
+/**************************************************************************
+ *
+ * Copyright 2026 agent
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+#include "util/u_memory.h"
+#include "util/u_queue.h"
+
+
+static PIPE_THREAD_ROUTINE(util_queue_thread_func, param)
+{
+   struct util_queue *queue = (struct util_queue *) param;
+
+   pipe_mutex_lock(queue->lock);
+
+   while (1) {
+      struct util_queue_job *job;
+
+      while (!queue->kill_threads && !queue->head)
+         pipe_condvar_wait(queue->job_added, queue->lock);
+
+      if (queue->kill_threads)
+         break;
+
+      job = queue->head;
+      queue->head = job->next;
+      if (!queue->head)
+         queue->tail = NULL;
+      job->next = NULL;
+      job->state = UTIL_QUEUE_JOB_RUNNING;
+
+      pipe_mutex_unlock(queue->lock);
+      job->execute(job);
+      pipe_mutex_lock(queue->lock);
+
+      job->state = UTIL_QUEUE_JOB_IDLE;
+      pipe_condvar_broadcast(queue->job_done);
+   }
+
+   pipe_mutex_unlock(queue->lock);
+   return 0;
+}
+
+
+/**
+ * Start the worker threads.
+ * \return FALSE if no thread could be created.
+ */
+boolean
+util_queue_init(struct util_queue *queue, unsigned num_threads)
+{
+   unsigned i;
+
+   memset(queue, 0, sizeof *queue);
+
+   if (!num_threads)
+      return FALSE;
+
+   queue->threads = CALLOC(num_threads, sizeof *queue->threads);
+   if (!queue->threads)
+      return FALSE;
+
+   pipe_mutex_init(queue->lock);
+   pipe_condvar_init(queue->job_added);
+   pipe_condvar_init(queue->job_done);
+
+   for (i = 0; i < num_threads; i++) {
+      queue->threads[i] = pipe_thread_create(util_queue_thread_func, queue);
+      if (!queue->threads[i])
+         break;
+   }
+   queue->num_threads = i;
+
+   if (!queue->num_threads) {
+      util_queue_destroy(queue);
+      return FALSE;
+   }
+
+   return TRUE;
+}
+
+
+/**
+ * Stop the worker threads.  Jobs which have not started yet are dropped,
+ * running ones are waited for.
+ */
+void
+util_queue_destroy(struct util_queue *queue)
+{
+   unsigned i;
+
+   if (!queue->threads)
+      return;
+
+   pipe_mutex_lock(queue->lock);
+   while (queue->head) {
+      struct util_queue_job *job = queue->head;
+      queue->head = job->next;
+      job->next = NULL;
+      job->state = UTIL_QUEUE_JOB_IDLE;
+   }
+   queue->tail = NULL;
+   queue->kill_threads = TRUE;
+   pipe_condvar_broadcast(queue->job_added);
+   pipe_mutex_unlock(queue->lock);
+
+   for (i = 0; i < queue->num_threads; i++)
+      pipe_thread_wait(queue->threads[i]);
+
+   pipe_condvar_destroy(queue->job_done);
+   pipe_condvar_destroy(queue->job_added);
+   pipe_mutex_destroy(queue->lock);
+   FREE(queue->threads);
+   queue->threads = NULL;
+   queue->num_threads = 0;
+}
+
+
+/**
+ * Queue a job for execution by one of the worker threads.  The job must stay
+ * around until it completed or was removed with util_queue_remove_job().
+ */
+void
+util_queue_add_job(struct util_queue *queue,
+                   struct util_queue_job *job,
+                   void (*execute)(struct util_queue_job *job))
+{
+   pipe_mutex_lock(queue->lock);
+
+   assert(job->state == UTIL_QUEUE_JOB_IDLE);
+
+   job->next = NULL;
+   job->execute = execute;
+   job->state = UTIL_QUEUE_JOB_QUEUED;
+
+   if (queue->tail)
+      queue->tail->next = job;
+   else
+      queue->head = job;
+   queue->tail = job;
+
+   pipe_condvar_signal(queue->job_added);
+   pipe_mutex_unlock(queue->lock);
+}
+
+
+/**
+ * Wait until the job completed.
+ */
+void
+util_queue_wait_job(struct util_queue *queue,
+                    struct util_queue_job *job)
+{
+   pipe_mutex_lock(queue->lock);
+   while (job->state != UTIL_QUEUE_JOB_IDLE)
+      pipe_condvar_wait(queue->job_done, queue->lock);
+   pipe_mutex_unlock(queue->lock);
+}
+
+
+/**
+ * Make sure the job is neither queued nor running anymore: if it did not
+ * start yet it is dropped, otherwise this waits for it to complete.
+ */
+void
+util_queue_remove_job(struct util_queue *queue,
+                      struct util_queue_job *job)
+{
+   pipe_mutex_lock(queue->lock);
+
+   if (job->state == UTIL_QUEUE_JOB_QUEUED) {
+      struct util_queue_job *prev = NULL;
+      struct util_queue_job *iter = queue->head;
+
+      while (iter != job) {
+         prev = iter;
+         iter = iter->next;
+      }
+
+      if (prev)
+         prev->next = job->next;
+      else
+         queue->head = job->next;
+      if (queue->tail == job)
+         queue->tail = prev;
+
+      job->next = NULL;
+      job->state = UTIL_QUEUE_JOB_IDLE;
+   }
+
+   while (job->state != UTIL_QUEUE_JOB_IDLE)
+      pipe_condvar_wait(queue->job_done, queue->lock);
+
+   pipe_mutex_unlock(queue->lock);
+}
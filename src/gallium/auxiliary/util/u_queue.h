@@ -0,0 +1,103 @@
+/**************************************************************************
+ *
+ * Copyright 2026 agent
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Job queue executed by a pool of worker threads.
+ *
+ * Jobs are embedded in the caller's objects, so adding a job never allocates
+ * memory.  A job can be added again once it completed.
+ */
+
+
+#ifndef U_QUEUE_H
+#define U_QUEUE_H
+
+
+#include "pipe/p_compiler.h"
+#include "os/os_thread.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+enum util_queue_job_state {
+   UTIL_QUEUE_JOB_IDLE = 0,
+   UTIL_QUEUE_JOB_QUEUED,
+   UTIL_QUEUE_JOB_RUNNING
+};
+
+
+struct util_queue_job {
+   struct util_queue_job *next;
+   void (*execute)(struct util_queue_job *job);
+   enum util_queue_job_state state;   /**< protected by the queue lock */
+};
+
+
+struct util_queue {
+   pipe_mutex lock;
+   pipe_condvar job_added;
+   pipe_condvar job_done;
+
+   /** FIFO of queued jobs */
+   struct util_queue_job *head;
+   struct util_queue_job *tail;
+
+   boolean kill_threads;
+   unsigned num_threads;
+   pipe_thread *threads;
+};
+
+
+boolean
+util_queue_init(struct util_queue *queue, unsigned num_threads);
+
+void
+util_queue_destroy(struct util_queue *queue);
+
+void
+util_queue_add_job(struct util_queue *queue,
+                   struct util_queue_job *job,
+                   void (*execute)(struct util_queue_job *job));
+
+void
+util_queue_wait_job(struct util_queue *queue,
+                    struct util_queue_job *job);
+
+void
+util_queue_remove_job(struct util_queue *queue,
+                      struct util_queue_job *job);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* U_QUEUE_H */
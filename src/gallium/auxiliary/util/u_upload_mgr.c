@@ -29,15 +29,34 @@
  * coalescing small buffers into larger ones.
  */
 
+#include <inttypes.h>
+
 #include "pipe/p_defines.h"
+#include "util/u_debug.h"
 #include "util/u_inlines.h"
 #include "pipe/p_context.h"
+#include "pipe/p_screen.h"
 #include "util/u_memory.h"
 #include "util/u_math.h"
 
 #include "u_upload_mgr.h"
 
 
+DEBUG_GET_ONCE_BOOL_OPTION(upload_stats, "GALLIUM_UPLOAD_STATS", FALSE)
+
+
+/* A buffer of the ring */
+struct u_upload_ring_buffer {
+   struct pipe_resource *buffer;
+   struct pipe_transfer *transfer;
+   uint8_t *map;
+   struct pipe_fence_handle *fence; /* Fence of the last flush using it. */
+   boolean pending;                 /* Used since the last fence. */
+   int own_refs;                    /* References held by the buffer's own
+                                     * reference and transfer. */
+};
+
+
 struct u_upload_mgr {
    struct pipe_context *pipe;
 
@@ -52,6 +71,14 @@ struct u_upload_mgr {
    uint8_t *map;    /* Pointer to the mapped upload buffer. */
    unsigned offset; /* Aligned offset to the upload buffer, pointing
                      * at the first unused byte. */
+
+   /* In ring mode the ring buffers own the buffer, transfer and map above. */
+   struct u_upload_ring_buffer *ring;
+   unsigned num_ring_buffers;
+   unsigned ring_index;    /* Ring buffer being filled. */
+   unsigned recycle_count; /* Ring buffers reused so far. */
+
+   struct u_upload_stats stats;
 };
 
 
@@ -88,6 +115,33 @@ struct u_upload_mgr *u_upload_create( struct pipe_context *pipe,
 }
 
 
+struct u_upload_mgr *u_upload_create_ring( struct pipe_context *pipe,
+                                           unsigned default_size,
+                                           unsigned alignment,
+                                           unsigned bind,
+                                           unsigned num_buffers )
+{
+   struct u_upload_mgr *upload = u_upload_create(pipe, default_size,
+                                                 alignment, bind);
+   if (!upload)
+      return NULL;
+
+   /* Without persistent mappings, keep discarding full buffers */
+   if (!upload->map_persistent || num_buffers < 2)
+      return upload;
+
+   upload->ring = CALLOC(num_buffers, sizeof *upload->ring);
+   if (!upload->ring) {
+      u_upload_destroy(upload);
+      return NULL;
+   }
+
+   upload->num_ring_buffers = num_buffers;
+   upload->ring_index = num_buffers - 1;
+   return upload;
+}
+
+
 static void upload_unmap_internal(struct u_upload_mgr *upload, boolean destroying)
 {
    if (!destroying && upload->map_persistent)
@@ -122,28 +176,91 @@ static void u_upload_release_buffer(struct u_upload_mgr *upload)
 }
 
 
+static void u_upload_release_ring_buffer(struct u_upload_mgr *upload,
+                                         struct u_upload_ring_buffer *rb)
+{
+   struct pipe_screen *screen = upload->pipe->screen;
+
+   if (rb->transfer)
+      pipe_transfer_unmap(upload->pipe, rb->transfer);
+   pipe_resource_reference(&rb->buffer, NULL);
+   screen->fence_reference(screen, &rb->fence, NULL);
+   rb->transfer = NULL;
+   rb->map = NULL;
+   rb->pending = FALSE;
+}
+
+
 void u_upload_destroy( struct u_upload_mgr *upload )
 {
-   u_upload_release_buffer( upload );
+   if (debug_get_option_upload_stats()) {
+      _debug_printf("u_upload: %"PRIu64" bytes uploaded, %u buffers, "
+                    "%u stalls\n", upload->stats.bytes_uploaded,
+                    upload->stats.num_buffers, upload->stats.num_stalls);
+   }
+
+   if (upload->ring) {
+      unsigned i;
+
+      for (i = 0; i < upload->num_ring_buffers; i++)
+         u_upload_release_ring_buffer(upload, &upload->ring[i]);
+      FREE(upload->ring);
+   }
+   else {
+      u_upload_release_buffer( upload );
+   }
    FREE( upload );
 }
 
 
-static enum pipe_error 
-u_upload_alloc_buffer( struct u_upload_mgr *upload,
-                       unsigned min_size )
+boolean u_upload_needs_fence( const struct u_upload_mgr *upload )
+{
+   unsigned i;
+
+   for (i = 0; i < upload->num_ring_buffers; i++) {
+      if (upload->ring[i].pending)
+         return TRUE;
+   }
+   return FALSE;
+}
+
+
+void u_upload_fence( struct u_upload_mgr *upload,
+                     struct pipe_fence_handle *fence )
 {
    struct pipe_screen *screen = upload->pipe->screen;
-   struct pipe_resource buffer;
-   unsigned size;
+   unsigned i;
 
-   /* Release the old buffer, if present:
-    */
-   u_upload_release_buffer( upload );
+   for (i = 0; i < upload->num_ring_buffers; i++) {
+      struct u_upload_ring_buffer *rb = &upload->ring[i];
 
-   /* Allocate a new one: 
-    */
-   size = align(MAX2(upload->default_size, min_size), 4096);
+      if (rb->pending) {
+         screen->fence_reference(screen, &rb->fence, fence);
+         rb->pending = FALSE;
+      }
+   }
+}
+
+
+void u_upload_get_stats( const struct u_upload_mgr *upload,
+                         struct u_upload_stats *stats )
+{
+   *stats = upload->stats;
+}
+
+
+unsigned u_upload_recycle_count( const struct u_upload_mgr *upload )
+{
+   return upload->recycle_count;
+}
+
+
+static struct pipe_resource *
+u_upload_create_buffer( struct u_upload_mgr *upload,
+                        unsigned size )
+{
+   struct pipe_screen *screen = upload->pipe->screen;
+   struct pipe_resource buffer;
 
    memset(&buffer, 0, sizeof buffer);
    buffer.target = PIPE_BUFFER;
@@ -160,7 +277,25 @@ u_upload_alloc_buffer( struct u_upload_mgr *upload,
                      PIPE_RESOURCE_FLAG_MAP_COHERENT;
    }
 
-   upload->buffer = screen->resource_create(screen, &buffer);
+   upload->stats.num_buffers++;
+   return screen->resource_create(screen, &buffer);
+}
+
+static enum pipe_error 
+u_upload_alloc_buffer( struct u_upload_mgr *upload,
+                       unsigned min_size )
+{
+   unsigned size;
+
+   /* Release the old buffer, if present:
+    */
+   u_upload_release_buffer( upload );
+
+   /* Allocate a new one: 
+    */
+   size = align(MAX2(upload->default_size, min_size), 4096);
+
+   upload->buffer = u_upload_create_buffer(upload, size);
    if (upload->buffer == NULL) {
       return PIPE_ERROR_OUT_OF_MEMORY;
    }
@@ -179,6 +314,71 @@ u_upload_alloc_buffer( struct u_upload_mgr *upload,
    return PIPE_OK;
 }
 
+/**
+ * Move on to the next buffer of the ring, waiting for the GPU to be done
+ * with it if needed.
+ */
+static enum pipe_error
+u_upload_next_ring_buffer( struct u_upload_mgr *upload,
+                           unsigned min_size )
+{
+   struct pipe_screen *screen = upload->pipe->screen;
+   unsigned index = (upload->ring_index + 1) % upload->num_ring_buffers;
+   struct u_upload_ring_buffer *rb = &upload->ring[index];
+
+   upload->buffer = NULL;
+   upload->transfer = NULL;
+   upload->map = NULL;
+
+   /* A buffer used since the last flush can't be waited for, so replace it
+    * like a full buffer is replaced outside of ring mode.  So is a buffer
+    * still referenced by the caller, e.g. bound as a constant buffer, since
+    * overwriting it would change what the binding reads.  Buffers too small
+    * for the allocation are replaced too.
+    */
+   if (rb->pending ||
+       (rb->buffer &&
+        (p_atomic_read(&rb->buffer->reference.count) > rb->own_refs ||
+         rb->buffer->width0 < min_size)))
+      u_upload_release_ring_buffer(upload, rb);
+
+   if (rb->fence) {
+      if (!screen->fence_signalled(screen, rb->fence)) {
+         upload->stats.num_stalls++;
+         screen->fence_finish(screen, rb->fence, PIPE_TIMEOUT_INFINITE);
+      }
+      screen->fence_reference(screen, &rb->fence, NULL);
+   }
+
+   if (rb->buffer)
+      upload->recycle_count++;
+   else {
+      unsigned size = align(MAX2(upload->default_size, min_size), 4096);
+
+      rb->buffer = u_upload_create_buffer(upload, size);
+      if (!rb->buffer)
+         return PIPE_ERROR_OUT_OF_MEMORY;
+
+      rb->map = pipe_buffer_map_range(upload->pipe, rb->buffer, 0, size,
+                                      upload->map_flags, &rb->transfer);
+      if (!rb->map) {
+         rb->transfer = NULL;
+         pipe_resource_reference(&rb->buffer, NULL);
+         return PIPE_ERROR_OUT_OF_MEMORY;
+      }
+
+      /* Some drivers' transfers reference the buffer, some don't. */
+      rb->own_refs = p_atomic_read(&rb->buffer->reference.count);
+   }
+
+   upload->ring_index = index;
+   upload->buffer = rb->buffer;
+   upload->transfer = rb->transfer;
+   upload->map = rb->map;
+   upload->offset = 0;
+   return PIPE_OK;
+}
+
 enum pipe_error u_upload_alloc( struct u_upload_mgr *upload,
                                 unsigned min_out_offset,
                                 unsigned size,
@@ -201,8 +401,9 @@ enum pipe_error u_upload_alloc( struct u_upload_mgr *upload,
     * for the sub-allocation. */
    if (!upload->buffer ||
        MAX2(upload->offset, alloc_offset) + alloc_size > upload->buffer->width0) {
-      enum pipe_error ret = u_upload_alloc_buffer(upload,
-                                                  alloc_offset + alloc_size);
+      enum pipe_error ret = upload->ring ?
+         u_upload_next_ring_buffer(upload, alloc_offset + alloc_size) :
+         u_upload_alloc_buffer(upload, alloc_offset + alloc_size);
       if (ret != PIPE_OK)
          return ret;
    }
@@ -233,6 +434,9 @@ enum pipe_error u_upload_alloc( struct u_upload_mgr *upload,
    *out_offset = offset;
 
    upload->offset = offset + alloc_size;
+   upload->stats.bytes_uploaded += alloc_size;
+   if (upload->ring)
+      upload->ring[upload->ring_index].pending = TRUE;
    return PIPE_OK;
 }
 
@@ -36,6 +36,17 @@
 
 struct pipe_context;
 struct pipe_resource;
+struct pipe_fence_handle;
+
+
+/**
+ * Upload statistics.
+ */
+struct u_upload_stats {
+   uint64_t bytes_uploaded;  /**< bytes suballocated */
+   unsigned num_buffers;     /**< upload buffers created */
+   unsigned num_stalls;      /**< waits for the GPU to release a ring buffer */
+};
 
 
 /**
@@ -51,6 +62,25 @@ struct u_upload_mgr *u_upload_create( struct pipe_context *pipe,
                                       unsigned alignment,
                                       unsigned bind );
 
+/**
+ * Create an upload manager that recycles a ring of persistently mapped
+ * buffers instead of allocating a new buffer whenever one fills up.
+ *
+ * The buffers stay mapped, so uploads are plain copies at the write
+ * pointer.  A full buffer is reused once the GPU is done with it, which the
+ * owner must tell by passing the fence of each flush to u_upload_fence(),
+ * and nothing outside the upload manager references it anymore.
+ * Falls back to a regular upload manager if the driver can't map buffers
+ * persistently.
+ *
+ * \param num_buffers  Number of buffers in the ring.
+ */
+struct u_upload_mgr *u_upload_create_ring( struct pipe_context *pipe,
+                                           unsigned default_size,
+                                           unsigned alignment,
+                                           unsigned bind,
+                                           unsigned num_buffers );
+
 /**
  * Destroy the upload manager.
  */
@@ -68,6 +98,33 @@ void u_upload_destroy( struct u_upload_mgr *upload );
  */
 void u_upload_unmap( struct u_upload_mgr *upload );
 
+/**
+ * Whether the ring has buffers used since the last u_upload_fence().
+ */
+boolean u_upload_needs_fence( const struct u_upload_mgr *upload );
+
+/**
+ * Mark the ring buffers used so far as busy until the fence signals.
+ *
+ * \param fence  Fence of a flush submitting all the previous uploads.
+ */
+void u_upload_fence( struct u_upload_mgr *upload,
+                     struct pipe_fence_handle *fence );
+
+/**
+ * Number of times a ring buffer was reused so far.  Once it changes, data
+ * suballocated before may have been overwritten, unless the caller still
+ * holds a reference to its buffer: buffers referenced outside the upload
+ * manager are replaced instead of reused.
+ */
+unsigned u_upload_recycle_count( const struct u_upload_mgr *upload );
+
+/**
+ * Get the upload statistics.
+ */
+void u_upload_get_stats( const struct u_upload_mgr *upload,
+                         struct u_upload_stats *stats );
+
 /**
  * Sub-allocate new memory from the upload buffer.
  *
@@ -91,6 +91,7 @@
 #include "util/u_format.h"
 #include "util/u_inlines.h"
 #include "util/u_memory.h"
+#include "util/u_minmax_index.h"
 #include "util/u_upload_mgr.h"
 #include "translate/translate.h"
 #include "translate/translate_cache.h"
@@ -140,6 +141,22 @@ enum {
    VB_NUM = 3
 };
 
+/* Number of index ranges remembered; must be a power of two. */
+#define U_VBUF_INDEX_RANGE_CACHE_SIZE 64
+
+/* The smallest and largest index of a range of an index buffer.
+ * Apps drawing from static index buffers hit the same ranges over and over,
+ * so they are remembered until the buffer is written to. */
+struct u_vbuf_index_range {
+   struct pipe_resource *buffer; /* NULL if the entry is unused */
+   unsigned offset;              /* in bytes */
+   unsigned count;
+   unsigned index_size;
+   unsigned restart_index;
+   boolean primitive_restart;
+   int min_index, max_index;
+};
+
 struct u_vbuf {
    struct u_vbuf_caps caps;
 
@@ -184,6 +201,9 @@ struct u_vbuf {
    uint32_t incompatible_vb_mask; /* each bit describes a corresp. buffer */
    /* Which buffer has a non-zero stride. */
    uint32_t nonzero_stride_vb_mask; /* each bit describes a corresp. buffer */
+
+   /* Index ranges of non-user index buffers, direct-mapped. */
+   struct u_vbuf_index_range index_ranges[U_VBUF_INDEX_RANGE_CACHE_SIZE];
 };
 
 static void *
@@ -328,7 +348,7 @@ u_vbuf_set_vertex_elements_internal(struct u_vbuf *mgr, unsigned count,
 {
    struct pipe_context *pipe = mgr->pipe;
    unsigned key_size, hash_key;
-   struct cso_hash_iter iter;
+   void *cached;
    struct u_vbuf_elements *ve;
    struct cso_velems_state velems_state;
 
@@ -338,20 +358,20 @@ u_vbuf_set_vertex_elements_internal(struct u_vbuf *mgr, unsigned count,
    memcpy(velems_state.velems, states,
           sizeof(struct pipe_vertex_element) * count);
    hash_key = cso_construct_key((void*)&velems_state, key_size);
-   iter = cso_find_state_template(mgr->cso_cache, hash_key, CSO_VELEMENTS,
-                                  (void*)&velems_state, key_size);
+   cached = cso_find_state_template(mgr->cso_cache, hash_key, CSO_VELEMENTS,
+                                    &velems_state, key_size);
 
-   if (cso_hash_iter_is_null(iter)) {
+   if (!cached) {
       struct cso_velements *cso = MALLOC_STRUCT(cso_velements);
       memcpy(&cso->state, &velems_state, key_size);
       cso->data = u_vbuf_create_vertex_elements(mgr, count, states);
       cso->delete_state = (cso_state_callback)u_vbuf_delete_vertex_elements;
       cso->context = (void*)mgr;
 
-      iter = cso_insert_state(mgr->cso_cache, hash_key, CSO_VELEMENTS, cso);
+      cso_insert_state(mgr->cso_cache, hash_key, CSO_VELEMENTS, cso);
       ve = cso->data;
    } else {
-      ve = ((struct cso_velements *)cso_hash_iter_data(iter))->data;
+      ve = ((struct cso_velements *)cached)->data;
    }
 
    assert(ve);
@@ -388,6 +408,8 @@ void u_vbuf_destroy(struct u_vbuf *mgr)
    }
    pipe_resource_reference(&mgr->aux_vertex_buffer_saved.buffer, NULL);
 
+   u_vbuf_invalidate_index_ranges(mgr, NULL);
+
    translate_cache_destroy(mgr->translate_cache);
    u_upload_destroy(mgr->uploader);
    cso_cache_delete(mgr->cso_cache);
@@ -1021,7 +1043,20 @@ static boolean u_vbuf_mapping_vertex_buffer_blocks(struct u_vbuf *mgr)
             mgr->nonzero_stride_vb_mask)) != 0;
 }
 
-static void u_vbuf_get_minmax_index(struct pipe_context *pipe,
+void u_vbuf_invalidate_index_ranges(struct u_vbuf *mgr,
+                                    struct pipe_resource *buffer)
+{
+   unsigned i;
+
+   for (i = 0; i < U_VBUF_INDEX_RANGE_CACHE_SIZE; i++) {
+      struct u_vbuf_index_range *range = &mgr->index_ranges[i];
+
+      if (range->buffer && (!buffer || range->buffer == buffer))
+         pipe_resource_reference(&range->buffer, NULL);
+   }
+}
+
+static void u_vbuf_get_minmax_index(struct u_vbuf *mgr,
                                     struct pipe_index_buffer *ib,
                                     boolean primitive_restart,
                                     unsigned restart_index,
@@ -1030,94 +1065,53 @@ static void u_vbuf_get_minmax_index(struct pipe_context *pipe,
                                     int *out_max_index)
 {
    struct pipe_transfer *transfer = NULL;
+   struct u_vbuf_index_range *range = NULL;
+   unsigned offset = ib->offset + start * ib->index_size;
+   unsigned min, max;
    const void *indices;
-   unsigned i;
 
    if (ib->user_buffer) {
-      indices = (uint8_t*)ib->user_buffer +
-                ib->offset + start * ib->index_size;
+      indices = (uint8_t*)ib->user_buffer + offset;
    } else {
-      indices = pipe_buffer_map_range(pipe, ib->buffer,
-                                      ib->offset + start * ib->index_size,
+      uintptr_t hash = (uintptr_t)ib->buffer / sizeof(struct pipe_resource);
+
+      hash ^= offset ^ (count * 31);
+      range = &mgr->index_ranges[hash & (U_VBUF_INDEX_RANGE_CACHE_SIZE - 1)];
+
+      if (range->buffer == ib->buffer &&
+          range->offset == offset &&
+          range->count == count &&
+          range->index_size == ib->index_size &&
+          range->primitive_restart == primitive_restart &&
+          (!primitive_restart || range->restart_index == restart_index)) {
+         *out_min_index = range->min_index;
+         *out_max_index = range->max_index;
+         return;
+      }
+
+      indices = pipe_buffer_map_range(mgr->pipe, ib->buffer, offset,
                                       count * ib->index_size,
                                       PIPE_TRANSFER_READ, &transfer);
    }
 
-   switch (ib->index_size) {
-   case 4: {
-      const unsigned *ui_indices = (const unsigned*)indices;
-      unsigned max_ui = 0;
-      unsigned min_ui = ~0U;
-      if (primitive_restart) {
-         for (i = 0; i < count; i++) {
-            if (ui_indices[i] != restart_index) {
-               if (ui_indices[i] > max_ui) max_ui = ui_indices[i];
-               if (ui_indices[i] < min_ui) min_ui = ui_indices[i];
-            }
-         }
-      }
-      else {
-         for (i = 0; i < count; i++) {
-            if (ui_indices[i] > max_ui) max_ui = ui_indices[i];
-            if (ui_indices[i] < min_ui) min_ui = ui_indices[i];
-         }
-      }
-      *out_min_index = min_ui;
-      *out_max_index = max_ui;
-      break;
-   }
-   case 2: {
-      const unsigned short *us_indices = (const unsigned short*)indices;
-      unsigned max_us = 0;
-      unsigned min_us = ~0U;
-      if (primitive_restart) {
-         for (i = 0; i < count; i++) {
-            if (us_indices[i] != restart_index) {
-               if (us_indices[i] > max_us) max_us = us_indices[i];
-               if (us_indices[i] < min_us) min_us = us_indices[i];
-            }
-         }
-      }
-      else {
-         for (i = 0; i < count; i++) {
-            if (us_indices[i] > max_us) max_us = us_indices[i];
-            if (us_indices[i] < min_us) min_us = us_indices[i];
-         }
-      }
-      *out_min_index = min_us;
-      *out_max_index = max_us;
-      break;
-   }
-   case 1: {
-      const unsigned char *ub_indices = (const unsigned char*)indices;
-      unsigned max_ub = 0;
-      unsigned min_ub = ~0U;
-      if (primitive_restart) {
-         for (i = 0; i < count; i++) {
-            if (ub_indices[i] != restart_index) {
-               if (ub_indices[i] > max_ub) max_ub = ub_indices[i];
-               if (ub_indices[i] < min_ub) min_ub = ub_indices[i];
-            }
-         }
-      }
-      else {
-         for (i = 0; i < count; i++) {
-            if (ub_indices[i] > max_ub) max_ub = ub_indices[i];
-            if (ub_indices[i] < min_ub) min_ub = ub_indices[i];
-         }
-      }
-      *out_min_index = min_ub;
-      *out_max_index = max_ub;
-      break;
-   }
-   default:
-      assert(0);
-      *out_min_index = 0;
-      *out_max_index = 0;
-   }
+   util_get_minmax_index(indices, ib->index_size, count,
+                         primitive_restart, restart_index, &min, &max);
+   *out_min_index = min;
+   *out_max_index = max;
 
    if (transfer) {
-      pipe_buffer_unmap(pipe, transfer);
+      pipe_buffer_unmap(mgr->pipe, transfer);
+   }
+
+   if (range) {
+      pipe_resource_reference(&range->buffer, ib->buffer);
+      range->offset = offset;
+      range->count = count;
+      range->index_size = ib->index_size;
+      range->primitive_restart = primitive_restart;
+      range->restart_index = restart_index;
+      range->min_index = *out_min_index;
+      range->max_index = *out_max_index;
    }
 }
 
@@ -1196,7 +1190,7 @@ void u_vbuf_draw_vbo(struct u_vbuf *mgr, const struct pipe_draw_info *info)
             min_index = new_info.min_index;
             max_index = new_info.max_index;
          } else {
-            u_vbuf_get_minmax_index(mgr->pipe, &mgr->index_buffer,
+            u_vbuf_get_minmax_index(mgr, &mgr->index_buffer,
                                     new_info.primitive_restart,
                                     new_info.restart_index, new_info.start,
                                     new_info.count, &min_index, &max_index);
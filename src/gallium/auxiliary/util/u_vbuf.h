@@ -73,6 +73,11 @@ void u_vbuf_set_index_buffer(struct u_vbuf *mgr,
                              const struct pipe_index_buffer *ib);
 void u_vbuf_draw_vbo(struct u_vbuf *mgr, const struct pipe_draw_info *info);
 
+/* Must be called when the contents of a buffer change, so that cached
+ * index ranges are recomputed.  NULL means all buffers. */
+void u_vbuf_invalidate_index_ranges(struct u_vbuf *mgr,
+                                    struct pipe_resource *buffer);
+
 /* Save/restore functionality. */
 void u_vbuf_save_vertex_elements(struct u_vbuf *mgr);
 void u_vbuf_restore_vertex_elements(struct u_vbuf *mgr);
@@ -92,6 +92,8 @@ static void llvmpipe_destroy( struct pipe_context *pipe )
    }
 
    lp_delete_setup_variants(llvmpipe);
+   if (llvmpipe->setup_variants_hash)
+      cso_hash_delete(llvmpipe->setup_variants_hash);
 
    LLVMContextDispose(llvmpipe->context);
    llvmpipe->context = NULL;
@@ -168,6 +170,10 @@ llvmpipe_create_context( struct pipe_screen *screen, void *priv )
    if (!llvmpipe->context)
       goto fail;
 
+   llvmpipe->setup_variants_hash = cso_hash_create();
+   if (!llvmpipe->setup_variants_hash)
+      goto fail;
+
    /*
     * Create drawing context and plug our rendering stage into it.
     */
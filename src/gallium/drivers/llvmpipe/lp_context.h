@@ -146,8 +146,13 @@ struct llvmpipe_context {
    unsigned nr_fs_variants;
    unsigned nr_fs_instrs;
 
+   /** Variants built per tier, for the LP_QUERY_FS_*_COMPILES queries */
+   uint64_t nr_fs_tier_compiles[LP_FS_NUM_TIERS];
+
    struct lp_setup_variant_list_item setup_variants_list;
+   struct cso_hash *setup_variants_hash;  /**< by key_hash */
    unsigned nr_setup_variants;
+   unsigned nr_setup_variants_evicted;
 
    /** Conditional query object and mode */
    struct pipe_query *render_cond_query;
@@ -61,7 +61,19 @@
 #define LP_MAX_WIDTH  (1 << (LP_MAX_TEXTURE_LEVELS - 1))
 
 
-#define LP_MAX_THREADS 16
+/**
+ * Upper bound on the number of rasterizer threads.  The rasterizer
+ * allocates its tasks at runtime, based on the number of CPUs, so this
+ * only bounds per-thread bookkeeping like the scene's bin queues.
+ */
+#define LP_MAX_THREADS 256
+
+
+/**
+ * Max number of scenes per setup context.  The actual number of scenes
+ * in flight is chosen at screen creation time (see LP_NUM_SCENES).
+ */
+#define LP_MAX_SCENES 8
 
 
 /**
@@ -83,6 +95,14 @@
  */
 #define LP_MAX_SHADER_INSTRUCTIONS MAX2(256*1024, 512*LP_MAX_SHADER_VARIANTS)
 
+/**
+ * Number of invocations (binned shading commands) after which a fragment
+ * shader variant gets rebuilt in the background at the optimized and hot
+ * tiers respectively.  Only used with LP_ASYNC_COMPILE.
+ */
+#define LP_FS_OPTIMIZED_INVOCATIONS 256
+#define LP_FS_HOT_INVOCATIONS (64 * 1024)
+
 /**
  * Max number of setup variants that will be kept around.
  *
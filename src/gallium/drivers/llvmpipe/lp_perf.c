@@ -102,9 +102,43 @@ lp_print_counters(void)
       debug_printf("llvmpipe: nr_color_tile_load:           %9u\n", lp_count.nr_color_tile_load);
       debug_printf("llvmpipe: nr_color_tile_store:          %9u\n", lp_count.nr_color_tile_store);
 
+      debug_printf("llvmpipe: nr_scene_block_allocs:        %9u\n", lp_count.nr_scene_block_allocs);
+      debug_printf("llvmpipe: nr_scene_block_reuses:        %9u\n", lp_count.nr_scene_block_reuses);
+      debug_printf("llvmpipe: scene size high water:        %9u KB\n", lp_count.scene_size_high_water / 1024);
+      debug_printf("llvmpipe: scene arena high water:       %9u KB\n", lp_count.scene_arena_high_water / 1024);
+
       debug_printf("llvmpipe: nr_llvm_compiles:             %u\n", lp_count.nr_llvm_compiles);
       debug_printf("llvmpipe: total LLVM compile time:      %.2f sec\n", lp_count.llvm_compile_time / 1000000.0);
       debug_printf("llvmpipe: average LLVM compile time:    %.2f sec\n", lp_count.llvm_compile_time / 1000000.0 / lp_count.nr_llvm_compiles);
-
+      debug_printf("llvmpipe: nr_llvm_tier_compiles:        %u\n", lp_count.nr_llvm_tier_compiles);
+      debug_printf("llvmpipe: nr_llvm_hot_compiles:         %u\n", lp_count.nr_llvm_hot_compiles);
+
+      {
+         unsigned i, nr_tasks = 0;
+         int64_t total_time = 0, max_time = 0;
+
+         for (i = 0; i < LP_MAX_THREADS; i++) {
+            const struct lp_task_counters *task = &lp_count.task[i];
+
+            if (!task->nr_bins)
+               continue;
+
+            debug_printf("llvmpipe: task %2u: nr_bins: %9u  nr_stolen_bins: %9u  busy: %.3f sec\n",
+                         i, task->nr_bins, task->nr_stolen_bins,
+                         task->busy_time / 1000000.0);
+
+            nr_tasks++;
+            total_time += task->busy_time;
+            max_time = MAX2(max_time, task->busy_time);
+         }
+
+         if (nr_tasks && total_time) {
+            /* 1.0 means perfectly balanced, nr_tasks means one task did
+             * all the work.
+             */
+            debug_printf("llvmpipe: task imbalance (max/avg busy): %.2f\n",
+                         (double) max_time * nr_tasks / (double) total_time);
+         }
+      }
    }
 }
@@ -34,6 +34,20 @@
 #define LP_PERF_H
 
 #include "pipe/p_compiler.h"
+#include "lp_limits.h"
+
+
+/**
+ * Per rasterizer task counters, to see how evenly the bins of the
+ * scenes are spread over the threads.
+ */
+struct lp_task_counters
+{
+   unsigned nr_bins;         /**< bins rasterized */
+   unsigned nr_stolen_bins;  /**< bins taken from another task's queue */
+   int64_t busy_time;        /**< time spent rasterizing, in microseconds */
+};
+
 
 /**
  * Various counters
@@ -58,10 +72,19 @@ struct lp_counters
    unsigned nr_non_empty_4;
    unsigned nr_llvm_compiles;
    int64_t llvm_compile_time;  /**< total, in microseconds */
+   unsigned nr_llvm_tier_compiles;  /**< background rebuilds at -O2 */
+   unsigned nr_llvm_hot_compiles;   /**< background rebuilds at -O3 */
 
    unsigned nr_color_tile_clear;
    unsigned nr_color_tile_load;
    unsigned nr_color_tile_store;
+
+   unsigned nr_scene_block_allocs;
+   unsigned nr_scene_block_reuses;
+   unsigned scene_size_high_water;   /**< in bytes */
+   unsigned scene_arena_high_water;  /**< in bytes */
+
+   struct lp_task_counters task[LP_MAX_THREADS];
 };
 
 
@@ -73,10 +96,18 @@ extern struct lp_counters lp_count;
 #define LP_COUNT(counter) lp_count.counter++
 #define LP_COUNT_ADD(counter, incr)  lp_count.counter += (incr)
 #define LP_COUNT_GET(counter) (lp_count.counter)
+#define LP_COUNT_MAX(counter, val) \
+   lp_count.counter = MAX2(lp_count.counter, (val))
+#define LP_COUNT_TASK(idx, counter) lp_count.task[idx].counter++
+#define LP_COUNT_TASK_ADD(idx, counter, incr) \
+   lp_count.task[idx].counter += (incr)
 #else
 #define LP_COUNT(counter)
 #define LP_COUNT_ADD(counter, incr) (void)(incr)
 #define LP_COUNT_GET(counter) 0
+#define LP_COUNT_MAX(counter, val) (void)(val)
+#define LP_COUNT_TASK(idx, counter)
+#define LP_COUNT_TASK_ADD(idx, counter, incr) (void)(incr)
 #endif
 
 
@@ -48,19 +48,54 @@ static struct llvmpipe_query *llvmpipe_query( struct pipe_query *p )
    return (struct llvmpipe_query *)p;
 }
 
+static boolean
+is_driver_query(unsigned type)
+{
+   return type >= LP_QUERY_FS_QUICK_COMPILES &&
+          type <= LP_QUERY_VS_HOT_COMPILES;
+}
+
+
+/**
+ * Current value of the counter behind a driver specific query.
+ */
+static uint64_t
+get_driver_query_count(struct llvmpipe_context *llvmpipe, unsigned type)
+{
+   switch (type) {
+   case LP_QUERY_FS_QUICK_COMPILES:
+      return llvmpipe->nr_fs_tier_compiles[LP_FS_TIER_QUICK];
+   case LP_QUERY_FS_OPTIMIZED_COMPILES:
+      return llvmpipe->nr_fs_tier_compiles[LP_FS_TIER_OPTIMIZED];
+   case LP_QUERY_FS_HOT_COMPILES:
+      return llvmpipe->nr_fs_tier_compiles[LP_FS_TIER_HOT];
+   case LP_QUERY_VS_HOT_COMPILES:
+      return draw_get_shader_hot_recompiles(llvmpipe->draw);
+   default:
+      assert(0);
+      return 0;
+   }
+}
+
+
 static struct pipe_query *
 llvmpipe_create_query(struct pipe_context *pipe, 
                       unsigned type,
                       unsigned index)
 {
+   struct llvmpipe_screen *screen = llvmpipe_screen(pipe->screen);
+   unsigned num_threads = MAX2(1, screen->num_threads);
    struct llvmpipe_query *pq;
 
-   assert(type < PIPE_QUERY_TYPES);
+   assert(type < PIPE_QUERY_TYPES || is_driver_query(type));
 
-   pq = CALLOC_STRUCT( llvmpipe_query );
+   /* The per-thread counters live right after the query object */
+   pq = CALLOC(1, sizeof *pq + 2 * num_threads * sizeof(uint64_t));
 
    if (pq) {
       pq->type = type;
+      pq->start = (uint64_t *) (pq + 1);
+      pq->end = pq->start + num_threads;
    }
 
    return (struct pipe_query *) pq;
@@ -164,6 +199,12 @@ llvmpipe_get_query_result(struct pipe_context *pipe,
       stats->primitives_storage_needed = pq->num_primitives_generated;
    }
       break;
+   case LP_QUERY_FS_QUICK_COMPILES:
+   case LP_QUERY_FS_OPTIMIZED_COMPILES:
+   case LP_QUERY_FS_HOT_COMPILES:
+   case LP_QUERY_VS_HOT_COMPILES:
+      *result = pq->end_count - pq->begin_count;
+      break;
    case PIPE_QUERY_PIPELINE_STATISTICS: {
       struct pipe_query_data_pipeline_statistics *stats =
          (struct pipe_query_data_pipeline_statistics *)vresult;
@@ -188,8 +229,16 @@ static void
 llvmpipe_begin_query(struct pipe_context *pipe, struct pipe_query *q)
 {
    struct llvmpipe_context *llvmpipe = llvmpipe_context( pipe );
+   struct llvmpipe_screen *screen = llvmpipe_screen(pipe->screen);
+   unsigned num_threads = MAX2(1, screen->num_threads);
    struct llvmpipe_query *pq = llvmpipe_query(q);
 
+   /* Driver specific queries aren't binned */
+   if (is_driver_query(pq->type)) {
+      pq->begin_count = get_driver_query_count(llvmpipe, pq->type);
+      return;
+   }
+
    /* Check if the query is already in the scene.  If so, we need to
     * flush the scene now.  Real apps shouldn't re-use a query in a
     * frame of rendering.
@@ -199,8 +248,8 @@ llvmpipe_begin_query(struct pipe_context *pipe, struct pipe_query *q)
    }
 
 
-   memset(pq->start, 0, sizeof(pq->start));
-   memset(pq->end, 0, sizeof(pq->end));
+   memset(pq->start, 0, num_threads * sizeof(pq->start[0]));
+   memset(pq->end, 0, num_threads * sizeof(pq->end[0]));
    lp_setup_begin_query(llvmpipe->setup, pq);
 
    switch (pq->type) {
@@ -244,6 +293,11 @@ llvmpipe_end_query(struct pipe_context *pipe, struct pipe_query *q)
    struct llvmpipe_context *llvmpipe = llvmpipe_context( pipe );
    struct llvmpipe_query *pq = llvmpipe_query(q);
 
+   if (is_driver_query(pq->type)) {
+      pq->end_count = get_driver_query_count(llvmpipe, pq->type);
+      return;
+   }
+
    lp_setup_end_query(llvmpipe->setup, pq);
 
    switch (pq->type) {
@@ -35,19 +35,28 @@
 
 #include <limits.h>
 #include "os/os_thread.h"
+#include "pipe/p_defines.h"
 #include "lp_limits.h"
 
 
 struct llvmpipe_context;
 
 
+/* Driver specific queries, for the HUD */
+#define LP_QUERY_FS_QUICK_COMPILES      (PIPE_QUERY_DRIVER_SPECIFIC + 0)
+#define LP_QUERY_FS_OPTIMIZED_COMPILES  (PIPE_QUERY_DRIVER_SPECIFIC + 1)
+#define LP_QUERY_FS_HOT_COMPILES        (PIPE_QUERY_DRIVER_SPECIFIC + 2)
+#define LP_QUERY_VS_HOT_COMPILES        (PIPE_QUERY_DRIVER_SPECIFIC + 3)
+
+
 struct llvmpipe_query {
-   uint64_t start[LP_MAX_THREADS];  /* start count value for each thread */
-   uint64_t end[LP_MAX_THREADS];    /* end count value for each thread */
+   uint64_t *start;                 /* start count value for each thread */
+   uint64_t *end;                   /* end count value for each thread */
    struct lp_fence *fence;          /* fence from last scene this was binned in */
    unsigned type;                   /* PIPE_QUERY_* */
    unsigned num_primitives_generated;
    unsigned num_primitives_written;
+   uint64_t begin_count, end_count; /* for the LP_QUERY_x queries */
 
    struct pipe_query_data_pipeline_statistics stats;
 };
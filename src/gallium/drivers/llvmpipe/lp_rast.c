@@ -31,6 +31,7 @@
 #include "util/u_rect.h"
 #include "util/u_surface.h"
 #include "util/u_pack_color.h"
+#include "util/u_cpu_detect.h"
 
 #include "os/os_time.h"
 
@@ -67,16 +68,25 @@ lp_rast_begin( struct lp_rasterizer *rast,
    LP_DBG(DEBUG_RAST, "%s\n", __FUNCTION__);
 
    lp_scene_begin_rasterization( scene );
-   lp_scene_bin_iter_begin( scene );
+   lp_scene_bin_iter_begin( scene, MAX2(1, rast->num_threads) );
 }
 
 
+/**
+ * End rasterizing a scene.
+ * Called once per scene by one thread, after all threads are done with
+ * the scene.  The scene is handed back to the setup code for reuse.
+ */
 static void
 lp_rast_end( struct lp_rasterizer *rast )
 {
-   lp_scene_end_rasterization( rast->curr_scene );
+   struct lp_scene *scene = rast->curr_scene;
+
+   lp_scene_end_rasterization( scene );
 
    rast->curr_scene = NULL;
+
+   lp_scene_enqueue( scene->empty_queue, scene );
 }
 
 
@@ -655,13 +665,27 @@ rasterize_scene(struct lp_rasterizer_task *task,
       /* loop over scene bins, rasterize each */
       {
          struct cmd_bin *bin;
+         boolean stolen;
          int i, j;
+#ifdef DEBUG
+         int64_t start = os_time_get();
+#endif
 
          assert(scene);
-         while ((bin = lp_scene_bin_iter_next(scene, &i, &j))) {
+         while ((bin = lp_scene_bin_iter_next(scene, task->thread_index,
+                                              &i, &j, &stolen))) {
             if (!is_empty_bin( bin ))
                rasterize_bin(task, bin, i, j);
+
+            LP_COUNT_TASK(task->thread_index, nr_bins);
+            if (stolen)
+               LP_COUNT_TASK(task->thread_index, nr_stolen_bins);
          }
+
+#ifdef DEBUG
+         LP_COUNT_TASK_ADD(task->thread_index, busy_time,
+                           os_time_get() - start);
+#endif
       }
    }
 
@@ -676,6 +700,8 @@ rasterize_scene(struct lp_rasterizer_task *task,
 
 /**
  * Called by setup module when it has something for us to render.
+ * With rasterization threads this returns immediately and the scene
+ * is put back into its empty queue once it has been rendered.
  */
 void
 lp_rast_queue_scene( struct lp_rasterizer *rast,
@@ -718,29 +744,12 @@ lp_rast_queue_scene( struct lp_rasterizer *rast,
 }
 
 
-void
-lp_rast_finish( struct lp_rasterizer *rast )
-{
-   if (rast->num_threads == 0) {
-      /* nothing to do */
-   }
-   else {
-      int i;
-
-      /* wait for work to complete */
-      for (i = 0; i < rast->num_threads; i++) {
-         pipe_semaphore_wait(&rast->tasks[i].work_done);
-      }
-   }
-}
-
-
 /**
  * This is the thread's main entrypoint.
  * It's a simple loop:
  *   1. wait for work
  *   2. do work
- *   3. signal that we're done
+ *   3. hand the scene back to the setup code
  */
 static PIPE_THREAD_ROUTINE( thread_function, init_data )
 {
@@ -754,6 +763,13 @@ static PIPE_THREAD_ROUTINE( thread_function, init_data )
     */
    util_fpstate_set_denorms_to_zero(fpstate);
 
+   if (rast->pin_threads) {
+      unsigned cpu = task->thread_index % MAX2(1, util_cpu_caps.nr_cpus);
+      if (!pipe_thread_pin_to_cpu(cpu) && debug)
+         debug_printf("thread %d could not be pinned to cpu %u\n",
+                      task->thread_index, cpu);
+   }
+
    while (1) {
       /* wait for work */
       if (debug)
@@ -787,17 +803,12 @@ static PIPE_THREAD_ROUTINE( thread_function, init_data )
       /* wait for all threads to finish with this scene */
       pipe_barrier_wait( &rast->barrier );
 
-      /* XXX: shouldn't be necessary:
-       */
       if (task->thread_index == 0) {
          lp_rast_end( rast );
       }
 
-      /* signal done with work */
       if (debug)
          debug_printf("thread %d done working\n", task->thread_index);
-
-      pipe_semaphore_signal(&task->work_done);
    }
 
 #ifdef _WIN32
@@ -848,15 +859,29 @@ lp_rast_create( unsigned num_threads )
       goto no_full_scenes;
    }
 
-   for (i = 0; i < Elements(rast->tasks); i++) {
+   rast->num_threads = num_threads;
+
+   /* Even without threads we need one task to rasterize with */
+   rast->tasks = CALLOC(MAX2(1, num_threads), sizeof *rast->tasks);
+   if (!rast->tasks) {
+      goto no_tasks;
+   }
+
+   if (num_threads) {
+      rast->threads = CALLOC(num_threads, sizeof *rast->threads);
+      if (!rast->threads) {
+         goto no_threads;
+      }
+   }
+
+   for (i = 0; i < MAX2(1, num_threads); i++) {
       struct lp_rasterizer_task *task = &rast->tasks[i];
       task->rast = rast;
       task->thread_index = i;
    }
 
-   rast->num_threads = num_threads;
-
    rast->no_rast = debug_get_bool_option("LP_NO_RAST", FALSE);
+   rast->pin_threads = debug_get_bool_option("LP_PIN_THREADS", FALSE);
 
    create_rast_threads(rast);
 
@@ -867,6 +892,10 @@ lp_rast_create( unsigned num_threads )
 
    return rast;
 
+no_threads:
+   FREE(rast->tasks);
+no_tasks:
+   lp_scene_queue_destroy(rast->full_scenes);
 no_full_scenes:
    FREE(rast);
 no_rast:
@@ -911,6 +940,8 @@ void lp_rast_destroy( struct lp_rasterizer *rast )
 
    lp_scene_queue_destroy(rast->full_scenes);
 
+   FREE(rast->threads);
+   FREE(rast->tasks);
    FREE(rast);
 }
 
@@ -123,11 +123,14 @@ struct lp_rasterizer
    /** The scene currently being rasterized by the threads */
    struct lp_scene *curr_scene;
 
-   /** A task object for each rasterization thread */
-   struct lp_rasterizer_task tasks[LP_MAX_THREADS];
+   /** A task object for each rasterization thread (at least one) */
+   struct lp_rasterizer_task *tasks;
 
    unsigned num_threads;
-   pipe_thread threads[LP_MAX_THREADS];
+   pipe_thread *threads;
+
+   /** Pin each thread to a CPU (LP_PIN_THREADS) */
+   boolean pin_threads;
 
    /** For synchronizing the rasterization threads */
    pipe_barrier barrier;
@@ -31,9 +31,11 @@
 #include "util/u_inlines.h"
 #include "util/simple_list.h"
 #include "util/u_format.h"
+#include "util/u_atomic.h"
 #include "lp_scene.h"
 #include "lp_fence.h"
 #include "lp_debug.h"
+#include "lp_perf.h"
 
 
 #define RESOURCE_REF_SZ 32
@@ -46,23 +48,109 @@ struct resource_ref {
 };
 
 
+/** Data blocks start this far into their allocation, keeping data aligned */
+#define DATA_BLOCK_HEADER_SIZE align(sizeof(struct data_block), 16)
+
+
+void
+lp_scene_arena_init(struct lp_scene_arena *arena,
+                    unsigned max_scene_size)
+{
+   memset(arena, 0, sizeof *arena);
+   arena->next_block_size = DATA_BLOCK_SIZE;
+   arena->max_scene_size = MAX2(max_scene_size, LP_SCENE_MAX_SIZE);
+}
+
+
+/**
+ * Free the arena's blocks.  All scenes using it must have been destroyed.
+ */
+void
+lp_scene_arena_fini(struct lp_scene_arena *arena)
+{
+   struct data_block *block, *tmp;
+
+   for (block = arena->free_blocks; block; block = tmp) {
+      tmp = block->next;
+      arena->total_size -= block->size;
+      FREE(block);
+   }
+   arena->free_blocks = NULL;
+
+   assert(arena->total_size == 0);
+}
+
+
+/**
+ * Get a data block, preferably one a previous scene gave back.
+ */
+static struct data_block *
+lp_scene_arena_get_block(struct lp_scene_arena *arena)
+{
+   struct data_block *block = arena->free_blocks;
+   unsigned size;
+
+   if (block) {
+      arena->free_blocks = block->next;
+      block->used = 0;
+      block->next = NULL;
+      LP_COUNT(nr_scene_block_reuses);
+      return block;
+   }
+
+   size = arena->next_block_size;
+   block = MALLOC(DATA_BLOCK_HEADER_SIZE + size);
+   if (!block)
+      return NULL;
+
+   block->data = (ubyte *) block + DATA_BLOCK_HEADER_SIZE;
+   block->size = size;
+   block->used = 0;
+   block->next = NULL;
+
+   arena->next_block_size = MIN2(size * 2, DATA_BLOCK_MAX_SIZE);
+   arena->total_size += size;
+   arena->high_water = MAX2(arena->high_water, arena->total_size);
+
+   LP_COUNT(nr_scene_block_allocs);
+   LP_COUNT_MAX(scene_arena_high_water, arena->high_water);
+
+   return block;
+}
+
+
+static void
+lp_scene_arena_put_block(struct lp_scene_arena *arena,
+                         struct data_block *block)
+{
+   block->next = arena->free_blocks;
+   arena->free_blocks = block;
+}
+
+
 /**
  * Create a new scene object.
  * \param queue  the queue to put newly rendered/emptied scenes into
+ * \param arena  where to get the data blocks from
  */
 struct lp_scene *
-lp_scene_create( struct pipe_context *pipe )
+lp_scene_create( struct pipe_context *pipe,
+                 struct lp_scene_queue *queue,
+                 struct lp_scene_arena *arena )
 {
    struct lp_scene *scene = CALLOC_STRUCT(lp_scene);
    if (!scene)
       return NULL;
 
    scene->pipe = pipe;
+   scene->empty_queue = queue;
+   scene->arena = arena;
 
-   scene->data.head =
-      CALLOC_STRUCT(data_block);
-
-   pipe_mutex_init(scene->mutex);
+   scene->data.head = lp_scene_arena_get_block(arena);
+   if (!scene->data.head) {
+      FREE(scene);
+      return NULL;
+   }
 
 #ifdef DEBUG
    /* Do some scene limit sanity checks here */
@@ -90,9 +178,8 @@ void
 lp_scene_destroy(struct lp_scene *scene)
 {
    lp_fence_reference(&scene->fence, NULL);
-   pipe_mutex_destroy(scene->mutex);
    assert(scene->data.head->next == NULL);
-   FREE(scene->data.head);
+   lp_scene_arena_put_block(scene->arena, scene->data.head);
    FREE(scene);
 }
 
@@ -201,12 +288,14 @@ lp_scene_begin_rasterization(struct lp_scene *scene)
 
 
 /**
- * Free all the temporary data in a scene.
+ * Unmap the framebuffer surfaces.  Called by the rasterizer once all
+ * threads are done with the scene.  The scene's temporary data stays
+ * around until lp_scene_reset() is called by the setup code.
  */
 void
 lp_scene_end_rasterization(struct lp_scene *scene )
 {
-   int i, j;
+   int i;
 
    /* Unmap color buffers */
    for (i = 0; i < scene->fb.nr_cbufs; i++) {
@@ -229,6 +318,19 @@ lp_scene_end_rasterization(struct lp_scene *scene )
                               zsbuf->u.tex.first_layer);
       scene->zsbuf.map = NULL;
    }
+}
+
+
+/**
+ * Free all the temporary data in a scene so that it can be used for
+ * binning again.
+ * Must only be called by the setup code, once the scene is back in the
+ * empty queue (or was never handed to the rasterizer).
+ */
+void
+lp_scene_reset(struct lp_scene *scene )
+{
+   int i, j;
 
    /* Reset all command lists:
     */
@@ -271,7 +373,7 @@ lp_scene_end_rasterization(struct lp_scene *scene )
                       j, scene->resource_reference_size);
    }
 
-   /* Free all scene data blocks:
+   /* Give all but one scene data block back to the arena:
     */
    {
       struct data_block_list *list = &scene->data;
@@ -279,7 +381,7 @@ lp_scene_end_rasterization(struct lp_scene *scene )
 
       for (block = list->head->next; block; block = tmp) {
          tmp = block->next;
-	 FREE(block);
+         lp_scene_arena_put_block(scene->arena, block);
       }
 
       list->head->next = NULL;
@@ -327,24 +429,27 @@ lp_scene_new_cmd_block( struct lp_scene *scene,
 struct data_block *
 lp_scene_new_data_block( struct lp_scene *scene )
 {
-   if (scene->scene_size + DATA_BLOCK_SIZE > LP_SCENE_MAX_SIZE) {
+   struct lp_scene_arena *arena = scene->arena;
+   struct data_block *block;
+
+   block = lp_scene_arena_get_block(arena);
+   if (block == NULL)
+      return NULL;
+
+   if (scene->scene_size + block->size > arena->max_scene_size) {
       if (0) debug_printf("%s: failed\n", __FUNCTION__);
+      lp_scene_arena_put_block(arena, block);
       scene->alloc_failed = TRUE;
       return NULL;
    }
-   else {
-      struct data_block *block = MALLOC_STRUCT(data_block);
-      if (block == NULL)
-         return NULL;
-      
-      scene->scene_size += sizeof *block;
 
-      block->used = 0;
-      block->next = scene->data.head;
-      scene->data.head = block;
+   scene->scene_size += block->size;
+   LP_COUNT_MAX(scene_size_high_water, scene->scene_size);
 
-      return block;
-   }
+   block->next = scene->data.head;
+   scene->data.head = block;
+
+   return block;
 }
 
 
@@ -446,61 +551,133 @@ lp_scene_is_resource_referenced(const struct lp_scene *scene,
 
 
 
-/** advance curr_x,y to the next bin */
-static boolean
-next_bin(struct lp_scene *scene)
+/**
+ * Compute the Morton (Z) order of the scene's tiles, so that consecutive
+ * bins are close to each other in screen space.
+ */
+static void
+lp_scene_bin_order_init(struct lp_scene *scene)
 {
-   scene->curr_x++;
-   if (scene->curr_x >= scene->tiles_x) {
-      scene->curr_x = 0;
-      scene->curr_y++;
-   }
-   if (scene->curr_y >= scene->tiles_y) {
-      /* no more bins */
-      return FALSE;
+   unsigned size = util_next_power_of_two(MAX2(scene->tiles_x,
+                                                scene->tiles_y));
+   unsigned code, n = 0;
+
+   for (code = 0; code < size * size; code++) {
+      unsigned x = 0, y = 0, bit;
+
+      for (bit = 0; (1u << (2 * bit)) < size * size; bit++) {
+         x |= ((code >> (2 * bit)) & 1) << bit;
+         y |= ((code >> (2 * bit + 1)) & 1) << bit;
+      }
+
+      if (x < scene->tiles_x && y < scene->tiles_y)
+         scene->bin_order[n++] = x | (y << 8);
    }
-   return TRUE;
+
+   assert(n == scene->tiles_x * scene->tiles_y);
+   scene->num_bin_order = n;
+   scene->bin_order_tiles_x = scene->tiles_x;
+   scene->bin_order_tiles_y = scene->tiles_y;
 }
 
 
+/**
+ * Prepare the bin iterator.  The non-empty bins are split into
+ * num_queues contiguous runs of the Morton order, one per rasterizer
+ * task, so that each task starts out on a compact region of the screen.
+ * Called once per scene, before any thread calls lp_scene_bin_iter_next().
+ */
 void
-lp_scene_bin_iter_begin( struct lp_scene *scene )
+lp_scene_bin_iter_begin( struct lp_scene *scene, unsigned num_queues )
+{
+   unsigned i, n = 0;
+
+   assert(num_queues >= 1 && num_queues <= LP_MAX_THREADS);
+
+   if (scene->bin_order_tiles_x != scene->tiles_x ||
+       scene->bin_order_tiles_y != scene->tiles_y ||
+       scene->num_bin_order == 0)
+      lp_scene_bin_order_init(scene);
+
+   for (i = 0; i < scene->num_bin_order; i++) {
+      unsigned pos = scene->bin_order[i];
+      const struct cmd_bin *bin =
+         lp_scene_get_bin(scene, pos & 0xff, pos >> 8);
+      if (bin->head)
+         scene->active_bins[n++] = pos;
+   }
+   scene->num_active_bins = n;
+
+   scene->num_bin_queues = num_queues;
+   for (i = 0; i < num_queues; i++) {
+      unsigned head = i * n / num_queues;
+      unsigned tail = (i + 1) * n / num_queues;
+      scene->bin_queue[i] = head | (tail << 16);
+   }
+}
+
+
+/**
+ * Take a bin from the head (owner == TRUE) or tail (owner == FALSE) of
+ * the given deque.  Returns the index into active_bins or -1 if the
+ * deque is empty.
+ */
+static int
+bin_queue_pop(int32_t *queue, boolean owner)
 {
-   scene->curr_x = scene->curr_y = -1;
+   while (1) {
+      int32_t old = *queue;
+      unsigned head = old & 0xffff;
+      unsigned tail = (unsigned) old >> 16;
+      int32_t new;
+
+      if (head >= tail)
+         return -1;
+
+      if (owner)
+         new = (head + 1) | (tail << 16);
+      else
+         new = head | ((tail - 1) << 16);
+
+      if (p_atomic_cmpxchg(queue, old, new) == old)
+         return owner ? head : tail - 1;
+   }
 }
 
 
 /**
- * Return pointer to next bin to be rendered.
- * The lp_scene::curr_x and ::curr_y fields will be advanced.
- * Multiple rendering threads will call this function to get a chunk
- * of work (a bin) to work on.
+ * Return pointer to next bin to be rendered by the given task.
+ * Tasks take bins from the front of their own deque.  When that runs
+ * dry they steal from the back of the other tasks' deques, which is
+ * the work furthest away from what the owner is doing.
+ * Multiple rendering threads will call this function concurrently.
  */
 struct cmd_bin *
-lp_scene_bin_iter_next( struct lp_scene *scene , int *x, int *y)
+lp_scene_bin_iter_next( struct lp_scene *scene, unsigned queue,
+                        int *x, int *y, boolean *stolen )
 {
-   struct cmd_bin *bin = NULL;
+   unsigned pos, i;
+   int idx;
 
-   pipe_mutex_lock(scene->mutex);
+   assert(queue < scene->num_bin_queues);
 
-   if (scene->curr_x < 0) {
-      /* first bin */
-      scene->curr_x = 0;
-      scene->curr_y = 0;
-   }
-   else if (!next_bin(scene)) {
-      /* no more bins left */
-      goto end;
+   idx = bin_queue_pop(&scene->bin_queue[queue], TRUE);
+   *stolen = FALSE;
+
+   for (i = 1; idx < 0 && i < scene->num_bin_queues; i++) {
+      unsigned victim = (queue + i) % scene->num_bin_queues;
+      idx = bin_queue_pop(&scene->bin_queue[victim], FALSE);
+      *stolen = TRUE;
    }
 
-   bin = lp_scene_get_bin(scene, scene->curr_x, scene->curr_y);
-   *x = scene->curr_x;
-   *y = scene->curr_y;
+   if (idx < 0)
+      return NULL;
+
+   pos = scene->active_bins[idx];
+   *x = pos & 0xff;
+   *y = pos >> 8;
 
-end:
-   /*printf("return bin %p at %d, %d\n", (void *) bin, *bin_x, *bin_y);*/
-   pipe_mutex_unlock(scene->mutex);
-   return bin;
+   return lp_scene_get_bin(scene, *x, *y);
 }
 
 
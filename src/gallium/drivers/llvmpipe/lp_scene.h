@@ -38,6 +38,8 @@
 #include "os/os_thread.h"
 #include "lp_rast.h"
 #include "lp_debug.h"
+#include "lp_limits.h"
+#include "lp_state_fs.h"
 
 struct lp_scene_queue;
 struct lp_rast_state;
@@ -54,11 +56,15 @@ struct lp_rast_state;
  */
 #define CMD_BLOCK_MAX 29
 
-/* Bytes per data block.
+/* Bytes per data block.  This is the size of the first blocks of a context
+ * and of the biggest allocation possible; later blocks grow geometrically up
+ * to DATA_BLOCK_MAX_SIZE.
  */
 #define DATA_BLOCK_SIZE (64 * 1024)
+#define DATA_BLOCK_MAX_SIZE (1024 * 1024)
 
-/* Scene temporary storage is clamped to this size:
+/* Scene temporary storage is clamped to this size by default (see
+ * LP_SCENE_MAX_SIZE env var):
  */
 #define LP_SCENE_MAX_SIZE (9*1024*1024)
 
@@ -83,7 +89,8 @@ struct cmd_block {
 
 
 struct data_block {
-   ubyte data[DATA_BLOCK_SIZE];
+   ubyte *data;
+   unsigned size;
    unsigned used;
    struct data_block *next;
 };
@@ -107,14 +114,30 @@ struct cmd_bin {
  * Examples include triangle data and state data.  The commands in
  * the per-tile bins will point to chunks of data in this structure.
  *
- * Include the first block of data statically to ensure we can always
- * initiate a scene without relying on malloc succeeding.
+ * A scene always keeps one block to ensure we can always initiate a scene
+ * without relying on malloc succeeding.
  */
 struct data_block_list {
-   struct data_block first;
    struct data_block *head;
 };
 
+
+/**
+ * Backing store for the data blocks of all the scenes of a context.
+ *
+ * Blocks go back here when a scene is reset instead of being freed, so that
+ * binning frame after frame doesn't keep hitting the system allocator.  New
+ * blocks double in size up to DATA_BLOCK_MAX_SIZE, so big scenes need few of
+ * them.  Only the setup code of the context uses it, so there's no locking.
+ */
+struct lp_scene_arena {
+   struct data_block *free_blocks;
+   unsigned next_block_size;  /**< size of the next block to allocate */
+   unsigned max_scene_size;   /**< scene temporary storage limit */
+   unsigned total_size;       /**< bytes in all blocks, free or in use */
+   unsigned high_water;       /**< maximum of total_size */
+};
+
 struct resource_ref;
 
 /**
@@ -129,6 +152,12 @@ struct lp_scene {
    struct pipe_context *pipe;
    struct lp_fence *fence;
 
+   /** The queue to put the scene into once it has been rasterized */
+   struct lp_scene_queue *empty_queue;
+
+   /** Where the data blocks come from */
+   struct lp_scene_arena *arena;
+
    /* The queries still active at end of scene */
    struct llvmpipe_query *active_queries[LP_MAX_ACTIVE_BINNED_QUERIES];
    unsigned num_active_queries;
@@ -172,8 +201,25 @@ struct lp_scene {
     */
    unsigned tiles_x, tiles_y;
 
-   int curr_x, curr_y;  /**< for iterating over bins */
-   pipe_mutex mutex;
+   /**
+    * All tile positions (x | y << 8) in Morton order, for the current
+    * tiles_x/tiles_y.  Only recomputed when the framebuffer size changes.
+    */
+   unsigned bin_order_tiles_x, bin_order_tiles_y;
+   unsigned num_bin_order;
+   uint16_t bin_order[TILES_X * TILES_Y];
+
+   /**
+    * The non-empty bins of the scene, in Morton order.  Split into one
+    * contiguous range (deque) per rasterizer task, see
+    * lp_scene_bin_iter_begin().
+    */
+   unsigned num_active_bins;
+   uint16_t active_bins[TILES_X * TILES_Y];
+
+   /** Per-task deques: head in the low 16 bits, tail in the high 16 bits */
+   unsigned num_bin_queues;
+   int32_t bin_queue[LP_MAX_THREADS];
 
    struct cmd_bin tile[TILES_X][TILES_Y];
    struct data_block_list data;
@@ -181,7 +227,14 @@ struct lp_scene {
 
 
 
-struct lp_scene *lp_scene_create(struct pipe_context *pipe);
+void lp_scene_arena_init(struct lp_scene_arena *arena,
+                         unsigned max_scene_size);
+
+void lp_scene_arena_fini(struct lp_scene_arena *arena);
+
+struct lp_scene *lp_scene_create(struct pipe_context *pipe,
+                                 struct lp_scene_queue *queue,
+                                 struct lp_scene_arena *arena);
 
 void lp_scene_destroy(struct lp_scene *scene);
 
@@ -217,10 +270,10 @@ lp_scene_alloc( struct lp_scene *scene, unsigned size)
 
    if (LP_DEBUG & DEBUG_MEM)
       debug_printf("alloc %u block %u/%u tot %u/%u\n",
-		   size, block->used, DATA_BLOCK_SIZE,
-		   scene->scene_size, LP_SCENE_MAX_SIZE);
+		   size, block->used, block->size,
+		   scene->scene_size, scene->arena->max_scene_size);
 
-   if (block->used + size > DATA_BLOCK_SIZE) {
+   if (block->used + size > block->size) {
       block = lp_scene_new_data_block( scene );
       if (!block) {
          /* out of memory */
@@ -251,10 +304,10 @@ lp_scene_alloc_aligned( struct lp_scene *scene, unsigned size,
    if (LP_DEBUG & DEBUG_MEM)
       debug_printf("alloc %u block %u/%u tot %u/%u\n",
 		   size + alignment - 1,
-		   block->used, DATA_BLOCK_SIZE,
-		   scene->scene_size, LP_SCENE_MAX_SIZE);
+		   block->used, block->size,
+		   scene->scene_size, scene->arena->max_scene_size);
        
-   if (block->used + size + alignment - 1 > DATA_BLOCK_SIZE) {
+   if (block->used + size + alignment - 1 > block->size) {
       block = lp_scene_new_data_block( scene );
       if (!block)
          return NULL;
@@ -347,6 +400,9 @@ lp_scene_bin_cmd_with_state( struct lp_scene *scene,
    if (!lp_scene_bin_command( scene, x, y, cmd, arg ))
       return FALSE;
 
+   /* For tiered compilation, see llvmpipe_tier_up_fs_variant() */
+   state->variant->nr_invocations++;
+
    return TRUE;
 }
 
@@ -378,10 +434,11 @@ lp_scene_get_num_bins( const struct lp_scene *scene )
 
 
 void
-lp_scene_bin_iter_begin( struct lp_scene *scene );
+lp_scene_bin_iter_begin( struct lp_scene *scene, unsigned num_queues );
 
 struct cmd_bin *
-lp_scene_bin_iter_next( struct lp_scene *scene, int *x, int *y );
+lp_scene_bin_iter_next( struct lp_scene *scene, unsigned queue,
+                        int *x, int *y, boolean *stolen );
 
 
 
@@ -404,6 +461,8 @@ lp_scene_begin_rasterization(struct lp_scene *scene);
 void
 lp_scene_end_rasterization(struct lp_scene *scene );
 
+void
+lp_scene_reset(struct lp_scene *scene );
 
 
 
@@ -35,10 +35,14 @@
 #include "util/u_ringbuffer.h"
 #include "util/u_memory.h"
 #include "lp_scene_queue.h"
+#include "lp_limits.h"
 
 
 
-#define MAX_SCENE_QUEUE 4
+/* The ring buffer always keeps one slot free, so make it twice as large
+ * as needed to hold all the scenes of a context.
+ */
+#define MAX_SCENE_QUEUE (2 * LP_MAX_SCENES)
 
 struct scene_packet {
    struct util_packet header;
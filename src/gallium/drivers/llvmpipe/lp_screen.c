@@ -47,6 +47,7 @@
 #include "lp_debug.h"
 #include "lp_public.h"
 #include "lp_limits.h"
+#include "lp_query.h"
 #include "lp_rast.h"
 
 #include "state_tracker/sw_winsys.h"
@@ -474,10 +475,35 @@ llvmpipe_flush_frontbuffer(struct pipe_screen *_screen,
    struct llvmpipe_screen *screen = llvmpipe_screen(_screen);
    struct sw_winsys *winsys = screen->winsys;
    struct llvmpipe_resource *texture = llvmpipe_resource(resource);
+   struct lp_fence *fence = NULL;
 
    assert(texture->dt);
-   if (texture->dt)
+   if (!texture->dt)
+      return;
+
+   /* Scenes are rasterized asynchronously: everything queued so far has
+    * landed in the display target once the last fence signals.
+    */
+   pipe_mutex_lock(screen->rast_mutex);
+   lp_fence_reference(&fence, screen->last_fence);
+   pipe_mutex_unlock(screen->rast_mutex);
+
+   if (winsys->displaytarget_display_fenced) {
+      /* Let the winsys wait for it, so the next frame can be binned and
+       * rasterized meanwhile.
+       */
+      winsys->displaytarget_display_fenced(winsys, texture->dt,
+                                           context_private, sub_box,
+                                           _screen,
+                                           (struct pipe_fence_handle *) fence);
+   }
+   else {
+      if (fence)
+         lp_fence_wait(fence);
       winsys->displaytarget_display(winsys, texture->dt, context_private, sub_box);
+   }
+
+   lp_fence_reference(&fence, NULL);
 }
 
 static void
@@ -489,6 +515,11 @@ llvmpipe_destroy_screen( struct pipe_screen *_screen )
    if (screen->rast)
       lp_rast_destroy(screen->rast);
 
+   if (screen->num_compile_threads)
+      util_queue_destroy(&screen->compile_queue);
+
+   lp_fence_reference(&screen->last_fence, NULL);
+
    lp_jit_screen_cleanup(screen);
 
    if(winsys->destroy)
@@ -549,6 +580,30 @@ llvmpipe_get_timestamp(struct pipe_screen *_screen)
    return os_time_get_nano();
 }
 
+
+static int
+llvmpipe_get_driver_query_info(struct pipe_screen *screen,
+                               unsigned index,
+                               struct pipe_driver_query_info *info)
+{
+   static const struct pipe_driver_query_info queries[] = {
+      {"fs-quick-compiles", LP_QUERY_FS_QUICK_COMPILES, 0, FALSE},
+      {"fs-optimized-compiles", LP_QUERY_FS_OPTIMIZED_COMPILES, 0, FALSE},
+      {"fs-hot-compiles", LP_QUERY_FS_HOT_COMPILES, 0, FALSE},
+      {"vs-hot-compiles", LP_QUERY_VS_HOT_COMPILES, 0, FALSE}
+   };
+
+   if (!info)
+      return Elements(queries);
+
+   if (index >= Elements(queries))
+      return 0;
+
+   *info = queries[index];
+   return 1;
+}
+
+
 /**
  * Create a new pipe_screen object
  * Note: we're not presently subclassing pipe_screen (no llvmpipe_screen).
@@ -577,6 +632,16 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
 
    screen->winsys = winsys;
 
+   /* Process as many pixels at once as the CPU's vector registers hold.
+    * 16-wide is only tested for interpolation, depth and color writes
+    * (lp_test_width), so it isn't the default on AVX-512 CPUs yet.
+    */
+   screen->fs_vector_length = lp_native_vector_width / 32;
+   screen->fs_vector_length = debug_get_num_option("LP_FS_VECTOR_LENGTH",
+                                                   screen->fs_vector_length);
+   if (screen->fs_vector_length != 8 && screen->fs_vector_length != 16)
+      screen->fs_vector_length = 4;
+
    screen->base.destroy = llvmpipe_destroy_screen;
 
    screen->base.get_name = llvmpipe_get_name;
@@ -593,9 +658,11 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
    screen->base.fence_finish = llvmpipe_fence_finish;
 
    screen->base.get_timestamp = llvmpipe_get_timestamp;
+   screen->base.get_driver_query_info = llvmpipe_get_driver_query_info;
 
    llvmpipe_init_screen_resource_funcs(&screen->base);
 
+   /* One rasterizer thread per CPU, the binning thread is the app's */
    screen->num_threads = util_cpu_caps.nr_cpus > 1 ? util_cpu_caps.nr_cpus : 0;
 #ifdef PIPE_SUBSYSTEM_EMBEDDED
    screen->num_threads = 0;
@@ -603,6 +670,14 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
    screen->num_threads = debug_get_num_option("LP_NUM_THREADS", screen->num_threads);
    screen->num_threads = MIN2(screen->num_threads, LP_MAX_THREADS);
 
+   /* Two scenes are enough to overlap binning with rasterization */
+   screen->num_scenes = debug_get_num_option("LP_NUM_SCENES", 2);
+   screen->num_scenes = CLAMP(screen->num_scenes, 1, LP_MAX_SCENES);
+
+   /* In megabytes; lp_scene_arena_init() raises it to the built-in limit */
+   screen->scene_max_size = debug_get_num_option("LP_SCENE_MAX_SIZE", 0);
+   screen->scene_max_size = MIN2(screen->scene_max_size, 1024) * 1024 * 1024;
+
    screen->rast = lp_rast_create(screen->num_threads);
    if (!screen->rast) {
       lp_jit_screen_cleanup(screen);
@@ -611,6 +686,17 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
    }
    pipe_mutex_init(screen->rast_mutex);
 
+   /* Off by default: it trades rendering speed for shorter stalls */
+   screen->num_compile_threads = debug_get_num_option("LP_ASYNC_COMPILE", 0);
+   screen->num_compile_threads = MIN2(screen->num_compile_threads,
+                                      LP_MAX_THREADS);
+   if (screen->num_compile_threads) {
+      if (util_queue_init(&screen->compile_queue, screen->num_compile_threads))
+         screen->num_compile_threads = screen->compile_queue.num_threads;
+      else
+         screen->num_compile_threads = 0;
+   }
+
    util_format_s3tc_init();
 
    return &screen->base;
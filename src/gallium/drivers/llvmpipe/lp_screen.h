@@ -37,10 +37,12 @@
 #include "pipe/p_screen.h"
 #include "pipe/p_defines.h"
 #include "os/os_thread.h"
+#include "util/u_queue.h"
 #include "gallivm/lp_bld.h"
 
 
 struct sw_winsys;
+struct lp_fence;
 
 
 struct llvmpipe_screen
@@ -51,12 +53,34 @@ struct llvmpipe_screen
 
    unsigned num_threads;
 
+   /**
+    * Number of pixels the fragment shader code processes at once (4, 8 or
+    * 16), picked from the SIMD width of the CPU.
+    */
+   unsigned fs_vector_length;
+
+   /** Number of scenes per context which can be in flight at once */
+   unsigned num_scenes;
+
+   /** Limit of the temporary storage of one scene, in bytes */
+   unsigned scene_max_size;
+
    /* Increments whenever textures are modified.  Contexts can track this.
     */
    unsigned timestamp;
 
    struct lp_rasterizer *rast;
    pipe_mutex rast_mutex;
+
+   /** Fence of the last scene queued for rasterization, by any context */
+   struct lp_fence *last_fence;
+
+   /**
+    * Threads compiling optimized fragment shader variants in the background,
+    * if num_compile_threads is not zero.
+    */
+   unsigned num_compile_threads;
+   struct util_queue compile_queue;
 };
 
 
@@ -44,6 +44,7 @@
 #include "lp_context.h"
 #include "lp_memory.h"
 #include "lp_scene.h"
+#include "lp_scene_queue.h"
 #include "lp_texture.h"
 #include "lp_debug.h"
 #include "lp_fence.h"
@@ -63,26 +64,32 @@ static boolean set_scene_state( struct lp_setup_context *, enum setup_state,
 static boolean try_update_scene_state( struct lp_setup_context *setup );
 
 
+/**
+ * Get a scene which is not in use by the rasterizer and prepare it for
+ * binning.  This only blocks if all the scenes of this context are
+ * still queued for (or being) rasterized.
+ */
 static void
 lp_setup_get_empty_scene(struct lp_setup_context *setup)
 {
-   assert(setup->scene == NULL);
+   struct lp_scene *scene;
 
-   setup->scene_idx++;
-   setup->scene_idx %= Elements(setup->scenes);
-
-   setup->scene = setup->scenes[setup->scene_idx];
+   assert(setup->scene == NULL);
 
-   if (setup->scene->fence) {
+   scene = lp_scene_dequeue(setup->empty_scenes, FALSE);
+   if (!scene) {
       if (LP_DEBUG & DEBUG_SETUP)
-         debug_printf("%s: wait for scene %d\n",
-                      __FUNCTION__, setup->scene->fence->id);
+         debug_printf("%s: wait for a scene\n", __FUNCTION__);
 
-      lp_fence_wait(setup->scene->fence);
+      scene = lp_scene_dequeue(setup->empty_scenes, TRUE);
    }
 
-   lp_scene_begin_binning(setup->scene, &setup->fb, setup->rasterizer_discard);
+   /* Release whatever the scene still holds from its last use */
+   lp_scene_reset(scene);
+
+   setup->scene = scene;
 
+   lp_scene_begin_binning(setup->scene, &setup->fb, setup->rasterizer_discard);
 }
 
 
@@ -164,23 +171,16 @@ lp_setup_rasterize_scene( struct lp_setup_context *setup )
    if (setup->last_fence)
       setup->last_fence->issued = TRUE;
 
-   pipe_mutex_lock(screen->rast_mutex);
-
-   /* FIXME: We enqueue the scene then wait on the rasterizer to finish.
-    * This means we never actually run any vertex stuff in parallel to
-    * rasterization (not in the same context at least) which is what the
-    * multiple scenes per setup is about - when we get a new empty scene
-    * any old one is already empty again because we waited here for
-    * raster tasks to be finished. Ideally, we shouldn't need to wait here
-    * and rely on fences elsewhere when waiting is necessary.
-    * Certainly, lp_scene_end_rasterization() would need to be deferred too
-    * and there's probably other bits why this doesn't actually work.
+   /* We don't wait for the rasterizer here.  The scene comes back to us
+    * through setup->empty_scenes once it has been rendered, and anybody
+    * who needs the results waits on the scene's fence.  This lets us bin
+    * the next scene while the rasterizer threads work on this one.
     */
+   pipe_mutex_lock(screen->rast_mutex);
+   lp_fence_reference(&screen->last_fence, scene->fence);
    lp_rast_queue_scene(screen->rast, scene);
-   lp_rast_finish(screen->rast);
    pipe_mutex_unlock(screen->rast_mutex);
 
-   lp_scene_end_rasterization(setup->scene);
    lp_setup_reset( setup );
 
    LP_DBG(DEBUG_SETUP, "%s done \n", __FUNCTION__);
@@ -341,7 +341,8 @@ set_scene_state( struct lp_setup_context *setup,
 
 fail:
    if (setup->scene) {
-      lp_scene_end_rasterization(setup->scene);
+      lp_scene_reset(setup->scene);
+      lp_scene_enqueue(setup->empty_scenes, setup->scene);
       setup->scene = NULL;
    }
 
@@ -973,9 +974,28 @@ lp_setup_is_resource_referenced( const struct lp_setup_context *setup,
       return LP_REFERENCED_FOR_READ | LP_REFERENCED_FOR_WRITE;
    }
 
-   /* check textures referenced by the scene */
-   for (i = 0; i < Elements(setup->scenes); i++) {
-      if (lp_scene_is_resource_referenced(setup->scenes[i], texture)) {
+   /* check the render targets and textures referenced by the scenes.
+    * Scenes which have already been rasterized may still hold references
+    * until they get reused, but they don't access the resources anymore.
+    * A queued scene may target a different framebuffer than the current
+    * one, and its render targets aren't in its resource list.
+    */
+   for (i = 0; i < setup->num_scenes; i++) {
+      struct lp_scene *scene = setup->scenes[i];
+      unsigned j;
+
+      if (scene->fence && lp_fence_signalled(scene->fence))
+         continue;
+
+      for (j = 0; j < scene->fb.nr_cbufs; j++) {
+         if (scene->fb.cbufs[j] && scene->fb.cbufs[j]->texture == texture)
+            return LP_REFERENCED_FOR_READ | LP_REFERENCED_FOR_WRITE;
+      }
+      if (scene->fb.zsbuf && scene->fb.zsbuf->texture == texture) {
+         return LP_REFERENCED_FOR_READ | LP_REFERENCED_FOR_WRITE;
+      }
+
+      if (lp_scene_is_resource_referenced(scene, texture)) {
          return LP_REFERENCED_FOR_READ;
       }
    }
@@ -1197,6 +1217,9 @@ lp_setup_update_state( struct lp_setup_context *setup,
 
       assert(setup->setup.variant);
 
+      if (setup->fs.current.variant)
+         llvmpipe_tier_up_fs_variant(lp, setup->fs.current.variant);
+
       /* Will probably need to move this somewhere else, just need  
        * to know about vertex shader point size attribute.
        */
@@ -1258,6 +1281,12 @@ lp_setup_destroy( struct lp_setup_context *setup )
 {
    uint i;
 
+   /* Give back the scene we were building, if any */
+   if (setup->scene) {
+      lp_scene_reset(setup->scene);
+      lp_scene_enqueue(setup->empty_scenes, setup->scene);
+   }
+
    lp_setup_reset( setup );
 
    util_unreference_framebuffer_state(&setup->fb);
@@ -1270,16 +1299,20 @@ lp_setup_destroy( struct lp_setup_context *setup )
       pipe_resource_reference(&setup->constants[i].current.buffer, NULL);
    }
 
-   /* free the scenes in the 'empty' queue */
-   for (i = 0; i < Elements(setup->scenes); i++) {
-      struct lp_scene *scene = setup->scenes[i];
-
-      if (scene->fence)
-         lp_fence_wait(scene->fence);
+   /* wait for all the scenes to come back from the rasterizer */
+   for (i = 0; i < setup->num_scenes; i++) {
+      struct lp_scene *scene = lp_scene_dequeue(setup->empty_scenes, TRUE);
+      lp_scene_reset(scene);
+   }
 
-      lp_scene_destroy(scene);
+   /* free the scenes */
+   for (i = 0; i < setup->num_scenes; i++) {
+      lp_scene_destroy(setup->scenes[i]);
    }
 
+   lp_scene_queue_destroy(setup->empty_scenes);
+   lp_scene_arena_fini(&setup->scene_arena);
+
    lp_fence_reference(&setup->last_fence, NULL);
 
    FREE( setup );
@@ -1312,6 +1345,7 @@ lp_setup_create( struct pipe_context *pipe,
 
 
    setup->num_threads = screen->num_threads;
+   setup->num_scenes = screen->num_scenes;
    setup->vbuf = draw_vbuf_stage(draw, &setup->base);
    if (!setup->vbuf) {
       goto no_vbuf;
@@ -1320,14 +1354,26 @@ lp_setup_create( struct pipe_context *pipe,
    draw_set_rasterize_stage(draw, setup->vbuf);
    draw_set_render(draw, &setup->base);
 
+   lp_scene_arena_init(&setup->scene_arena, screen->scene_max_size);
+
+   setup->empty_scenes = lp_scene_queue_create();
+   if (!setup->empty_scenes) {
+      goto no_scenes;
+   }
+
    /* create some empty scenes */
-   for (i = 0; i < MAX_SCENES; i++) {
-      setup->scenes[i] = lp_scene_create( pipe );
+   for (i = 0; i < setup->num_scenes; i++) {
+      setup->scenes[i] = lp_scene_create( pipe, setup->empty_scenes,
+                                          &setup->scene_arena );
       if (!setup->scenes[i]) {
          goto no_scenes;
       }
    }
 
+   for (i = 0; i < setup->num_scenes; i++) {
+      lp_scene_enqueue(setup->empty_scenes, setup->scenes[i]);
+   }
+
    setup->triangle = first_triangle;
    setup->line     = first_line;
    setup->point    = first_point;
@@ -1337,12 +1383,18 @@ lp_setup_create( struct pipe_context *pipe,
    return setup;
 
 no_scenes:
-   for (i = 0; i < MAX_SCENES; i++) {
+   for (i = 0; i < setup->num_scenes; i++) {
       if (setup->scenes[i]) {
          lp_scene_destroy(setup->scenes[i]);
       }
    }
 
+   if (setup->empty_scenes) {
+      lp_scene_queue_destroy(setup->empty_scenes);
+   }
+
+   lp_scene_arena_fini(&setup->scene_arena);
+
    setup->vbuf->destroy(setup->vbuf);
 no_vbuf:
    FREE(setup);
@@ -54,11 +54,6 @@
 struct lp_setup_variant;
 
 
-/** Max number of scenes */
-/* XXX: make multiple scenes per context work, see lp_setup_rasterize_scene */
-#define MAX_SCENES 1
-
-
 
 /**
  * Point/line/triangle setup context.
@@ -87,9 +82,15 @@ struct lp_setup_context
     */
    struct draw_stage *vbuf;
    unsigned num_threads;
-   unsigned scene_idx;
-   struct lp_scene *scenes[MAX_SCENES];  /**< all the scenes */
-   struct lp_scene *scene;               /**< current scene being built */
+   unsigned num_scenes;
+   struct lp_scene *scenes[LP_MAX_SCENES];  /**< all the scenes */
+   struct lp_scene *scene;                  /**< current scene being built */
+
+   /** Scenes which have been rasterized and can be reused for binning */
+   struct lp_scene_queue *empty_scenes;
+
+   /** Data blocks shared by this context's scenes */
+   struct lp_scene_arena scene_arena;
 
    struct lp_fence *last_fence;
    struct llvmpipe_query *active_queries[LP_MAX_ACTIVE_BINNED_QUERIES];
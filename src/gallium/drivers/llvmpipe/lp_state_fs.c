@@ -59,10 +59,12 @@
 
 #include <limits.h>
 #include "pipe/p_defines.h"
+#include "util/u_atomic.h"
 #include "util/u_inlines.h"
 #include "util/u_memory.h"
 #include "util/u_pointer.h"
 #include "util/u_format.h"
+#include "util/u_hash.h"
 #include "util/u_dump.h"
 #include "util/u_string.h"
 #include "util/simple_list.h"
@@ -77,6 +79,7 @@
 #include "gallivm/lp_bld_const.h"
 #include "gallivm/lp_bld_conv.h"
 #include "gallivm/lp_bld_init.h"
+#include "gallivm/lp_bld_cache.h"
 #include "gallivm/lp_bld_intr.h"
 #include "gallivm/lp_bld_logic.h"
 #include "gallivm/lp_bld_tgsi.h"
@@ -93,6 +96,7 @@
 #include "lp_bld_depth.h"
 #include "lp_bld_interp.h"
 #include "lp_context.h"
+#include "lp_screen.h"
 #include "lp_debug.h"
 #include "lp_perf.h"
 #include "lp_setup.h"
@@ -2137,6 +2141,76 @@ generate_unswizzled_blend(struct gallivm_state *gallivm,
 }
 
 
+/**
+ * Name of the fragment function.  When the module goes to the gallivm
+ * cache the name must be the same in every process.
+ */
+static void
+get_fragment_func_name(const struct lp_fragment_shader_variant *variant,
+                       unsigned partial_mask,
+                       char *func_name, size_t size)
+{
+   if (gallivm_cache_active(variant->gallivm)) {
+      util_snprintf(func_name, size, "fs_%s",
+                    partial_mask ? "partial" : "whole");
+   }
+   else {
+      util_snprintf(func_name, size, "fs%u_variant%u_%s",
+                    variant->shader->no, variant->no,
+                    partial_mask ? "partial" : "whole");
+   }
+}
+
+
+/**
+ * The blending code only handles up to 8-wide vectors, so split 16-wide
+ * fragment shader outputs and masks into 8-wide halves (upper half of the
+ * stamp first, as the 8-wide fragment shader would have produced them).
+ */
+static void
+split_fs_outputs(struct gallivm_state *gallivm,
+                 const struct lp_fragment_shader_variant_key *key,
+                 unsigned nr_outputs,
+                 struct lp_type *fs_type,
+                 unsigned *num_fs,
+                 LLVMValueRef fs_mask[16 / 4],
+                 LLVMValueRef (*fs_out_color)[TGSI_NUM_CHANNELS][16 / 4])
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_type half_type = *fs_type;
+   LLVMTypeRef half_ptr_type;
+   LLVMValueRef mask = fs_mask[0];
+   unsigned num_halves = key->resource_1d ? 1 : 2;
+   unsigned i, cbuf, chan;
+
+   assert(fs_type->length == 16);
+   assert(*num_fs == 1);
+
+   half_type.length = 8;
+   half_ptr_type = LLVMPointerType(lp_build_vec_type(gallivm, half_type), 0);
+
+   for (cbuf = 0; cbuf < nr_outputs; cbuf++) {
+      for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+         LLVMValueRef ptr = LLVMBuildBitCast(builder,
+                                             fs_out_color[cbuf][chan][0],
+                                             half_ptr_type, "");
+         for (i = 0; i < num_halves; i++) {
+            LLVMValueRef index = lp_build_const_int32(gallivm, i);
+            fs_out_color[cbuf][chan][i] = LLVMBuildGEP(builder, ptr,
+                                                       &index, 1, "");
+         }
+      }
+   }
+
+   for (i = 0; i < num_halves; i++) {
+      fs_mask[i] = lp_build_extract_range(gallivm, mask, i * 8, 8);
+   }
+
+   *fs_type = half_type;
+   *num_fs = num_halves;
+}
+
+
 /**
  * Generate the runtime callable function for the whole fragment pipeline.
  * Note that the function which we generate operates on a block of 16
@@ -2144,8 +2218,7 @@ generate_unswizzled_blend(struct gallivm_state *gallivm,
  * 2x2 pixels.
  */
 static void
-generate_fragment(struct llvmpipe_context *lp,
-                  struct lp_fragment_shader *shader,
+generate_fragment(struct lp_fragment_shader *shader,
                   struct lp_fragment_shader_variant *variant,
                   unsigned partial_mask)
 {
@@ -2215,7 +2288,7 @@ generate_fragment(struct llvmpipe_context *lp,
    fs_type.sign = TRUE;          /* values are signed */
    fs_type.norm = FALSE;         /* values are not limited to [0,1] or [-1,1] */
    fs_type.width = 32;           /* 32-bit float */
-   fs_type.length = MIN2(lp_native_vector_width / 32, 16); /* n*4 elements per vector */
+   fs_type.length = key->vector_length; /* n*4 elements per vector */
 
    memset(&blend_type, 0, sizeof blend_type);
    blend_type.floating = FALSE; /* values are integers */
@@ -2233,8 +2306,7 @@ generate_fragment(struct llvmpipe_context *lp,
 
    blend_vec_type = lp_build_vec_type(gallivm, blend_type);
 
-   util_snprintf(func_name, sizeof(func_name), "fs%u_variant%u_%s",
-                 shader->no, variant->no, partial_mask ? "partial" : "whole");
+   get_fragment_func_name(variant, partial_mask, func_name, sizeof func_name);
 
    arg_types[0] = variant->jit_context_ptr_type;       /* context */
    arg_types[1] = int32_type;                          /* x */
@@ -2306,7 +2378,7 @@ generate_fragment(struct llvmpipe_context *lp,
 
    num_fs = 16 / fs_type.length; /* number of loops per 4x4 stamp */
    /* for 1d resources only run "upper half" of stamp */
-   if (key->resource_1d)
+   if (key->resource_1d && num_fs > 1)
       num_fs /= 2;
 
    {
@@ -2345,6 +2417,16 @@ generate_fragment(struct llvmpipe_context *lp,
          else {
             mask = lp_build_const_int_vec(gallivm, fs_type, ~0);
          }
+         if (key->resource_1d && num_fs == 1 && fs_type.length > 8) {
+            /* a 16-wide vector covers the whole stamp, mask the lower half */
+            LLVMValueRef bits[16];
+            unsigned j;
+            for (j = 0; j < fs_type.length; j++) {
+               bits[j] = LLVMConstInt(int32_type, j < 8 ? ~0U : 0, 0);
+            }
+            mask = LLVMBuildAnd(builder, mask,
+                                LLVMConstVector(bits, fs_type.length), "");
+         }
          LLVMBuildStore(builder, mask, mask_ptr);
       }
 
@@ -2387,6 +2469,12 @@ generate_fragment(struct llvmpipe_context *lp,
             }
          }
       }
+
+      if (fs_type.length > 8) {
+         split_fs_outputs(gallivm, key,
+                          dual_source_blend ? MAX2(key->nr_cbufs, 2) : key->nr_cbufs,
+                          &fs_type, &num_fs, fs_mask, fs_out_color);
+      }
    }
 
    sampler->destroy(sampler);
@@ -2436,6 +2524,7 @@ dump_fs_variant_key(const struct lp_fragment_shader_variant_key *key)
 
    debug_printf("fs variant %p:\n", (void *) key);
 
+   debug_printf("vector_length = %u\n", key->vector_length);
    if (key->flatshade) {
       debug_printf("flatshade = 1\n");
    }
@@ -2532,6 +2621,254 @@ lp_debug_fs_variant(const struct lp_fragment_shader_variant *variant)
 }
 
 
+static void
+get_variant_module_name(const struct lp_fragment_shader_variant *variant,
+                        char *module_name, size_t size)
+{
+   util_snprintf(module_name, size, "fs%u_variant%u",
+                 variant->shader->no, variant->no);
+}
+
+
+/**
+ * Look the variant up in the gallivm cache, and if found get the fragment
+ * functions from there.
+ * \return FALSE if the variant's code must be generated, in which case
+ * variant->gallivm is ready for it (or NULL if out of memory).
+ */
+static boolean
+load_cached_variant(struct lp_fragment_shader_variant *variant)
+{
+   struct lp_fragment_shader *shader = variant->shader;
+   LLVMContextRef context = variant->gallivm->context;
+   enum gallivm_opt_level opt_level;
+   char name[64];
+
+   gallivm_cache_key_add(variant->gallivm, shader->base.tokens,
+                         tgsi_num_tokens(shader->base.tokens) *
+                         sizeof(struct tgsi_token));
+   gallivm_cache_key_add(variant->gallivm, &variant->key,
+                         shader->variant_key_size);
+
+   if (!gallivm_cache_lookup(variant->gallivm))
+      return FALSE;
+
+   /* No IR, this just loads the cached object code */
+   gallivm_compile_module(variant->gallivm);
+
+   variant->nr_instrs += gallivm_cache_nr_instrs(variant->gallivm);
+
+   get_fragment_func_name(variant, RAST_EDGE_TEST, name, sizeof name);
+   variant->jit_function[RAST_EDGE_TEST] = (lp_jit_frag_func)
+         gallivm_cache_jit_function(variant->gallivm, name);
+
+   if (variant->opaque) {
+      get_fragment_func_name(variant, RAST_WHOLE, name, sizeof name);
+      variant->jit_function[RAST_WHOLE] = (lp_jit_frag_func)
+            gallivm_cache_jit_function(variant->gallivm, name);
+   }
+   else {
+      variant->jit_function[RAST_WHOLE] = variant->jit_function[RAST_EDGE_TEST];
+   }
+
+   gallivm_free_ir(variant->gallivm);
+
+   if (variant->jit_function[RAST_EDGE_TEST] &&
+       variant->jit_function[RAST_WHOLE]) {
+      return TRUE;
+   }
+
+   /* Bad cache entry, generate the code from scratch */
+   memset(variant->jit_function, 0, sizeof variant->jit_function);
+   variant->nr_instrs = 0;
+   opt_level = variant->gallivm->opt_level;
+   gallivm_destroy(variant->gallivm);
+   get_variant_module_name(variant, name, sizeof name);
+   variant->gallivm = gallivm_create(name, context);
+   if (variant->gallivm)
+      variant->gallivm->opt_level = opt_level;
+   return FALSE;
+}
+
+
+/**
+ * Generate the IR of the variant's fragment functions and compile it.
+ */
+static void
+compile_variant(struct lp_fragment_shader_variant *variant)
+{
+   struct lp_fragment_shader *shader = variant->shader;
+
+   lp_jit_init_types(variant);
+
+   if (variant->jit_function[RAST_EDGE_TEST] == NULL)
+      generate_fragment(shader, variant, RAST_EDGE_TEST);
+
+   if (variant->jit_function[RAST_WHOLE] == NULL) {
+      if (variant->opaque) {
+         /* Specialized shader, which doesn't need to read the color buffer. */
+         generate_fragment(shader, variant, RAST_WHOLE);
+      }
+   }
+
+   /*
+    * Compile everything
+    */
+
+   gallivm_compile_module(variant->gallivm);
+
+   variant->nr_instrs += lp_build_count_ir_module(variant->gallivm->module);
+
+   if (variant->function[RAST_EDGE_TEST]) {
+      variant->jit_function[RAST_EDGE_TEST] = (lp_jit_frag_func)
+            gallivm_jit_function(variant->gallivm,
+                                 variant->function[RAST_EDGE_TEST]);
+   }
+
+   if (variant->function[RAST_WHOLE]) {
+         variant->jit_function[RAST_WHOLE] = (lp_jit_frag_func)
+               gallivm_jit_function(variant->gallivm,
+                                    variant->function[RAST_WHOLE]);
+   } else if (!variant->jit_function[RAST_WHOLE]) {
+      variant->jit_function[RAST_WHOLE] = variant->jit_function[RAST_EDGE_TEST];
+   }
+
+   gallivm_free_ir(variant->gallivm);
+}
+
+
+static enum gallivm_opt_level
+get_tier_opt_level(enum lp_fs_tier tier)
+{
+   switch (tier) {
+   case LP_FS_TIER_QUICK:
+      return GALLIVM_OPT_FAST;
+   case LP_FS_TIER_HOT:
+      return GALLIVM_OPT_AGGRESSIVE;
+   case LP_FS_TIER_OPTIMIZED:
+   default:
+      return GALLIVM_OPT_DEFAULT;
+   }
+}
+
+
+/**
+ * Rebuild the code of a variant at its requested tier, on one of the compile
+ * threads.
+ */
+static void
+compile_tier_variant(struct util_queue_job *job)
+{
+   struct lp_fragment_shader_variant *variant =
+      (struct lp_fragment_shader_variant *)
+      ((char *) job - offsetof(struct lp_fragment_shader_variant, compile_job));
+   enum lp_fs_tier tier = variant->requested_tier;
+   struct lp_fragment_shader_variant *recompiled = variant->recompiled[tier];
+   LLVMContextRef context;
+   char module_name[64];
+
+   /* LLVM contexts must not be shared among threads */
+   context = LLVMContextCreate();
+   if (!context)
+      goto done;
+
+   get_variant_module_name(recompiled, module_name, sizeof module_name);
+   recompiled->gallivm = gallivm_create(module_name, context);
+
+   if (recompiled->gallivm) {
+      recompiled->gallivm->opt_level = get_tier_opt_level(tier);
+      if (!load_cached_variant(recompiled) &&
+          recompiled->gallivm) {
+         compile_variant(recompiled);
+      }
+   }
+
+   if (recompiled->jit_function[RAST_EDGE_TEST] &&
+       recompiled->jit_function[RAST_WHOLE]) {
+      /* Rasterizer threads pick the new code up on their next call */
+      variant->jit_function[RAST_EDGE_TEST] = recompiled->jit_function[RAST_EDGE_TEST];
+      variant->jit_function[RAST_WHOLE] = recompiled->jit_function[RAST_WHOLE];
+   }
+
+   /* Only the generated code is left, which doesn't depend on the context */
+   LLVMContextDispose(context);
+
+done:
+   /* Also on failure, so that the variant may move on to the next tier */
+   p_atomic_set(&variant->tier, tier);
+}
+
+
+/**
+ * Have the code of the variant rebuilt at the given tier in the background.
+ */
+static void
+queue_tier_variant(struct llvmpipe_context *lp,
+                   struct lp_fragment_shader_variant *variant,
+                   enum lp_fs_tier tier)
+{
+   struct llvmpipe_screen *screen = llvmpipe_screen(lp->pipe.screen);
+   struct lp_fragment_shader_variant *recompiled;
+
+   assert(!variant->recompiled[tier]);
+
+   recompiled = CALLOC_STRUCT(lp_fragment_shader_variant);
+   if (!recompiled)
+      return;
+
+   memcpy(&recompiled->key, &variant->key, variant->shader->variant_key_size);
+   recompiled->shader = variant->shader;
+   recompiled->no = variant->no;
+   recompiled->opaque = variant->opaque;
+   recompiled->ps_inv_multiplier = variant->ps_inv_multiplier;
+
+   /* The previous tier's job may still be wrapping up */
+   util_queue_wait_job(&screen->compile_queue, &variant->compile_job);
+
+   variant->recompiled[tier] = recompiled;
+   variant->requested_tier = tier;
+
+   util_queue_add_job(&screen->compile_queue, &variant->compile_job,
+                      compile_tier_variant);
+
+   lp->nr_fs_tier_compiles[tier]++;
+   if (tier == LP_FS_TIER_HOT)
+      LP_COUNT(nr_llvm_hot_compiles);
+   else
+      LP_COUNT(nr_llvm_tier_compiles);
+}
+
+
+/**
+ * Rebuild the variant at the next tier in the background if it was invoked
+ * often enough.  Called before drawing with the variant bound.
+ */
+void
+llvmpipe_tier_up_fs_variant(struct llvmpipe_context *lp,
+                            struct lp_fragment_shader_variant *variant)
+{
+   static const unsigned tier_invocations[LP_FS_NUM_TIERS] = {
+      0,
+      LP_FS_OPTIMIZED_INVOCATIONS,
+      LP_FS_HOT_INVOCATIONS
+   };
+   unsigned next = variant->requested_tier + 1;
+
+   if (next >= LP_FS_NUM_TIERS ||
+       variant->nr_invocations < tier_invocations[next])
+      return;
+
+   /* Still building the current tier */
+   if (p_atomic_read(&variant->tier) != (int) variant->requested_tier)
+      return;
+
+   if (!llvmpipe_screen(lp->pipe.screen)->num_compile_threads)
+      return;
+
+   queue_tier_variant(lp, variant, (enum lp_fs_tier) next);
+}
+
+
 /**
  * Generate a new fragment shader variant from the shader code and
  * other state indicated by the key.
@@ -2541,6 +2878,7 @@ generate_variant(struct llvmpipe_context *lp,
                  struct lp_fragment_shader *shader,
                  const struct lp_fragment_shader_variant_key *key)
 {
+   struct llvmpipe_screen *screen = llvmpipe_screen(lp->pipe.screen);
    struct lp_fragment_shader_variant *variant;
    const struct util_format_description *cbuf0_format_desc;
    boolean fullcolormask;
@@ -2550,8 +2888,12 @@ generate_variant(struct llvmpipe_context *lp,
    if(!variant)
       return NULL;
 
-   util_snprintf(module_name, sizeof(module_name), "fs%u_variant%u",
-                 shader->no, shader->variants_created);
+   variant->shader = shader;
+   variant->list_item_global.base = variant;
+   variant->list_item_local.base = variant;
+   variant->no = shader->variants_created++;
+
+   get_variant_module_name(variant, module_name, sizeof module_name);
 
    variant->gallivm = gallivm_create(module_name, lp->context);
    if (!variant->gallivm) {
@@ -2559,11 +2901,6 @@ generate_variant(struct llvmpipe_context *lp,
       return NULL;
    }
 
-   variant->shader = shader;
-   variant->list_item_global.base = variant;
-   variant->list_item_local.base = variant;
-   variant->no = shader->variants_created++;
-
    memcpy(&variant->key, key, shader->variant_key_size);
 
    /*
@@ -2597,41 +2934,30 @@ generate_variant(struct llvmpipe_context *lp,
       lp_debug_fs_variant(variant);
    }
 
-   lp_jit_init_types(variant);
-   
-   if (variant->jit_function[RAST_EDGE_TEST] == NULL)
-      generate_fragment(lp, shader, variant, RAST_EDGE_TEST);
-
-   if (variant->jit_function[RAST_WHOLE] == NULL) {
-      if (variant->opaque) {
-         /* Specialized shader, which doesn't need to read the color buffer. */
-         generate_fragment(lp, shader, variant, RAST_WHOLE);
-      }
+   if (screen->num_compile_threads) {
+      /*
+       * Make do with a quick build until the variant turns out to be used
+       * enough to be worth optimizing (which also looks the cache up).
+       */
+      variant->gallivm->opt_level = get_tier_opt_level(LP_FS_TIER_QUICK);
+      variant->tier = LP_FS_TIER_QUICK;
+      variant->requested_tier = LP_FS_TIER_QUICK;
+      compile_variant(variant);
+      return variant;
    }
 
-   /*
-    * Compile everything
-    */
+   variant->tier = LP_FS_TIER_OPTIMIZED;
+   variant->requested_tier = LP_FS_TIER_OPTIMIZED;
 
-   gallivm_compile_module(variant->gallivm);
+   if (load_cached_variant(variant))
+      return variant;
 
-   variant->nr_instrs += lp_build_count_ir_module(variant->gallivm->module);
-
-   if (variant->function[RAST_EDGE_TEST]) {
-      variant->jit_function[RAST_EDGE_TEST] = (lp_jit_frag_func)
-            gallivm_jit_function(variant->gallivm,
-                                 variant->function[RAST_EDGE_TEST]);
-   }
-
-   if (variant->function[RAST_WHOLE]) {
-         variant->jit_function[RAST_WHOLE] = (lp_jit_frag_func)
-               gallivm_jit_function(variant->gallivm,
-                                    variant->function[RAST_WHOLE]);
-   } else if (!variant->jit_function[RAST_WHOLE]) {
-      variant->jit_function[RAST_WHOLE] = variant->jit_function[RAST_EDGE_TEST];
+   if (!variant->gallivm) {
+      FREE(variant);
+      return NULL;
    }
 
-   gallivm_free_ir(variant->gallivm);
+   compile_variant(variant);
 
    return variant;
 }
@@ -2654,6 +2980,12 @@ llvmpipe_create_fs_state(struct pipe_context *pipe,
    shader->no = fs_no++;
    make_empty_list(&shader->variants);
 
+   shader->variants_hash = cso_hash_create();
+   if (!shader->variants_hash) {
+      FREE(shader);
+      return NULL;
+   }
+
    /* get/save the summary info for this shader */
    lp_build_tgsi_info(templ->tokens, &shader->info);
 
@@ -2662,6 +2994,7 @@ llvmpipe_create_fs_state(struct pipe_context *pipe,
 
    shader->draw_data = draw_create_fragment_shader(llvmpipe->draw, templ);
    if (shader->draw_data == NULL) {
+      cso_hash_delete(shader->variants_hash);
       FREE((void *) shader->base.tokens);
       FREE(shader);
       return NULL;
@@ -2757,19 +3090,40 @@ void
 llvmpipe_remove_shader_variant(struct llvmpipe_context *lp,
                                struct lp_fragment_shader_variant *variant)
 {
+   struct cso_hash_iter iter;
+
    if (gallivm_debug & GALLIVM_DEBUG_IR) {
       debug_printf("llvmpipe: del fs #%u var #%u v created #%u v cached"
-                   " #%u v total cached #%u\n",
+                   " #%u v evicted #%u v total cached #%u\n",
                    variant->shader->no,
                    variant->no,
                    variant->shader->variants_created,
                    variant->shader->variants_cached,
+                   variant->shader->variants_evicted,
                    lp->nr_fs_variants);
    }
 
+   if (variant->recompiled[variant->requested_tier]) {
+      struct llvmpipe_screen *screen = llvmpipe_screen(lp->pipe.screen);
+      unsigned i;
+
+      util_queue_remove_job(&screen->compile_queue, &variant->compile_job);
+
+      for (i = 0; i < LP_FS_NUM_TIERS; i++) {
+         struct lp_fragment_shader_variant *recompiled = variant->recompiled[i];
+         if (recompiled) {
+            if (recompiled->gallivm)
+               gallivm_destroy(recompiled->gallivm);
+            FREE(recompiled);
+         }
+      }
+   }
+
    gallivm_destroy(variant->gallivm);
 
-   /* remove from shader's list */
+   /* remove from shader's hash table and list */
+   cso_hash_erase_data(variant->shader->variants_hash, variant->key_hash,
+                       variant);
    remove_from_list(&variant->list_item_local);
    variant->shader->variants_cached--;
 
@@ -2809,7 +3163,16 @@ llvmpipe_delete_fs_state(struct pipe_context *pipe, void *fs)
    /* Delete draw module's data */
    draw_delete_fragment_shader(llvmpipe->draw, shader->draw_data);
 
+   if (LP_DEBUG & DEBUG_FS) {
+      debug_printf("llvmpipe: Delete fragment shader #%u: %u variants created,"
+                   " %u evicted\n",
+                   shader->no, shader->variants_created,
+                   shader->variants_evicted);
+   }
+
    assert(shader->variants_cached == 0);
+   assert(cso_hash_size(shader->variants_hash) == 0);
+   cso_hash_delete(shader->variants_hash);
    FREE((void *) shader->base.tokens);
    FREE(shader);
 }
@@ -2951,6 +3314,7 @@ make_variant_key(struct llvmpipe_context *lp,
    }
 
    key->nr_cbufs = lp->framebuffer.nr_cbufs;
+   key->vector_length = llvmpipe_screen(lp->pipe.screen)->fs_vector_length;
 
    if (!key->blend.independent_blend_enable) {
       /* we always need independent blend otherwise the fixups below won't work */
@@ -3079,20 +3443,16 @@ llvmpipe_update_fs(struct llvmpipe_context *lp)
 {
    struct lp_fragment_shader *shader = lp->fs;
    struct lp_fragment_shader_variant_key key;
-   struct lp_fragment_shader_variant *variant = NULL;
-   struct lp_fs_variant_list_item *li;
+   struct lp_fragment_shader_variant *variant;
+   unsigned key_hash;
 
    make_variant_key(lp, shader, &key);
+   key_hash = util_hash_crc32(&key, shader->variant_key_size);
 
    /* Search the variants for one which matches the key */
-   li = first_elem(&shader->variants);
-   while(!at_end(&shader->variants, li)) {
-      if(memcmp(&li->base->key, &key, shader->variant_key_size) == 0) {
-         variant = li->base;
-         break;
-      }
-      li = next_elem(li);
-   }
+   variant = cso_hash_find_data_from_key(shader->variants_hash, key_hash, &key,
+                                         offsetof(struct lp_fragment_shader_variant, key),
+                                         shader->variant_key_size);
 
    if (variant) {
       /* Move this variant to the head of the list to implement LRU
@@ -3143,6 +3503,7 @@ llvmpipe_update_fs(struct llvmpipe_context *lp)
             item = last_elem(&lp->fs_variants_list);
             assert(item);
             assert(item->base);
+            item->base->shader->variants_evicted++;
             llvmpipe_remove_shader_variant(lp, item->base);
          }
       }
@@ -3159,6 +3520,9 @@ llvmpipe_update_fs(struct llvmpipe_context *lp)
 
       /* Put the new variant into the list */
       if (variant) {
+         lp->nr_fs_tier_compiles[variant->tier]++;
+         variant->key_hash = key_hash;
+         cso_hash_insert(shader->variants_hash, key_hash, variant);
          insert_at_head(&shader->variants, &variant->list_item_local);
          insert_at_head(&lp->fs_variants_list, &variant->list_item_global);
          lp->nr_fs_variants++;
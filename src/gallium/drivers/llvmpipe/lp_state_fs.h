@@ -33,6 +33,8 @@
 #include "pipe/p_compiler.h"
 #include "pipe/p_state.h"
 #include "tgsi/tgsi_scan.h" /* for tgsi_shader_info */
+#include "util/u_queue.h"
+#include "cso_cache/cso_hash.h"
 #include "gallivm/lp_bld_sample.h" /* for struct lp_sampler_static_state */
 #include "gallivm/lp_bld_tgsi.h" /* for lp_tgsi_info */
 #include "lp_bld_interp.h" /* for struct lp_shader_input */
@@ -77,6 +79,7 @@ struct lp_fragment_shader_variant_key
    unsigned occlusion_count:1;
    unsigned resource_1d:1;
    unsigned depth_clamp:1;
+   unsigned vector_length:5;    /* fs_type.length, see llvmpipe_screen */
 
    enum pipe_format zsbuf_format;
    enum pipe_format cbuf_format[PIPE_MAX_COLOR_BUFS];
@@ -85,6 +88,23 @@ struct lp_fragment_shader_variant_key
 };
 
 
+/**
+ * Optimization tiers of a fragment shader variant.
+ *
+ * With LP_ASYNC_COMPILE a variant is first built quickly, and rebuilt in the
+ * background at the next tier once it was invoked often enough (see
+ * LP_FS_*_INVOCATIONS).  Otherwise variants are built at the optimized tier
+ * right away.
+ */
+enum lp_fs_tier
+{
+   LP_FS_TIER_QUICK = 0,   /**< GALLIVM_OPT_FAST */
+   LP_FS_TIER_OPTIMIZED,   /**< GALLIVM_OPT_DEFAULT */
+   LP_FS_TIER_HOT,         /**< GALLIVM_OPT_AGGRESSIVE */
+   LP_FS_NUM_TIERS
+};
+
+
 /** doubly-linked list item */
 struct lp_fs_variant_list_item
 {
@@ -96,6 +116,7 @@ struct lp_fs_variant_list_item
 struct lp_fragment_shader_variant
 {
    struct lp_fragment_shader_variant_key key;
+   unsigned key_hash;   /**< hash of the first variant_key_size bytes of key */
 
    boolean opaque;
    uint8_t ps_inv_multiplier;
@@ -116,6 +137,20 @@ struct lp_fragment_shader_variant
    struct lp_fs_variant_list_item list_item_global, list_item_local;
    struct lp_fragment_shader *shader;
 
+   /*
+    * Tiered compilation.  compile_job builds the code of requested_tier into
+    * recompiled[requested_tier] on a compile thread, switches jit_function[]
+    * over to it and finally sets tier.  Older code stays around until the
+    * variant is destroyed, as rasterizer threads may still be running it.
+    */
+   struct util_queue_job compile_job;
+   struct lp_fragment_shader_variant *recompiled[LP_FS_NUM_TIERS];
+   enum lp_fs_tier requested_tier;
+   int tier;   /**< last tier built, written by the compile thread */
+
+   /** Number of binned shading commands, updated at setup time */
+   unsigned nr_invocations;
+
    /* For debugging/profiling purposes */
    unsigned no;
 };
@@ -130,6 +165,9 @@ struct lp_fragment_shader
 
    struct lp_fs_variant_list_item variants;
 
+   /** The variants again, hashed by key_hash for quick lookup */
+   struct cso_hash *variants_hash;
+
    struct draw_fragment_shader *draw_data;
 
    /* For debugging/profiling purposes */
@@ -137,6 +175,7 @@ struct lp_fragment_shader
    unsigned no;
    unsigned variants_created;
    unsigned variants_cached;
+   unsigned variants_evicted;  /**< removed to make room for others */
 
    /** Fragment shader input interpolation info */
    struct lp_shader_input inputs[PIPE_MAX_SHADER_INPUTS];
@@ -150,6 +189,10 @@ void
 llvmpipe_remove_shader_variant(struct llvmpipe_context *lp,
                                struct lp_fragment_shader_variant *variant);
 
+void
+llvmpipe_tier_up_fs_variant(struct llvmpipe_context *lp,
+                            struct lp_fragment_shader_variant *variant);
+
 boolean
 llvmpipe_rasterization_disabled(struct llvmpipe_context *lp);
 
@@ -26,6 +26,7 @@
  **************************************************************************/
 
 
+#include "util/u_hash.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/simple_list.h"
@@ -891,15 +892,20 @@ static void
 remove_setup_variant(struct llvmpipe_context *lp,
                      struct lp_setup_variant *variant)
 {
+   struct cso_hash_iter iter;
+
    if (gallivm_debug & GALLIVM_DEBUG_IR) {
-      debug_printf("llvmpipe: del setup_variant #%u total %u\n",
-                   variant->no, lp->nr_setup_variants);
+      debug_printf("llvmpipe: del setup_variant #%u total %u evicted %u\n",
+                   variant->no, lp->nr_setup_variants,
+                   lp->nr_setup_variants_evicted);
    }
 
    if (variant->gallivm) {
       gallivm_destroy(variant->gallivm);
    }
 
+   cso_hash_erase_data(lp->setup_variants_hash, variant->key_hash, variant);
+
    remove_from_list(&variant->list_item_global);
    lp->nr_setup_variants--;
    FREE(variant);
@@ -931,6 +937,7 @@ cull_setup_variants(struct llvmpipe_context *lp)
       item = last_elem(&lp->setup_variants_list);
       assert(item);
       assert(item->base);
+      lp->nr_setup_variants_evicted++;
       remove_setup_variant(lp, item->base);
    }
 }
@@ -945,18 +952,19 @@ void
 llvmpipe_update_setup(struct llvmpipe_context *lp)
 {
    struct lp_setup_variant_key *key = &lp->setup_variant.key;
-   struct lp_setup_variant *variant = NULL;
-   struct lp_setup_variant_list_item *li;
+   struct lp_setup_variant *variant;
+   unsigned key_hash;
 
    lp_make_setup_variant_key(lp, key);
+   key_hash = util_hash_crc32(key, key->size);
 
-   foreach(li, &lp->setup_variants_list) {
-      if(li->base->key.size == key->size &&
-         memcmp(&li->base->key, key, key->size) == 0) {
-         variant = li->base;
-         break;
-      }
-   }
+   /* The size is part of the compared bytes, and every key has room for
+    * the largest size.
+    */
+   variant = cso_hash_find_data_from_key(lp->setup_variants_hash, key_hash,
+                                         key,
+                                         offsetof(struct lp_setup_variant, key),
+                                         key->size);
 
    if (variant) {
       move_to_head(&lp->setup_variants_list, &variant->list_item_global);
@@ -968,6 +976,8 @@ llvmpipe_update_setup(struct llvmpipe_context *lp)
 
       variant = generate_setup_variant(key, lp);
       if (variant) {
+         variant->key_hash = key_hash;
+         cso_hash_insert(lp->setup_variants_hash, key_hash, variant);
          insert_at_head(&lp->setup_variants_list, &variant->list_item_global);
          lp->nr_setup_variants++;
       }
@@ -0,0 +1,417 @@
+/**************************************************************************
+ *
+ * Copyright 2026 agent
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * @file
+ * Per-pixel throughput of the fragment pipeline at the different vector
+ * lengths (see LP_FS_VECTOR_LENGTH).
+ *
+ * The generated code mimics what a simple fragment shader variant does for
+ * each 4x4 stamp: interpolate depth and color, depth test against the depth
+ * buffer, and write depth and the clamped color for the surviving pixels,
+ * 16 / length vectors at a time.
+ */
+
+
+#include "util/u_memory.h"
+#include "util/u_pointer.h"
+#include "gallivm/lp_bld_init.h"
+#include "gallivm/lp_bld_type.h"
+#include "gallivm/lp_bld_const.h"
+#include "gallivm/lp_bld_arit.h"
+#include "gallivm/lp_bld_logic.h"
+#include "gallivm/lp_bld_flow.h"
+#include "gallivm/lp_bld_debug.h"
+#include "lp_test.h"
+
+
+#define NUM_STAMPS 256
+#define NUM_ATTRIBS 5   /* z, r, g, b, a */
+
+
+typedef void (*width_test_ptr_t)(const float *coeffs,
+                                 const float *pos,
+                                 float *depth,
+                                 float *color,
+                                 int32_t num_stamps);
+
+
+/** Pixel offsets of a 4x4 stamp, in the quad order the fragment shader uses */
+static const float stamp_pos[2][16] = {
+   { 0, 1, 0, 1, 2, 3, 2, 3, 0, 1, 0, 1, 2, 3, 2, 3 },
+   { 0, 0, 1, 1, 0, 0, 1, 1, 2, 2, 3, 3, 2, 2, 3, 3 }
+};
+
+
+void
+write_tsv_header(FILE *fp)
+{
+   fprintf(fp,
+           "result\t"
+           "cycles_per_pixel\t"
+           "type\n");
+
+   fflush(fp);
+}
+
+
+static void
+write_tsv_row(FILE *fp,
+              struct lp_type type,
+              double cycles,
+              boolean success)
+{
+   fprintf(fp, "%s\t", success ? "pass" : "fail");
+
+   fprintf(fp, "%.2f\t", cycles);
+
+   dump_type(fp, type);
+   fprintf(fp, "\n");
+
+   fflush(fp);
+}
+
+
+static LLVMValueRef
+vec_ptr(struct gallivm_state *gallivm,
+        struct lp_type type,
+        LLVMValueRef base,
+        LLVMValueRef index)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMValueRef ptr = LLVMBuildGEP(builder, base, &index, 1, "");
+   return LLVMBuildBitCast(builder, ptr,
+                           LLVMPointerType(lp_build_vec_type(gallivm, type), 0),
+                           "");
+}
+
+
+static LLVMValueRef
+add_width_test(struct gallivm_state *gallivm,
+               struct lp_type type)
+{
+   LLVMModuleRef module = gallivm->module;
+   LLVMContextRef context = gallivm->context;
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMTypeRef float_ptr_type = LLVMPointerType(LLVMFloatTypeInContext(context), 0);
+   LLVMTypeRef args[5];
+   LLVMValueRef func;
+   LLVMValueRef coeffs_ptr, pos_ptr, depth_ptr, color_ptr, num_stamps;
+   LLVMValueRef a0[NUM_ATTRIBS], dadx[NUM_ATTRIBS], dady[NUM_ATTRIBS];
+   LLVMBasicBlockRef block;
+   struct lp_build_context bld;
+   struct lp_build_for_loop_state loop;
+   unsigned num_fs = 16 / type.length;
+   unsigned i, attrib;
+
+   args[0] = float_ptr_type;
+   args[1] = float_ptr_type;
+   args[2] = float_ptr_type;
+   args[3] = float_ptr_type;
+   args[4] = LLVMInt32TypeInContext(context);
+
+   func = LLVMAddFunction(module, "test",
+                          LLVMFunctionType(LLVMVoidTypeInContext(context),
+                                           args, Elements(args), 0));
+   LLVMSetFunctionCallConv(func, LLVMCCallConv);
+   coeffs_ptr = LLVMGetParam(func, 0);
+   pos_ptr = LLVMGetParam(func, 1);
+   depth_ptr = LLVMGetParam(func, 2);
+   color_ptr = LLVMGetParam(func, 3);
+   num_stamps = LLVMGetParam(func, 4);
+
+   block = LLVMAppendBasicBlockInContext(context, func, "entry");
+   LLVMPositionBuilderAtEnd(builder, block);
+
+   lp_build_context_init(&bld, gallivm, type);
+
+   for (attrib = 0; attrib < NUM_ATTRIBS; ++attrib) {
+      LLVMValueRef coeffs[3];
+      for (i = 0; i < 3; ++i) {
+         LLVMValueRef index = lp_build_const_int32(gallivm, attrib * 3 + i);
+         LLVMValueRef ptr = LLVMBuildGEP(builder, coeffs_ptr, &index, 1, "");
+         coeffs[i] = lp_build_broadcast_scalar(&bld,
+                                               LLVMBuildLoad(builder, ptr, ""));
+      }
+      a0[attrib] = coeffs[0];
+      dadx[attrib] = coeffs[1];
+      dady[attrib] = coeffs[2];
+   }
+
+   lp_build_for_loop_begin(&loop, gallivm,
+                           lp_build_const_int32(gallivm, 0),
+                           LLVMIntULT,
+                           num_stamps,
+                           lp_build_const_int32(gallivm, 1));
+   {
+      LLVMValueRef stamp_x, stamp_offset;
+
+      stamp_x = LLVMBuildMul(builder, loop.counter,
+                             lp_build_const_int32(gallivm, 4), "");
+      stamp_x = LLVMBuildSIToFP(builder, stamp_x,
+                                LLVMFloatTypeInContext(context), "");
+      stamp_x = lp_build_broadcast_scalar(&bld, stamp_x);
+      stamp_offset = LLVMBuildMul(builder, loop.counter,
+                                  lp_build_const_int32(gallivm, 16), "");
+
+      for (i = 0; i < num_fs; ++i) {
+         LLVMValueRef offset = lp_build_const_int32(gallivm, i * type.length);
+         LLVMValueRef pixel = LLVMBuildAdd(builder, stamp_offset, offset, "");
+         LLVMValueRef x, y, z, z_fb, mask, ptr;
+
+         x = LLVMBuildLoad(builder, vec_ptr(gallivm, type, pos_ptr, offset), "");
+         x = lp_build_add(&bld, x, stamp_x);
+         y = LLVMBuildLoad(builder,
+                           vec_ptr(gallivm, type, pos_ptr,
+                                   lp_build_const_int32(gallivm, 16 + i * type.length)),
+                           "");
+
+         z = lp_build_add(&bld, a0[0], lp_build_mul(&bld, dadx[0], x));
+         z = lp_build_add(&bld, z, lp_build_mul(&bld, dady[0], y));
+
+         ptr = vec_ptr(gallivm, type, depth_ptr, pixel);
+         z_fb = LLVMBuildLoad(builder, ptr, "");
+         mask = lp_build_cmp(&bld, PIPE_FUNC_LESS, z, z_fb);
+         LLVMBuildStore(builder, lp_build_select(&bld, mask, z, z_fb), ptr);
+
+         for (attrib = 1; attrib < NUM_ATTRIBS; ++attrib) {
+            LLVMValueRef index, value, dst;
+
+            value = lp_build_add(&bld, a0[attrib],
+                                 lp_build_mul(&bld, dadx[attrib], x));
+            value = lp_build_add(&bld, value,
+                                 lp_build_mul(&bld, dady[attrib], y));
+            value = lp_build_clamp(&bld, value, bld.zero, bld.one);
+
+            index = LLVMBuildMul(builder, pixel,
+                                 lp_build_const_int32(gallivm, NUM_ATTRIBS - 1), "");
+            index = LLVMBuildAdd(builder, index,
+                                 lp_build_const_int32(gallivm, (attrib - 1) * type.length), "");
+            ptr = vec_ptr(gallivm, type, color_ptr, index);
+            dst = LLVMBuildLoad(builder, ptr, "");
+            LLVMBuildStore(builder, lp_build_select(&bld, mask, value, dst), ptr);
+         }
+      }
+   }
+   lp_build_for_loop_end(&loop);
+
+   LLVMBuildRetVoid(builder);
+
+   gallivm_verify_function(gallivm, func);
+
+   return func;
+}
+
+
+/**
+ * What the generated code computes.  The color of each vector of pixels is
+ * stored channel after channel, like the fragment shader's color_store.
+ */
+static void
+ref_width_test(struct lp_type type,
+               const float *coeffs,
+               float *depth,
+               float *color,
+               unsigned num_stamps)
+{
+   unsigned stamp, pixel, attrib;
+
+   for (stamp = 0; stamp < num_stamps; ++stamp) {
+      for (pixel = 0; pixel < 16; ++pixel) {
+         unsigned index = stamp * 16 + pixel;
+         float x = stamp_pos[0][pixel] + (float)(stamp * 4);
+         float y = stamp_pos[1][pixel];
+         float z = coeffs[0] + coeffs[1] * x;
+         unsigned vec = index / type.length;
+         unsigned elem = index % type.length;
+
+         z = z + coeffs[2] * y;
+         if (!(z < depth[index]))
+            continue;
+
+         depth[index] = z;
+         for (attrib = 1; attrib < NUM_ATTRIBS; ++attrib) {
+            float value = coeffs[attrib * 3] + coeffs[attrib * 3 + 1] * x;
+            value = value + coeffs[attrib * 3 + 2] * y;
+            value = MIN2(MAX2(value, 0.0f), 1.0f);
+            color[(vec * (NUM_ATTRIBS - 1) + attrib - 1) * type.length + elem] = value;
+         }
+      }
+   }
+}
+
+
+PIPE_ALIGN_STACK
+static boolean
+test_one(unsigned verbose,
+         FILE *fp,
+         struct lp_type type)
+{
+   const unsigned num_pixels = NUM_STAMPS * 16;
+   const unsigned num_colors = num_pixels * (NUM_ATTRIBS - 1);
+   struct gallivm_state *gallivm;
+   LLVMValueRef func;
+   width_test_ptr_t width_test_ptr;
+   PIPE_ALIGN_VAR(LP_MIN_VECTOR_ALIGN) float pos[2 * 16];
+   float coeffs[NUM_ATTRIBS * 3];
+   float *depth, *color, *depth_init, *ref_depth, *ref_color;
+   int64_t cycles = 0;
+   boolean success = TRUE;
+   unsigned i, j;
+
+   if (verbose >= 1) {
+      dump_type(stderr, type);
+      fprintf(stderr, " ...\n");
+   }
+
+   memcpy(pos, stamp_pos, sizeof pos);
+
+   for (i = 0; i < Elements(coeffs); ++i) {
+      coeffs[i] = random_float();
+      if (i % 3)
+         coeffs[i] /= 64.0f;
+   }
+
+   depth = align_malloc(num_pixels * sizeof(float), LP_MIN_VECTOR_ALIGN);
+   color = align_malloc(num_colors * sizeof(float), LP_MIN_VECTOR_ALIGN);
+   depth_init = MALLOC(num_pixels * sizeof(float));
+   ref_depth = MALLOC(num_pixels * sizeof(float));
+   ref_color = CALLOC(num_colors, sizeof(float));
+   if (!depth || !color || !depth_init || !ref_depth || !ref_color) {
+      success = FALSE;
+      goto out;
+   }
+
+   for (i = 0; i < num_pixels; ++i)
+      depth_init[i] = random_float() * 4.0f;
+
+   gallivm = gallivm_create("test_module", LLVMGetGlobalContext());
+
+   func = add_width_test(gallivm, type);
+
+   gallivm_compile_module(gallivm);
+
+   width_test_ptr = (width_test_ptr_t)gallivm_jit_function(gallivm, func);
+
+   gallivm_free_ir(gallivm);
+
+   memcpy(ref_depth, depth_init, num_pixels * sizeof(float));
+   ref_width_test(type, coeffs, ref_depth, ref_color, NUM_STAMPS);
+
+   /*
+    * Take the fastest run, the others were most likely disturbed by
+    * interrupts or cold caches.
+    */
+   for (i = 0; i < LP_TEST_NUM_SAMPLES; ++i) {
+      int64_t start_counter, end_counter;
+
+      memcpy(depth, depth_init, num_pixels * sizeof(float));
+      memset(color, 0, num_colors * sizeof(float));
+
+      start_counter = rdtsc();
+      width_test_ptr(coeffs, pos, depth, color, NUM_STAMPS);
+      end_counter = rdtsc();
+
+      if (i == 0 || end_counter - start_counter < cycles)
+         cycles = end_counter - start_counter;
+   }
+
+   for (j = 0; j < num_pixels && success; ++j) {
+      if (fabs(depth[j] - ref_depth[j]) > 1e-5)
+         success = FALSE;
+   }
+   for (j = 0; j < num_colors && success; ++j) {
+      if (fabs(color[j] - ref_color[j]) > 1e-5)
+         success = FALSE;
+   }
+
+   if (!success || verbose >= 1) {
+      if (verbose < 1) {
+         dump_type(stderr, type);
+         fprintf(stderr, " ...\n");
+      }
+      fprintf(stderr, "  %s, %.2f cycles/pixel\n",
+              success ? "PASS" : "MISMATCH",
+              (double)cycles / num_pixels);
+   }
+
+   if (fp)
+      write_tsv_row(fp, type, (double)cycles / num_pixels, success);
+
+   gallivm_destroy(gallivm);
+
+out:
+   align_free(depth);
+   align_free(color);
+   FREE(depth_init);
+   FREE(ref_depth);
+   FREE(ref_color);
+
+   return success;
+}
+
+
+static const unsigned vector_lengths[] = { 4, 8, 16 };
+
+
+static struct lp_type
+width_type(unsigned length)
+{
+   return lp_type_float_vec(32, 32 * length);
+}
+
+
+boolean
+test_all(unsigned verbose, FILE *fp)
+{
+   boolean success = TRUE;
+   unsigned i;
+
+   for (i = 0; i < Elements(vector_lengths); ++i) {
+      if (!test_one(verbose, fp, width_type(vector_lengths[i])))
+         success = FALSE;
+   }
+
+   return success;
+}
+
+
+boolean
+test_some(unsigned verbose, FILE *fp,
+          unsigned long n)
+{
+   /* Every width is cheap to test, so no point in picking random ones */
+   return test_all(verbose, fp);
+}
+
+
+boolean
+test_single(unsigned verbose, FILE *fp)
+{
+   return test_one(verbose, fp, width_type(lp_native_vector_width / 32));
+}
@@ -49,6 +49,7 @@ struct pipe_screen;
 struct pipe_context;
 struct pipe_resource;
 struct pipe_box;
+struct pipe_fence_handle;
 
 /**
  * Opaque pointer.
@@ -135,6 +136,23 @@ struct sw_winsys
    void 
    (*displaytarget_destroy)( struct sw_winsys *ws, 
                              struct sw_displaytarget *dt );
+
+   /**
+    * Optional.  Like displaytarget_display, but rendering to the display
+    * target may still be in progress: its contents are only complete once
+    * the fence signals (see pipe_screen::fence_finish).  This lets the
+    * consumer of the frame wait for it while the next one is rendered.
+    *
+    * The fence may be NULL if there is nothing to wait for.  It is only
+    * valid during the call; use pipe_screen::fence_reference to keep it.
+    */
+   void
+   (*displaytarget_display_fenced)( struct sw_winsys *ws,
+                                    struct sw_displaytarget *dt,
+                                    void *context_private,
+                                    struct pipe_box *box,
+                                    struct pipe_screen *screen,
+                                    struct pipe_fence_handle *fence );
 };
 
 
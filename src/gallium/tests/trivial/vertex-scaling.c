@@ -0,0 +1,352 @@
+/**************************************************************************
+ *
+ * Copyright © 2010 Jakob Bornecrantz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * Vertex processing thread scaling benchmark.
+ *
+ * Draws many tiny triangles with a long vertex shader and rasterizer
+ * discard, so nearly all the time goes to the draw module's vertex
+ * processing, with DRAW_VS_THREADS set to 0, 1, 2, 4, ... up to the number
+ * of CPUs (or the first argument).  Prints vertices/sec for each thread
+ * count.  Only meaningful with drivers using the draw module with LLVM.
+ */
+
+
+#define WIDTH 256
+#define HEIGHT 256
+#define NUM_TRIS 100000
+#define NUM_FRAMES 20
+#define VS_ITERATIONS 64
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* pipe_*_state structs */
+#include "pipe/p_state.h"
+/* pipe_context */
+#include "pipe/p_context.h"
+/* pipe_screen */
+#include "pipe/p_screen.h"
+/* PIPE_* */
+#include "pipe/p_defines.h"
+/* TGSI_SEMANTIC_{POSITION|GENERIC} */
+#include "pipe/p_shader_tokens.h"
+/* pipe_buffer_* helpers */
+#include "util/u_inlines.h"
+
+/* constant state object helper */
+#include "cso_cache/cso_context.h"
+
+/* util_draw_vertex_buffer helper */
+#include "util/u_draw_quad.h"
+/* FREE & CALLOC_STRUCT */
+#include "util/u_memory.h"
+/* util_snprintf */
+#include "util/u_string.h"
+/* util_make_fragment_passthrough_shader */
+#include "util/u_simple_shaders.h"
+/* util_cpu_caps */
+#include "util/u_cpu_detect.h"
+/* tgsi_text_translate */
+#include "tgsi/tgsi_text.h"
+/* os_time_get */
+#include "os/os_time.h"
+/* to get a hardware pipe driver */
+#include "pipe-loader/pipe_loader.h"
+
+struct program
+{
+	struct pipe_loader_device *dev;
+	struct pipe_screen *screen;
+	struct pipe_context *pipe;
+	struct cso_context *cso;
+
+	struct pipe_blend_state blend;
+	struct pipe_depth_stencil_alpha_state depthstencil;
+	struct pipe_rasterizer_state rasterizer;
+	struct pipe_viewport_state viewport;
+	struct pipe_framebuffer_state framebuffer;
+	struct pipe_vertex_element velem[2];
+
+	void *vs;
+	void *fs;
+
+	struct pipe_resource *vbuf;
+	struct pipe_resource *target;
+};
+
+/* A vertex shader doing a lot of pointless math on the color */
+static void *make_vs(struct pipe_context *pipe)
+{
+	static const char header[] =
+		"VERT\n"
+		"DCL IN[0]\n"
+		"DCL IN[1]\n"
+		"DCL OUT[0], POSITION\n"
+		"DCL OUT[1], COLOR\n"
+		"DCL TEMP[0]\n"
+		"IMM[0] FLT32 { 0.99, 0.01, 0.5, 1.0 }\n"
+		"  0: MOV TEMP[0], IN[1]\n";
+	char *text = MALLOC(sizeof header + VS_ITERATIONS * 128 + 128);
+	struct tgsi_token tokens[1024];
+	struct pipe_shader_state state;
+	unsigned i, n = 1;
+	int len;
+	void *vs;
+
+	len = util_sprintf(text, "%s", header);
+	for (i = 0; i < VS_ITERATIONS; i++) {
+		len += util_sprintf(text + len,
+		                    "%3u: MAD TEMP[0], TEMP[0], IMM[0].xxxx, IMM[0].yyyy\n"
+		                    "%3u: DP4 TEMP[0].w, TEMP[0], IMM[0]\n",
+		                    n, n + 1);
+		n += 2;
+	}
+	util_sprintf(text + len,
+	             "%3u: MOV OUT[0], IN[0]\n"
+	             "%3u: MOV OUT[1], TEMP[0]\n"
+	             "%3u: END\n", n, n + 1, n + 2);
+
+	if (!tgsi_text_translate(text, tokens, Elements(tokens))) {
+		fprintf(stderr, "failed to translate the vertex shader\n");
+		exit(1);
+	}
+	FREE(text);
+
+	memset(&state, 0, sizeof state);
+	state.tokens = tokens;
+	vs = pipe->create_vs_state(pipe, &state);
+
+	return vs;
+}
+
+static void init_prog(struct program *p)
+{
+	struct pipe_surface surf_tmpl;
+	int ret;
+
+	/* find a device */
+	ret = pipe_loader_probe(&p->dev, 1);
+	assert(ret);
+
+	p->screen = pipe_loader_create_screen(p->dev, PIPE_SEARCH_DIR);
+	assert(p->screen);
+
+	/* create the pipe driver context, this picks up DRAW_VS_THREADS */
+	p->pipe = p->screen->context_create(p->screen, NULL);
+	p->cso = cso_create_context(p->pipe);
+
+	/* vertex buffer: lots of tiny triangles */
+	{
+		float (*vertices)[2][4] = MALLOC(NUM_TRIS * 3 * sizeof(*vertices));
+		unsigned i;
+
+		srand(42);
+		for (i = 0; i < NUM_TRIS * 3; i++) {
+			if (i % 3 == 0) {
+				vertices[i][0][0] = 2.0f * rand() / RAND_MAX - 1.0f;
+				vertices[i][0][1] = 2.0f * rand() / RAND_MAX - 1.0f;
+			} else {
+				vertices[i][0][0] = vertices[i - i % 3][0][0] + 0.001f * (i % 3);
+				vertices[i][0][1] = vertices[i - i % 3][0][1] + 0.001f * (i % 2);
+			}
+			vertices[i][0][2] = 0.0f;
+			vertices[i][0][3] = 1.0f;
+			vertices[i][1][0] = (float) rand() / RAND_MAX;
+			vertices[i][1][1] = (float) rand() / RAND_MAX;
+			vertices[i][1][2] = (float) rand() / RAND_MAX;
+			vertices[i][1][3] = 1.0f;
+		}
+
+		p->vbuf = pipe_buffer_create(p->screen, PIPE_BIND_VERTEX_BUFFER,
+					     PIPE_USAGE_DEFAULT,
+					     NUM_TRIS * 3 * sizeof(*vertices));
+		pipe_buffer_write(p->pipe, p->vbuf, 0,
+				  NUM_TRIS * 3 * sizeof(*vertices), vertices);
+		FREE(vertices);
+	}
+
+	/* render target texture */
+	{
+		struct pipe_resource tmplt;
+		memset(&tmplt, 0, sizeof(tmplt));
+		tmplt.target = PIPE_TEXTURE_2D;
+		tmplt.format = PIPE_FORMAT_B8G8R8A8_UNORM; /* All drivers support this */
+		tmplt.width0 = WIDTH;
+		tmplt.height0 = HEIGHT;
+		tmplt.depth0 = 1;
+		tmplt.array_size = 1;
+		tmplt.last_level = 0;
+		tmplt.bind = PIPE_BIND_RENDER_TARGET;
+
+		p->target = p->screen->resource_create(p->screen, &tmplt);
+	}
+
+	memset(&p->blend, 0, sizeof(p->blend));
+	p->blend.rt[0].colormask = PIPE_MASK_RGBA;
+
+	/* no-op depth/stencil/alpha */
+	memset(&p->depthstencil, 0, sizeof(p->depthstencil));
+
+	/* rasterizer: throw the triangles away after vertex processing */
+	memset(&p->rasterizer, 0, sizeof(p->rasterizer));
+	p->rasterizer.cull_face = PIPE_FACE_NONE;
+	p->rasterizer.half_pixel_center = 1;
+	p->rasterizer.bottom_edge_rule = 1;
+	p->rasterizer.depth_clip = 1;
+	p->rasterizer.rasterizer_discard = 1;
+
+	surf_tmpl.format = PIPE_FORMAT_B8G8R8A8_UNORM;
+	surf_tmpl.u.tex.level = 0;
+	surf_tmpl.u.tex.first_layer = 0;
+	surf_tmpl.u.tex.last_layer = 0;
+	/* drawing destination */
+	memset(&p->framebuffer, 0, sizeof(p->framebuffer));
+	p->framebuffer.width = WIDTH;
+	p->framebuffer.height = HEIGHT;
+	p->framebuffer.nr_cbufs = 1;
+	p->framebuffer.cbufs[0] = p->pipe->create_surface(p->pipe, p->target, &surf_tmpl);
+
+	/* viewport */
+	p->viewport.scale[0] = (float)WIDTH / 2.0f;
+	p->viewport.scale[1] = (float)HEIGHT / 2.0f;
+	p->viewport.scale[2] = 0.5f;
+	p->viewport.translate[0] = (float)WIDTH / 2.0f;
+	p->viewport.translate[1] = (float)HEIGHT / 2.0f;
+	p->viewport.translate[2] = 0.5f;
+
+	/* vertex elements state */
+	memset(p->velem, 0, sizeof(p->velem));
+	p->velem[0].src_offset = 0 * 4 * sizeof(float); /* offset 0, first element */
+	p->velem[0].instance_divisor = 0;
+	p->velem[0].vertex_buffer_index = 0;
+	p->velem[0].src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+
+	p->velem[1].src_offset = 1 * 4 * sizeof(float); /* offset 16, second element */
+	p->velem[1].instance_divisor = 0;
+	p->velem[1].vertex_buffer_index = 0;
+	p->velem[1].src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+
+	p->vs = make_vs(p->pipe);
+
+	/* fragment shader */
+	p->fs = util_make_fragment_passthrough_shader(p->pipe,
+                    TGSI_SEMANTIC_COLOR, TGSI_INTERPOLATE_PERSPECTIVE, TRUE);
+}
+
+static void close_prog(struct program *p)
+{
+	cso_destroy_context(p->cso);
+
+	p->pipe->delete_vs_state(p->pipe, p->vs);
+	p->pipe->delete_fs_state(p->pipe, p->fs);
+
+	pipe_surface_reference(&p->framebuffer.cbufs[0], NULL);
+	pipe_resource_reference(&p->target, NULL);
+	pipe_resource_reference(&p->vbuf, NULL);
+
+	p->pipe->destroy(p->pipe);
+	p->screen->destroy(p->screen);
+	pipe_loader_release(&p->dev, 1);
+}
+
+static void draw(struct program *p)
+{
+	cso_set_framebuffer(p->cso, &p->framebuffer);
+
+	cso_set_blend(p->cso, &p->blend);
+	cso_set_depth_stencil_alpha(p->cso, &p->depthstencil);
+	cso_set_rasterizer(p->cso, &p->rasterizer);
+	cso_set_viewport(p->cso, &p->viewport);
+
+	cso_set_fragment_shader_handle(p->cso, p->fs);
+	cso_set_vertex_shader_handle(p->cso, p->vs);
+
+	cso_set_vertex_elements(p->cso, 2, p->velem);
+
+	util_draw_vertex_buffer(p->pipe, p->cso,
+	                        p->vbuf, 0, 0,
+	                        PIPE_PRIM_TRIANGLES,
+	                        NUM_TRIS * 3, /* verts */
+	                        2);           /* attribs/vert */
+
+	p->pipe->flush(p->pipe, NULL, 0);
+}
+
+static double run(unsigned num_threads)
+{
+	struct program *p = CALLOC_STRUCT(program);
+	struct pipe_fence_handle *fence = NULL;
+	char value[16];
+	int64_t start, end;
+	unsigned i;
+
+	util_snprintf(value, sizeof value, "%u", num_threads);
+	setenv("DRAW_VS_THREADS", value, 1);
+
+	init_prog(p);
+
+	/* warm up: shader compilation, first allocations */
+	draw(p);
+
+	start = os_time_get();
+	for (i = 0; i < NUM_FRAMES; i++)
+		draw(p);
+	p->pipe->flush(p->pipe, &fence, 0);
+	p->screen->fence_finish(p->screen, fence, PIPE_TIMEOUT_INFINITE);
+	p->screen->fence_reference(p->screen, &fence, NULL);
+	end = os_time_get();
+
+	close_prog(p);
+	FREE(p);
+
+	return NUM_FRAMES * NUM_TRIS * 3 * 1000000.0 / (double)(end - start);
+}
+
+int main(int argc, char** argv)
+{
+	unsigned max_threads, n;
+	double base = 0.0;
+
+	util_cpu_detect();
+	max_threads = argc > 1 ? atoi(argv[1]) : util_cpu_caps.nr_cpus;
+
+	printf("vs threads  Mvertices/sec  speedup\n");
+	n = 0;
+	while (1) {
+		double vps = run(n);
+
+		if (n == 0)
+			base = vps;
+
+		printf("%10u  %13.2f  %6.2fx\n", n, vps / 1000000.0, vps / base);
+
+		if (n >= max_threads)
+			break;
+		n = n ? MIN2(n * 2, max_threads) : 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,377 @@
+/**************************************************************************
+ *
+ * Copyright 2026 agent
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Test case and benchmark for the CSO hash tables.
+ *
+ * A stream of state changes like the ones an application makes every frame
+ * (a few states used all the time, a long tail of rarely used ones) is
+ * replayed against cso_hash and cso_open_hash, checking that both find the
+ * same objects and timing the lookups.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pipe/p_state.h"
+#include "cso_cache/cso_cache.h"
+#include "cso_cache/cso_hash.h"
+#include "cso_cache/cso_open_hash.h"
+#include "os/os_time.h"
+#include "util/u_memory.h"
+
+
+#define NUM_BLEND      96
+#define NUM_RASTERIZER 160
+#define NUM_DSA        64
+#define NUM_SAMPLER    384
+
+#define STREAM_LENGTH  (1 << 20)
+#define ITERATIONS     8
+
+
+struct state_change {
+   enum cso_cache_type type;
+   const void *templ;
+   unsigned size;
+};
+
+
+static struct pipe_blend_state blends[NUM_BLEND];
+static struct pipe_rasterizer_state rasterizers[NUM_RASTERIZER];
+static struct pipe_depth_stencil_alpha_state dsas[NUM_DSA];
+static struct pipe_sampler_state samplers[NUM_SAMPLER];
+
+
+static unsigned rand_state = 1;
+
+static unsigned
+next_rand(void)
+{
+   rand_state = rand_state * 1103515245 + 12345;
+   return rand_state >> 8;
+}
+
+
+/**
+ * Pick an index in [0, n) favouring the low ones, roughly like the state
+ * usage of a frame.
+ */
+static unsigned
+skewed_index(unsigned n)
+{
+   double x = (next_rand() & 0xffff) / 65536.0;
+   return (unsigned)(x * x * x * n);
+}
+
+
+static void
+init_states(void)
+{
+   unsigned i;
+
+   /* The states only need to be distinct and deterministic; vary the
+    * fields that usually change between draws.
+    */
+   for (i = 0; i < NUM_BLEND; i++) {
+      struct pipe_blend_state *blend = &blends[i];
+      blend->rt[0].blend_enable = i & 1;
+      blend->rt[0].rgb_func = (i >> 1) % 5;
+      blend->rt[0].rgb_src_factor = (i >> 1) / 5 % 8;
+      blend->rt[0].rgb_dst_factor = i / 80;
+      blend->rt[0].colormask = 0xf;
+   }
+
+   for (i = 0; i < NUM_RASTERIZER; i++) {
+      struct pipe_rasterizer_state *rast = &rasterizers[i];
+      rast->cull_face = i & 3;
+      rast->front_ccw = (i >> 2) & 1;
+      rast->scissor = (i >> 3) & 1;
+      rast->offset_tri = (i >> 4) & 1;
+      rast->offset_units = (float)(i >> 5);
+      rast->line_width = 1.0f;
+      rast->half_pixel_center = 1;
+   }
+
+   for (i = 0; i < NUM_DSA; i++) {
+      struct pipe_depth_stencil_alpha_state *dsa = &dsas[i];
+      dsa->depth.enabled = 1;
+      dsa->depth.writemask = i & 1;
+      dsa->depth.func = (i >> 1) & 7;
+      dsa->stencil[0].enabled = (i >> 4) & 1;
+      dsa->stencil[0].valuemask = i >> 5;
+   }
+
+   for (i = 0; i < NUM_SAMPLER; i++) {
+      struct pipe_sampler_state *sampler = &samplers[i];
+      sampler->wrap_s = i % 3;
+      sampler->wrap_t = i / 3 % 3;
+      sampler->min_img_filter = (i / 9) & 1;
+      sampler->mag_img_filter = (i / 9) & 1;
+      sampler->min_mip_filter = (i / 18) % 3;
+      sampler->max_anisotropy = i / 54;
+      sampler->max_lod = 1000.0f;
+   }
+}
+
+
+static void
+init_stream(struct state_change *stream, unsigned length)
+{
+   unsigned i;
+
+   for (i = 0; i < length; i++) {
+      struct state_change *change = &stream[i];
+
+      switch (next_rand() % 8) {
+      case 0:
+         change->type = CSO_BLEND;
+         change->templ = &blends[skewed_index(NUM_BLEND)];
+         change->size = sizeof(struct pipe_blend_state);
+         break;
+      case 1:
+      case 2:
+         change->type = CSO_RASTERIZER;
+         change->templ = &rasterizers[skewed_index(NUM_RASTERIZER)];
+         change->size = sizeof(struct pipe_rasterizer_state);
+         break;
+      case 3:
+         change->type = CSO_DEPTH_STENCIL_ALPHA;
+         change->templ = &dsas[skewed_index(NUM_DSA)];
+         change->size = sizeof(struct pipe_depth_stencil_alpha_state);
+         break;
+      default:
+         change->type = CSO_SAMPLER;
+         change->templ = &samplers[skewed_index(NUM_SAMPLER)];
+         change->size = sizeof(struct pipe_sampler_state);
+         break;
+      }
+   }
+}
+
+
+/**
+ * Replay the stream, adding the missing states to both tables, and check
+ * that they agree.
+ */
+static boolean
+replay_check(const struct state_change *stream, unsigned length,
+             struct cso_hash **hashes, struct cso_open_hash **open_hashes)
+{
+   unsigned i, inserted = 0;
+
+   for (i = 0; i < length; i++) {
+      const struct state_change *change = &stream[i];
+      unsigned key = cso_construct_key((void *)change->templ, change->size);
+      void *a = cso_hash_find_data_from_template(hashes[change->type], key,
+                                                 (void *)change->templ,
+                                                 change->size);
+      void *b = cso_open_hash_find(open_hashes[change->type], key,
+                                   change->templ, change->size);
+
+      if (a != b) {
+         printf("mismatch at state change %u\n", i);
+         return FALSE;
+      }
+
+      if (!a) {
+         void *state = MALLOC(change->size);
+         memcpy(state, change->templ, change->size);
+         cso_hash_insert(hashes[change->type], key, state);
+         if (!cso_open_hash_insert(open_hashes[change->type], key, state)) {
+            printf("out of memory\n");
+            return FALSE;
+         }
+         inserted++;
+      }
+   }
+
+   printf("%u state changes, %u distinct states\n", length, inserted);
+   return TRUE;
+}
+
+
+static double
+replay_cso_hash(const struct state_change *stream, unsigned length,
+                struct cso_hash **hashes)
+{
+   int64_t start = os_time_get_nano();
+   uintptr_t sum = 0;
+   unsigned i, j;
+
+   for (j = 0; j < ITERATIONS; j++) {
+      for (i = 0; i < length; i++) {
+         const struct state_change *change = &stream[i];
+         unsigned key = cso_construct_key((void *)change->templ,
+                                          change->size);
+         sum += (uintptr_t)
+            cso_hash_find_data_from_template(hashes[change->type], key,
+                                             (void *)change->templ,
+                                             change->size);
+      }
+   }
+
+   /* Keep the lookups from being optimized away */
+   if (!sum)
+      printf("no state found\n");
+
+   return (double)(os_time_get_nano() - start) / ((double)length * ITERATIONS);
+}
+
+
+static double
+replay_cso_open_hash(const struct state_change *stream, unsigned length,
+                     struct cso_open_hash **open_hashes)
+{
+   int64_t start = os_time_get_nano();
+   uintptr_t sum = 0;
+   unsigned i, j;
+
+   for (j = 0; j < ITERATIONS; j++) {
+      for (i = 0; i < length; i++) {
+         const struct state_change *change = &stream[i];
+         unsigned key = cso_construct_key((void *)change->templ,
+                                          change->size);
+         sum += (uintptr_t)
+            cso_open_hash_find(open_hashes[change->type], key,
+                               change->templ, change->size);
+      }
+   }
+
+   if (!sum)
+      printf("no state found\n");
+
+   return (double)(os_time_get_nano() - start) / ((double)length * ITERATIONS);
+}
+
+
+/**
+ * Remove about half of the entries the way the cache is sanitized, and
+ * check that all the others are still found.
+ */
+static boolean
+check_erase(struct cso_open_hash *hash, unsigned size)
+{
+   unsigned count = cso_open_hash_size(hash);
+   unsigned slot, removed = 0, found = 0;
+   void **kept = MALLOC(count * sizeof *kept);
+   unsigned *keys = MALLOC(count * sizeof *keys);
+   unsigned num_kept = 0, i;
+
+   for (slot = cso_open_hash_next(hash, 0); slot < hash->size;
+        slot = cso_open_hash_next(hash, slot + 1)) {
+      void *state = cso_open_hash_data(hash, slot);
+      if (next_rand() & 1) {
+         cso_open_hash_erase(hash, slot);
+         FREE(state);
+         removed++;
+      }
+      else {
+         kept[num_kept] = state;
+         keys[num_kept] = hash->keys[slot];
+         num_kept++;
+      }
+   }
+
+   for (i = 0; i < num_kept; i++) {
+      if (cso_open_hash_find(hash, keys[i], kept[i], size) == kept[i])
+         found++;
+   }
+
+   FREE(kept);
+   FREE(keys);
+
+   if (cso_open_hash_size(hash) != count - removed || found != num_kept) {
+      printf("erase failed: %u of %u entries found\n", found, num_kept);
+      return FALSE;
+   }
+
+   return TRUE;
+}
+
+
+int main(int argc, char **argv)
+{
+   struct cso_hash *hashes[CSO_CACHE_MAX];
+   struct cso_open_hash *open_hashes[CSO_CACHE_MAX];
+   struct state_change *stream;
+   boolean pass = TRUE;
+   double t_hash, t_open_hash;
+   unsigned state_sizes[CSO_CACHE_MAX];
+   unsigned i;
+
+   memset(state_sizes, 0, sizeof state_sizes);
+   state_sizes[CSO_RASTERIZER] = sizeof(struct pipe_rasterizer_state);
+   state_sizes[CSO_BLEND] = sizeof(struct pipe_blend_state);
+   state_sizes[CSO_DEPTH_STENCIL_ALPHA] =
+      sizeof(struct pipe_depth_stencil_alpha_state);
+   state_sizes[CSO_SAMPLER] = sizeof(struct pipe_sampler_state);
+
+   init_states();
+
+   stream = MALLOC(STREAM_LENGTH * sizeof *stream);
+   init_stream(stream, STREAM_LENGTH);
+
+   for (i = 0; i < CSO_CACHE_MAX; i++) {
+      hashes[i] = cso_hash_create();
+      open_hashes[i] = cso_open_hash_create();
+   }
+
+   pass = replay_check(stream, STREAM_LENGTH, hashes, open_hashes);
+
+   if (pass) {
+      t_hash = replay_cso_hash(stream, STREAM_LENGTH, hashes);
+      t_open_hash = replay_cso_open_hash(stream, STREAM_LENGTH, open_hashes);
+      printf("cso_hash:      %6.1f ns per state change\n", t_hash);
+      printf("cso_open_hash: %6.1f ns per state change\n", t_open_hash);
+   }
+
+   /* The states are owned by both tables; free them through the open hash */
+   for (i = 0; i < CSO_CACHE_MAX; i++) {
+      struct cso_open_hash *hash = open_hashes[i];
+      unsigned slot;
+
+      cso_hash_delete(hashes[i]);
+
+      if (pass && state_sizes[i])
+         pass = check_erase(hash, state_sizes[i]);
+
+      for (slot = cso_open_hash_next(hash, 0); slot < hash->size;
+           slot = cso_open_hash_next(hash, slot + 1))
+         FREE(cso_open_hash_data(hash, slot));
+      cso_open_hash_delete(hash);
+   }
+
+   FREE(stream);
+
+   printf("%s\n", pass ? "PASS" : "FAIL");
+
+   return pass ? 0 : 1;
+}
@@ -0,0 +1,342 @@
+/**************************************************************************
+ *
+ * Copyright 2026 agent
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Consumer of the shared memory winsys (null_sw_shm_create).
+ *
+ * Renders a frame with the software rasterizer (llvmpipe when built,
+ * GALLIUM_DRIVER=softpipe for the other one) into a shared memory display
+ * target, presents it, and checks the pixels the way another process
+ * would: mmap the presented fd, wait on the fence, read.  The fd exported
+ * with resource_get_handle must show the same pixels.
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "pipe/p_config.h"
+
+#if defined(PIPE_OS_UNIX)
+
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_shader_tokens.h"
+#include "pipe/p_state.h"
+#include "cso_cache/cso_context.h"
+#include "state_tracker/drm_driver.h"
+#include "util/u_draw_quad.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "util/u_simple_shaders.h"
+#include "target-helpers/inline_sw_helper.h"
+#include "sw/null/null_sw_winsys.h"
+
+
+#define WIDTH  64
+#define HEIGHT 32
+
+/* PIPE_FORMAT_B8G8R8A8_UNORM pixels read as 32-bit words */
+#define BLUE   0xff0000ff
+#define GREEN  0xff00ff00
+
+
+/**
+ * What the consumer got from the last present.
+ */
+struct frame_consumer
+{
+   unsigned presents;
+   int fd;
+   unsigned size;
+   unsigned stride;
+   unsigned width, height;
+   struct pipe_screen *screen;
+   struct pipe_fence_handle *fence;
+};
+
+
+static void
+present(void *data, const struct null_sw_frame *frame)
+{
+   struct frame_consumer *consumer = data;
+
+   consumer->presents++;
+
+   /* The fd and fence are only valid during the call */
+   consumer->fd = dup(frame->fd);
+   consumer->size = frame->size;
+   consumer->stride = frame->stride;
+   consumer->width = frame->width;
+   consumer->height = frame->height;
+   consumer->screen = frame->screen;
+   if (frame->fence)
+      frame->screen->fence_reference(frame->screen, &consumer->fence,
+                                     frame->fence);
+}
+
+
+/**
+ * Clear to blue and draw a green quad over the left half.
+ */
+static void
+render(struct pipe_context *pipe, struct pipe_resource *target)
+{
+   static const float vertices[6][2][4] = {
+      { { -1.0f, -1.0f, 0.0f, 1.0f }, { 0.0f, 1.0f, 0.0f, 1.0f } },
+      { {  0.0f, -1.0f, 0.0f, 1.0f }, { 0.0f, 1.0f, 0.0f, 1.0f } },
+      { {  0.0f,  1.0f, 0.0f, 1.0f }, { 0.0f, 1.0f, 0.0f, 1.0f } },
+      { { -1.0f, -1.0f, 0.0f, 1.0f }, { 0.0f, 1.0f, 0.0f, 1.0f } },
+      { {  0.0f,  1.0f, 0.0f, 1.0f }, { 0.0f, 1.0f, 0.0f, 1.0f } },
+      { { -1.0f,  1.0f, 0.0f, 1.0f }, { 0.0f, 1.0f, 0.0f, 1.0f } },
+   };
+   const uint semantic_names[] = { TGSI_SEMANTIC_POSITION,
+                                   TGSI_SEMANTIC_COLOR };
+   const uint semantic_indexes[] = { 0, 0 };
+   struct cso_context *cso = cso_create_context(pipe);
+   struct pipe_framebuffer_state framebuffer;
+   struct pipe_blend_state blend;
+   struct pipe_depth_stencil_alpha_state dsa;
+   struct pipe_rasterizer_state rasterizer;
+   struct pipe_viewport_state viewport;
+   struct pipe_vertex_element velem[2];
+   struct pipe_surface surf_tmpl, *surf;
+   struct pipe_resource *vbuf;
+   union pipe_color_union clear_color;
+   void *vs, *fs;
+
+   memset(&surf_tmpl, 0, sizeof surf_tmpl);
+   surf_tmpl.format = target->format;
+   surf = pipe->create_surface(pipe, target, &surf_tmpl);
+
+   memset(&framebuffer, 0, sizeof framebuffer);
+   framebuffer.width = WIDTH;
+   framebuffer.height = HEIGHT;
+   framebuffer.nr_cbufs = 1;
+   framebuffer.cbufs[0] = surf;
+   cso_set_framebuffer(cso, &framebuffer);
+
+   clear_color.f[0] = 0.0f;
+   clear_color.f[1] = 0.0f;
+   clear_color.f[2] = 1.0f;
+   clear_color.f[3] = 1.0f;
+   pipe->clear(pipe, PIPE_CLEAR_COLOR, &clear_color, 0, 0);
+
+   memset(&blend, 0, sizeof blend);
+   blend.rt[0].colormask = PIPE_MASK_RGBA;
+   cso_set_blend(cso, &blend);
+
+   memset(&dsa, 0, sizeof dsa);
+   cso_set_depth_stencil_alpha(cso, &dsa);
+
+   memset(&rasterizer, 0, sizeof rasterizer);
+   rasterizer.cull_face = PIPE_FACE_NONE;
+   rasterizer.half_pixel_center = 1;
+   rasterizer.bottom_edge_rule = 1;
+   rasterizer.depth_clip = 1;
+   cso_set_rasterizer(cso, &rasterizer);
+
+   memset(&viewport, 0, sizeof viewport);
+   viewport.scale[0] = WIDTH / 2.0f;
+   viewport.scale[1] = HEIGHT / 2.0f;
+   viewport.scale[2] = 1.0f;
+   viewport.translate[0] = WIDTH / 2.0f;
+   viewport.translate[1] = HEIGHT / 2.0f;
+   cso_set_viewport(cso, &viewport);
+
+   vs = util_make_vertex_passthrough_shader(pipe, 2, semantic_names,
+                                            semantic_indexes, FALSE);
+   fs = util_make_fragment_passthrough_shader(pipe, TGSI_SEMANTIC_COLOR,
+                                              TGSI_INTERPOLATE_PERSPECTIVE,
+                                              TRUE);
+   cso_set_vertex_shader_handle(cso, vs);
+   cso_set_fragment_shader_handle(cso, fs);
+
+   memset(velem, 0, sizeof velem);
+   velem[0].src_offset = 0;
+   velem[0].src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+   velem[1].src_offset = 4 * sizeof(float);
+   velem[1].src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+   cso_set_vertex_elements(cso, 2, velem);
+
+   vbuf = pipe_buffer_create(pipe->screen, PIPE_BIND_VERTEX_BUFFER,
+                             PIPE_USAGE_DEFAULT, sizeof vertices);
+   pipe_buffer_write(pipe, vbuf, 0, sizeof vertices, vertices);
+
+   util_draw_vertex_buffer(pipe, cso, vbuf, 0, 0, PIPE_PRIM_TRIANGLES, 6, 2);
+
+   /* Queue the scene, without waiting for it */
+   pipe->flush(pipe, NULL, 0);
+
+   cso_destroy_context(cso);
+   pipe->delete_vs_state(pipe, vs);
+   pipe->delete_fs_state(pipe, fs);
+   pipe_resource_reference(&vbuf, NULL);
+   pipe_surface_reference(&surf, NULL);
+}
+
+
+/**
+ * Map a frame's shared memory and check it has the expected pixels.
+ */
+static boolean
+check_frame(int fd, unsigned size, unsigned stride, const char *what)
+{
+   const uint8_t *map;
+   unsigned x, y;
+   boolean pass = TRUE;
+
+   map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+   if (map == MAP_FAILED) {
+      printf("%s: mmap failed\n", what);
+      return FALSE;
+   }
+
+   for (y = 0; y < HEIGHT && pass; y++) {
+      const uint32_t *row = (const uint32_t *) (map + y * stride);
+
+      for (x = 0; x < WIDTH; x++) {
+         uint32_t expected = x < WIDTH / 2 ? GREEN : BLUE;
+
+         if (row[x] != expected) {
+            printf("%s: pixel %u, %u is 0x%08x instead of 0x%08x\n",
+                   what, x, y, row[x], expected);
+            pass = FALSE;
+            break;
+         }
+      }
+   }
+
+   munmap((void *) map, size);
+   return pass;
+}
+
+
+int main(int argc, char **argv)
+{
+   struct frame_consumer consumer;
+   struct sw_winsys *winsys;
+   struct pipe_screen *screen;
+   struct pipe_context *pipe;
+   struct pipe_resource templat, *target;
+   struct winsys_handle whandle;
+   boolean pass = TRUE;
+
+   memset(&consumer, 0, sizeof consumer);
+   consumer.fd = -1;
+
+   winsys = null_sw_shm_create(present, &consumer);
+   if (!winsys) {
+      printf("null_sw_shm_create failed\n");
+      return 1;
+   }
+
+   screen = sw_screen_create(winsys);
+   if (!screen) {
+      printf("no software rasterizer\n");
+      winsys->destroy(winsys);
+      return 1;
+   }
+   printf("rendering with %s\n", screen->get_name(screen));
+
+   pipe = screen->context_create(screen, NULL);
+
+   memset(&templat, 0, sizeof templat);
+   templat.target = PIPE_TEXTURE_2D;
+   templat.format = PIPE_FORMAT_B8G8R8A8_UNORM;
+   templat.width0 = WIDTH;
+   templat.height0 = HEIGHT;
+   templat.depth0 = 1;
+   templat.array_size = 1;
+   templat.bind = PIPE_BIND_RENDER_TARGET | PIPE_BIND_DISPLAY_TARGET |
+                  PIPE_BIND_SHARED;
+   target = screen->resource_create(screen, &templat);
+
+   render(pipe, target);
+   screen->flush_frontbuffer(screen, target, 0, 0, NULL, NULL);
+
+   if (consumer.presents != 1 || consumer.fd < 0 ||
+       consumer.width != WIDTH || consumer.height != HEIGHT ||
+       consumer.stride < WIDTH * 4 ||
+       consumer.size < consumer.stride * HEIGHT) {
+      printf("unexpected present: %u presents, fd %d, %ux%u, stride %u\n",
+             consumer.presents, consumer.fd, consumer.width,
+             consumer.height, consumer.stride);
+      pass = FALSE;
+   }
+   else {
+      /* What a consumer in another process does with the frame */
+      if (consumer.fence) {
+         printf("present fenced, frame %s when presented\n",
+                screen->fence_signalled(screen, consumer.fence) ?
+                "complete" : "still rendering");
+         consumer.screen->fence_finish(consumer.screen, consumer.fence,
+                                       PIPE_TIMEOUT_INFINITE);
+      }
+      pass = check_frame(consumer.fd, consumer.size, consumer.stride,
+                         "presented frame");
+
+      memset(&whandle, 0, sizeof whandle);
+      whandle.type = DRM_API_HANDLE_TYPE_FD;
+      if (screen->resource_get_handle(screen, target, &whandle)) {
+         pass = check_frame(whandle.handle, consumer.size, whandle.stride,
+                            "exported fd") && pass;
+         close(whandle.handle);
+      }
+      else {
+         printf("resource_get_handle failed\n");
+         pass = FALSE;
+      }
+   }
+
+   if (consumer.fence)
+      screen->fence_reference(screen, &consumer.fence, NULL);
+   if (consumer.fd >= 0)
+      close(consumer.fd);
+
+   pipe_resource_reference(&target, NULL);
+   pipe->destroy(pipe);
+   screen->destroy(screen);   /* and the winsys */
+
+   printf("%s\n", pass ? "PASS" : "FAIL");
+   return pass ? 0 : 1;
+}
+
+#else /* !PIPE_OS_UNIX */
+
+int main(int argc, char **argv)
+{
+   printf("shared memory display targets need a Unix system\n");
+   return 0;
+}
+
+#endif /* !PIPE_OS_UNIX */
@@ -29,6 +29,7 @@
 #include "util/u_format.h"
 #include "util/u_half.h"
 #include "util/u_cpu_detect.h"
+#include "os/os_time.h"
 #include "rtasm/rtasm_cpu.h"
 
 /* don't use this for serious use */
@@ -46,6 +47,152 @@ static double rand_double()
    return v;
 }
 
+/* common vertex formats, fetched into R32G32B32A32_FLOAT */
+static const enum pipe_format bench_formats[] = {
+   PIPE_FORMAT_R32G32B32A32_FLOAT,
+   PIPE_FORMAT_R32G32B32_FLOAT,
+   PIPE_FORMAT_R32G32_FLOAT,
+   PIPE_FORMAT_R64G64B64_FLOAT,
+   PIPE_FORMAT_R16G16B16A16_FLOAT,
+   PIPE_FORMAT_R16G16_FLOAT,
+   PIPE_FORMAT_R8G8B8A8_UNORM,
+   PIPE_FORMAT_B8G8R8A8_UNORM,
+   PIPE_FORMAT_R8G8B8A8_SNORM,
+   PIPE_FORMAT_R16G16B16A16_UNORM,
+   PIPE_FORMAT_R16G16_SNORM,
+   PIPE_FORMAT_R32G32B32A32_UNORM,
+   PIPE_FORMAT_R10G10B10A2_UNORM,
+   PIPE_FORMAT_R10G10B10A2_SNORM,
+   PIPE_FORMAT_B10G10R10A2_UNORM,
+   PIPE_FORMAT_R10G10B10A2_USCALED,
+   PIPE_FORMAT_B5G6R5_UNORM
+};
+
+/* 32 bit integers lose a bit in the SSE path */
+static boolean
+bench_compare(float a, float b)
+{
+   return fabsf(a - b) <= 1e-6f * MAX2(1.0f, fabsf(b));
+}
+
+static double
+bench_run(struct translate *translate, const unsigned *elts,
+          unsigned count, unsigned iterations, void *output)
+{
+   int64_t start = os_time_get();
+   unsigned i;
+
+   for (i = 0; i < iterations; ++i) {
+      if (elts)
+         translate->run_elts(translate, elts, count, 0, 0, output);
+      else
+         translate->run(translate, 0, count, 0, 0, output);
+   }
+
+   return (double) count * iterations / (os_time_get() - start);
+}
+
+/**
+ * Measure the vertex throughput of the given implementation against
+ * translate_generic, checking that both produce the same vertices.
+ */
+static int
+benchmark(struct translate *(*create_fn)(const struct translate_key *key),
+          const char *name)
+{
+   const unsigned count = 64 * 1024;
+   const unsigned iterations = 64;
+   unsigned char *input = align_malloc(count * 32, 64);
+   float *output[2];
+   unsigned *elts = align_malloc(count * sizeof *elts, 64);
+   struct translate_key key;
+   unsigned i, j, k;
+   int ret = 0;
+
+   output[0] = align_malloc(count * 4 * sizeof(float), 64);
+   output[1] = align_malloc(count * 4 * sizeof(float), 64);
+
+   srand(4359025);
+   for (i = 0; i < count * 32; ++i)
+      input[i] = rand();
+   for (i = 0; i < count; ++i)
+      elts[i] = rand() % count;
+
+   memset(&key, 0, sizeof key);
+   key.nr_elements = 1;
+   key.output_stride = 4 * sizeof(float);
+   key.element[0].type = TRANSLATE_ELEMENT_NORMAL;
+   key.element[0].output_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+
+   printf("%-36s %14s %14s %14s\n", "format (Mverts/s)",
+          name, "generic", "indexed");
+
+   for (i = 0; i < Elements(bench_formats); ++i) {
+      const struct util_format_description *desc =
+         util_format_description(bench_formats[i]);
+      struct translate *translate[2];
+      unsigned stride = util_format_get_stride(bench_formats[i], 1);
+      double rate[3];
+
+      key.element[0].input_format = bench_formats[i];
+
+      translate[0] = create_fn(&key);
+      translate[1] = translate_generic_create(&key);
+      if (!translate[0] || !translate[1]) {
+         printf("%-36s %14s\n", desc->name, "unsupported");
+         if (translate[0])
+            translate[0]->release(translate[0]);
+         if (translate[1])
+            translate[1]->release(translate[1]);
+         continue;
+      }
+
+      /* avoid NaNs, which do not compare */
+      if (desc->channel[0].type == UTIL_FORMAT_TYPE_FLOAT) {
+         for (j = 0; j < count * stride; j += desc->channel[0].size / 8) {
+            if (desc->channel[0].size == 16)
+               *(uint16_t *)(input + j) = util_float_to_half((float)rand_double());
+            else if (desc->channel[0].size == 32)
+               *(float *)(input + j) = (float)rand_double();
+            else
+               *(double *)(input + j) = rand_double();
+         }
+      }
+
+      for (j = 0; j < 2; ++j)
+         translate[j]->set_buffer(translate[j], 0, input, stride, count - 1);
+
+      rate[0] = bench_run(translate[0], NULL, count, iterations, output[0]);
+      rate[1] = bench_run(translate[1], NULL, count, iterations, output[1]);
+      for (j = 0; j < count * 4; ++j) {
+         if (!bench_compare(output[0][j], output[1][j]))
+            break;
+      }
+
+      rate[2] = bench_run(translate[0], elts, count, iterations, output[0]);
+      translate[1]->run_elts(translate[1], elts, count, 0, 0, output[1]);
+      for (k = 0; k < count * 4; ++k) {
+         if (!bench_compare(output[0][k], output[1][k]))
+            break;
+      }
+
+      printf("%-36s %14.1f %14.1f %14.1f%s\n", desc->name,
+             rate[0], rate[1], rate[2],
+             (j < count * 4 || k < count * 4) ? "  MISMATCH" : "");
+      if (j < count * 4 || k < count * 4)
+         ret = 1;
+
+      translate[1]->release(translate[1]);
+      translate[0]->release(translate[0]);
+   }
+
+   align_free(output[1]);
+   align_free(output[0]);
+   align_free(elts);
+   align_free(input);
+   return ret;
+}
+
 int main(int argc, char** argv)
 {
    struct translate *(*create_fn)(const struct translate_key *key) = 0;
@@ -82,6 +229,9 @@ int main(int argc, char** argv)
       util_cpu_caps.has_sse2 = 0;
       util_cpu_caps.has_sse3 = 0;
       util_cpu_caps.has_sse4_1 = 0;
+      util_cpu_caps.has_avx = 0;
+      util_cpu_caps.has_avx2 = 0;
+      util_cpu_caps.has_f16c = 0;
       create_fn = translate_sse2_create;
    }
    else if (!strcmp(argv[1], "sse"))
@@ -94,6 +244,9 @@ int main(int argc, char** argv)
       util_cpu_caps.has_sse2 = 0;
       util_cpu_caps.has_sse3 = 0;
       util_cpu_caps.has_sse4_1 = 0;
+      util_cpu_caps.has_avx = 0;
+      util_cpu_caps.has_avx2 = 0;
+      util_cpu_caps.has_f16c = 0;
       create_fn = translate_sse2_create;
    }
    else if (!strcmp(argv[1], "sse2"))
@@ -105,6 +258,9 @@ int main(int argc, char** argv)
       }
       util_cpu_caps.has_sse3 = 0;
       util_cpu_caps.has_sse4_1 = 0;
+      util_cpu_caps.has_avx = 0;
+      util_cpu_caps.has_avx2 = 0;
+      util_cpu_caps.has_f16c = 0;
       create_fn = translate_sse2_create;
    }
    else if (!strcmp(argv[1], "sse3"))
@@ -115,6 +271,9 @@ int main(int argc, char** argv)
          return 2;
       }
       util_cpu_caps.has_sse4_1 = 0;
+      util_cpu_caps.has_avx = 0;
+      util_cpu_caps.has_avx2 = 0;
+      util_cpu_caps.has_f16c = 0;
       create_fn = translate_sse2_create;
    }
    else if (!strcmp(argv[1], "sse4.1"))
@@ -124,15 +283,40 @@ int main(int argc, char** argv)
          printf("Error: CPU doesn't support SSE4.1 (test with qemu)\n");
          return 2;
       }
+      util_cpu_caps.has_avx = 0;
+      util_cpu_caps.has_avx2 = 0;
+      util_cpu_caps.has_f16c = 0;
+      create_fn = translate_sse2_create;
+   }
+   else if (!strcmp(argv[1], "avx"))
+   {
+      if(!util_cpu_caps.has_avx || !rtasm_cpu_has_sse())
+      {
+         printf("Error: CPU doesn't support AVX (test with qemu)\n");
+         return 2;
+      }
+      util_cpu_caps.has_avx2 = 0;
+      create_fn = translate_sse2_create;
+   }
+   else if (!strcmp(argv[1], "avx2"))
+   {
+      if(!util_cpu_caps.has_avx2 || !rtasm_cpu_has_sse())
+      {
+         printf("Error: CPU doesn't support AVX2 (test with qemu)\n");
+         return 2;
+      }
       create_fn = translate_sse2_create;
    }
 
    if (!create_fn)
    {
-      printf("Usage: ./translate_test [generic|x86|nosse|sse|sse2|sse3|sse4.1]\n");
+      printf("Usage: ./translate_test [generic|x86|nosse|sse|sse2|sse3|sse4.1|avx|avx2] [bench]\n");
       return 2;
    }
 
+   if (argc > 2 && !strcmp(argv[2], "bench"))
+      return benchmark(create_fn, argv[1]);
+
    for (i = 1; i < Elements(buffer); ++i)
       buffer[i] = align_malloc(buffer_size, 4096);
 
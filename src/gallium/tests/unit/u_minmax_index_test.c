@@ -0,0 +1,187 @@
+/**************************************************************************
+ *
+ * Copyright 2026 agent
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * Checks util_get_minmax_index() against the plain C version and measures
+ * how many indices per second both scan.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_minmax_index.h"
+#include "os/os_time.h"
+
+#define NUM_INDICES (1024 * 1024)
+#define NUM_RUNS 64
+
+
+/* rand() returns 31 bits at most */
+static unsigned
+rand_index(void)
+{
+   return ((unsigned) rand() << 16) ^ (unsigned) rand();
+}
+
+
+static void
+fill_indices(void *indices, unsigned index_size, unsigned count,
+             unsigned restart_index)
+{
+   const unsigned max_index = 0xffffffff >> (32 - index_size * 8);
+   unsigned i;
+
+   for (i = 0; i < count; i++) {
+      unsigned value;
+
+      /* Mix in values around the sign bit and the top of the range, which
+       * random values may miss.
+       */
+      switch (rand() % 16) {
+      case 0:
+         value = restart_index;
+         break;
+      case 1:
+         value = max_index / 2 + 1;
+         break;
+      case 2:
+         value = max_index - 1;
+         break;
+      default:
+         value = rand_index();
+         break;
+      }
+
+      switch (index_size) {
+      case 4:
+         ((uint32_t *) indices)[i] = value;
+         break;
+      case 2:
+         ((uint16_t *) indices)[i] = value;
+         break;
+      default:
+         ((uint8_t *) indices)[i] = value;
+         break;
+      }
+   }
+}
+
+
+static boolean
+test_correctness(void *indices, unsigned index_size)
+{
+   static const unsigned counts[] = { 0, 1, 3, 7, 15, 16, 17, 33, 1000 };
+   const unsigned max_index = 0xffffffff >> (32 - index_size * 8);
+   boolean success = TRUE;
+   unsigned r, i, j;
+
+   /* No restart, the usual restart index, and one in the middle */
+   for (r = 0; r < 3; r++) {
+      const unsigned restart = r > 0;
+      const unsigned restart_index = r == 2 ? max_index / 2 : max_index;
+
+      for (i = 0; i < Elements(counts); i++) {
+         for (j = 0; j < 100; j++) {
+            unsigned min_c, max_c, min, max;
+
+            fill_indices(indices, index_size, counts[i], restart_index);
+
+            util_get_minmax_index_c(indices, index_size, counts[i],
+                                    restart, restart_index, &min_c, &max_c);
+            util_get_minmax_index(indices, index_size, counts[i],
+                                  restart, restart_index, &min, &max);
+
+            if (min != min_c || max != max_c) {
+               printf("FAILED: index_size %u, count %u, restart %u "
+                      "(0x%x): got 0x%x..0x%x, expected 0x%x..0x%x\n",
+                      index_size, counts[i], restart, restart_index,
+                      min, max, min_c, max_c);
+               success = FALSE;
+               break;
+            }
+         }
+      }
+   }
+
+   return success;
+}
+
+
+static void
+test_speed(void *indices, unsigned index_size)
+{
+   int64_t start, c_time, time;
+   unsigned min, max;
+   unsigned i;
+
+   fill_indices(indices, index_size, NUM_INDICES, ~0);
+
+   start = os_time_get();
+   for (i = 0; i < NUM_RUNS; i++)
+      util_get_minmax_index_c(indices, index_size, NUM_INDICES,
+                              TRUE, ~0, &min, &max);
+   c_time = os_time_get() - start;
+
+   start = os_time_get();
+   for (i = 0; i < NUM_RUNS; i++)
+      util_get_minmax_index(indices, index_size, NUM_INDICES,
+                            TRUE, ~0, &min, &max);
+   time = os_time_get() - start;
+
+   printf("index_size %u: C %.1f Mindices/s, optimized %.1f Mindices/s\n",
+          index_size,
+          (double) NUM_INDICES * NUM_RUNS / MAX2(c_time, 1),
+          (double) NUM_INDICES * NUM_RUNS / MAX2(time, 1));
+}
+
+
+int
+main(int argc, char **argv)
+{
+   static const unsigned index_sizes[] = { 1, 2, 4 };
+   void *indices = MALLOC(NUM_INDICES * 4);
+   boolean success = TRUE;
+   unsigned i;
+
+   if (!indices)
+      return 1;
+
+   for (i = 0; i < Elements(index_sizes); i++) {
+      if (!test_correctness(indices, index_sizes[i]))
+         success = FALSE;
+   }
+
+   for (i = 0; i < Elements(index_sizes); i++)
+      test_speed(indices, index_sizes[i]);
+
+   FREE(indices);
+
+   printf("%s\n", success ? "Success!" : "Failure!");
+   return success ? 0 : 1;
+}
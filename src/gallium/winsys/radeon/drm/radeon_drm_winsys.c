@@ -544,6 +544,17 @@ static uint64_t radeon_query_value(struct radeon_winsys *rws,
         radeon_get_drm_value(ws->fd, RADEON_INFO_GTT_USAGE,
                              "gtt-usage", (uint32_t*)&retval);
         return retval;
+    case RADEON_BUFFER_CACHE_HITS:
+    case RADEON_BUFFER_CACHE_MISSES: {
+        struct pb_cache_bucket_stats stats[PB_CACHE_NUM_BUCKETS];
+        unsigned i;
+
+        pb_cache_manager_get_stats(ws->cman, stats);
+        for (i = 0; i < PB_CACHE_NUM_BUCKETS; i++)
+            retval += value == RADEON_BUFFER_CACHE_HITS ? stats[i].hits :
+                                                          stats[i].misses;
+        return retval;
+    }
     }
     return 0;
 }
@@ -169,7 +169,9 @@ enum radeon_value_id {
     RADEON_NUM_CS_FLUSHES,
     RADEON_NUM_BYTES_MOVED,
     RADEON_VRAM_USAGE,
-    RADEON_GTT_USAGE
+    RADEON_GTT_USAGE,
+    RADEON_BUFFER_CACHE_HITS,
+    RADEON_BUFFER_CACHE_MISSES
 };
 
 enum radeon_bo_priority {
@@ -0,0 +1,354 @@
+/**************************************************************************
+ *
+ * Copyright 2026 agent
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Headless software rasterizer winsys with shared memory display targets.
+ *
+ * The driver renders straight into the shared memory, and presenting only
+ * hands the frame (fd and completion fence) to the consumer, so there is no
+ * copy per frame and the consumer can wait for the frame while the next one
+ * is rendered.
+ */
+
+#include "pipe/p_config.h"
+#include "pipe/p_format.h"
+#include "pipe/p_state.h"
+#include "util/u_format.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "state_tracker/sw_winsys.h"
+#include "state_tracker/drm_driver.h"
+#include "null_sw_winsys.h"
+
+#if defined(PIPE_OS_UNIX)
+
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+
+struct null_shm_sw_winsys
+{
+   struct sw_winsys base;
+
+   null_sw_present_func present;
+   void *present_data;
+};
+
+
+struct null_shm_displaytarget
+{
+   enum pipe_format format;
+   unsigned width;
+   unsigned height;
+   unsigned stride;
+   unsigned size;
+
+   int fd;
+   void *data;
+};
+
+
+static INLINE struct null_shm_sw_winsys *
+null_shm_sw_winsys(struct sw_winsys *ws)
+{
+   return (struct null_shm_sw_winsys *)ws;
+}
+
+
+static INLINE struct null_shm_displaytarget *
+null_shm_displaytarget(struct sw_displaytarget *dt)
+{
+   return (struct null_shm_displaytarget *)dt;
+}
+
+
+/**
+ * Create an anonymous shared memory file of the given size.
+ */
+static int
+null_shm_alloc(unsigned size)
+{
+   int fd = -1;
+
+#ifdef __NR_memfd_create
+   fd = syscall(__NR_memfd_create, "null_sw", 1 /* MFD_CLOEXEC */);
+#endif
+
+   if (fd < 0) {
+      /* Kernels without memfd: an unlinked file in /dev/shm will do */
+      char name[] = "/dev/shm/null_sw-XXXXXX";
+
+      fd = mkstemp(name);
+      if (fd < 0)
+         return -1;
+      unlink(name);
+      fcntl(fd, F_SETFD, FD_CLOEXEC);
+   }
+
+   if (ftruncate(fd, size) < 0) {
+      close(fd);
+      return -1;
+   }
+
+   return fd;
+}
+
+
+static boolean
+null_shm_is_displaytarget_format_supported(struct sw_winsys *ws,
+                                           unsigned tex_usage,
+                                           enum pipe_format format)
+{
+   return util_format_get_blocksize(format) != 0 &&
+          !util_format_is_compressed(format);
+}
+
+
+static struct null_shm_displaytarget *
+null_shm_displaytarget_wrap(enum pipe_format format,
+                            unsigned width, unsigned height,
+                            unsigned stride, int fd)
+{
+   struct null_shm_displaytarget *shm_dt;
+
+   shm_dt = CALLOC_STRUCT(null_shm_displaytarget);
+   if (!shm_dt)
+      return NULL;
+
+   shm_dt->format = format;
+   shm_dt->width = width;
+   shm_dt->height = height;
+   shm_dt->stride = stride;
+   shm_dt->size = stride * util_format_get_nblocksy(format, height);
+   shm_dt->fd = fd;
+
+   shm_dt->data = mmap(NULL, shm_dt->size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED, fd, 0);
+   if (shm_dt->data == MAP_FAILED) {
+      FREE(shm_dt);
+      return NULL;
+   }
+
+   return shm_dt;
+}
+
+
+static struct sw_displaytarget *
+null_shm_displaytarget_create(struct sw_winsys *winsys,
+                              unsigned tex_usage,
+                              enum pipe_format format,
+                              unsigned width, unsigned height,
+                              unsigned alignment,
+                              unsigned *stride)
+{
+   struct null_shm_displaytarget *shm_dt;
+   unsigned dt_stride;
+   int fd;
+
+   dt_stride = align(util_format_get_stride(format, width), alignment);
+
+   fd = null_shm_alloc(dt_stride * util_format_get_nblocksy(format, height));
+   if (fd < 0)
+      return NULL;
+
+   shm_dt = null_shm_displaytarget_wrap(format, width, height, dt_stride, fd);
+   if (!shm_dt) {
+      close(fd);
+      return NULL;
+   }
+
+   *stride = dt_stride;
+   return (struct sw_displaytarget *)shm_dt;
+}
+
+
+static struct sw_displaytarget *
+null_shm_displaytarget_from_handle(struct sw_winsys *winsys,
+                                   const struct pipe_resource *templat,
+                                   struct winsys_handle *whandle,
+                                   unsigned *stride)
+{
+   struct null_shm_displaytarget *shm_dt;
+   int fd;
+
+   if (whandle->type != DRM_API_HANDLE_TYPE_FD)
+      return NULL;
+
+   fd = fcntl(whandle->handle, F_DUPFD_CLOEXEC, 0);
+   if (fd < 0)
+      return NULL;
+
+   shm_dt = null_shm_displaytarget_wrap(templat->format,
+                                        templat->width0, templat->height0,
+                                        whandle->stride, fd);
+   if (!shm_dt) {
+      close(fd);
+      return NULL;
+   }
+
+   *stride = shm_dt->stride;
+   return (struct sw_displaytarget *)shm_dt;
+}
+
+
+static boolean
+null_shm_displaytarget_get_handle(struct sw_winsys *winsys,
+                                  struct sw_displaytarget *dt,
+                                  struct winsys_handle *whandle)
+{
+   struct null_shm_displaytarget *shm_dt = null_shm_displaytarget(dt);
+   int fd;
+
+   if (whandle->type != DRM_API_HANDLE_TYPE_FD)
+      return FALSE;
+
+   fd = fcntl(shm_dt->fd, F_DUPFD_CLOEXEC, 0);
+   if (fd < 0)
+      return FALSE;
+
+   whandle->handle = fd;
+   whandle->stride = shm_dt->stride;
+   return TRUE;
+}
+
+
+static void *
+null_shm_displaytarget_map(struct sw_winsys *ws,
+                           struct sw_displaytarget *dt,
+                           unsigned flags)
+{
+   return null_shm_displaytarget(dt)->data;
+}
+
+
+static void
+null_shm_displaytarget_unmap(struct sw_winsys *ws,
+                             struct sw_displaytarget *dt)
+{
+   /* The mapping stays for the lifetime of the display target */
+}
+
+
+static void
+null_shm_displaytarget_destroy(struct sw_winsys *winsys,
+                               struct sw_displaytarget *dt)
+{
+   struct null_shm_displaytarget *shm_dt = null_shm_displaytarget(dt);
+
+   munmap(shm_dt->data, shm_dt->size);
+   close(shm_dt->fd);
+   FREE(shm_dt);
+}
+
+
+static void
+null_shm_displaytarget_display_fenced(struct sw_winsys *winsys,
+                                      struct sw_displaytarget *dt,
+                                      void *context_private,
+                                      struct pipe_box *box,
+                                      struct pipe_screen *screen,
+                                      struct pipe_fence_handle *fence)
+{
+   struct null_shm_sw_winsys *shm_ws = null_shm_sw_winsys(winsys);
+   struct null_shm_displaytarget *shm_dt = null_shm_displaytarget(dt);
+   struct null_sw_frame frame;
+
+   if (!shm_ws->present)
+      return;
+
+   frame.fd = shm_dt->fd;
+   frame.size = shm_dt->size;
+   frame.format = shm_dt->format;
+   frame.width = shm_dt->width;
+   frame.height = shm_dt->height;
+   frame.stride = shm_dt->stride;
+   frame.box = box;
+   frame.screen = fence ? screen : NULL;
+   frame.fence = fence;
+
+   shm_ws->present(shm_ws->present_data, &frame);
+}
+
+
+static void
+null_shm_displaytarget_display(struct sw_winsys *winsys,
+                               struct sw_displaytarget *dt,
+                               void *context_private,
+                               struct pipe_box *box)
+{
+   /* Drivers without fences have finished rendering by now */
+   null_shm_displaytarget_display_fenced(winsys, dt, context_private, box,
+                                         NULL, NULL);
+}
+
+
+static void
+null_shm_destroy(struct sw_winsys *winsys)
+{
+   FREE(winsys);
+}
+
+
+struct sw_winsys *
+null_sw_shm_create(null_sw_present_func present, void *data)
+{
+   struct null_shm_sw_winsys *ws;
+
+   ws = CALLOC_STRUCT(null_shm_sw_winsys);
+   if (!ws)
+      return NULL;
+
+   ws->present = present;
+   ws->present_data = data;
+
+   ws->base.destroy = null_shm_destroy;
+   ws->base.is_displaytarget_format_supported = null_shm_is_displaytarget_format_supported;
+   ws->base.displaytarget_create = null_shm_displaytarget_create;
+   ws->base.displaytarget_from_handle = null_shm_displaytarget_from_handle;
+   ws->base.displaytarget_get_handle = null_shm_displaytarget_get_handle;
+   ws->base.displaytarget_map = null_shm_displaytarget_map;
+   ws->base.displaytarget_unmap = null_shm_displaytarget_unmap;
+   ws->base.displaytarget_display = null_shm_displaytarget_display;
+   ws->base.displaytarget_display_fenced = null_shm_displaytarget_display_fenced;
+   ws->base.displaytarget_destroy = null_shm_displaytarget_destroy;
+
+   return &ws->base;
+}
+
+#else /* !PIPE_OS_UNIX */
+
+struct sw_winsys *
+null_sw_shm_create(null_sw_present_func present, void *data)
+{
+   return NULL;
+}
+
+#endif /* !PIPE_OS_UNIX */
@@ -30,11 +30,54 @@
 #define NULL_SW_WINSYS_H_
 
 
+#include "pipe/p_format.h"
+
+
 struct sw_winsys;
+struct pipe_box;
+struct pipe_screen;
+struct pipe_fence_handle;
 
 
 struct sw_winsys *
 null_sw_create(void);
 
 
+/**
+ * A frame presented through a shared memory display target.
+ */
+struct null_sw_frame
+{
+   int fd;                     /**< shared memory with the pixels, for mmap() */
+   unsigned size;              /**< size of the shared memory in bytes */
+   enum pipe_format format;
+   unsigned width;
+   unsigned height;
+   unsigned stride;
+   const struct pipe_box *box; /**< presented region, may be NULL */
+
+   /**
+    * The pixels are complete once screen->fence_finish() returns for this
+    * fence.  May be NULL if they already are.
+    */
+   struct pipe_screen *screen;
+   struct pipe_fence_handle *fence;
+};
+
+
+typedef void
+(*null_sw_present_func)(void *data, const struct null_sw_frame *frame);
+
+
+/**
+ * Headless winsys whose display targets live in shared memory (memfd, or
+ * /dev/shm), so that another process can map the rendered frames instead of
+ * copying them out.  present() is called for each presented frame; the fd
+ * and fence are only valid during that call, keep them with dup() and
+ * screen->fence_reference().
+ */
+struct sw_winsys *
+null_sw_shm_create(null_sw_present_func present, void *data);
+
+
 #endif /* NULL_SW_WINSYS_H_ */
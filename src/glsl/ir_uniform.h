@@ -183,6 +183,19 @@ struct gl_uniform_storage {
    bool hidden;
 };
 
+/**
+ * A glUniform location, with the checks that don't depend on the call
+ * already done.  The linker builds one per UniformRemapTable entry.
+ */
+struct gl_uniform_descriptor {
+   /** NULL if calls for the location take the full path */
+   struct gl_uniform_storage *uni;
+   unsigned array_index;
+   unsigned max_count;   /**< elements from array_index to the end */
+   unsigned base_type;   /**< enum glsl_base_type */
+   unsigned components;
+};
+
 #ifdef __cplusplus
 }
 #endif
@@ -1032,6 +1032,59 @@ link_assign_uniform_locations(struct gl_shader_program *prog,
 
    link_set_image_access_qualifiers(prog);
    link_set_uniform_initializers(prog, boolean_true);
+   link_build_uniform_descriptors(prog);
 
    return;
 }
+
+
+/**
+ * Build the glUniform location descriptors from the uniform remap table.
+ *
+ * This is done at link time rather than on the first glUniform call, as the
+ * program may be shared by contexts calling glUniform from several threads.
+ * On allocation failure the table is left NULL, and glUniform takes the
+ * full path.
+ */
+void
+link_build_uniform_descriptors(struct gl_shader_program *prog)
+{
+   ralloc_free(prog->UniformDescriptors);
+   prog->UniformDescriptors =
+      rzalloc_array(prog, struct gl_uniform_descriptor,
+                    prog->NumUniformRemapTable);
+   if (prog->UniformDescriptors == NULL)
+      return;
+
+   for (unsigned loc = 0; loc < prog->NumUniformRemapTable; loc++) {
+      struct gl_uniform_storage *const uni = prog->UniformRemapTable[loc];
+
+      if (uni == NULL || uni == INACTIVE_UNIFORM_EXPLICIT_LOCATION)
+         continue;
+
+      /* Only plain float, int and uint scalars and vectors, which are
+       * stored as given.
+       */
+      if (uni->type->is_matrix() ||
+          (uni->type->base_type != GLSL_TYPE_FLOAT &&
+           uni->type->base_type != GLSL_TYPE_INT &&
+           uni->type->base_type != GLSL_TYPE_UINT))
+         continue;
+
+      struct gl_uniform_descriptor *const desc =
+         &prog->UniformDescriptors[loc];
+      if (uni->array_elements != 0) {
+         desc->array_index = loc - uni->remap_location;
+         if (desc->array_index >= uni->array_elements)
+            continue;
+         desc->max_count = uni->array_elements - desc->array_index;
+      } else {
+         desc->array_index = 0;
+         desc->max_count = 1;
+      }
+
+      desc->uni = uni;
+      desc->base_type = uni->type->base_type;
+      desc->components = uni->type->vector_elements;
+   }
+}
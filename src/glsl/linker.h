@@ -44,6 +44,9 @@ extern void
 link_set_uniform_initializers(struct gl_shader_program *prog,
                               unsigned int boolean_true);
 
+extern void
+link_build_uniform_descriptors(struct gl_shader_program *prog);
+
 extern int
 link_cross_validate_uniform_block(void *mem_ctx,
 				  struct gl_uniform_block **linked_blocks,
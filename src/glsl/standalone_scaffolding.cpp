@@ -92,6 +92,7 @@ _mesa_clear_shader_program_data(struct gl_shader_program *shProg)
    shProg->UniformStorage = NULL;
    shProg->NumUniformRemapTable = 0;
    shProg->UniformRemapTable = NULL;
+   shProg->UniformDescriptors = NULL;
    shProg->UniformHash = NULL;
 
    ralloc_free(shProg->InfoLog);
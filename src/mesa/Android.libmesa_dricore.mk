@@ -50,7 +50,8 @@ endif # MESA_ENABLE_ASM
 ifeq ($(ARCH_X86_HAVE_SSE4_1),true)
 LOCAL_SRC_FILES += \
 	$(SRCDIR)main/streaming-load-memcpy.c \
-	$(SRCDIR)main/sse_minmax.c
+	$(SRCDIR)main/sse_minmax.c \
+	$(SRCDIR)main/sse_swizzle_convert.c
 LOCAL_CFLAGS := -msse4.1
 endif
 
@@ -118,6 +118,7 @@
 #include "scissor.h"
 #include "shared.h"
 #include "shaderobj.h"
+#include "shaderqueue.h"
 #include "util/simple_list.h"
 #include "state.h"
 #include "stencil.h"
@@ -1251,6 +1252,9 @@ _mesa_create_context(gl_api api,
 void
 _mesa_free_context_data( struct gl_context *ctx )
 {
+   /* Queued compiles and links may use the context */
+   _mesa_shader_queue_drain();
+
    if (!_mesa_get_current_context()){
       /* No current context, but we may need one in order to delete
        * texture objs, etc.  So temporarily bind the context now.
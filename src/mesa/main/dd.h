@@ -500,6 +500,16 @@ struct dd_function_table {
     */
    GLboolean (*LinkShader)(struct gl_context *ctx,
                            struct gl_shader_program *shader);
+
+   /**
+    * Optional.  Called after the GLSL linker succeeded, before LinkShader,
+    * to lower and optimize the linked IR for the driver.
+    *
+    * This may run on a shader queue thread, so it must only transform the
+    * program's IR and read constant state such as ctx->Const.
+    */
+   void (*LowerLinkedShaders)(struct gl_context *ctx,
+                              struct gl_shader_program *shader);
    /*@}*/
 
    /**
@@ -82,6 +82,24 @@ struct gl_list_instruction
    void (*Execute)( struct gl_context *ctx, void *data );
    void (*Destroy)( struct gl_context *ctx, void *data );
    void (*Print)( struct gl_context *ctx, void *data, FILE *f );
+
+   /**
+    * Optional, used by optimize_list().  Overwrites returns the VERT_BIT_x
+    * mask of the current attributes the instruction always sets without
+    * reading them first.
+    *
+    * Merge is called for two instructions of this opcode with only
+    * attribute changes between them.  It appends the one in \p next to the
+    * one in \p data, including the effect of those changes, and releases
+    * the storage of \p next, or returns false and leaves both alone.
+    * \p before holds the attribute values known before \p data and
+    * \p current those known before \p next.  Merge is called once more
+    * with \p next NULL after the last instruction merged into \p data.
+    */
+   GLbitfield64 (*Overwrites)( struct gl_context *ctx, void *data );
+   GLboolean (*Merge)( struct gl_context *ctx, void *data, void *next,
+                       const struct gl_list_attribs *before,
+                       const struct gl_list_attribs *current );
 };
 
 
@@ -484,8 +502,9 @@ typedef enum
    /* ARB_uniform_buffer_object */
    OPCODE_UNIFORM_BLOCK_BINDING,
 
-   /* The following three are meta instructions */
+   /* The following four are meta instructions */
    OPCODE_ERROR,                /* raise compiled-in error */
+   OPCODE_SKIP,                 /* n[1].ui nodes removed by optimize_list() */
    OPCODE_CONTINUE,
    OPCODE_END_OF_LIST,
    OPCODE_EXT_0
@@ -830,6 +849,9 @@ _mesa_delete_list(struct gl_context *ctx, struct gl_display_list *dlist)
             n += InstSize[n[0].opcode];
             break;
 
+         case OPCODE_SKIP:
+            n += n[1].ui;
+            break;
          case OPCODE_CONTINUE:
             n = (Node *) get_pointer(&n[1]);
             free(block);
@@ -1085,6 +1107,9 @@ _mesa_dlist_alloc(struct gl_context *ctx, GLuint opcode, GLuint bytes)
  * \param execute  function to execute the new display list command
  * \param destroy  function to destroy the new display list command
  * \param print  function to print the new display list command
+ * \param merge  function to merge two of the commands, or NULL
+ * \param overwrites  function returning the current attributes the command
+ *                    sets without reading them, or NULL
  * \return  the new opcode number or -1 if error
  */
 GLint
@@ -1092,7 +1117,13 @@ _mesa_dlist_alloc_opcode(struct gl_context *ctx,
                          GLuint size,
                          void (*execute) (struct gl_context *, void *),
                          void (*destroy) (struct gl_context *, void *),
-                         void (*print) (struct gl_context *, void *, FILE *))
+                         void (*print) (struct gl_context *, void *, FILE *),
+                         GLboolean (*merge) (struct gl_context *, void *,
+                                             void *,
+                                             const struct gl_list_attribs *,
+                                             const struct gl_list_attribs *),
+                         GLbitfield64 (*overwrites) (struct gl_context *,
+                                                     void *))
 {
    if (ctx->ListExt->NumOpcodes < MAX_DLIST_EXT_OPCODES) {
       const GLuint i = ctx->ListExt->NumOpcodes++;
@@ -1101,6 +1132,8 @@ _mesa_dlist_alloc_opcode(struct gl_context *ctx,
       ctx->ListExt->Opcode[i].Execute = execute;
       ctx->ListExt->Opcode[i].Destroy = destroy;
       ctx->ListExt->Opcode[i].Print = print;
+      ctx->ListExt->Opcode[i].Merge = merge;
+      ctx->ListExt->Opcode[i].Overwrites = overwrites;
       return i + OPCODE_EXT_0;
    }
    return -1;
@@ -1154,6 +1187,218 @@ trim_list(struct gl_context *ctx)
 }
 
 
+/**
+ * The current attribute an ATTR instruction sets, and its size and value
+ * in \p size and \p value, or -1 for the other instructions.  Setting
+ * attribute 0 emits a vertex, so -1 for that too.
+ */
+static GLint
+get_attr_instruction(const Node *n, GLuint *size, GLfloat value[4])
+{
+   GLint attr;
+   GLuint i;
+
+   switch (n[0].opcode) {
+   case OPCODE_ATTR_1F_NV:
+   case OPCODE_ATTR_2F_NV:
+   case OPCODE_ATTR_3F_NV:
+   case OPCODE_ATTR_4F_NV:
+      if (n[1].e == VERT_ATTRIB_POS)
+         return -1;
+      attr = n[1].e;
+      *size = n[0].opcode - OPCODE_ATTR_1F_NV + 1;
+      break;
+   case OPCODE_ATTR_1F_ARB:
+   case OPCODE_ATTR_2F_ARB:
+   case OPCODE_ATTR_3F_ARB:
+   case OPCODE_ATTR_4F_ARB:
+      if (n[1].e == 0)
+         return -1;
+      attr = VERT_ATTRIB_GENERIC(n[1].e);
+      *size = n[0].opcode - OPCODE_ATTR_1F_ARB + 1;
+      break;
+   default:
+      return -1;
+   }
+
+   ASSIGN_4V(value, 0.0f, 0.0f, 0.0f, 1.0f);
+   for (i = 0; i < *size; i++)
+      value[i] = n[2 + i].f;
+
+   return attr;
+}
+
+
+/** Turn an instruction of \p size nodes into a jump over it */
+static void
+skip_instruction(Node *n, GLuint size)
+{
+   ASSERT(size >= 2);
+   n[0].opcode = OPCODE_SKIP;
+   n[1].ui = size;
+}
+
+
+/** Let the instruction \p n know nothing more is merged into it */
+static void
+end_merge(struct gl_context *ctx, Node *n)
+{
+   if (n) {
+      const struct gl_list_instruction *inst =
+         &ctx->ListExt->Opcode[n[0].opcode - OPCODE_EXT_0];
+      inst->Merge(ctx, &n[1], NULL, NULL, NULL);
+   }
+}
+
+
+/**
+ * Called by EndList to make the list cheaper to replay.
+ *
+ * A glColor, glNormal, glTexCoord or glVertexAttrib outside glBegin/End is
+ * dropped when nothing reads the value it sets before a vertex list stores
+ * the attribute in every vertex (see gl_list_instruction::Overwrites).
+ * Vertex lists with nothing but such attribute changes between them are
+ * merged, the changes going into the vertices of the merged list, so a
+ * model compiled as many glBegin/End pairs with a glColor or glNormal
+ * before each draws with a few primitives.  Any other instruction ends
+ * both optimizations, as it may depend on the current attributes.
+ *
+ * The instructions are turned into OPCODE_SKIP in place.  If the list is
+ * called between glBegin and glEnd, the first vertex list raises
+ * GL_INVALID_OPERATION either way, but the dropped attributes aren't set.
+ */
+static void
+optimize_list(struct gl_context *ctx, struct gl_display_list *dlist)
+{
+   /* The last ATTR instruction of each attribute nothing has read yet */
+   Node *pending[VERT_ATTRIB_MAX];
+   /* The attribute values known here and before vertex_list */
+   struct gl_list_attribs current, before;
+   /* The vertex list the next one may be merged into, and the first
+    * instruction after the last list merged into it.
+    */
+   Node *vertex_list = NULL, *after = NULL;
+   GLboolean removed = GL_FALSE;
+   Node *n = dlist->Head;
+   GLfloat value[4];
+   GLuint size;
+   GLint attr;
+
+   memset(pending, 0, sizeof(pending));
+   current.Known = 0;
+
+   while (n[0].opcode != OPCODE_END_OF_LIST) {
+      const OpCode opcode = n[0].opcode;
+
+      if (opcode == OPCODE_CONTINUE) {
+         n = (Node *) get_pointer(&n[1]);
+         continue;
+      }
+
+      if (is_ext_opcode(opcode)) {
+         const struct gl_list_instruction *inst =
+            &ctx->ListExt->Opcode[opcode - OPCODE_EXT_0];
+         const GLbitfield64 overwrites =
+            inst->Overwrites ? inst->Overwrites(ctx, &n[1]) : 0;
+
+         for (attr = 0; attr < VERT_ATTRIB_MAX; attr++) {
+            if (pending[attr] && (overwrites & VERT_BIT(attr))) {
+               skip_instruction(pending[attr],
+                                InstSize[pending[attr][0].opcode]);
+               removed = GL_TRUE;
+            }
+            pending[attr] = NULL;
+         }
+
+         if (inst->Merge && vertex_list &&
+             vertex_list[0].opcode == opcode &&
+             inst->Merge(ctx, &vertex_list[1], &n[1], &before, &current)) {
+            /* The merged list applies the attribute changes in between */
+            while (after != n) {
+               if (after[0].opcode == OPCODE_CONTINUE) {
+                  after = (Node *) get_pointer(&after[1]);
+               }
+               else if (after[0].opcode == OPCODE_SKIP) {
+                  after += after[1].ui;
+               }
+               else {
+                  ASSERT(get_attr_instruction(after, &size, value) >= 0);
+                  size = InstSize[after[0].opcode];
+                  skip_instruction(after, size);
+                  after += size;
+               }
+            }
+            skip_instruction(n, inst->Size);
+            removed = GL_TRUE;
+         }
+         else {
+            end_merge(ctx, vertex_list);
+            vertex_list = inst->Merge ? n : NULL;
+            before = current;
+         }
+
+         current.Known &= overwrites ? ~overwrites : 0;
+         n += inst->Size;
+         after = n;
+         continue;
+      }
+
+      attr = get_attr_instruction(n, &size, value);
+      if (attr >= 0) {
+         if (pending[attr]) {
+            skip_instruction(pending[attr],
+                             InstSize[pending[attr][0].opcode]);
+            removed = GL_TRUE;
+         }
+         pending[attr] = n;
+         current.Sizes[attr] = size;
+         COPY_4V(current.Values[attr], value);
+         current.Known |= VERT_BIT(attr);
+      }
+      else {
+         /* Anything else may use or change the current attributes */
+         memset(pending, 0, sizeof(pending));
+         end_merge(ctx, vertex_list);
+         vertex_list = NULL;
+         current.Known = 0;
+      }
+
+      n += InstSize[opcode];
+   }
+
+   end_merge(ctx, vertex_list);
+
+   if (!removed)
+      return;
+
+   /* Jump over runs of removed instructions at once.  A jump never crosses
+    * a block, as _mesa_delete_list() frees the blocks as it goes.
+    */
+   n = dlist->Head;
+   while (n[0].opcode != OPCODE_END_OF_LIST) {
+      const OpCode opcode = n[0].opcode;
+
+      if (opcode == OPCODE_CONTINUE) {
+         n = (Node *) get_pointer(&n[1]);
+      }
+      else if (opcode == OPCODE_SKIP) {
+         Node *next = n + n[1].ui;
+
+         while (next[0].opcode == OPCODE_SKIP)
+            next += next[1].ui;
+         n[1].ui = next - n;
+         n = next;
+      }
+      else if (is_ext_opcode(opcode)) {
+         n += ctx->ListExt->Opcode[opcode - OPCODE_EXT_0].Size;
+      }
+      else {
+         n += InstSize[opcode];
+      }
+   }
+}
+
+
 
 /*
  * Display List compilation functions
@@ -8894,6 +9139,9 @@ execute_list(struct gl_context *ctx, GLuint list)
             CALL_UniformBlockBinding(ctx->Exec, (n[1].ui, n[2].ui, n[3].ui));
             break;
 
+         case OPCODE_SKIP:
+            n += n[1].ui;
+            break;
          case OPCODE_CONTINUE:
             n = (Node *) get_pointer(&n[1]);
             break;
@@ -9082,7 +9330,8 @@ _mesa_EndList(void)
     */
    ctx->Driver.EndList(ctx);
 
-   (void) alloc_instruction(ctx, OPCODE_END_OF_LIST, 0);
+   if (alloc_instruction(ctx, OPCODE_END_OF_LIST, 0))
+      optimize_list(ctx, ctx->ListState.CurrentList);
 
    trim_list(ctx);
 
@@ -9943,6 +10192,9 @@ print_list(struct gl_context *ctx, GLuint list, const char *fname)
             fprintf(f, "Error: %s %s\n", enum_string(n[1].e),
                    (const char *) get_pointer(&n[2]));
             break;
+         case OPCODE_SKIP:
+            n += n[1].ui;
+            break;
          case OPCODE_CONTINUE:
             fprintf(f, "DISPLAY-LIST-CONTINUE\n");
             n = (Node *) get_pointer(&n[1]);
@@ -36,6 +36,18 @@
 #include "main/mtypes.h"
 
 
+/**
+ * Current attribute values glEndList knows at some point of the list it
+ * optimizes, from the glColor, glNormal, etc. compiled into it.
+ */
+struct gl_list_attribs
+{
+   GLbitfield64 Known;                  /**< VERT_BIT_x of the known values */
+   GLubyte Sizes[VERT_ATTRIB_MAX];      /**< 1, 2, 3 or 4 */
+   GLfloat Values[VERT_ATTRIB_MAX][4];
+};
+
+
 GLboolean GLAPIENTRY
 _mesa_IsList(GLuint list);
 void GLAPIENTRY
@@ -63,7 +75,11 @@ extern void *_mesa_dlist_alloc(struct gl_context *ctx, GLuint opcode, GLuint sz)
 extern GLint _mesa_dlist_alloc_opcode( struct gl_context *ctx, GLuint sz,
                                        void (*execute)( struct gl_context *, void * ),
                                        void (*destroy)( struct gl_context *, void * ),
-                                       void (*print)( struct gl_context *, void *, FILE * ) );
+                                       void (*print)( struct gl_context *, void *, FILE * ),
+                                       GLboolean (*merge)( struct gl_context *, void *, void *,
+                                                           const struct gl_list_attribs *,
+                                                           const struct gl_list_attribs * ),
+                                       GLbitfield64 (*overwrites)( struct gl_context *, void * ) );
 
 extern void _mesa_delete_list(struct gl_context *ctx, struct gl_display_list *dlist);
 
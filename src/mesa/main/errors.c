@@ -1497,6 +1497,13 @@ void
 _mesa_error_no_memory(const char *caller)
 {
    GET_CURRENT_CONTEXT(ctx);
+
+   /* Shader queue threads have no current context */
+   if (!ctx) {
+      _mesa_problem(NULL, "out of memory in %s", caller);
+      return;
+   }
+
    _mesa_error(ctx, GL_OUT_OF_MEMORY, "out of memory in %s", caller);
 }
 
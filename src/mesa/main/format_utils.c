@@ -26,6 +26,8 @@
 #include "glformats.h"
 #include "format_pack.h"
 #include "format_unpack.h"
+#include "sse_swizzle_convert.h"
+#include "x86/common_x86_asm.h"
 
 const mesa_array_format RGBA32_FLOAT =
    MESA_ARRAY_FORMAT(4, 1, 1, 1, 4, 0, 1, 2, 3);
@@ -1432,6 +1434,23 @@ _mesa_swizzle_and_convert(void *void_dst, GLenum dst_type, int num_dst_channels,
                                   swizzle, normalized, count))
       return;
 
+#if defined(USE_SSE41)
+   if (cpu_has_sse4_1 && num_dst_channels == 4 && num_src_channels == 4) {
+      int done = _mesa_sse41_swizzle_and_convert(void_dst, dst_type,
+                                                 void_src, src_type,
+                                                 swizzle, normalized, count);
+      if (done == count)
+         return;
+
+      /* The C code below does the remaining pixels */
+      void_dst = (uint8_t *) void_dst +
+                 done * 4 * _mesa_array_format_datatype_get_size(dst_type);
+      void_src = (const uint8_t *) void_src +
+                 done * 4 * _mesa_array_format_datatype_get_size(src_type);
+      count -= done;
+   }
+#endif
+
    switch (dst_type) {
    case MESA_ARRAY_FORMAT_TYPE_FLOAT:
       convert_float(void_dst, num_dst_channels, void_src, src_type,
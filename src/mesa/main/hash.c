@@ -4,6 +4,12 @@
  *
  * Used for display lists, texture objects, vertex/fragment programs,
  * buffer objects, etc.  The hash functions are thread-safe.
+ *
+ * Small keys, which is what glGen* hands out, are stored in an array
+ * indexed by the key that _mesa_HashLookup() reads without locking, so
+ * contexts sharing objects don't contend on the mutex when binding them.
+ * Other keys are in a struct hash_table protected by the mutex.  Writers
+ * always take the mutex.
  * 
  * \note key=0 is illegal.
  *
@@ -38,31 +44,53 @@
 #include "imports.h"
 #include "hash.h"
 #include "util/hash_table.h"
+#include "util/u_atomic.h"
 
 /**
- * Magic GLuint object name that gets stored outside of the struct hash_table.
+ * Magic GLuint object name that never gets stored in the struct hash_table.
  *
  * The hash table needs a particular pointer to be the marker for a key that
  * was deleted from the table, along with NULL for the "never allocated in the
  * table" marker.  Legacy GL allows any GLuint to be used as a GL object name,
- * and we use a 1:1 mapping from GLuints to key pointers, so we need to be
- * able to track a GLuint that happens to match the deleted key outside of
- * struct hash_table.  We tell the hash table to use "1" as the deleted key
- * value, so that we test the deleted-key-in-the-table path as best we can.
+ * and we use a 1:1 mapping from GLuints to key pointers, so we tell the hash
+ * table to use "1" as the deleted key value: it is always below
+ * DIRECT_MIN_KEYS, so it lives in the direct array instead.
  */
 #define DELETED_KEY_VALUE 1
 
+/**
+ * Size of the first direct array, and the most keys it grows to.  The array
+ * only doubles when a key just past its end is inserted, so names given out
+ * by glGen* end up in it while sparse names stay in the hash table until
+ * the array reaches them.
+ */
+#define DIRECT_MIN_KEYS 64
+#define DIRECT_MAX_KEYS (1 << 16)
+
+/**
+ * Array of the data of the keys below Size, indexed by the key.
+ *
+ * When it grows, the new array replaces it for readers in one pointer
+ * store.  Readers that loaded the old pointer may still be indexing it, so
+ * it is put on the Retired list and only freed with the table.  The sizes
+ * double, so the retired arrays take no more memory than the current one.
+ */
+struct direct_array {
+   GLuint Size;
+   void **Entries;
+   struct direct_array *Retired;   /**< the array this one replaced */
+};
+
 /**
  * The hash table data structure.  
  */
 struct _mesa_HashTable {
    struct hash_table *ht;
+   struct direct_array *Direct;          /**< keys below Direct->Size */
    GLuint MaxKey;                        /**< highest key inserted so far */
    mtx_t Mutex;                /**< mutual exclusion lock */
    mtx_t WalkMutex;            /**< for _mesa_HashWalk() */
    GLboolean InDeleteAll;                /**< Debug check */
-   /** Value that would be in the table for DELETED_KEY_VALUE. */
-   void *deleted_key_data;
 };
 
 /** @{
@@ -109,6 +137,79 @@ uint_key(GLuint id)
 }
 /** @} */
 
+
+/**
+ * Store a pointer that _mesa_HashLookup() may load without locking.
+ *
+ * The compare-and-swap is a full barrier, so the object pointed to is
+ * visible to other threads before the pointer is.  Writers hold the mutex,
+ * so it never fails.
+ */
+static inline void
+publish(void **slot, void *value)
+{
+   void *old = *slot;
+
+   (void) p_atomic_cmpxchg(slot, old, value);
+}
+
+
+/** The direct array as seen by lock-free readers */
+static inline struct direct_array *
+get_direct(const struct _mesa_HashTable *table)
+{
+   return p_atomic_read(&table->Direct);
+}
+
+
+static struct direct_array *
+alloc_direct(GLuint size)
+{
+   struct direct_array *direct = calloc(1, sizeof(*direct) +
+                                        size * sizeof(void *));
+
+   if (direct) {
+      direct->Size = size;
+      direct->Entries = (void **) (direct + 1);
+   }
+
+   return direct;
+}
+
+
+/**
+ * Replace the direct array by one twice as big, moving the entries for the
+ * new keys out of the hash table.  Called with the mutex held.
+ *
+ * \return GL_FALSE if out of memory, in which case the keys stay in the
+ * hash table.
+ */
+static GLboolean
+grow_direct(struct _mesa_HashTable *table)
+{
+   struct direct_array *old = table->Direct;
+   struct direct_array *direct = alloc_direct(old->Size * 2);
+   struct hash_entry *entry;
+   GLuint key;
+
+   if (!direct)
+      return GL_FALSE;
+
+   memcpy(direct->Entries, old->Entries, old->Size * sizeof(void *));
+
+   hash_table_foreach(table->ht, entry) {
+      key = (uintptr_t) entry->key;
+      if (key < direct->Size) {
+         direct->Entries[key] = entry->data;
+         _mesa_hash_table_remove(table->ht, entry);
+      }
+   }
+
+   direct->Retired = old;
+   publish((void **) &table->Direct, direct);
+   return GL_TRUE;
+}
+
 /**
  * Create a new hash table.
  * 
@@ -128,6 +229,14 @@ _mesa_NewHashTable(void)
          return NULL;
       }
 
+      table->Direct = alloc_direct(DIRECT_MIN_KEYS);
+      if (table->Direct == NULL) {
+         _mesa_hash_table_destroy(table->ht, NULL);
+         free(table);
+         _mesa_error_no_memory(__func__);
+         return NULL;
+      }
+
       _mesa_hash_table_set_deleted_key(table->ht, uint_key(DELETED_KEY_VALUE));
       mtx_init(&table->Mutex, mtx_plain);
       mtx_init(&table->WalkMutex, mtx_plain);
@@ -152,14 +261,28 @@ _mesa_NewHashTable(void)
 void
 _mesa_DeleteHashTable(struct _mesa_HashTable *table)
 {
+   struct direct_array *direct, *retired;
+   GLuint key;
+
    assert(table);
 
-   if (_mesa_hash_table_next_entry(table->ht, NULL) != NULL) {
+   for (key = 1; key < table->Direct->Size; key++) {
+      if (table->Direct->Entries[key])
+         break;
+   }
+
+   if (key < table->Direct->Size ||
+       _mesa_hash_table_next_entry(table->ht, NULL) != NULL) {
       _mesa_problem(NULL, "In _mesa_DeleteHashTable, found non-freed data");
    }
 
    _mesa_hash_table_destroy(table->ht, NULL);
 
+   for (direct = table->Direct; direct; direct = retired) {
+      retired = direct->Retired;
+      free(direct);
+   }
+
    mtx_destroy(&table->Mutex);
    mtx_destroy(&table->WalkMutex);
    free(table);
@@ -179,8 +302,8 @@ _mesa_HashLookup_unlocked(struct _mesa_HashTable *table, GLuint key)
    assert(table);
    assert(key);
 
-   if (key == DELETED_KEY_VALUE)
-      return table->deleted_key_data;
+   if (key < table->Direct->Size)
+      return table->Direct->Entries[key];
 
    entry = _mesa_hash_table_search(table->ht, uint_key(key));
    if (!entry)
@@ -192,6 +315,10 @@ _mesa_HashLookup_unlocked(struct _mesa_HashTable *table, GLuint key)
 
 /**
  * Lookup an entry in the hash table.
+ *
+ * Keys in the direct array are looked up without locking.  A writer may
+ * replace the array meanwhile, but the one loaded here stays allocated and
+ * holds the entry as it was when it was replaced.
  * 
  * \param table the hash table.
  * \param key the key.
@@ -201,8 +328,15 @@ _mesa_HashLookup_unlocked(struct _mesa_HashTable *table, GLuint key)
 void *
 _mesa_HashLookup(struct _mesa_HashTable *table, GLuint key)
 {
+   const struct direct_array *direct;
    void *res;
    assert(table);
+   assert(key);
+
+   direct = get_direct(table);
+   if (key < direct->Size)
+      return p_atomic_read(&direct->Entries[key]);
+
    mtx_lock(&table->Mutex);
    res = _mesa_HashLookup_unlocked(table, key);
    mtx_unlock(&table->Mutex);
@@ -270,8 +404,12 @@ _mesa_HashInsert_unlocked(struct _mesa_HashTable *table, GLuint key, void *data)
    if (key > table->MaxKey)
       table->MaxKey = key;
 
-   if (key == DELETED_KEY_VALUE) {
-      table->deleted_key_data = data;
+   if (key >= table->Direct->Size && key < table->Direct->Size * 2 &&
+       key < DIRECT_MAX_KEYS)
+      grow_direct(table);
+
+   if (key < table->Direct->Size) {
+      publish(&table->Direct->Entries[key], data);
    } else {
       entry = _mesa_hash_table_search_pre_hashed(table->ht, hash, uint_key(key));
       if (entry) {
@@ -344,8 +482,8 @@ _mesa_HashRemove(struct _mesa_HashTable *table, GLuint key)
    }
 
    mtx_lock(&table->Mutex);
-   if (key == DELETED_KEY_VALUE) {
-      table->deleted_key_data = NULL;
+   if (key < table->Direct->Size) {
+      publish(&table->Direct->Entries[key], NULL);
    } else {
       entry = _mesa_hash_table_search(table->ht, uint_key(key));
       _mesa_hash_table_remove(table->ht, entry);
@@ -369,20 +507,25 @@ _mesa_HashDeleteAll(struct _mesa_HashTable *table,
                     void (*callback)(GLuint key, void *data, void *userData),
                     void *userData)
 {
+   struct direct_array *direct;
    struct hash_entry *entry;
+   GLuint key;
 
    ASSERT(table);
    ASSERT(callback);
    mtx_lock(&table->Mutex);
    table->InDeleteAll = GL_TRUE;
+   direct = table->Direct;
+   for (key = 1; key < direct->Size; key++) {
+      if (direct->Entries[key]) {
+         callback(key, direct->Entries[key], userData);
+         publish(&direct->Entries[key], NULL);
+      }
+   }
    hash_table_foreach(table->ht, entry) {
       callback((uintptr_t)entry->key, entry->data, userData);
       _mesa_hash_table_remove(table->ht, entry);
    }
-   if (table->deleted_key_data) {
-      callback(DELETED_KEY_VALUE, table->deleted_key_data, userData);
-      table->deleted_key_data = NULL;
-   }
    table->InDeleteAll = GL_FALSE;
    mtx_unlock(&table->Mutex);
 }
@@ -400,12 +543,17 @@ _mesa_HashClone(const struct _mesa_HashTable *table)
    struct _mesa_HashTable *table2 = (struct _mesa_HashTable *) table;
    struct hash_entry *entry;
    struct _mesa_HashTable *clonetable;
+   GLuint key;
 
    ASSERT(table);
    mtx_lock(&table2->Mutex);
 
    clonetable = _mesa_NewHashTable();
    assert(clonetable);
+   for (key = 1; key < table->Direct->Size; key++) {
+      if (table->Direct->Entries[key])
+         _mesa_HashInsert(clonetable, key, table->Direct->Entries[key]);
+   }
    hash_table_foreach(table->ht, entry) {
       _mesa_HashInsert(clonetable, (GLint)(uintptr_t)entry->key, entry->data);
    }
@@ -435,16 +583,26 @@ _mesa_HashWalk(const struct _mesa_HashTable *table,
 {
    /* cast-away const */
    struct _mesa_HashTable *table2 = (struct _mesa_HashTable *) table;
+   const struct direct_array *direct;
    struct hash_entry *entry;
+   GLuint key;
+   void *data;
 
    ASSERT(table);
    ASSERT(callback);
    mtx_lock(&table2->WalkMutex);
+   /* The callback may insert keys and replace the array, but this one
+    * stays allocated.
+    */
+   direct = get_direct(table);
+   for (key = 1; key < direct->Size; key++) {
+      data = p_atomic_read(&direct->Entries[key]);
+      if (data)
+         callback(key, data, userData);
+   }
    hash_table_foreach(table->ht, entry) {
       callback((uintptr_t)entry->key, entry->data, userData);
    }
-   if (table->deleted_key_data)
-      callback(DELETED_KEY_VALUE, table->deleted_key_data, userData);
    mtx_unlock(&table2->WalkMutex);
 }
 
@@ -462,8 +620,6 @@ debug_print_entry(GLuint key, void *data, void *userData)
 void
 _mesa_HashPrint(const struct _mesa_HashTable *table)
 {
-   if (table->deleted_key_data)
-      debug_print_entry(DELETED_KEY_VALUE, table->deleted_key_data, NULL);
    _mesa_HashWalk(table, debug_print_entry, NULL);
 }
 
@@ -524,11 +680,14 @@ _mesa_HashFindFreeKeyBlock(struct _mesa_HashTable *table, GLuint numKeys)
 GLuint
 _mesa_HashNumEntries(const struct _mesa_HashTable *table)
 {
+   const struct direct_array *direct = get_direct(table);
    struct hash_entry *entry;
-   GLuint count = 0;
+   GLuint count = 0, key;
 
-   if (table->deleted_key_data)
-      count++;
+   for (key = 1; key < direct->Size; key++) {
+      if (direct->Entries[key])
+         count++;
+   }
 
    hash_table_foreach(table->ht, entry)
       count++;
@@ -2544,6 +2544,10 @@ struct gl_shader
    unsigned Version;       /**< GLSL version used for linking */
    GLboolean IsES;         /**< True if this shader uses GLSL ES */
 
+   /** Shader queue jobs using the shader, see shaderqueue.c */
+   unsigned QueuedJobs;
+   unsigned FinishedJobs;
+
    /**
     * \name Sampler tracking
     *
@@ -2871,6 +2875,12 @@ struct gl_shader_program
    unsigned NumUniformRemapTable;
    struct gl_uniform_storage **UniformRemapTable;
 
+   /**
+    * What glUniform needs to know about each location, built by the linker
+    * along with UniformRemapTable.
+    */
+   struct gl_uniform_descriptor *UniformDescriptors;
+
    /**
     * Size of the gl_ClipDistance array that is output from the last pipeline
     * stage before the fragment shader.
@@ -2904,6 +2914,16 @@ struct gl_shader_program
 
    GLboolean LinkStatus;   /**< GL_LINK_STATUS */
    GLboolean Validated;
+
+   /** Shader queue jobs linking the program, see shaderqueue.c */
+   unsigned QueuedJobs;
+   unsigned FinishedJobs;
+   /**
+    * The driver part of a queued link hasn't run yet.  Only changed with the
+    * shader queue's mutex held.
+    */
+   GLboolean LinkPending;
+
    GLboolean _Used;        /**< Ever used for drawing? */
    GLboolean SamplersValidated; /**< Samplers validated against texture units? */
    GLchar *InfoLog;
@@ -46,6 +46,7 @@
 #include "main/pipelineobj.h"
 #include "main/shaderapi.h"
 #include "main/shaderobj.h"
+#include "main/shaderqueue.h"
 #include "main/transformfeedback.h"
 #include "main/uniforms.h"
 #include "program/program.h"
@@ -729,6 +730,8 @@ get_shaderiv(struct gl_context *ctx, GLuint name, GLenum pname, GLint *params)
       return;
    }
 
+   _mesa_shader_queue_wait_shader(shader);
+
    switch (pname) {
    case GL_SHADER_TYPE:
       *params = shader->Type;
@@ -774,6 +777,7 @@ get_shader_info_log(struct gl_context *ctx, GLuint shader, GLsizei bufSize,
       _mesa_error(ctx, GL_INVALID_VALUE, "glGetShaderInfoLog(shader)");
       return;
    }
+   _mesa_shader_queue_wait_shader(sh);
    _mesa_copy_string(infoLog, bufSize, length, sh->InfoLog);
 }
 
@@ -790,6 +794,7 @@ get_shader_source(struct gl_context *ctx, GLuint shader, GLsizei maxLength,
    if (!sh) {
       return;
    }
+   _mesa_shader_queue_wait_shader(sh);
    _mesa_copy_string(sourceOut, maxLength, length, sh->Source);
 }
 
@@ -807,6 +812,8 @@ shader_source(struct gl_context *ctx, GLuint shader, const GLchar *source)
    if (!sh)
       return;
 
+   _mesa_shader_queue_wait_shader(sh);
+
    /* free old shader source string and install new one */
    free((void *)sh->Source);
    sh->Source = source;
@@ -818,23 +825,12 @@ shader_source(struct gl_context *ctx, GLuint shader, const GLchar *source)
 
 
 /**
- * Compile a shader.
+ * Compile a shader object whose pragmas have been set up.  This doesn't
+ * call into the driver, so it can run on a shader queue thread.
  */
-static void
-compile_shader(struct gl_context *ctx, GLuint shaderObj)
+void
+_mesa_compile_shader(struct gl_context *ctx, struct gl_shader *sh)
 {
-   struct gl_shader *sh;
-   struct gl_shader_compiler_options *options;
-
-   sh = _mesa_lookup_shader_err(ctx, shaderObj, "glCompileShader");
-   if (!sh)
-      return;
-
-   options = &ctx->Const.ShaderCompilerOptions[sh->Stage];
-
-   /* set default pragma state for shader */
-   sh->Pragmas = options->DefaultPragmas;
-
    if (!sh->Source) {
       /* If the user called glCompileShader without first calling
        * glShaderSource, we should fail to compile, but not raise a GL_ERROR.
@@ -890,6 +886,32 @@ compile_shader(struct gl_context *ctx, GLuint shaderObj)
 }
 
 
+/**
+ * Compile a shader.
+ */
+static void
+compile_shader(struct gl_context *ctx, GLuint shaderObj)
+{
+   struct gl_shader *sh;
+   struct gl_shader_compiler_options *options;
+
+   sh = _mesa_lookup_shader_err(ctx, shaderObj, "glCompileShader");
+   if (!sh)
+      return;
+
+   /* A link may still be reading the IR */
+   _mesa_shader_queue_wait_shader(sh);
+
+   options = &ctx->Const.ShaderCompilerOptions[sh->Stage];
+
+   /* set default pragma state for shader */
+   sh->Pragmas = options->DefaultPragmas;
+
+   if (!_mesa_shader_queue_compile(ctx, sh))
+      _mesa_compile_shader(ctx, sh);
+}
+
+
 /**
  * Link a program's shaders.
  */
@@ -897,6 +919,7 @@ static void
 link_program(struct gl_context *ctx, GLuint program)
 {
    struct gl_shader_program *shProg;
+   GLuint i;
 
    shProg = _mesa_lookup_shader_program_err(ctx, program, "glLinkProgram");
    if (!shProg)
@@ -915,18 +938,19 @@ link_program(struct gl_context *ctx, GLuint program)
 
    FLUSH_VERTICES(ctx, _NEW_PROGRAM);
 
-   _mesa_glsl_link_shader(ctx, shProg);
+   if (_mesa_shader_queue_link(ctx, shProg))
+      return;
 
-   if (shProg->LinkStatus == GL_FALSE &&
-       (ctx->_Shader->Flags & GLSL_REPORT_ERRORS)) {
-      _mesa_debug(ctx, "Error linking program %u:\n%s\n",
-                  shProg->Name, shProg->InfoLog);
-   }
+   /* Linking here reads the shaders' IR, which queued compiles may still
+    * be writing.
+    */
+   for (i = 0; i < shProg->NumShaders; i++)
+      _mesa_shader_queue_wait_shader(shProg->Shaders[i]);
+
+   _mesa_glsl_link_shader(ctx, shProg);
 
    /* debug code */
    if (0) {
-      GLuint i;
-
       printf("Link %u shaders in program %u: %s\n",
                    shProg->NumShaders, shProg->Name,
                    shProg->LinkStatus ? "Success" : "Failed");
@@ -1654,6 +1678,7 @@ _mesa_GetShaderPrecisionFormat(GLenum shadertype, GLenum precisiontype,
 void GLAPIENTRY
 _mesa_ReleaseShaderCompiler(void)
 {
+   _mesa_shader_queue_drain();
    _mesa_destroy_shader_compiler_caches();
 }
 
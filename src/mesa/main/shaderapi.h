@@ -38,6 +38,7 @@ extern "C" {
 
 struct _glapi_table;
 struct gl_context;
+struct gl_shader;
 struct gl_shader_program;
 
 extern GLbitfield
@@ -47,6 +48,9 @@ extern void
 _mesa_copy_string(GLchar *dst, GLsizei maxLength,
                   GLsizei *length, const GLchar *src);
 
+extern void
+_mesa_compile_shader(struct gl_context *ctx, struct gl_shader *sh);
+
 extern void
 _mesa_use_program(struct gl_context *ctx, struct gl_shader_program *shProg);
 
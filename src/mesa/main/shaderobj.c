@@ -36,6 +36,7 @@
 #include "main/mtypes.h"
 #include "main/shaderapi.h"
 #include "main/shaderobj.h"
+#include "main/shaderqueue.h"
 #include "main/uniforms.h"
 #include "program/program.h"
 #include "program/prog_parameter.h"
@@ -76,6 +77,7 @@ _mesa_reference_shader(struct gl_context *ctx, struct gl_shader **ptr,
       if (deleteFlag) {
 	 if (old->Name != 0)
 	    _mesa_HashRemove(ctx->Shared->ShaderObjects, old->Name);
+         _mesa_shader_queue_wait_shader(old);
          ctx->Driver.DeleteShader(ctx, old);
       }
 
@@ -218,6 +220,7 @@ _mesa_reference_shader_program_(struct gl_context *ctx,
       if (deleteFlag) {
 	 if (old->Name != 0)
 	    _mesa_HashRemove(ctx->Shared->ShaderObjects, old->Name);
+         _mesa_shader_queue_wait_program(ctx, old, GL_FALSE);
          ctx->Driver.DeleteShaderProgram(ctx, old);
       }
 
@@ -295,6 +298,11 @@ _mesa_clear_shader_program_data(struct gl_shader_program *shProg)
       shProg->UniformRemapTable = NULL;
    }
 
+   if (shProg->UniformDescriptors) {
+      ralloc_free(shProg->UniformDescriptors);
+      shProg->UniformDescriptors = NULL;
+   }
+
    if (shProg->UniformHash) {
       string_to_uint_map_dtor(shProg->UniformHash);
       shProg->UniformHash = NULL;
@@ -408,6 +416,8 @@ _mesa_lookup_shader_program(struct gl_context *ctx, GLuint name)
       if (shProg && shProg->Type != GL_SHADER_PROGRAM_MESA) {
          return NULL;
       }
+      if (shProg)
+         _mesa_shader_queue_wait_program(ctx, shProg, GL_TRUE);
       return shProg;
    }
    return NULL;
@@ -436,6 +446,7 @@ _mesa_lookup_shader_program_err(struct gl_context *ctx, GLuint name,
          _mesa_error(ctx, GL_INVALID_OPERATION, "%s", caller);
          return NULL;
       }
+      _mesa_shader_queue_wait_program(ctx, shProg, GL_TRUE);
       return shProg;
    }
 }
@@ -0,0 +1,333 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2026  agent   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file shaderqueue.c
+ * Compiling and linking GLSL on worker threads.
+ *
+ * Jobs are run in the order they were queued.  Every shader and program
+ * counts the jobs using it that were queued and that finished; a job
+ * remembers the count of queued jobs when it was added (its ticket) for
+ * each shader it uses and waits for the earlier ones to finish before
+ * running.  So a link waits for the compiles of its shaders, and links
+ * sharing a shader, which write to the shader's IR while cross validating
+ * globals, don't run at the same time.  Since the earlier jobs have been
+ * taken off the queue already, this never waits for a job nobody runs.
+ */
+
+
+#include <stdlib.h>
+
+#include "c11/threads.h"
+#include "main/glheader.h"
+#include "main/errors.h"
+#include "main/macros.h"
+#include "main/shaderapi.h"
+#include "main/shaderobj.h"
+#include "main/shaderqueue.h"
+#include "main/threadpool.h"
+#include "program/ir_to_mesa.h"
+
+
+struct shader_job
+{
+   struct shader_job *next;
+   struct gl_context *ctx;
+
+   /** Program to link, or NULL to compile shaders[0] */
+   struct gl_shader_program *prog;
+
+   unsigned num_shaders;
+   struct gl_shader **shaders;
+   unsigned *tickets;
+};
+
+
+static struct
+{
+   struct _mesa_threadpool *threads;
+   struct _mesa_threadpool_client client;
+   cnd_t job_done;
+
+   struct shader_job *head;
+   struct shader_job **tail;
+   unsigned pending;            /**< jobs queued or running */
+} queue;
+
+static once_flag queue_once = ONCE_FLAG_INIT;
+
+
+static GLboolean
+shader_queue_run(struct _mesa_threadpool *threads)
+{
+   struct shader_job *job = queue.head;
+   unsigned i;
+
+   (void) threads;
+
+   if (!job)
+      return GL_FALSE;
+
+   queue.head = job->next;
+   if (!queue.head)
+      queue.tail = &queue.head;
+
+   for (i = 0; i < job->num_shaders; i++) {
+      while (job->shaders[i]->FinishedJobs != job->tickets[i])
+         cnd_wait(&queue.job_done, &queue.threads->mutex);
+   }
+   mtx_unlock(&queue.threads->mutex);
+
+   if (job->prog)
+      _mesa_glsl_link_shader_ir(job->ctx, job->prog);
+   else
+      _mesa_compile_shader(job->ctx, job->shaders[0]);
+
+   mtx_lock(&queue.threads->mutex);
+   for (i = 0; i < job->num_shaders; i++)
+      job->shaders[i]->FinishedJobs++;
+   if (job->prog)
+      job->prog->FinishedJobs++;
+   queue.pending--;
+   cnd_broadcast(&queue.job_done);
+
+   free(job);
+   return GL_TRUE;
+}
+
+
+static void
+shader_queue_init(void)
+{
+   cnd_init(&queue.job_done);
+   queue.tail = &queue.head;
+
+   queue.threads = _mesa_threadpool_add_client(&queue.client,
+                                               "MESA_GLSL_THREADS", GL_FALSE,
+                                               shader_queue_run);
+}
+
+
+static INLINE GLboolean
+shader_queue_started(void)
+{
+   call_once(&queue_once, shader_queue_init);
+   return queue.client.num_threads != 0;
+}
+
+
+static GLboolean
+shader_queue_enabled(struct gl_context *ctx)
+{
+   if (!shader_queue_started())
+      return GL_FALSE;
+
+   /* Compiler messages for a synchronous debug callback must be sent from
+    * the application's thread.
+    */
+   if (_mesa_get_debug_state_int(ctx, GL_DEBUG_OUTPUT_SYNCHRONOUS_ARB) &&
+       _mesa_get_debug_state_ptr(ctx, GL_DEBUG_CALLBACK_FUNCTION_ARB))
+      return GL_FALSE;
+
+   return GL_TRUE;
+}
+
+
+static struct shader_job *
+shader_job_create(struct gl_context *ctx, unsigned num_shaders)
+{
+   struct shader_job *job;
+
+   job = calloc(1, sizeof(*job) +
+                num_shaders * (sizeof(job->shaders[0]) +
+                               sizeof(job->tickets[0])));
+   if (!job)
+      return NULL;
+
+   job->ctx = ctx;
+   job->num_shaders = num_shaders;
+   job->shaders = (struct gl_shader **) (job + 1);
+   job->tickets = (unsigned *) (job->shaders + num_shaders);
+   return job;
+}
+
+
+static void
+shader_job_add(struct shader_job *job)
+{
+   unsigned i;
+
+   mtx_lock(&queue.threads->mutex);
+   for (i = 0; i < job->num_shaders; i++)
+      job->tickets[i] = job->shaders[i]->QueuedJobs++;
+   if (job->prog) {
+      job->prog->QueuedJobs++;
+      job->prog->LinkPending = GL_TRUE;
+   }
+
+   *queue.tail = job;
+   queue.tail = &job->next;
+   queue.pending++;
+   cnd_signal(&queue.threads->has_work);
+   mtx_unlock(&queue.threads->mutex);
+}
+
+
+/**
+ * Queue compiling a shader.  The shader's pragmas are expected to be set up
+ * already.
+ *
+ * \return GL_FALSE if the caller has to compile the shader itself.
+ */
+GLboolean
+_mesa_shader_queue_compile(struct gl_context *ctx, struct gl_shader *sh)
+{
+   struct shader_job *job;
+
+   if (!shader_queue_enabled(ctx))
+      return GL_FALSE;
+
+   job = shader_job_create(ctx, 1);
+   if (!job)
+      return GL_FALSE;
+
+   job->shaders[0] = sh;
+   shader_job_add(job);
+   return GL_TRUE;
+}
+
+
+/**
+ * Queue the GLSL part of linking a program.  The driver part runs when the
+ * program is next looked up.
+ *
+ * \return GL_FALSE if the caller has to link the program itself.
+ */
+GLboolean
+_mesa_shader_queue_link(struct gl_context *ctx,
+                        struct gl_shader_program *shProg)
+{
+   struct shader_job *job;
+   unsigned i;
+
+   /* Programs in use are reached through pointers, without a lookup, so
+    * they must never be seen half linked.
+    */
+   if (shProg->RefCount > 1 || !shader_queue_enabled(ctx))
+      return GL_FALSE;
+
+   job = shader_job_create(ctx, shProg->NumShaders);
+   if (!job)
+      return GL_FALSE;
+
+   /* Releasing the previous results calls into the driver, so it is done
+    * here rather than by the linker.
+    */
+   _mesa_clear_shader_program_data(shProg);
+   for (i = 0; i < MESA_SHADER_STAGES; i++) {
+      if (shProg->_LinkedShaders[i]) {
+         ctx->Driver.DeleteShader(ctx, shProg->_LinkedShaders[i]);
+         shProg->_LinkedShaders[i] = NULL;
+      }
+   }
+
+   job->prog = shProg;
+   for (i = 0; i < shProg->NumShaders; i++)
+      job->shaders[i] = shProg->Shaders[i];
+
+   shader_job_add(job);
+   return GL_TRUE;
+}
+
+
+/**
+ * Wait for the queued jobs using a shader.
+ */
+void
+_mesa_shader_queue_wait_shader(struct gl_shader *sh)
+{
+   if (!shader_queue_started())
+      return;
+
+   mtx_lock(&queue.threads->mutex);
+   while (sh->FinishedJobs != sh->QueuedJobs)
+      cnd_wait(&queue.job_done, &queue.threads->mutex);
+   mtx_unlock(&queue.threads->mutex);
+}
+
+
+/**
+ * Wait for a queued link of the program and, if \p finish is set, run the
+ * driver part of it.
+ */
+void
+_mesa_shader_queue_wait_program(struct gl_context *ctx,
+                                struct gl_shader_program *shProg,
+                                GLboolean finish)
+{
+   GLboolean link_driver;
+
+   if (!shader_queue_started())
+      return;
+
+   mtx_lock(&queue.threads->mutex);
+   while (shProg->FinishedJobs != shProg->QueuedJobs)
+      cnd_wait(&queue.job_done, &queue.threads->mutex);
+
+   /* The driver part counts as one more job of the program, so that other
+    * threads looking the program up meanwhile wait for it to finish.
+    */
+   link_driver = finish && shProg->LinkPending;
+   if (link_driver) {
+      shProg->LinkPending = GL_FALSE;
+      shProg->QueuedJobs++;
+   }
+   mtx_unlock(&queue.threads->mutex);
+
+   if (link_driver) {
+      _mesa_glsl_link_shader_driver(ctx, shProg);
+
+      mtx_lock(&queue.threads->mutex);
+      shProg->FinishedJobs++;
+      cnd_broadcast(&queue.job_done);
+      mtx_unlock(&queue.threads->mutex);
+   }
+}
+
+
+/**
+ * Wait for all the queued jobs, before the contexts they refer to or the
+ * compiler's caches go away.
+ */
+void
+_mesa_shader_queue_drain(void)
+{
+   if (!shader_queue_started())
+      return;
+
+   mtx_lock(&queue.threads->mutex);
+   while (queue.pending)
+      cnd_wait(&queue.job_done, &queue.threads->mutex);
+   mtx_unlock(&queue.threads->mutex);
+}
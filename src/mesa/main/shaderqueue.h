@@ -0,0 +1,79 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2026  agent   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file shaderqueue.h
+ * Compiling and linking GLSL on worker threads.
+ *
+ * glCompileShader and glLinkProgram queue the GLSL front end and the GLSL
+ * IR linker, followed by the driver's IR lowering
+ * (ctx->Driver.LowerLinkedShaders), and return.  Anything that looks at the
+ * results waits for them first; for programs that is also where the rest of
+ * the driver part of the link (ctx->Driver.LinkShader) runs, once, on the
+ * first thread to look.
+ *
+ * The number of threads is set with MESA_GLSL_THREADS (0 disables the
+ * queue); by default there is one per CPU, up to 8.  They come from the
+ * thread pool shared with the threaded texstore.
+ */
+
+
+#ifndef SHADERQUEUE_H
+#define SHADERQUEUE_H
+
+
+#include "main/glheader.h"
+#include "main/mtypes.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+extern GLboolean
+_mesa_shader_queue_compile(struct gl_context *ctx, struct gl_shader *sh);
+
+extern GLboolean
+_mesa_shader_queue_link(struct gl_context *ctx,
+                        struct gl_shader_program *shProg);
+
+extern void
+_mesa_shader_queue_wait_shader(struct gl_shader *sh);
+
+extern void
+_mesa_shader_queue_wait_program(struct gl_context *ctx,
+                                struct gl_shader_program *shProg,
+                                GLboolean finish);
+
+extern void
+_mesa_shader_queue_drain(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* SHADERQUEUE_H */
@@ -0,0 +1,398 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * \file sse_swizzle_convert.c
+ * SSE4.1 versions of the most common _mesa_swizzle_and_convert() cases.
+ *
+ * These handle four channel to four channel conversions, with any swizzle,
+ * four pixels at a time, and give exactly the same results as the C code:
+ * the swizzle is a byte shuffle, and the conversions do the same arithmetic
+ * on four channels at once.
+ */
+
+#include <smmintrin.h>
+
+#include "main/sse_swizzle_convert.h"
+
+
+/**
+ * Shuffle mask applying the swizzle to the pixels in a vector of channels
+ * of the given size, and the constant to OR in for SWIZZLE_ONE channels.
+ */
+static void
+make_swizzle_mask(const uint8_t swizzle[4], unsigned size, const void *one,
+                  __m128i *mask, __m128i *ones)
+{
+   uint8_t m[16], o[16];
+   unsigned i;
+
+   for (i = 0; i < 16; i++) {
+      const unsigned pixel = i / (4 * size);
+      const unsigned chan = i / size % 4;
+      const unsigned byte = i % size;
+
+      if (swizzle[chan] < 4) {
+         m[i] = pixel * 4 * size + swizzle[chan] * size + byte;
+         o[i] = 0;
+      } else {
+         /* The high bit selects zero */
+         m[i] = 0x80;
+         o[i] = swizzle[chan] == MESA_FORMAT_SWIZZLE_ONE ?
+                ((const uint8_t *) one)[byte] : 0;
+      }
+   }
+
+   *mask = _mm_loadu_si128((const __m128i *) m);
+   *ones = _mm_loadu_si128((const __m128i *) o);
+}
+
+static inline __m128i
+apply_swizzle(__m128i v, __m128i mask, __m128i ones)
+{
+   return _mm_or_si128(_mm_shuffle_epi8(v, mask), ones);
+}
+
+static inline __m128
+apply_swizzle_ps(__m128 v, __m128i mask, __m128i ones)
+{
+   return _mm_castsi128_ps(apply_swizzle(_mm_castps_si128(v), mask, ones));
+}
+
+
+/** x / 255 for 0 <= x < 65535 in 16 bit lanes */
+static inline __m128i
+div_255_epu16(__m128i x)
+{
+   return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(x, _mm_set1_epi16(1)),
+                                       _mm_srli_epi16(x, 8)), 8);
+}
+
+
+/** Like _mesa_half_to_float() */
+static inline __m128
+half_to_float(__m128i h)
+{
+   const __m128i em = _mm_and_si128(h, _mm_set1_epi32(0x7fff));
+   const __m128i sign = _mm_slli_epi32(_mm_xor_si128(h, em), 16);
+   const __m128i denorm = _mm_cmplt_epi32(em, _mm_set1_epi32(0x0400));
+   const __m128i inf_nan = _mm_cmpgt_epi32(em, _mm_set1_epi32(0x7bff));
+   const __m128i nan = _mm_cmpgt_epi32(em, _mm_set1_epi32(0x7c00));
+   __m128i f, d;
+
+   f = _mm_add_epi32(_mm_slli_epi32(em, 13), _mm_set1_epi32((127 - 15) << 23));
+
+   /* Denorms and zero are the mantissa times 2^-24.  Scaling the converted
+    * integer only involves normal floats, which DAZ and FTZ leave alone.
+    */
+   d = _mm_castps_si128(_mm_mul_ps(_mm_cvtepi32_ps(em),
+                                   _mm_set1_ps(1.0f / (1 << 24))));
+   f = _mm_blendv_epi8(f, d, denorm);
+
+   /* Infinity, and NaN with the mantissa set to 1 */
+   f = _mm_blendv_epi8(f, _mm_sub_epi32(_mm_set1_epi32(0x7f800000), nan),
+                       inf_nan);
+
+   return _mm_castsi128_ps(_mm_or_si128(f, sign));
+}
+
+
+/** Like _mesa_float_to_half(), in the low 16 bits of each lane */
+static inline __m128i
+float_to_half(__m128 x)
+{
+   const __m128i bits = _mm_castps_si128(x);
+   const __m128i abs = _mm_and_si128(bits, _mm_set1_epi32(0x7fffffff));
+   const __m128i sign = _mm_srli_epi32(_mm_xor_si128(bits, abs), 16);
+   const __m128i denorm_magic = _mm_set1_epi32((127 - 15 + 23 - 10 + 1) << 23);
+   __m128i normal, denorm, special, h;
+
+   /* Results below the smallest normal half: let the float adder round */
+   denorm = _mm_sub_epi32(_mm_castps_si128(
+                             _mm_add_ps(_mm_castsi128_ps(abs),
+                                        _mm_castsi128_ps(denorm_magic))),
+                          denorm_magic);
+
+   /* Rebias the exponent and round the mantissa to nearest even; rounding
+    * up carries into the exponent, up to infinity.
+    */
+   normal = _mm_add_epi32(abs, _mm_set1_epi32(((15 - 127) << 23) + 0xfff));
+   normal = _mm_add_epi32(normal, _mm_and_si128(_mm_srli_epi32(abs, 13),
+                                                _mm_set1_epi32(1)));
+   normal = _mm_srli_epi32(normal, 13);
+
+   h = _mm_blendv_epi8(normal, denorm,
+                       _mm_cmplt_epi32(abs, _mm_set1_epi32(113 << 23)));
+
+   /* Infinity for too large values, 0x7c01 for NaN */
+   special = _mm_sub_epi32(_mm_set1_epi32(0x7c00),
+                           _mm_cmpgt_epi32(abs, _mm_set1_epi32(0x7f800000)));
+   h = _mm_blendv_epi8(h, special,
+                       _mm_cmpgt_epi32(abs, _mm_set1_epi32((143 << 23) - 1)));
+
+   return _mm_or_si128(h, sign);
+}
+
+
+/** Like _mesa_float_to_unorm(x, 8), in the low 8 bits of each lane */
+static inline __m128i
+float_to_unorm8(__m128 x)
+{
+   /* maxps returns the second operand for NaN, like the C code's 0 */
+   x = _mm_min_ps(_mm_max_ps(x, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+   return _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(255.0f)));
+}
+
+
+static int
+convert_ubyte_ubyte(uint8_t *dst, const uint8_t *src,
+                    const uint8_t swizzle[4], bool normalized, int count)
+{
+   const uint8_t one = normalized ? UINT8_MAX : 1;
+   __m128i mask, ones;
+   int i;
+
+   make_swizzle_mask(swizzle, 1, &one, &mask, &ones);
+
+   for (i = 0; i + 4 <= count; i += 4) {
+      __m128i v = _mm_loadu_si128((const __m128i *) (src + i * 4));
+      v = apply_swizzle(v, mask, ones);
+      _mm_storeu_si128((__m128i *) (dst + i * 4), v);
+   }
+
+   return i;
+}
+
+
+static int
+convert_ubyte_float(float *dst, const uint8_t *src,
+                    const uint8_t swizzle[4], bool normalized, int count)
+{
+   const float one = 1.0f;
+   const __m128 scale = _mm_set1_ps(normalized ? 1.0f / 255.0f : 1.0f);
+   __m128i mask, ones;
+   int i, j;
+
+   make_swizzle_mask(swizzle, 4, &one, &mask, &ones);
+
+   for (i = 0; i + 4 <= count; i += 4) {
+      __m128i v = _mm_loadu_si128((const __m128i *) (src + i * 4));
+
+      for (j = 0; j < 4; j++) {
+         __m128 f = _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(v)), scale);
+         _mm_storeu_ps(dst + (i + j) * 4, apply_swizzle_ps(f, mask, ones));
+         v = _mm_srli_si128(v, 4);
+      }
+   }
+
+   return i;
+}
+
+
+static int
+convert_float_ubyte(uint8_t *dst, const float *src,
+                    const uint8_t swizzle[4], int count)
+{
+   const float one = 1.0f;
+   __m128i mask, ones;
+   int i;
+
+   make_swizzle_mask(swizzle, 4, &one, &mask, &ones);
+
+   for (i = 0; i + 4 <= count; i += 4) {
+      __m128i p0, p1, p2, p3;
+
+      p0 = float_to_unorm8(apply_swizzle_ps(_mm_loadu_ps(src + i * 4 + 0),
+                                            mask, ones));
+      p1 = float_to_unorm8(apply_swizzle_ps(_mm_loadu_ps(src + i * 4 + 4),
+                                            mask, ones));
+      p2 = float_to_unorm8(apply_swizzle_ps(_mm_loadu_ps(src + i * 4 + 8),
+                                            mask, ones));
+      p3 = float_to_unorm8(apply_swizzle_ps(_mm_loadu_ps(src + i * 4 + 12),
+                                            mask, ones));
+
+      _mm_storeu_si128((__m128i *) (dst + i * 4),
+                       _mm_packus_epi16(_mm_packus_epi32(p0, p1),
+                                        _mm_packus_epi32(p2, p3)));
+   }
+
+   return i;
+}
+
+
+static int
+convert_half_float(float *dst, const uint16_t *src,
+                   const uint8_t swizzle[4], int count)
+{
+   const float one = 1.0f;
+   __m128i mask, ones;
+   int i, j;
+
+   make_swizzle_mask(swizzle, 4, &one, &mask, &ones);
+
+   for (i = 0; i + 4 <= count; i += 4) {
+      for (j = 0; j < 4; j += 2) {
+         __m128i v = _mm_loadu_si128((const __m128i *) (src + (i + j) * 4));
+         __m128 f0 = half_to_float(_mm_cvtepu16_epi32(v));
+         __m128 f1 = half_to_float(_mm_cvtepu16_epi32(_mm_srli_si128(v, 8)));
+
+         _mm_storeu_ps(dst + (i + j) * 4, apply_swizzle_ps(f0, mask, ones));
+         _mm_storeu_ps(dst + (i + j) * 4 + 4, apply_swizzle_ps(f1, mask, ones));
+      }
+   }
+
+   return i;
+}
+
+
+static int
+convert_float_half(uint16_t *dst, const float *src,
+                   const uint8_t swizzle[4], int count)
+{
+   const float one = 1.0f;
+   __m128i mask, ones;
+   int i;
+
+   make_swizzle_mask(swizzle, 4, &one, &mask, &ones);
+
+   for (i = 0; i + 2 <= count; i += 2) {
+      __m128i h0, h1;
+
+      h0 = float_to_half(apply_swizzle_ps(_mm_loadu_ps(src + i * 4),
+                                          mask, ones));
+      h1 = float_to_half(apply_swizzle_ps(_mm_loadu_ps(src + i * 4 + 4),
+                                          mask, ones));
+
+      _mm_storeu_si128((__m128i *) (dst + i * 4), _mm_packus_epi32(h0, h1));
+   }
+
+   return i;
+}
+
+
+static int
+convert_ubyte_byte(int8_t *dst, const uint8_t *src,
+                   const uint8_t swizzle[4], int count)
+{
+   const int8_t one = INT8_MAX;
+   const __m128i zero = _mm_setzero_si128();
+   const __m128i m127 = _mm_set1_epi16(127);
+   __m128i mask, ones;
+   int i;
+
+   make_swizzle_mask(swizzle, 1, &one, &mask, &ones);
+
+   for (i = 0; i + 4 <= count; i += 4) {
+      __m128i v = _mm_loadu_si128((const __m128i *) (src + i * 4));
+      __m128i lo = _mm_unpacklo_epi8(v, zero);
+      __m128i hi = _mm_unpackhi_epi8(v, zero);
+
+      /* _mesa_unorm_to_snorm(x, 8, 8): (x * 127 + 127) / 255 */
+      lo = div_255_epu16(_mm_add_epi16(_mm_mullo_epi16(lo, m127), m127));
+      hi = div_255_epu16(_mm_add_epi16(_mm_mullo_epi16(hi, m127), m127));
+
+      v = _mm_packs_epi16(lo, hi);
+      v = apply_swizzle(v, mask, ones);
+      _mm_storeu_si128((__m128i *) (dst + i * 4), v);
+   }
+
+   return i;
+}
+
+
+static int
+convert_byte_ubyte(uint8_t *dst, const int8_t *src,
+                   const uint8_t swizzle[4], int count)
+{
+   const uint8_t one = UINT8_MAX;
+   const __m128i zero = _mm_setzero_si128();
+   __m128i mask, ones;
+   int i;
+
+   make_swizzle_mask(swizzle, 1, &one, &mask, &ones);
+
+   for (i = 0; i + 4 <= count; i += 4) {
+      /* Negative values become 0 */
+      __m128i v = _mm_max_epi8(_mm_loadu_si128((const __m128i *) (src + i * 4)),
+                               zero);
+      __m128i lo = _mm_unpacklo_epi8(v, zero);
+      __m128i hi = _mm_unpackhi_epi8(v, zero);
+
+      /* _mesa_snorm_to_unorm(x, 8, 8): x * 2 + (x >> 6) */
+      lo = _mm_add_epi16(_mm_add_epi16(lo, lo), _mm_srli_epi16(lo, 6));
+      hi = _mm_add_epi16(_mm_add_epi16(hi, hi), _mm_srli_epi16(hi, 6));
+
+      v = _mm_packus_epi16(lo, hi);
+      v = apply_swizzle(v, mask, ones);
+      _mm_storeu_si128((__m128i *) (dst + i * 4), v);
+   }
+
+   return i;
+}
+
+
+/**
+ * Convert as many pixels as possible of a four channel to four channel
+ * _mesa_swizzle_and_convert() call.
+ *
+ * \return the number of pixels converted, which is 0 for unsupported type
+ *         combinations and otherwise count rounded down to a multiple of
+ *         the pixels converted per iteration.
+ */
+int
+_mesa_sse41_swizzle_and_convert(void *dst,
+                                enum mesa_array_format_datatype dst_type,
+                                const void *src,
+                                enum mesa_array_format_datatype src_type,
+                                const uint8_t swizzle[4], bool normalized,
+                                int count)
+{
+   switch (dst_type) {
+   case MESA_ARRAY_FORMAT_TYPE_UBYTE:
+      if (src_type == MESA_ARRAY_FORMAT_TYPE_UBYTE)
+         return convert_ubyte_ubyte(dst, src, swizzle, normalized, count);
+      if (src_type == MESA_ARRAY_FORMAT_TYPE_FLOAT && normalized)
+         return convert_float_ubyte(dst, src, swizzle, count);
+      if (src_type == MESA_ARRAY_FORMAT_TYPE_BYTE && normalized)
+         return convert_byte_ubyte(dst, src, swizzle, count);
+      break;
+   case MESA_ARRAY_FORMAT_TYPE_BYTE:
+      if (src_type == MESA_ARRAY_FORMAT_TYPE_UBYTE && normalized)
+         return convert_ubyte_byte(dst, src, swizzle, count);
+      break;
+   case MESA_ARRAY_FORMAT_TYPE_FLOAT:
+      if (src_type == MESA_ARRAY_FORMAT_TYPE_UBYTE)
+         return convert_ubyte_float(dst, src, swizzle, normalized, count);
+      if (src_type == MESA_ARRAY_FORMAT_TYPE_HALF)
+         return convert_half_float(dst, src, swizzle, count);
+      break;
+   case MESA_ARRAY_FORMAT_TYPE_HALF:
+      if (src_type == MESA_ARRAY_FORMAT_TYPE_FLOAT)
+         return convert_float_half(dst, src, swizzle, count);
+      break;
+   default:
+      break;
+   }
+
+   return 0;
+}
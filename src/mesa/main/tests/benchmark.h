@@ -0,0 +1,54 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file benchmark.h
+ * Timing for the tests that also print performance numbers.
+ *
+ * The measurements take a while and check nothing, so they only run with
+ * MESA_TEST_BENCHMARK set in the environment, e.g.
+ * "MESA_TEST_BENCHMARK=1 ./main-test --gtest_filter=*throughput*".
+ */
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <stdlib.h>
+
+#include "os/os_time.h"
+
+/** Whether to run the measurements and print their results */
+static inline bool
+benchmark_enabled(void)
+{
+   return getenv("MESA_TEST_BENCHMARK") != NULL;
+}
+
+/** Monotonic time in seconds */
+static inline double
+benchmark_seconds(void)
+{
+   return os_time_get_nano() * 1e-9;
+}
+
+#endif /* BENCHMARK_H */
@@ -0,0 +1,98 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file context_fixture.h
+ * Base fixture for the tests that call into a context.
+ *
+ * The context uses the common driver functions and no window system, e.g.
+ *
+ *    void Foo_test::SetUp()
+ *    {
+ *       create_context(API_OPENGL_COMPAT);
+ *       make_current();
+ *    }
+ */
+
+#ifndef CONTEXT_FIXTURE_H
+#define CONTEXT_FIXTURE_H
+
+#include <gtest/gtest.h>
+#include <string.h>
+
+extern "C" {
+#include "main/context.h"
+#include "main/framebuffer.h"
+#include "main/mtypes.h"
+#include "drivers/common/driverfuncs.h"
+#include "vbo/vbo.h"
+}
+
+class ContextFixture : public ::testing::Test {
+public:
+   ContextFixture() : fb(NULL) {}
+
+   virtual void TearDown()
+   {
+      if (fb) {
+         _mesa_make_current(NULL, NULL, NULL);
+         _mesa_reference_framebuffer(&fb, NULL);
+      }
+   }
+
+   /**
+    * Initialize ctx for \p api, with the driver functions that
+    * init_driver_functions() set up.
+    */
+   void create_context(gl_api api)
+   {
+      memset(&visual, 0, sizeof(visual));
+      memset(&driver_functions, 0, sizeof(driver_functions));
+      memset(&ctx, 0, sizeof(ctx));
+
+      _mesa_init_driver_functions(&driver_functions);
+      init_driver_functions(&driver_functions);
+      _mesa_initialize_context(&ctx, api, &visual, NULL, &driver_functions);
+      _vbo_CreateContext(&ctx);
+   }
+
+   /**
+    * Bind ctx and a framebuffer without buffers to the thread, which the GL
+    * entry points need.
+    */
+   void make_current()
+   {
+      fb = _mesa_create_framebuffer(&visual);
+      _mesa_make_current(&ctx, fb, fb);
+   }
+
+   /** Hook to override some of the common driver functions */
+   virtual void init_driver_functions(struct dd_function_table *driver) {}
+
+   struct gl_config visual;
+   struct dd_function_table driver_functions;
+   struct gl_context ctx;
+   struct gl_framebuffer *fb;
+};
+
+#endif /* CONTEXT_FIXTURE_H */
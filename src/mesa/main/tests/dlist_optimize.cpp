@@ -0,0 +1,313 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \name dlist_optimize.cpp
+ *
+ * Check that glEndList merges the vertex lists of a display list with
+ * attribute changes between its glBegin/End pairs, that replaying it draws
+ * the same vertices with the same attributes as before.  With
+ * MESA_TEST_BENCHMARK set, also print the number of draws and the time of
+ * replaying lists with and without state changes that prevent merging.
+ */
+
+#include <gtest/gtest.h>
+#include <vector>
+
+extern "C" {
+#include "main/api_exec.h"
+#include "main/bufferobj.h"
+#include "main/compiler.h"
+#include "main/dispatch.h"
+#include "main/dlist.h"
+#include "main/macros.h"
+#include "main/mtypes.h"
+#include "main/version.h"
+#include "main/vtxfmt.h"
+#include "vbo/vbo.h"
+}
+
+#include "benchmark.h"
+#include "context_fixture.h"
+
+struct vertex {
+   GLfloat pos[4];
+   GLfloat color[4];
+   GLfloat normal[4];
+};
+
+/* A vertex with the normal the tests set before compiling their lists */
+static const vertex outside = {
+   { 0, 0, 0, 1 },
+   { 0, 0, 0, 1 },
+   { 0, 1, 0, 1 },
+};
+
+/* What the draws got since the last reset_draws() */
+static unsigned num_draws, num_prims;
+static std::vector<vertex> drawn;
+static bool record_vertices;
+
+static void
+reset_draws(void)
+{
+   num_draws = 0;
+   num_prims = 0;
+   drawn.clear();
+   record_vertices = true;
+}
+
+static void
+get_attrib(struct gl_context *ctx, gl_vert_attrib attr, GLuint i,
+           GLfloat value[4])
+{
+   const struct gl_client_array *array = ctx->Array._DrawArrays[attr];
+   const GLubyte *ptr = array->Ptr + i * array->StrideB;
+   GLint c;
+
+   if (_mesa_is_bufferobj(array->BufferObj))
+      ptr += (uintptr_t) array->BufferObj->Data;
+
+   for (c = 0; c < 4; c++)
+      value[c] = c < array->Size ? ((const GLfloat *) ptr)[c] : c == 3;
+}
+
+static void
+record_draw(struct gl_context *ctx, const struct _mesa_prim *prims,
+            GLuint nr_prims, const struct _mesa_index_buffer *ib,
+            GLboolean index_bounds_valid, GLuint min_index, GLuint max_index,
+            struct gl_transform_feedback_object *tfb_vertcount,
+            struct gl_buffer_object *indirect)
+{
+   num_draws++;
+   num_prims += nr_prims;
+
+   if (!record_vertices)
+      return;
+
+   for (GLuint p = 0; p < nr_prims; p++) {
+      for (GLuint i = prims[p].start; i < prims[p].start + prims[p].count;
+           i++) {
+         vertex v;
+
+         get_attrib(ctx, VERT_ATTRIB_POS, i, v.pos);
+         get_attrib(ctx, VERT_ATTRIB_COLOR0, i, v.color);
+         get_attrib(ctx, VERT_ATTRIB_NORMAL, i, v.normal);
+         drawn.push_back(v);
+      }
+   }
+}
+
+static void
+update_state(struct gl_context *ctx, GLuint new_state)
+{
+}
+
+class DlistOptimize_test : public ContextFixture {
+public:
+   virtual void SetUp();
+   virtual void init_driver_functions(struct dd_function_table *driver);
+
+   void compile(GLuint list, unsigned count, GLenum state_change,
+                std::vector<vertex> *expected);
+   double replay(GLuint list, unsigned times);
+};
+
+void
+DlistOptimize_test::init_driver_functions(struct dd_function_table *driver)
+{
+   driver->UpdateState = update_state;
+}
+
+void
+DlistOptimize_test::SetUp()
+{
+   create_context(API_OPENGL_COMPAT);
+   vbo_set_draw_func(&ctx, record_draw);
+
+   _mesa_compute_version(&ctx);
+   _mesa_initialize_dispatch_tables(&ctx);
+   _mesa_initialize_vbo_vtxfmt(&ctx);
+   make_current();
+
+   reset_draws();
+}
+
+/**
+ * Compile \p count triangles in glBegin/End pairs, each with a color and
+ * sometimes a normal set before it and texture coordinates in the
+ * vertices, and \p state_change, if not GL_NONE, between the pairs.  The
+ * vertices the list draws are appended to \p expected, whose last vertex
+ * has the current normal.
+ */
+void
+DlistOptimize_test::compile(GLuint list, unsigned count, GLenum state_change,
+                            std::vector<vertex> *expected)
+{
+   struct _glapi_table *disp;
+
+   _mesa_NewList(list, GL_COMPILE);
+   disp = ctx.CurrentDispatch;
+
+   /* Overwritten before anything reads it */
+   CALL_Color3f(disp, (0.5f, 0.5f, 0.5f));
+
+   for (unsigned i = 0; i < count; i++) {
+      const vertex v = {
+         { 0, 0, 0, 1 },
+         { (i % 7) / 7.0f, (i % 11) / 11.0f, (i % 13) / 13.0f, 1 },
+         { 0, 0, 1.0f - i % 3, 1 },
+      };
+
+      CALL_Color3fv(disp, (v.color));
+      if (i % 3 == 2)
+         CALL_Normal3fv(disp, (v.normal));
+      if (state_change != GL_NONE)
+         CALL_ShadeModel(disp, (i % 2 ? state_change : GL_SMOOTH));
+
+      CALL_Begin(disp, (GL_TRIANGLES));
+      for (unsigned j = 0; j < 3; j++) {
+         vertex w = v;
+
+         w.pos[0] = i;
+         w.pos[1] = j;
+         CALL_TexCoord2f(disp, (j, i));
+         CALL_Vertex3fv(disp, (w.pos));
+
+         /* Only every third triangle sets the normal */
+         if (i % 3 != 2)
+            COPY_4V(w.normal, expected->back().normal);
+         expected->push_back(w);
+      }
+      CALL_End(disp, ());
+   }
+
+   _mesa_EndList();
+   EXPECT_EQ((GLenum) GL_NO_ERROR, ctx.ErrorValue);
+}
+
+/** Call the list \p times times and return the time per call */
+double
+DlistOptimize_test::replay(GLuint list, unsigned times)
+{
+   double start = benchmark_seconds();
+
+   for (unsigned i = 0; i < times; i++)
+      _mesa_CallList(list);
+
+   return (benchmark_seconds() - start) / times;
+}
+
+static void
+check_vertices(const std::vector<vertex> &expected)
+{
+   ASSERT_EQ(expected.size(), drawn.size());
+   for (size_t i = 0; i < expected.size(); i++) {
+      EXPECT_EQ(0, memcmp(expected[i].pos, drawn[i].pos,
+                          sizeof(drawn[i].pos))) << i;
+      EXPECT_EQ(0, memcmp(expected[i].color, drawn[i].color,
+                          sizeof(drawn[i].color))) << i;
+      EXPECT_EQ(0, memcmp(expected[i].normal, drawn[i].normal,
+                          sizeof(drawn[i].normal))) << i;
+   }
+}
+
+TEST_F(DlistOptimize_test, merges_attribute_changes)
+{
+   std::vector<vertex> expected;
+
+   /* The first normal comes from outside the list */
+   CALL_Normal3f(ctx.CurrentDispatch, (0, 1, 0));
+   expected.push_back(outside);
+
+   compile(1, 1000, GL_NONE, &expected);
+   expected.erase(expected.begin());
+
+   _mesa_CallList(1);
+   EXPECT_EQ((GLenum) GL_NO_ERROR, ctx.ErrorValue);
+
+   /* The triangles with the normal from outside the list can't take it
+    * into their vertices, so up to the first normal of the list and the
+    * rest.
+    */
+   EXPECT_EQ(2u, num_draws);
+   EXPECT_EQ(2u, num_prims);
+   check_vertices(expected);
+
+   /* The current values are the ones of the last vertex */
+   EXPECT_EQ(0, memcmp(expected.back().color,
+                       ctx.Current.Attrib[VERT_ATTRIB_COLOR0],
+                       sizeof(expected.back().color)));
+   EXPECT_EQ(0, memcmp(expected.back().normal,
+                       ctx.Current.Attrib[VERT_ATTRIB_NORMAL],
+                       sizeof(expected.back().normal)));
+   EXPECT_EQ(999.0f, ctx.Current.Attrib[VERT_ATTRIB_TEX0][1]);
+}
+
+TEST_F(DlistOptimize_test, keeps_state_changes)
+{
+   std::vector<vertex> expected;
+
+   CALL_Normal3f(ctx.CurrentDispatch, (0, 1, 0));
+   expected.push_back(outside);
+
+   compile(1, 100, GL_FLAT, &expected);
+   expected.erase(expected.begin());
+
+   _mesa_CallList(1);
+   EXPECT_EQ((GLenum) GL_NO_ERROR, ctx.ErrorValue);
+
+   EXPECT_EQ(100u, num_draws);
+   check_vertices(expected);
+   EXPECT_EQ((GLenum) GL_FLAT, ctx.Light.ShadeModel);
+}
+
+TEST_F(DlistOptimize_test, replay)
+{
+   const unsigned count = 5000, times = 20;
+   std::vector<vertex> expected;
+   double merged, unmerged;
+   unsigned merged_draws;
+
+   expected.push_back(outside);
+   compile(1, count, GL_NONE, &expected);
+   compile(2, count, GL_FLAT, &expected);
+
+   /* Only the cost of the replay itself */
+   record_vertices = false;
+   merged = replay(1, times);
+   merged_draws = num_draws / times;
+   reset_draws();
+   record_vertices = false;
+   unmerged = replay(2, times);
+
+   if (benchmark_enabled()) {
+      printf("%u triangles, attribute changes only: %5u draws, %8.1f us\n",
+             count, merged_draws, merged * 1e6);
+      printf("%u triangles, with glShadeModel:      %5u draws, %8.1f us\n",
+             count, num_draws / times, unmerged * 1e6);
+   }
+
+   EXPECT_LT(merged_draws, 3u);
+   EXPECT_EQ(count, num_draws / times);
+}
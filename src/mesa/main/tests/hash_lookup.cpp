@@ -0,0 +1,262 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \name hash_lookup.cpp
+ *
+ * Check that _mesa_HashTable finds the same entries whether their keys are
+ * in the direct array or the hash table, including while the array grows
+ * under lookups from other threads.  With MESA_TEST_BENCHMARK set, print
+ * the lookup rate of threads sharing a table with and without the mutex.
+ */
+
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+extern "C" {
+#include "c11/threads.h"
+#include "main/hash.h"
+#include "main/macros.h"
+}
+
+#include "benchmark.h"
+
+/* Data for a key, so lookups can check what they get */
+static void *
+data_for(GLuint key)
+{
+   return (void *) (uintptr_t) (key * 4 + 0x1000);
+}
+
+class HashLookup_test : public ::testing::Test {
+public:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   struct _mesa_HashTable *table;
+};
+
+void
+HashLookup_test::SetUp()
+{
+   table = _mesa_NewHashTable();
+   ASSERT_TRUE(table != NULL);
+}
+
+static void
+remove_entry(GLuint key, void *data, void *userData)
+{
+   (*(unsigned *) userData)++;
+}
+
+void
+HashLookup_test::TearDown()
+{
+   unsigned count = 0;
+
+   _mesa_HashDeleteAll(table, remove_entry, &count);
+   _mesa_DeleteHashTable(table);
+}
+
+static void
+check_entry(GLuint key, void *data, void *userData)
+{
+   EXPECT_EQ(data_for(key), data);
+   (*(unsigned *) userData)++;
+}
+
+TEST_F(HashLookup_test, small_and_large_keys)
+{
+   static const GLuint sparse[] = { 5000, 100000, 3000000, 0xfffffffe };
+   struct _mesa_HashTable *clone;
+   unsigned count, i;
+   GLuint key;
+
+   /* A sparse key first, which the array only reaches later */
+   for (i = 0; i < ARRAY_SIZE(sparse); i++)
+      _mesa_HashInsert(table, sparse[i], data_for(sparse[i]));
+   for (key = 1; key <= 6000; key++) {
+      if (key != 5000)
+         _mesa_HashInsert(table, key, data_for(key));
+   }
+
+   for (key = 1; key <= 6000; key++)
+      ASSERT_EQ(data_for(key), _mesa_HashLookup(table, key)) << key;
+   for (i = 0; i < ARRAY_SIZE(sparse); i++)
+      EXPECT_EQ(data_for(sparse[i]), _mesa_HashLookup(table, sparse[i]));
+   EXPECT_EQ(NULL, _mesa_HashLookup(table, 6001));
+   EXPECT_EQ(NULL, _mesa_HashLookup(table, 100001));
+
+   /* Replace and remove entries on both sides */
+   _mesa_HashInsert(table, 7, data_for(8));
+   EXPECT_EQ(data_for(8), _mesa_HashLookup(table, 7));
+   _mesa_HashInsert(table, 7, data_for(7));
+   _mesa_HashRemove(table, 3);
+   _mesa_HashRemove(table, 100000);
+   EXPECT_EQ(NULL, _mesa_HashLookup(table, 3));
+   EXPECT_EQ(NULL, _mesa_HashLookup(table, 100000));
+
+   EXPECT_EQ(6000u + 3 - 2, _mesa_HashNumEntries(table));
+
+   count = 0;
+   _mesa_HashWalk(table, check_entry, &count);
+   EXPECT_EQ(6000u + 3 - 2, count);
+
+   clone = _mesa_HashClone(table);
+   count = 0;
+   _mesa_HashWalk(clone, check_entry, &count);
+   EXPECT_EQ(6000u + 3 - 2, count);
+   _mesa_HashDeleteAll(clone, remove_entry, &count);
+   _mesa_DeleteHashTable(clone);
+
+   /* The gap left by key 3 is found by the slow search */
+   EXPECT_EQ(3u, _mesa_HashFindFreeKeyBlock(table, 1));
+}
+
+struct lookup_thread {
+   struct _mesa_HashTable *table;
+   GLuint num_keys;
+   bool locked;
+   volatile bool *stop;
+   unsigned lookups;
+   unsigned errors;
+};
+
+static int
+lookup_thread(void *arg)
+{
+   struct lookup_thread *t = (struct lookup_thread *) arg;
+   GLuint key = 1;
+   void *data;
+
+   while (!*t->stop) {
+      if (t->locked) {
+         _mesa_HashLockMutex(t->table);
+         data = _mesa_HashLookupLocked(t->table, key);
+         _mesa_HashUnlockMutex(t->table);
+      } else {
+         data = _mesa_HashLookup(t->table, key);
+      }
+
+      if (data != data_for(key))
+         t->errors++;
+
+      t->lookups++;
+      key = key % t->num_keys + 1;
+   }
+
+   return 0;
+}
+
+TEST_F(HashLookup_test, lookups_while_growing)
+{
+   const GLuint num_keys = 1000;
+   struct lookup_thread threads[3];
+   thrd_t handles[3];
+   volatile bool stop = false;
+   unsigned i;
+   GLuint key;
+
+   for (key = 1; key <= num_keys; key++)
+      _mesa_HashInsert(table, key, data_for(key));
+
+   for (i = 0; i < ARRAY_SIZE(threads); i++) {
+      threads[i].table = table;
+      threads[i].num_keys = num_keys;
+      threads[i].locked = false;
+      threads[i].stop = &stop;
+      threads[i].lookups = 0;
+      threads[i].errors = 0;
+      thrd_create(&handles[i], lookup_thread, &threads[i]);
+   }
+
+   /* Grow the array to its maximum and churn keys beyond it */
+   for (key = num_keys + 1; key < 100000; key++) {
+      _mesa_HashInsert(table, key, data_for(key));
+      if (key % 3 == 0)
+         _mesa_HashRemove(table, key);
+      if (key % 1000 == 0)
+         thrd_yield();
+   }
+
+   stop = true;
+   for (i = 0; i < ARRAY_SIZE(threads); i++) {
+      thrd_join(handles[i], NULL);
+      EXPECT_EQ(0u, threads[i].errors);
+      EXPECT_LT(0u, threads[i].lookups);
+   }
+}
+
+/**
+ * What glBindTexture and friends do when contexts on several threads share
+ * a namespace: look up small genned names in the shared table.
+ */
+TEST_F(HashLookup_test, throughput)
+{
+   const GLuint num_keys = 4096;
+   const double duration = 0.2;
+   struct lookup_thread threads[4];
+   thrd_t handles[4];
+   volatile bool stop;
+   unsigned num_threads, locked, i, total;
+   double start, elapsed;
+   GLuint key;
+   if (!benchmark_enabled())
+      return;
+
+   for (key = 1; key <= num_keys; key++)
+      _mesa_HashInsert(table, key, data_for(key));
+
+   for (num_threads = 1; num_threads <= ARRAY_SIZE(threads);
+        num_threads *= 2) {
+      for (locked = 0; locked < 2; locked++) {
+         stop = false;
+         for (i = 0; i < num_threads; i++) {
+            threads[i].table = table;
+            threads[i].num_keys = num_keys;
+            threads[i].locked = locked;
+            threads[i].stop = &stop;
+            threads[i].lookups = 0;
+            threads[i].errors = 0;
+            thrd_create(&handles[i], lookup_thread, &threads[i]);
+         }
+
+         start = benchmark_seconds();
+         do {
+            thrd_yield();
+         } while (benchmark_seconds() - start < duration);
+         stop = true;
+
+         total = 0;
+         for (i = 0; i < num_threads; i++) {
+            thrd_join(handles[i], NULL);
+            EXPECT_EQ(0u, threads[i].errors);
+            total += threads[i].lookups;
+         }
+         elapsed = benchmark_seconds() - start;
+
+         printf("%u thread(s), %-10s %8.1f Mlookups/s\n", num_threads,
+                locked ? "mutex:" : "lock-free:", total / elapsed / 1e6);
+      }
+   }
+}
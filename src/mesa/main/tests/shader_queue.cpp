@@ -0,0 +1,275 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \name shader_queue.cpp
+ *
+ * Compile and link many programs on the shader queue, detaching and
+ * deleting their shaders while the jobs are still pending, and check the
+ * link results.
+ */
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+extern "C" {
+#include "main/compiler.h"
+#include "main/mtypes.h"
+#include "main/shaderapi.h"
+#include "main/shaderqueue.h"
+#include "main/uniforms.h"
+#include "main/version.h"
+}
+
+#include "context_fixture.h"
+
+#define NUM_PROGRAMS 64
+
+class ShaderQueue_test : public ContextFixture {
+public:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   GLuint compile(GLenum type, const char *source);
+   GLuint create_program(GLuint vs, GLuint fs);
+   void check_program(GLuint prog, GLboolean status, const char *uniform);
+};
+
+void
+ShaderQueue_test::SetUp()
+{
+   /* Run the jobs on threads even without several CPUs */
+   setenv("MESA_GLSL_THREADS", "4", 0);
+
+   create_context(API_OPENGL_COMPAT);
+
+   ctx.Extensions.ARB_vertex_shader = true;
+   ctx.Extensions.ARB_fragment_shader = true;
+
+   _mesa_compute_version(&ctx);
+   make_current();
+}
+
+void
+ShaderQueue_test::TearDown()
+{
+   _mesa_shader_queue_drain();
+   ContextFixture::TearDown();
+}
+
+GLuint
+ShaderQueue_test::compile(GLenum type, const char *source)
+{
+   GLuint sh = _mesa_CreateShader(type);
+
+   _mesa_ShaderSource(sh, 1, &source, NULL);
+   _mesa_CompileShader(sh);
+   return sh;
+}
+
+GLuint
+ShaderQueue_test::create_program(GLuint vs, GLuint fs)
+{
+   GLuint prog = _mesa_CreateProgram();
+
+   _mesa_AttachShader(prog, vs);
+   _mesa_AttachShader(prog, fs);
+   _mesa_LinkProgram(prog);
+   return prog;
+}
+
+void
+ShaderQueue_test::check_program(GLuint prog, GLboolean status,
+                                const char *uniform)
+{
+   GLint value = -1;
+
+   _mesa_GetProgramiv(prog, GL_LINK_STATUS, &value);
+   EXPECT_EQ(status, value) << "program " << prog;
+
+   if (status) {
+      EXPECT_NE(-1, _mesa_GetUniformLocation(prog, uniform))
+         << "program " << prog << " uniform " << uniform;
+   } else {
+      _mesa_GetProgramiv(prog, GL_INFO_LOG_LENGTH, &value);
+      EXPECT_LT(1, value) << "program " << prog;
+   }
+}
+
+static const char vs_source[] =
+   "#version 110\n"
+   "uniform vec4 offset;\n"
+   "varying vec4 color;\n"
+   "void main()\n"
+   "{\n"
+   "   color = gl_Color;\n"
+   "   gl_Position = gl_Vertex + offset;\n"
+   "}\n";
+
+static char *
+fs_source(unsigned i)
+{
+   char *source = (char *) malloc(256);
+
+   snprintf(source, 256,
+            "#version 110\n"
+            "uniform vec4 scale%u;\n"
+            "varying vec4 color;\n"
+            "void main()\n"
+            "{\n"
+            "   gl_FragColor = color * scale%u + vec4(%u.0);\n"
+            "}\n", i, i, i);
+   return source;
+}
+
+/**
+ * Programs sharing a vertex shader, with the shaders detached and deleted
+ * right after glLinkProgram.
+ */
+TEST_F(ShaderQueue_test, link_many_programs)
+{
+   GLuint progs[NUM_PROGRAMS];
+   GLuint vs = compile(GL_VERTEX_SHADER, vs_source);
+
+   for (unsigned i = 0; i < NUM_PROGRAMS; i++) {
+      char *source = fs_source(i);
+      GLuint fs = compile(GL_FRAGMENT_SHADER, source);
+
+      progs[i] = create_program(vs, fs);
+      _mesa_DetachShader(progs[i], fs);
+      _mesa_DeleteShader(fs);
+      free(source);
+   }
+   _mesa_DeleteShader(vs);
+
+   for (unsigned i = 0; i < NUM_PROGRAMS; i++) {
+      char name[32];
+
+      snprintf(name, sizeof(name), "scale%u", i);
+      check_program(progs[i], GL_TRUE, name);
+      check_program(progs[i], GL_TRUE, "offset");
+      _mesa_DeleteProgram(progs[i]);
+   }
+}
+
+/**
+ * Relinking programs while their previous links are pending, and deleting
+ * programs with pending links.
+ */
+TEST_F(ShaderQueue_test, relink_and_delete_pending)
+{
+   GLuint progs[NUM_PROGRAMS];
+   GLuint vs = compile(GL_VERTEX_SHADER, vs_source);
+   char *source = fs_source(0);
+   GLuint fs = compile(GL_FRAGMENT_SHADER, source);
+
+   for (unsigned i = 0; i < NUM_PROGRAMS; i++) {
+      progs[i] = create_program(vs, fs);
+      _mesa_LinkProgram(progs[i]);
+   }
+
+   for (unsigned i = 0; i < NUM_PROGRAMS; i += 2)
+      _mesa_DeleteProgram(progs[i]);
+
+   /* Relink without the fragment shader, which must not be overtaken by
+    * the previous link.
+    */
+   for (unsigned i = 1; i < NUM_PROGRAMS; i += 2) {
+      _mesa_DetachShader(progs[i], fs);
+      _mesa_LinkProgram(progs[i]);
+   }
+   _mesa_DeleteShader(vs);
+   _mesa_DeleteShader(fs);
+   free(source);
+
+   for (unsigned i = 1; i < NUM_PROGRAMS; i += 2) {
+      GLint value = -1;
+
+      _mesa_GetProgramiv(progs[i], GL_ATTACHED_SHADERS, &value);
+      EXPECT_EQ(1, value);
+      check_program(progs[i], GL_TRUE, "offset");
+      EXPECT_EQ(-1, _mesa_GetUniformLocation(progs[i], "scale0"));
+      _mesa_DeleteProgram(progs[i]);
+   }
+}
+
+/**
+ * Links that fail still report it, with a log.
+ */
+TEST_F(ShaderQueue_test, failed_links)
+{
+   static const char bad_fs_source[] =
+      "#version 110\n"
+      "varying vec4 missing;\n"
+      "void main()\n"
+      "{\n"
+      "   gl_FragColor = missing;\n"
+      "}\n";
+   GLuint progs[NUM_PROGRAMS];
+   GLuint vs = compile(GL_VERTEX_SHADER, vs_source);
+   GLuint fs = compile(GL_FRAGMENT_SHADER, bad_fs_source);
+
+   for (unsigned i = 0; i < NUM_PROGRAMS; i++)
+      progs[i] = create_program(vs, fs);
+   _mesa_DeleteShader(vs);
+   _mesa_DeleteShader(fs);
+
+   for (unsigned i = 0; i < NUM_PROGRAMS; i++) {
+      check_program(progs[i], GL_FALSE, NULL);
+      _mesa_DeleteProgram(progs[i]);
+   }
+}
+
+/**
+ * Relinking a bound program, which links right away, while the compile of
+ * one of its shaders is still queued.
+ */
+TEST_F(ShaderQueue_test, relink_bound_program_after_compile)
+{
+   GLuint vs = compile(GL_VERTEX_SHADER, vs_source);
+   char *source = fs_source(0);
+   GLuint fs = compile(GL_FRAGMENT_SHADER, source);
+   GLuint prog = create_program(vs, fs);
+
+   free(source);
+   _mesa_UseProgram(prog);
+
+   for (unsigned i = 1; i < NUM_PROGRAMS; i++) {
+      char name[32];
+
+      source = fs_source(i);
+      _mesa_ShaderSource(fs, 1, (const GLchar * const *) &source, NULL);
+      _mesa_CompileShader(fs);
+      _mesa_LinkProgram(prog);
+      free(source);
+
+      snprintf(name, sizeof(name), "scale%u", i);
+      check_program(prog, GL_TRUE, name);
+   }
+
+   _mesa_UseProgram(0);
+   _mesa_DeleteShader(vs);
+   _mesa_DeleteShader(fs);
+   _mesa_DeleteProgram(prog);
+}
@@ -0,0 +1,278 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \name swizzle_convert.cpp
+ *
+ * Check _mesa_swizzle_and_convert() against the per-channel conversion
+ * helpers for the four channel cases that have SIMD kernels, and with
+ * MESA_TEST_BENCHMARK set, print the number of pixels converted per second.
+ */
+
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern "C" {
+#include "main/cpuinfo.h"
+#include "main/format_utils.h"
+#include "main/macros.h"
+#include "x86/common_x86_asm.h"
+}
+
+#ifdef USE_SSE41
+#include <xmmintrin.h>
+#endif
+
+#include "benchmark.h"
+
+/* Not a multiple of any vector width, so the C tail is checked too */
+#define NUM_PIXELS 1027
+
+static const uint8_t swizzles[][4] = {
+   { 0, 1, 2, 3 },
+   { 2, 1, 0, 3 },
+   { 3, 2, 1, 0 },
+   { 0, 0, 0, MESA_FORMAT_SWIZZLE_ONE },
+   { MESA_FORMAT_SWIZZLE_ZERO, 1, MESA_FORMAT_SWIZZLE_ONE, 2 },
+};
+
+class SwizzleConvert_test : public ::testing::Test {
+public:
+   virtual void SetUp();
+
+   uint8_t ubytes[NUM_PIXELS * 4];
+   int8_t bytes[NUM_PIXELS * 4];
+   uint16_t halves[NUM_PIXELS * 4];
+   float floats[NUM_PIXELS * 4];
+};
+
+void
+SwizzleConvert_test::SetUp()
+{
+   unsigned i;
+
+   _mesa_get_cpu_features();
+
+   srand(42);
+   for (i = 0; i < NUM_PIXELS * 4; i++) {
+      ubytes[i] = rand();
+      bytes[i] = rand();
+      /* Every half, including denorms, infinities and NaNs */
+      halves[i] = i * 64 + rand() % 64;
+
+      switch (i % 4) {
+      case 0:
+         /* In [-0.5, 1.5] to exercise clamping */
+         floats[i] = (float) rand() / RAND_MAX * 2.0f - 0.5f;
+         break;
+      case 1:
+         /* Values halfway between two halves or unorm8 steps */
+         floats[i] = (rand() % 511) / 510.0f;
+         break;
+      case 2:
+         floats[i] = ldexpf((float) rand() / RAND_MAX, -(rand() % 30));
+         break;
+      default:
+         floats[i] = ldexpf((float) rand() / RAND_MAX - 0.5f, rand() % 40 - 8);
+         break;
+      }
+   }
+}
+
+/**
+ * Convert with the given types and check every channel against conv(),
+ * with zero and one coming from the swizzle.
+ */
+template<typename D, typename S, typename F>
+static void
+check(enum mesa_array_format_datatype dst_type,
+      enum mesa_array_format_datatype src_type, bool normalized,
+      const S *src, D one, F conv)
+{
+   D dst[NUM_PIXELS * 4];
+   unsigned s, i, c;
+
+   for (s = 0; s < ARRAY_SIZE(swizzles); s++) {
+      memset(dst, 0xcd, sizeof(dst));
+      _mesa_swizzle_and_convert(dst, dst_type, 4, src, src_type, 4,
+                                swizzles[s], normalized, NUM_PIXELS);
+
+      for (i = 0; i < NUM_PIXELS; i++) {
+         for (c = 0; c < 4; c++) {
+            const uint8_t swz = swizzles[s][c];
+            D expected;
+
+            if (swz == MESA_FORMAT_SWIZZLE_ZERO)
+               expected = 0;
+            else if (swz == MESA_FORMAT_SWIZZLE_ONE)
+               expected = one;
+            else
+               expected = conv(src[i * 4 + swz]);
+
+            /* Compare bits so NaNs compare equal */
+            ASSERT_EQ(0, memcmp(&expected, &dst[i * 4 + c], sizeof(D)))
+               << "swizzle " << s << " pixel " << i << " channel " << c;
+         }
+      }
+   }
+}
+
+static uint8_t copy_ubyte(uint8_t x) { return x; }
+static float unorm8_to_float(uint8_t x) { return _mesa_unorm_to_float(x, 8); }
+static float ubyte_to_float(uint8_t x) { return x; }
+static uint8_t float_to_unorm8(float x) { return _mesa_float_to_unorm(x, 8); }
+static uint16_t float_to_half(float x) { return _mesa_float_to_half(x); }
+static float half_to_float(uint16_t x) { return _mesa_half_to_float(x); }
+static int8_t unorm8_to_snorm8(uint8_t x) { return _mesa_unorm_to_snorm(x, 8, 8); }
+static uint8_t snorm8_to_unorm8(int8_t x) { return _mesa_snorm_to_unorm(x, 8, 8); }
+
+TEST_F(SwizzleConvert_test, ubyte_to_ubyte)
+{
+   check<uint8_t>(MESA_ARRAY_FORMAT_TYPE_UBYTE, MESA_ARRAY_FORMAT_TYPE_UBYTE,
+                  true, ubytes, (uint8_t) 0xff, copy_ubyte);
+}
+
+TEST_F(SwizzleConvert_test, unorm8_to_float)
+{
+   check<float>(MESA_ARRAY_FORMAT_TYPE_FLOAT, MESA_ARRAY_FORMAT_TYPE_UBYTE,
+                true, ubytes, 1.0f, unorm8_to_float);
+}
+
+TEST_F(SwizzleConvert_test, ubyte_to_float)
+{
+   check<float>(MESA_ARRAY_FORMAT_TYPE_FLOAT, MESA_ARRAY_FORMAT_TYPE_UBYTE,
+                false, ubytes, 1.0f, ubyte_to_float);
+}
+
+TEST_F(SwizzleConvert_test, float_to_unorm8)
+{
+   check<uint8_t>(MESA_ARRAY_FORMAT_TYPE_UBYTE, MESA_ARRAY_FORMAT_TYPE_FLOAT,
+                  true, floats, (uint8_t) 0xff, float_to_unorm8);
+}
+
+TEST_F(SwizzleConvert_test, float_to_half)
+{
+   check<uint16_t>(MESA_ARRAY_FORMAT_TYPE_HALF, MESA_ARRAY_FORMAT_TYPE_FLOAT,
+                   false, floats, (uint16_t) 0x3c00, float_to_half);
+}
+
+TEST_F(SwizzleConvert_test, half_to_float)
+{
+   check<float>(MESA_ARRAY_FORMAT_TYPE_FLOAT, MESA_ARRAY_FORMAT_TYPE_HALF,
+                false, halves, 1.0f, half_to_float);
+}
+
+#ifdef USE_SSE41
+/**
+ * Half denorms are normal floats, so the conversion must not depend on the
+ * denormals-are-zero and flush-to-zero modes.
+ */
+TEST_F(SwizzleConvert_test, half_to_float_daz)
+{
+   const unsigned int csr = _mm_getcsr();
+
+   _mm_setcsr(csr | 0x8040);
+   check<float>(MESA_ARRAY_FORMAT_TYPE_FLOAT, MESA_ARRAY_FORMAT_TYPE_HALF,
+                false, halves, 1.0f, half_to_float);
+   _mm_setcsr(csr);
+}
+#endif
+
+TEST_F(SwizzleConvert_test, unorm8_to_snorm8)
+{
+   check<int8_t>(MESA_ARRAY_FORMAT_TYPE_BYTE, MESA_ARRAY_FORMAT_TYPE_UBYTE,
+                 true, ubytes, (int8_t) 0x7f, unorm8_to_snorm8);
+}
+
+TEST_F(SwizzleConvert_test, snorm8_to_unorm8)
+{
+   check<uint8_t>(MESA_ARRAY_FORMAT_TYPE_UBYTE, MESA_ARRAY_FORMAT_TYPE_BYTE,
+                  true, bytes, (uint8_t) 0xff, snorm8_to_unorm8);
+}
+
+static double
+pixels_per_second(void *dst, enum mesa_array_format_datatype dst_type,
+                  const void *src, enum mesa_array_format_datatype src_type,
+                  bool normalized)
+{
+   const unsigned iterations = 2000;
+   double start = benchmark_seconds();
+   unsigned i;
+
+   for (i = 0; i < iterations; i++)
+      _mesa_swizzle_and_convert(dst, dst_type, 4, src, src_type, 4,
+                                swizzles[1], normalized, NUM_PIXELS);
+
+   return (double) iterations * NUM_PIXELS / (benchmark_seconds() - start);
+}
+
+TEST_F(SwizzleConvert_test, throughput)
+{
+   static const struct {
+      const char *name;
+      enum mesa_array_format_datatype dst_type, src_type;
+      bool normalized;
+   } cases[] = {
+      { "ubyte -> ubyte", MESA_ARRAY_FORMAT_TYPE_UBYTE,
+        MESA_ARRAY_FORMAT_TYPE_UBYTE, true },
+      { "unorm8 -> float", MESA_ARRAY_FORMAT_TYPE_FLOAT,
+        MESA_ARRAY_FORMAT_TYPE_UBYTE, true },
+      { "float -> unorm8", MESA_ARRAY_FORMAT_TYPE_UBYTE,
+        MESA_ARRAY_FORMAT_TYPE_FLOAT, true },
+      { "half -> float", MESA_ARRAY_FORMAT_TYPE_FLOAT,
+        MESA_ARRAY_FORMAT_TYPE_HALF, false },
+      { "float -> half", MESA_ARRAY_FORMAT_TYPE_HALF,
+        MESA_ARRAY_FORMAT_TYPE_FLOAT, false },
+   };
+   float dst[NUM_PIXELS * 4];
+   unsigned i;
+   if (!benchmark_enabled())
+      return;
+
+   for (i = 0; i < ARRAY_SIZE(cases); i++) {
+      const void *src =
+         cases[i].src_type == MESA_ARRAY_FORMAT_TYPE_UBYTE ? (void *) ubytes :
+         cases[i].src_type == MESA_ARRAY_FORMAT_TYPE_HALF ? (void *) halves :
+         (void *) floats;
+      double rate = pixels_per_second(dst, cases[i].dst_type, src,
+                                      cases[i].src_type,
+                                      cases[i].normalized);
+
+#if defined(USE_SSE41) && !defined(__SSE4_1__)
+      /* Also time the C code, if the CPU check can be overridden */
+      int features = _mesa_x86_cpu_features;
+      double c_rate;
+
+      _mesa_x86_cpu_features &= ~X86_FEATURE_SSE4_1;
+      c_rate = pixels_per_second(dst, cases[i].dst_type, src,
+                                 cases[i].src_type, cases[i].normalized);
+      _mesa_x86_cpu_features = features;
+
+      printf("%-16s %8.1f Mpixels/s (C: %8.1f Mpixels/s)\n",
+             cases[i].name, rate / 1e6, c_rate / 1e6);
+#else
+      printf("%-16s %8.1f Mpixels/s\n", cases[i].name, rate / 1e6);
+#endif
+   }
+}
@@ -0,0 +1,325 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \name texcompress_bptc.cpp
+ *
+ * Compress test images to BPTC at each MESA_BPTC_QUALITY, decode them with
+ * the fetch functions and check the PSNR of the result.  With
+ * MESA_TEST_BENCHMARK set, also print it with the number of blocks
+ * compressed per second.
+ */
+
+#include <gtest/gtest.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern "C" {
+#include "main/formats.h"
+#include "main/imports.h"
+#include "main/macros.h"
+#include "main/mtypes.h"
+#include "main/texcompress.h"
+#include "main/texcompress_bptc.h"
+#include "main/texstore.h"
+}
+
+#include "benchmark.h"
+
+/* Not a multiple of the block size, so partial blocks are encoded too */
+#define WIDTH 254
+#define HEIGHT 126
+
+#define N_QUALITIES 3
+
+typedef GLboolean (*store_func)(TEXSTORE_PARAMS);
+
+class TexcompressBptc_test : public ::testing::Test {
+public:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   void compress(mesa_format format, const void *src, GLenum srcFormat,
+                 GLenum srcType, int quality, GLubyte *dst, double *rate);
+
+   struct gl_context *ctx;
+   struct gl_pixelstore_attrib packing;
+};
+
+void
+TexcompressBptc_test::SetUp()
+{
+   unsigned i;
+
+   /* Normally filled in when the first context is created */
+   for (i = 0; i < 256; i++)
+      _mesa_ubyte_to_float_color_tab[i] = (float) i / 255.0F;
+
+   ctx = (struct gl_context *) calloc(1, sizeof(*ctx));
+
+   memset(&packing, 0, sizeof(packing));
+   packing.Alignment = 1;
+}
+
+void
+TexcompressBptc_test::TearDown()
+{
+   unsetenv("MESA_BPTC_QUALITY");
+   free(ctx);
+}
+
+void
+TexcompressBptc_test::compress(mesa_format format, const void *src,
+                               GLenum srcFormat, GLenum srcType, int quality,
+                               GLubyte *dst, double *rate)
+{
+   const int blocks = ((WIDTH + 3) / 4) * ((HEIGHT + 3) / 4);
+   GLubyte *slices[1] = { dst };
+   char value[2] = { (char) ('0' + quality), 0 };
+   store_func store;
+   GLenum baseFormat;
+   GLboolean ret;
+   double start;
+
+   switch (format) {
+   case MESA_FORMAT_BPTC_RGBA_UNORM:
+      store = _mesa_texstore_bptc_rgba_unorm;
+      baseFormat = GL_RGBA;
+      break;
+   case MESA_FORMAT_BPTC_RGB_SIGNED_FLOAT:
+      store = _mesa_texstore_bptc_rgb_signed_float;
+      baseFormat = GL_RGB;
+      break;
+   default:
+      store = _mesa_texstore_bptc_rgb_unsigned_float;
+      baseFormat = GL_RGB;
+      break;
+   }
+
+   /* A negative quality leaves the default */
+   if (quality < 0)
+      unsetenv("MESA_BPTC_QUALITY");
+   else
+      setenv("MESA_BPTC_QUALITY", value, 1);
+
+   start = benchmark_seconds();
+   ret = store(ctx, 2, baseFormat, format,
+               _mesa_format_row_stride(format, WIDTH), slices,
+               WIDTH, HEIGHT, 1, srcFormat, srcType, src, &packing);
+   *rate = blocks / (benchmark_seconds() - start);
+
+   EXPECT_TRUE(ret);
+}
+
+/**
+ * An image with smooth gradients, sharp edges between two or three colors,
+ * and a noisy gradient, in horizontal stripes.
+ */
+static float
+test_texel(int x, int y, int c)
+{
+   switch (y * 4 / HEIGHT) {
+   case 0:
+      return (float) (x * (c + 1) + y * (3 - c)) / (WIDTH * 4);
+   case 1:
+      return ((x / 3 + y / 5 + c) % 3) * 0.4f + 0.1f * c;
+   case 2:
+      return (sinf(x * 0.2f + c) + cosf(y * 0.13f * (c + 1))) * 0.25f + 0.5f;
+   default:
+      return (float) x / WIDTH * 0.8f +
+             ((x * 7919 + y * 104729 + c * 15485863) % 1021) / 5100.0f;
+   }
+}
+
+static double
+psnr(double squared_error, double n, double peak)
+{
+   if (squared_error == 0.0)
+      return INFINITY;
+
+   return 10.0 * log10(peak * peak * n / squared_error);
+}
+
+TEST_F(TexcompressBptc_test, rgba_unorm)
+{
+   compressed_fetch_func fetch =
+      _mesa_get_bptc_fetch_func(MESA_FORMAT_BPTC_RGBA_UNORM);
+   const size_t size = ((WIDTH + 3) / 4) * ((HEIGHT + 3) / 4) * 16;
+   GLubyte *src = (GLubyte *) malloc(WIDTH * HEIGHT * 4);
+   GLubyte *dst = (GLubyte *) malloc(size);
+   double psnrs[N_QUALITIES], rate, error;
+   GLfloat texel[4];
+   int quality, x, y, c;
+
+   for (y = 0; y < HEIGHT; y++) {
+      for (x = 0; x < WIDTH; x++) {
+         for (c = 0; c < 4; c++) {
+            /* Opaque left half, varying alpha on the right */
+            float value = c < 3 ? test_texel(x, y, c) :
+                          x < WIDTH / 2 ? 1.0f : test_texel(y, x, 1);
+            src[(y * WIDTH + x) * 4 + c] = CLAMP(value, 0.0f, 1.0f) * 255;
+         }
+      }
+   }
+
+   for (quality = 0; quality < N_QUALITIES; quality++) {
+      compress(MESA_FORMAT_BPTC_RGBA_UNORM, src, GL_RGBA, GL_UNSIGNED_BYTE,
+               quality, dst, &rate);
+
+      error = 0.0;
+      for (y = 0; y < HEIGHT; y++) {
+         for (x = 0; x < WIDTH; x++) {
+            fetch(dst, WIDTH, x, y, texel);
+            for (c = 0; c < 4; c++) {
+               double diff = texel[c] * 255.0f -
+                             src[(y * WIDTH + x) * 4 + c];
+               error += diff * diff;
+            }
+         }
+      }
+      psnrs[quality] = psnr(error, WIDTH * HEIGHT * 4, 255.0);
+
+      if (benchmark_enabled())
+         printf("RGBA unorm quality %d: %9.0f blocks/s, PSNR %5.2f dB\n",
+                quality, rate, psnrs[quality]);
+   }
+
+   /* Searching the modes and partitions gains a lot over the single mode
+    * encoder, and searching more never makes it worse.
+    */
+   EXPECT_GT(psnrs[1], psnrs[0] + 5.0);
+   EXPECT_GE(psnrs[2], psnrs[1]);
+
+   free(src);
+   free(dst);
+}
+
+/**
+ * The bits of a half float as a signed integer.  Errors of HDR images are
+ * measured on these, which is close to a log scale and is what the encoder
+ * minimizes.
+ */
+static int
+half_position(float value)
+{
+   GLhalfARB half = _mesa_float_to_half(value);
+
+   return (half & 0x8000) ? -(half & 0x7fff) : half;
+}
+
+static void
+check_rgb_float(TexcompressBptc_test *test, mesa_format format,
+                bool is_signed)
+{
+   compressed_fetch_func fetch = _mesa_get_bptc_fetch_func(format);
+   const size_t size = ((WIDTH + 3) / 4) * ((HEIGHT + 3) / 4) * 16;
+   GLfloat *src = (GLfloat *) malloc(WIDTH * HEIGHT * 3 * sizeof(GLfloat));
+   GLubyte *dst = (GLubyte *) malloc(size);
+   double psnrs[N_QUALITIES], rate, error;
+   GLfloat texel[4];
+   int quality, x, y, c;
+
+   /* High dynamic range, and negative for the signed format */
+   for (y = 0; y < HEIGHT; y++) {
+      for (x = 0; x < WIDTH; x++) {
+         for (c = 0; c < 3; c++) {
+            float value = test_texel(x, y, c) * (1 + (x * 16) / WIDTH);
+            if (is_signed)
+               value -= 2.0f;
+            src[(y * WIDTH + x) * 3 + c] = value;
+         }
+      }
+   }
+
+   for (quality = 0; quality < N_QUALITIES; quality++) {
+      test->compress(format, src, GL_RGB, GL_FLOAT, quality, dst, &rate);
+
+      error = 0.0;
+      for (y = 0; y < HEIGHT; y++) {
+         for (x = 0; x < WIDTH; x++) {
+            fetch(dst, WIDTH, x, y, texel);
+            for (c = 0; c < 3; c++) {
+               double diff = half_position(texel[c]) -
+                             half_position(src[(y * WIDTH + x) * 3 + c]);
+               error += diff * diff;
+            }
+         }
+      }
+      psnrs[quality] = psnr(error, WIDTH * HEIGHT * 3, 0x7bff);
+
+      if (benchmark_enabled()) {
+         printf("RGB %s float quality %d: %9.0f blocks/s, PSNR %5.2f dB\n",
+                is_signed ? "signed" : "unsigned", quality, rate,
+                psnrs[quality]);
+      }
+   }
+
+   EXPECT_GT(psnrs[1], psnrs[0] + 10.0);
+   EXPECT_GE(psnrs[2], psnrs[1] - 0.1);
+
+   free(src);
+   free(dst);
+}
+
+TEST_F(TexcompressBptc_test, rgb_unsigned_float)
+{
+   check_rgb_float(this, MESA_FORMAT_BPTC_RGB_UNSIGNED_FLOAT, false);
+}
+
+TEST_F(TexcompressBptc_test, rgb_signed_float)
+{
+   check_rgb_float(this, MESA_FORMAT_BPTC_RGB_SIGNED_FLOAT, true);
+}
+
+/**
+ * Without MESA_BPTC_QUALITY, the fast single mode encoder is used.
+ */
+TEST_F(TexcompressBptc_test, default_quality)
+{
+   const size_t size = ((WIDTH + 3) / 4) * ((HEIGHT + 3) / 4) * 16;
+   GLubyte *src = (GLubyte *) malloc(WIDTH * HEIGHT * 4);
+   GLubyte *fast = (GLubyte *) malloc(size);
+   GLubyte *dst = (GLubyte *) malloc(size);
+   double rate;
+   int x, y, c;
+
+   for (y = 0; y < HEIGHT; y++) {
+      for (x = 0; x < WIDTH; x++) {
+         for (c = 0; c < 4; c++) {
+            float value = c < 3 ? test_texel(x, y, c) : 1.0f;
+            src[(y * WIDTH + x) * 4 + c] = CLAMP(value, 0.0f, 1.0f) * 255;
+         }
+      }
+   }
+
+   compress(MESA_FORMAT_BPTC_RGBA_UNORM, src, GL_RGBA, GL_UNSIGNED_BYTE, 0,
+            fast, &rate);
+   compress(MESA_FORMAT_BPTC_RGBA_UNORM, src, GL_RGBA, GL_UNSIGNED_BYTE, -1,
+            dst, &rate);
+   EXPECT_EQ(0, memcmp(fast, dst, size));
+
+   free(src);
+   free(fast);
+   free(dst);
+}
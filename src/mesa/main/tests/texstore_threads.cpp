@@ -0,0 +1,226 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \name texstore_threads.cpp
+ *
+ * Check that _mesa_texstore() stores the same texels when the image is
+ * split in bands over worker threads, and with MESA_TEST_BENCHMARK set,
+ * print the conversion rate for each number of threads.
+ */
+
+#include <gtest/gtest.h>
+#include <stdlib.h>
+
+extern "C" {
+#include "main/compiler.h"
+#include "main/formats.h"
+#include "main/glformats.h"
+#include "main/image.h"
+#include "main/mtypes.h"
+#include "main/texstore.h"
+#include "main/texstore_threads.h"
+}
+
+#include "benchmark.h"
+#include "context_fixture.h"
+
+class TexstoreThreads_test : public ContextFixture {
+public:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   void *make_source(GLsizei width, GLsizei height, GLsizei depth,
+                     GLenum format, GLenum type);
+   GLubyte *store(GLuint dims, GLenum baseFormat, mesa_format dstFormat,
+                  GLsizei width, GLsizei height, GLsizei depth,
+                  GLenum format, GLenum type, const void *src,
+                  unsigned max_threads);
+   void check(GLuint dims, GLenum baseFormat, mesa_format dstFormat,
+              GLsizei width, GLsizei height, GLsizei depth,
+              GLenum format, GLenum type);
+   void measure(const char *name, GLenum baseFormat, mesa_format dstFormat,
+                GLsizei size, GLenum format, GLenum type);
+
+   struct gl_pixelstore_attrib packing;
+   unsigned num_threads;
+};
+
+void
+TexstoreThreads_test::SetUp()
+{
+   /* Run the bands on threads even without several CPUs */
+   setenv("MESA_TEXSTORE_THREADS", "3", 0);
+
+   create_context(API_OPENGL_COMPAT);
+
+   /* Rows and slices not starting at the beginning of the client image */
+   packing = ctx.DefaultPacking;
+   packing.Alignment = 8;
+   packing.SkipPixels = 3;
+   packing.SkipRows = 5;
+   packing.SkipImages = 1;
+
+   _mesa_texstore_set_max_threads(~0u);
+   num_threads = _mesa_texstore_max_bands() - 1;
+}
+
+void
+TexstoreThreads_test::TearDown()
+{
+   _mesa_texstore_set_max_threads(~0u);
+   ContextFixture::TearDown();
+}
+
+void *
+TexstoreThreads_test::make_source(GLsizei width, GLsizei height,
+                                  GLsizei depth, GLenum format, GLenum type)
+{
+   /* The whole client image, including the skipped rows, images and
+    * pixels.
+    */
+   size_t size = _mesa_image_row_stride(&packing, width, format, type) *
+                 ((depth + 1) * height + 5) +
+                 3 * _mesa_bytes_per_pixel(format, type);
+   GLubyte *src = (GLubyte *) malloc(size);
+
+   srand(7);
+   for (size_t i = 0; i < size; i++)
+      src[i] = rand();
+
+   /* Keep floats in a sane range */
+   if (type == GL_FLOAT) {
+      for (size_t i = 0; i < size / 4; i++)
+         ((float *) src)[i] = (float) (src[i * 4] % 160) / 128.0f - 0.1f;
+   }
+
+   return src;
+}
+
+GLubyte *
+TexstoreThreads_test::store(GLuint dims, GLenum baseFormat,
+                            mesa_format dstFormat,
+                            GLsizei width, GLsizei height, GLsizei depth,
+                            GLenum format, GLenum type, const void *src,
+                            unsigned max_threads)
+{
+   GLint rowStride = _mesa_format_row_stride(dstFormat, width);
+   GLint sliceSize = _mesa_format_image_size(dstFormat, width, height, 1);
+   GLubyte *dst = (GLubyte *) calloc(depth, sliceSize);
+   GLubyte **slices = (GLubyte **) malloc(depth * sizeof(GLubyte *));
+
+   for (GLsizei z = 0; z < depth; z++)
+      slices[z] = dst + z * sliceSize;
+
+   _mesa_texstore_set_max_threads(max_threads);
+   EXPECT_TRUE(_mesa_texstore(&ctx, dims, baseFormat, dstFormat, rowStride,
+                              slices, width, height, depth, format, type,
+                              src, &packing));
+
+   free(slices);
+   return dst;
+}
+
+void
+TexstoreThreads_test::check(GLuint dims, GLenum baseFormat,
+                            mesa_format dstFormat,
+                            GLsizei width, GLsizei height, GLsizei depth,
+                            GLenum format, GLenum type)
+{
+   void *src = make_source(width, height, depth, format, type);
+   GLubyte *expected = store(dims, baseFormat, dstFormat, width, height,
+                             depth, format, type, src, 0);
+   GLubyte *got = store(dims, baseFormat, dstFormat, width, height,
+                        depth, format, type, src, num_threads);
+
+   EXPECT_EQ(0, memcmp(expected, got,
+                       _mesa_format_image_size(dstFormat, width, height,
+                                               depth)));
+
+   free(expected);
+   free(got);
+   free(src);
+}
+
+void
+TexstoreThreads_test::measure(const char *name, GLenum baseFormat,
+                              mesa_format dstFormat, GLsizei size,
+                              GLenum format, GLenum type)
+{
+   void *src = make_source(size, size, 1, format, type);
+   double mb = (double) size * size * _mesa_bytes_per_pixel(format, type) /
+               (1024 * 1024);
+
+   for (unsigned threads = 0; threads <= num_threads; threads++) {
+      double start = benchmark_seconds();
+      GLubyte *dst = store(2, baseFormat, dstFormat, size, size, 1,
+                           format, type, src, threads);
+      double elapsed = benchmark_seconds() - start;
+
+      printf("%-26s %u thread(s): %8.1f MB/s\n", name, threads + 1,
+             mb / elapsed);
+      free(dst);
+   }
+
+   free(src);
+}
+
+TEST_F(TexstoreThreads_test, rows)
+{
+   check(2, GL_RGBA, MESA_FORMAT_R8G8B8A8_UNORM, 1021, 515, 1,
+         GL_RGB, GL_FLOAT);
+   check(2, GL_RGB, MESA_FORMAT_B5G6R5_UNORM, 777, 333, 1,
+         GL_BGRA, GL_UNSIGNED_BYTE);
+}
+
+TEST_F(TexstoreThreads_test, slices)
+{
+   check(3, GL_RGBA, MESA_FORMAT_R8G8B8A8_UNORM, 130, 70, 9,
+         GL_RGBA, GL_UNSIGNED_SHORT);
+   /* Fewer slices than bands */
+   check(3, GL_RGBA, MESA_FORMAT_RGBA_FLOAT16, 301, 157, 2,
+         GL_RGBA, GL_FLOAT);
+}
+
+TEST_F(TexstoreThreads_test, compressed)
+{
+   /* The RGTC encoder leaves the texels outside partial blocks undefined */
+   check(2, GL_RED, MESA_FORMAT_R_RGTC1_UNORM, 1024, 516, 1,
+         GL_RED, GL_UNSIGNED_BYTE);
+   /* A height that is not a multiple of the block height */
+   check(2, GL_RGBA, MESA_FORMAT_BPTC_RGBA_UNORM, 258, 254, 1,
+         GL_RGBA, GL_UNSIGNED_BYTE);
+}
+
+TEST_F(TexstoreThreads_test, throughput)
+{
+   if (!benchmark_enabled())
+      return;
+
+   measure("RGB float -> RGBA8", GL_RGBA, MESA_FORMAT_R8G8B8A8_UNORM, 2048,
+           GL_RGB, GL_FLOAT);
+   measure("RG ubyte -> RGTC2", GL_RG, MESA_FORMAT_RG_RGTC2_UNORM, 2048,
+           GL_RG, GL_UNSIGNED_BYTE);
+   measure("RGBA ubyte -> BPTC", GL_RGBA, MESA_FORMAT_BPTC_RGBA_UNORM, 512,
+           GL_RGBA, GL_UNSIGNED_BYTE);
+}
@@ -0,0 +1,192 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \name uniform_fast_path.cpp
+ *
+ * Check that glUniform calls taking the fast path of _mesa_uniform() still
+ * reach the driver storage and that mismatched calls still fail.  With
+ * MESA_TEST_BENCHMARK set, print the number of calls per second for
+ * changing and unchanged values.
+ */
+
+#include <gtest/gtest.h>
+
+extern "C" {
+#include "main/compiler.h"
+#include "main/shaderobj.h"
+#include "main/uniforms.h"
+}
+
+#include "glsl/glsl_types.h"
+#include "glsl/ir.h"
+#include "glsl/ir_uniform.h"
+#include "glsl/linker.h"
+
+#include "benchmark.h"
+#include "context_fixture.h"
+
+#define NUM_OFFSETS 8
+
+class UniformFastPath_test : public ContextFixture {
+public:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   struct gl_shader_program *prog;
+
+   /* What the driver sees: vec4 color, vec2 offsets[NUM_OFFSETS] */
+   float driver_color[4];
+   float driver_offsets[NUM_OFFSETS][2];
+};
+
+void
+UniformFastPath_test::SetUp()
+{
+   memset(driver_color, 0, sizeof(driver_color));
+   memset(driver_offsets, 0, sizeof(driver_offsets));
+
+   create_context(API_OPENGL_CORE);
+
+   /* What the linker would leave behind */
+   prog = ctx.Driver.NewShaderProgram(0);
+   prog->LinkStatus = GL_TRUE;
+   prog->NumUserUniformStorage = 2;
+   prog->UniformStorage =
+      rzalloc_array(prog, struct gl_uniform_storage, 2);
+
+   struct gl_uniform_storage *color = &prog->UniformStorage[0];
+   color->name = ralloc_strdup(prog, "color");
+   color->type = glsl_type::vec4_type;
+   color->storage = rzalloc_array(prog, union gl_constant_value, 4);
+   color->remap_location = 0;
+
+   struct gl_uniform_storage *offsets = &prog->UniformStorage[1];
+   offsets->name = ralloc_strdup(prog, "offsets");
+   offsets->type = glsl_type::vec2_type;
+   offsets->array_elements = NUM_OFFSETS;
+   offsets->storage =
+      rzalloc_array(prog, union gl_constant_value, 2 * NUM_OFFSETS);
+   offsets->remap_location = 1;
+
+   _mesa_uniform_attach_driver_storage(color, 0, 0, uniform_native,
+                                       driver_color);
+   _mesa_uniform_attach_driver_storage(offsets, sizeof(driver_offsets[0]), 0,
+                                       uniform_native, driver_offsets);
+
+   prog->NumUniformRemapTable = 1 + NUM_OFFSETS;
+   prog->UniformRemapTable =
+      rzalloc_array(prog, struct gl_uniform_storage *,
+                    prog->NumUniformRemapTable);
+   prog->UniformRemapTable[0] = color;
+   for (unsigned i = 0; i < NUM_OFFSETS; i++)
+      prog->UniformRemapTable[1 + i] = offsets;
+
+   link_build_uniform_descriptors(prog);
+}
+
+void
+UniformFastPath_test::TearDown()
+{
+   _mesa_free_shader_program_data(&ctx, prog);
+   ralloc_free(prog);
+   ContextFixture::TearDown();
+}
+
+TEST_F(UniformFastPath_test, values_reach_driver_storage)
+{
+   const float color[4] = { 0.25f, 0.5f, 0.75f, 1.0f };
+   const float offsets[3][2] = { { 1, 2 }, { 3, 4 }, { 5, 6 } };
+
+   /* Built with the remap table, not by the first glUniform call */
+   ASSERT_TRUE(prog->UniformDescriptors != NULL);
+
+   _mesa_uniform(&ctx, prog, 0, 1, color, GLSL_TYPE_FLOAT, 4);
+   EXPECT_EQ(GL_NO_ERROR, ctx.ErrorValue);
+   EXPECT_EQ(0, memcmp(color, driver_color, sizeof(color)));
+   EXPECT_TRUE(prog->UniformStorage[0].initialized);
+
+   /* offsets[2..4] */
+   _mesa_uniform(&ctx, prog, 3, 3, offsets, GLSL_TYPE_FLOAT, 2);
+   EXPECT_EQ(GL_NO_ERROR, ctx.ErrorValue);
+   EXPECT_EQ(0, memcmp(offsets, driver_offsets[2], sizeof(offsets)));
+   EXPECT_EQ(0.0f, driver_offsets[1][1]);
+   EXPECT_EQ(0.0f, driver_offsets[5][0]);
+
+   /* Past the end of the array is clamped by the full path */
+   _mesa_uniform(&ctx, prog, NUM_OFFSETS, 3, offsets, GLSL_TYPE_FLOAT, 2);
+   EXPECT_EQ(GL_NO_ERROR, ctx.ErrorValue);
+   EXPECT_EQ(0, memcmp(offsets[0], driver_offsets[NUM_OFFSETS - 1],
+                       sizeof(offsets[0])));
+}
+
+TEST_F(UniformFastPath_test, mismatches_still_fail)
+{
+   const GLint ivalues[4] = { 1, 2, 3, 4 };
+   const float values[4] = { 1, 2, 3, 4 };
+
+   _mesa_uniform(&ctx, prog, 0, 1, ivalues, GLSL_TYPE_INT, 4);
+   EXPECT_EQ(GL_INVALID_OPERATION, ctx.ErrorValue);
+   ctx.ErrorValue = GL_NO_ERROR;
+
+   _mesa_uniform(&ctx, prog, 0, 1, values, GLSL_TYPE_FLOAT, 3);
+   EXPECT_EQ(GL_INVALID_OPERATION, ctx.ErrorValue);
+   ctx.ErrorValue = GL_NO_ERROR;
+
+   _mesa_uniform(&ctx, prog, 0, 2, values, GLSL_TYPE_FLOAT, 4);
+   EXPECT_EQ(GL_INVALID_OPERATION, ctx.ErrorValue);
+   ctx.ErrorValue = GL_NO_ERROR;
+
+   _mesa_uniform(&ctx, prog, 1 + NUM_OFFSETS, 1, values, GLSL_TYPE_FLOAT, 4);
+   EXPECT_EQ(GL_INVALID_OPERATION, ctx.ErrorValue);
+   ctx.ErrorValue = GL_NO_ERROR;
+
+   EXPECT_EQ(0.0f, driver_color[0]);
+}
+
+TEST_F(UniformFastPath_test, calls_per_second)
+{
+   const unsigned iterations = 1000000;
+   float color[4] = { 0, 0, 0, 1 };
+   double start, changed, unchanged;
+   if (!benchmark_enabled())
+      return;
+
+   start = benchmark_seconds();
+   for (unsigned i = 0; i < iterations; i++) {
+      color[0] = (float) i;
+      _mesa_uniform(&ctx, prog, 0, 1, color, GLSL_TYPE_FLOAT, 4);
+   }
+   changed = benchmark_seconds() - start;
+
+   start = benchmark_seconds();
+   for (unsigned i = 0; i < iterations; i++)
+      _mesa_uniform(&ctx, prog, 0, 1, color, GLSL_TYPE_FLOAT, 4);
+   unchanged = benchmark_seconds() - start;
+
+   EXPECT_EQ(GL_NO_ERROR, ctx.ErrorValue);
+   EXPECT_EQ(color[0], driver_color[0]);
+
+   printf("glUniform4fv: %.1f M calls/s changing, %.1f M calls/s unchanged\n",
+          iterations / changed * 1e-6, iterations / unchanged * 1e-6);
+}
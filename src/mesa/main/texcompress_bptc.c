@@ -27,6 +27,7 @@
  */
 
 #include <stdbool.h>
+#include <float.h>
 #include "texcompress.h"
 #include "texcompress_bptc.h"
 #include "util/format_srgb.h"
@@ -34,6 +35,10 @@
 #include "macros.h"
 #include "image.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #define BLOCK_SIZE 4
 #define N_PARTITIONS 64
 #define BLOCK_BYTES 16
@@ -498,21 +503,22 @@ count_anchors_before_texel(int n_subsets,
    return count;
 }
 
+static const uint8_t weights2[] = { 0, 21, 43, 64 };
+static const uint8_t weights3[] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+static const uint8_t weights4[] =
+   { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+static const uint8_t *interpolation_weights[] = {
+   NULL, NULL, weights2, weights3, weights4
+};
+
 static int32_t
 interpolate(int32_t a, int32_t b,
             int index,
             int index_bits)
 {
-   static const uint8_t weights2[] = { 0, 21, 43, 64 };
-   static const uint8_t weights3[] = { 0, 9, 18, 27, 37, 46, 55, 64 };
-   static const uint8_t weights4[] =
-      { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
-   static const uint8_t *weights[] = {
-      NULL, NULL, weights2, weights3, weights4
-   };
    int weight;
 
-   weight = weights[index_bits][index];
+   weight = interpolation_weights[index_bits][index];
 
    return ((64 - weight) * a + weight * b + 32) >> 6;
 }
@@ -1245,10 +1251,911 @@ compress_rgba_unorm_block(int src_width, int src_height,
                              endpoints);
 }
 
+/* The encoders below are an opt-in high-quality mode for applications
+ * and tools that can afford slow compression.  They search several modes
+ * and partitions for each block and keep the encoding with the smallest
+ * error.  MESA_BPTC_QUALITY chooses how much they search:
+ *
+ *  0: the single mode encoders above, fastest but lowest quality
+ *  1: the modes that suit the block, with its most promising partitions
+ *  2: every mode, more partitions and refined endpoints
+ *
+ * The default stays 0: searching is two orders of magnitude slower, which
+ * is too slow for images compressed when glTexImage is called.
+ */
+enum bptc_quality {
+   BPTC_QUALITY_FAST,
+   BPTC_QUALITY_NORMAL,
+   BPTC_QUALITY_BEST
+};
+
+/* How many of the partitions ranked by rank_partitions() are encoded for
+ * each quality, for two and three subsets.
+ */
+static const int
+n_tried_partitions[][2] = {
+   { 0, 0 },
+   { 4, 0 },
+   { 16, 8 }
+};
+
+struct bptc_unorm_encoding {
+   int mode_num;
+   int partition_num;
+   uint8_t endpoints[3 * 2][4];  /**< quantized, without the p-bits */
+   uint8_t pbits[3 * 2];
+   uint8_t decoded[3 * 2][4];    /**< the endpoints expanded to bytes */
+   uint8_t indices[2][BLOCK_SIZE * BLOCK_SIZE];
+   uint32_t error;
+};
+
+struct unorm_block_texels {
+   uint8_t bytes[BLOCK_SIZE * BLOCK_SIZE][4];
+   float floats[BLOCK_SIZE * BLOCK_SIZE][4];
+   bool opaque;
+};
+
+static enum bptc_quality
+get_bptc_quality(void)
+{
+   const char *quality = getenv("MESA_BPTC_QUALITY");
+
+   if (!quality)
+      return BPTC_QUALITY_FAST;
+
+   return CLAMP(atoi(quality), BPTC_QUALITY_FAST, BPTC_QUALITY_BEST);
+}
+
+static uint32_t
+get_subset_texels(int n_subsets, int partition_num, int subset)
+{
+   uint32_t subsets, mask = 0;
+   int texel;
+
+   switch (n_subsets) {
+   case 1:
+      return 0xffff;
+   case 2:
+      subsets = partition_table1[partition_num];
+      break;
+   default:
+      subsets = partition_table2[partition_num];
+      break;
+   }
+
+   for (texel = 0; texel < BLOCK_SIZE * BLOCK_SIZE; texel++) {
+      if (((subsets >> (texel * 2)) & 3) == subset)
+         mask |= 1 << texel;
+   }
+
+   return mask;
+}
+
+static int
+get_anchor_texel(int n_subsets, int partition_num, int subset)
+{
+   if (subset == 0)
+      return 0;
+   else if (n_subsets == 2)
+      return anchor_indices[0][partition_num];
+   else
+      return anchor_indices[subset][partition_num];
+}
+
+/**
+ * Fit a line through the texels of a subset, along the principal axis of
+ * the texels found with a few power iterations on their covariance matrix.
+ * The endpoints are the extremes of the texels projected on the line.
+ * Returns the sum of the squared distances of the texels to the line, which
+ * tells how well the subset can be encoded.
+ */
+static float
+fit_line(const float texels[][4], uint32_t mask, int n_components,
+         float endpoints[2][4])
+{
+   float mean[4] = { 0.0f }, covariance[4][4] = { { 0.0f } };
+   float axis[4], product[4], diff[4], low[4], high[4];
+   float t, t_min = FLT_MAX, t_max = -FLT_MAX;
+   float length, total = 0.0f, along = 0.0f;
+   uint32_t m;
+   int n_texels = 0, texel, i, j, iteration;
+
+   for (i = 0; i < 4; i++) {
+      low[i] = FLT_MAX;
+      high[i] = -FLT_MAX;
+   }
+
+   for (m = mask; m; m &= m - 1) {
+      texel = ffs(m) - 1;
+      for (i = 0; i < 4; i++) {
+         mean[i] += texels[texel][i];
+         low[i] = MIN2(low[i], texels[texel][i]);
+         high[i] = MAX2(high[i], texels[texel][i]);
+      }
+      n_texels++;
+   }
+
+   if (n_texels == 0)
+      return 0.0f;
+
+   for (i = 0; i < 4; i++)
+      mean[i] /= n_texels;
+
+   for (m = mask; m; m &= m - 1) {
+      texel = ffs(m) - 1;
+      for (i = 0; i < n_components; i++)
+         diff[i] = texels[texel][i] - mean[i];
+      for (i = 0; i < n_components; i++) {
+         for (j = 0; j < n_components; j++)
+            covariance[i][j] += diff[i] * diff[j];
+         total += diff[i] * diff[i];
+      }
+   }
+
+   /* Start from the covariances with the component that varies most,
+    * scaled down so that the float texels of BPTC_FLOAT do not overflow.
+    */
+   j = 0;
+   for (i = 1; i < n_components; i++) {
+      if (covariance[i][i] > covariance[j][j])
+         j = i;
+   }
+   for (i = 0; i < 4; i++) {
+      axis[i] = covariance[j][j] > 0.0f ?
+                covariance[i][j] / covariance[j][j] : 0.0f;
+   }
+
+   for (iteration = 0; iteration < 4; iteration++) {
+      length = 0.0f;
+      for (i = 0; i < n_components; i++) {
+         product[i] = 0.0f;
+         for (j = 0; j < n_components; j++)
+            product[i] += covariance[i][j] * axis[j];
+         length += product[i] * product[i];
+      }
+
+      if (length < 1e-12f)
+         break;
+
+      length = 1.0f / sqrtf(length);
+      for (i = 0; i < n_components; i++)
+         axis[i] = product[i] * length;
+   }
+
+   length = 0.0f;
+   for (i = 0; i < n_components; i++)
+      length += axis[i] * axis[i];
+   length = length > 1e-12f ? 1.0f / sqrtf(length) : 0.0f;
+   for (i = 0; i < n_components; i++)
+      axis[i] *= length;
+
+   for (m = mask; m; m &= m - 1) {
+      texel = ffs(m) - 1;
+      t = 0.0f;
+      for (i = 0; i < n_components; i++)
+         t += (texels[texel][i] - mean[i]) * axis[i];
+      t_min = MIN2(t_min, t);
+      t_max = MAX2(t_max, t);
+      along += t * t;
+   }
+
+   /* Keep the endpoints within the bounding box of the texels */
+   for (i = 0; i < 4; i++) {
+      if (i < n_components) {
+         endpoints[0][i] = CLAMP(mean[i] + axis[i] * t_min, low[i], high[i]);
+         endpoints[1][i] = CLAMP(mean[i] + axis[i] * t_max, low[i], high[i]);
+      } else {
+         endpoints[0][i] = endpoints[1][i] = mean[i];
+      }
+   }
+
+   return MAX2(total - along, 0.0f);
+}
+
+/**
+ * Refit the endpoints of a subset to the chosen indices by least squares.
+ * Returns false if the texels all use the same weight.
+ */
+static bool
+refine_endpoints(const float texels[][4], uint32_t mask,
+                 const uint8_t *indices, int index_bits,
+                 float endpoints[2][4])
+{
+   float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+   float ax[4] = { 0.0f }, bx[4] = { 0.0f };
+   float a, b, det;
+   uint32_t m;
+   int texel, i;
+
+   for (m = mask; m; m &= m - 1) {
+      texel = ffs(m) - 1;
+      b = interpolation_weights[index_bits][indices[texel]] / 64.0f;
+      a = 1.0f - b;
+      aa += a * a;
+      ab += a * b;
+      bb += b * b;
+      for (i = 0; i < 4; i++) {
+         ax[i] += a * texels[texel][i];
+         bx[i] += b * texels[texel][i];
+      }
+   }
+
+   det = aa * bb - ab * ab;
+   if (det < 1e-6f)
+      return false;
+
+   det = 1.0f / det;
+   for (i = 0; i < 4; i++) {
+      endpoints[0][i] = (ax[i] * bb - bx[i] * ab) * det;
+      endpoints[1][i] = (bx[i] * aa - ax[i] * ab) * det;
+   }
+
+   return true;
+}
+
+/**
+ * The sum of the squared distances of the texels in mask to the line
+ * through them that fits best, from the sums of the texels and of their
+ * pairwise products.  This is what fit_line() returns, without the
+ * endpoints.
+ */
+static float
+line_residual(const double moments[16][14], uint32_t mask, int n_components)
+{
+   double sums[14] = { 0.0 }, covariance[4][4];
+   double axis[4], product[4], total = 0.0, along = 0.0, length;
+   uint32_t m;
+   int n_texels = 0, texel, i, j, k, iteration;
+
+   for (m = mask; m; m &= m - 1) {
+      texel = ffs(m) - 1;
+      for (i = 0; i < 14; i++)
+         sums[i] += moments[texel][i];
+      n_texels++;
+   }
+
+   if (n_texels == 0)
+      return 0.0f;
+
+   k = 4;
+   for (i = 0; i < n_components; i++) {
+      for (j = i; j < n_components; j++) {
+         covariance[i][j] = covariance[j][i] =
+            sums[k++] - sums[i] * sums[j] / n_texels;
+      }
+      total += covariance[i][i];
+   }
+
+   /* Power iteration from the covariances with the component that varies
+    * most, like fit_line().
+    */
+   k = 0;
+   for (i = 1; i < n_components; i++) {
+      if (covariance[i][i] > covariance[k][k])
+         k = i;
+   }
+   for (i = 0; i < n_components; i++)
+      axis[i] = covariance[i][k];
+
+   for (iteration = 0; iteration < 4; iteration++) {
+      length = 0.0;
+      for (i = 0; i < n_components; i++) {
+         product[i] = 0.0;
+         for (j = 0; j < n_components; j++)
+            product[i] += covariance[i][j] * axis[j];
+         length += product[i] * product[i];
+      }
+
+      if (length <= 0.0)
+         return 0.0f;
+
+      length = 1.0 / sqrt(length);
+      for (i = 0; i < n_components; i++)
+         axis[i] = product[i] * length;
+   }
+
+   /* The variance along the axis */
+   for (i = 0; i < n_components; i++) {
+      for (j = 0; j < n_components; j++)
+         along += axis[i] * covariance[i][j] * axis[j];
+   }
+
+   return MAX2(total - along, 0.0);
+}
+
+/**
+ * Find the partitions whose subsets lie closest to lines, which are the
+ * most promising ones to encode.  Returns how many were put in best.
+ */
+static int
+rank_partitions(const float texels[][4], int n_subsets, int n_partitions,
+                int n_components, int n_best, int *best)
+{
+   double moments[16][14];
+   float best_error[N_PARTITIONS], error;
+   uint32_t mask;
+   int count = 0, partition_num, subset, texel, i, j, k;
+
+   /* The texels and their products, summed over each subset below */
+   for (texel = 0; texel < 16; texel++) {
+      k = 4;
+      for (i = 0; i < 4; i++)
+         moments[texel][i] = texels[texel][i];
+      for (i = 0; i < n_components; i++) {
+         for (j = i; j < n_components; j++)
+            moments[texel][k++] = (double) texels[texel][i] * texels[texel][j];
+      }
+      for (; k < 14; k++)
+         moments[texel][k] = 0.0;
+   }
+
+   for (partition_num = 0; partition_num < n_partitions; partition_num++) {
+      error = 0.0f;
+      for (subset = 0; subset < n_subsets; subset++) {
+         mask = get_subset_texels(n_subsets, partition_num, subset);
+         error += line_residual(moments, mask, n_components);
+      }
+
+      /* Insertion sort into the list of the best ones */
+      if (count < n_best)
+         i = count++;
+      else if (n_best > 0 && error < best_error[n_best - 1])
+         i = n_best - 1;
+      else
+         continue;
+
+      for (; i > 0 && best_error[i - 1] > error; i--) {
+         best_error[i] = best_error[i - 1];
+         best[i] = best[i - 1];
+      }
+      best_error[i] = error;
+      best[i] = partition_num;
+   }
+
+   return count;
+}
+
+/**
+ * Find the n_bits value that, together with the p-bit if there is one (pbit
+ * is -1 otherwise), expands to the byte closest to value.
+ */
+static uint8_t
+quantize_unorm(float value, int n_bits, int pbit, uint8_t *decoded)
+{
+   int total_bits = n_bits + (pbit >= 0);
+   int max = (1 << n_bits) - 1;
+   float scaled, error, best_error = FLT_MAX;
+   int guess, q, best = 0;
+   uint8_t expanded;
+
+   value = CLAMP(value, 0.0f, 255.0f);
+   scaled = value * ((1 << total_bits) - 1) / 255.0f;
+   if (pbit >= 0)
+      scaled = (scaled - pbit) / 2.0f;
+   guess = CLAMP((int) (scaled + 0.5f), 0, max);
+
+   for (q = MAX2(guess - 1, 0); q <= MIN2(guess + 1, max); q++) {
+      expanded = expand_component(pbit >= 0 ? q << 1 | pbit : q, total_bits);
+      error = fabsf(expanded - value);
+      if (error < best_error) {
+         best_error = error;
+         best = q;
+         *decoded = expanded;
+      }
+   }
+
+   return best;
+}
+
+/**
+ * Quantize the endpoints of a subset for the mode, with the p-bits that
+ * bring them closest to the given ones.
+ */
+static void
+quantize_unorm_endpoints(const struct bptc_unorm_mode *mode,
+                         float endpoints[2][4],
+                         struct bptc_unorm_encoding *enc,
+                         int subset)
+{
+   int n_components = mode->n_alpha_bits ? 4 : 3;
+   int n_pbit_values = (mode->has_endpoint_pbits ||
+                        mode->has_shared_pbits) ? 2 : 1;
+   uint8_t quantized[2][2][4], decoded[2][2][4];
+   float error[2][2] = { { 0.0f } }, diff;
+   int pbit, endpoint, component, n_bits;
+
+   for (pbit = 0; pbit < n_pbit_values; pbit++) {
+      for (endpoint = 0; endpoint < 2; endpoint++) {
+         for (component = 0; component < n_components; component++) {
+            n_bits = component < 3 ? mode->n_color_bits : mode->n_alpha_bits;
+            quantized[pbit][endpoint][component] =
+               quantize_unorm(endpoints[endpoint][component], n_bits,
+                              n_pbit_values > 1 ? pbit : -1,
+                              &decoded[pbit][endpoint][component]);
+            diff = decoded[pbit][endpoint][component] -
+                   endpoints[endpoint][component];
+            error[pbit][endpoint] += diff * diff;
+         }
+      }
+   }
+
+   for (endpoint = 0; endpoint < 2; endpoint++) {
+      if (mode->has_shared_pbits)
+         pbit = error[1][0] + error[1][1] < error[0][0] + error[0][1];
+      else if (mode->has_endpoint_pbits)
+         pbit = error[1][endpoint] < error[0][endpoint];
+      else
+         pbit = 0;
+
+      memcpy(enc->endpoints[subset * 2 + endpoint],
+             quantized[pbit][endpoint], 4);
+      memcpy(enc->decoded[subset * 2 + endpoint],
+             decoded[pbit][endpoint], 4);
+      if (n_components == 3)
+         enc->decoded[subset * 2 + endpoint][3] = 255;
+      enc->pbits[subset * 2 + endpoint] = pbit;
+   }
+}
+
+static void
+make_unorm_palette(const uint8_t endpoint0[4], const uint8_t endpoint1[4],
+                   int index_bits, uint8_t palette[][4])
+{
+   int index, component;
+
+   for (index = 0; index < (1 << index_bits); index++) {
+      for (component = 0; component < 4; component++) {
+         palette[index][component] = interpolate(endpoint0[component],
+                                                 endpoint1[component],
+                                                 index, index_bits);
+      }
+   }
+}
+
+#if defined(__SSE2__)
+static inline __m128i
+min_epi32_sse2(__m128i a, __m128i b)
+{
+   __m128i less = _mm_cmplt_epi32(a, b);
+
+   return _mm_or_si128(_mm_and_si128(less, a), _mm_andnot_si128(less, b));
+}
+#endif
+
+/**
+ * Pick the closest palette entry for each texel in mask, comparing the
+ * first n_components components.  Returns the sum of the squared errors.
+ */
+static uint32_t
+pick_unorm_indices(const uint8_t texels[][4], uint32_t mask,
+                   const uint8_t palette[][4], int n_entries,
+                   int n_components, uint8_t *indices)
+{
+   uint32_t error = 0;
+   int texel, i;
+#if defined(__SSE2__)
+   const int alpha_mask = n_components == 4 ? 0xff : 0;
+   const uint8_t *p0, *p1, *p2, *p3, *t;
+   __m128i rg[4], ba[4], t_rg, t_ba, diff, dist, key, best;
+   int last = n_entries - 1;
+
+   /* Four entries per register, with the red and green or the blue and
+    * alpha of an entry in a 32-bit lane so that _mm_madd_epi16() adds their
+    * squares.  Short palettes are padded with the last entry, which never
+    * wins a tie.
+    */
+   for (i = 0; i < n_entries; i += 4) {
+      p0 = palette[i];
+      p1 = palette[MIN2(i + 1, last)];
+      p2 = palette[MIN2(i + 2, last)];
+      p3 = palette[MIN2(i + 3, last)];
+      rg[i / 4] = _mm_setr_epi16(p0[0], p0[1], p1[0], p1[1],
+                                 p2[0], p2[1], p3[0], p3[1]);
+      ba[i / 4] = _mm_setr_epi16(p0[2], p0[3] & alpha_mask,
+                                 p1[2], p1[3] & alpha_mask,
+                                 p2[2], p2[3] & alpha_mask,
+                                 p3[2], p3[3] & alpha_mask);
+   }
+
+   for (; mask; mask &= mask - 1) {
+      texel = ffs(mask) - 1;
+      t = texels[texel];
+      t_rg = _mm_set1_epi32(t[0] | t[1] << 16);
+      t_ba = _mm_set1_epi32(t[2] | (t[3] & alpha_mask) << 16);
+      best = _mm_set1_epi32(INT32_MAX);
+
+      for (i = 0; i < n_entries; i += 4) {
+         diff = _mm_sub_epi16(rg[i / 4], t_rg);
+         dist = _mm_madd_epi16(diff, diff);
+         diff = _mm_sub_epi16(ba[i / 4], t_ba);
+         dist = _mm_add_epi32(dist, _mm_madd_epi16(diff, diff));
+
+         /* The distance in the top bits and the entry in the bottom four,
+          * so the smallest key is the closest entry.
+          */
+         key = _mm_or_si128(_mm_slli_epi32(dist, 4),
+                            _mm_setr_epi32(i, i + 1, i + 2, i + 3));
+         best = min_epi32_sse2(best, key);
+      }
+
+      best = min_epi32_sse2(best, _mm_shuffle_epi32(best,
+                                                    _MM_SHUFFLE(1, 0, 3, 2)));
+      best = min_epi32_sse2(best, _mm_shuffle_epi32(best,
+                                                    _MM_SHUFFLE(2, 3, 0, 1)));
+      i = _mm_cvtsi128_si32(best);
+      indices[texel] = i & 0xf;
+      error += i >> 4;
+   }
+#else
+   uint32_t dist, best_dist;
+   int component, diff;
+
+   for (; mask; mask &= mask - 1) {
+      texel = ffs(mask) - 1;
+      best_dist = UINT32_MAX;
+
+      for (i = 0; i < n_entries; i++) {
+         dist = 0;
+         for (component = 0; component < n_components; component++) {
+            diff = palette[i][component] - texels[texel][component];
+            dist += diff * diff;
+         }
+         if (dist < best_dist) {
+            best_dist = dist;
+            indices[texel] = i;
+         }
+      }
+
+      error += best_dist;
+   }
+#endif
+
+   return error;
+}
+
+static uint32_t
+pick_alpha_indices(const uint8_t texels[][4], const uint8_t palette[][4],
+                   int n_entries, uint8_t *indices)
+{
+   uint32_t error = 0, dist, best_dist;
+   int texel, i, diff;
+
+   for (texel = 0; texel < BLOCK_SIZE * BLOCK_SIZE; texel++) {
+      best_dist = UINT32_MAX;
+
+      for (i = 0; i < n_entries; i++) {
+         diff = palette[i][3] - texels[texel][3];
+         dist = diff * diff;
+         if (dist < best_dist) {
+            best_dist = dist;
+            indices[texel] = i;
+         }
+      }
+
+      error += best_dist;
+   }
+
+   return error;
+}
+
+/**
+ * Swap the endpoints of a subset, or only the given components, and flip
+ * the indices to match.  The palette is symmetric so this gives the same
+ * texels, and is how the top bit of the anchor indices is kept clear.
+ */
+static void
+swap_unorm_endpoints(struct bptc_unorm_encoding *enc, int subset,
+                     int first_component, int n_components,
+                     int index_set, int index_bits, uint32_t mask)
+{
+   uint8_t *e0 = enc->endpoints[subset * 2];
+   uint8_t *e1 = enc->endpoints[subset * 2 + 1];
+   uint8_t *d0 = enc->decoded[subset * 2];
+   uint8_t *d1 = enc->decoded[subset * 2 + 1];
+   uint8_t t;
+   int component, texel;
+
+   for (component = first_component;
+        component < first_component + n_components;
+        component++) {
+      t = e0[component];
+      e0[component] = e1[component];
+      e1[component] = t;
+      t = d0[component];
+      d0[component] = d1[component];
+      d1[component] = t;
+   }
+
+   if (first_component == 0) {
+      t = enc->pbits[subset * 2];
+      enc->pbits[subset * 2] = enc->pbits[subset * 2 + 1];
+      enc->pbits[subset * 2 + 1] = t;
+   }
+
+   for (; mask; mask &= mask - 1) {
+      texel = ffs(mask) - 1;
+      enc->indices[index_set][texel] =
+         (1 << index_bits) - 1 - enc->indices[index_set][texel];
+   }
+}
+
+static uint32_t
+encode_unorm_subset(const struct unorm_block_texels *block,
+                    const struct bptc_unorm_mode *mode,
+                    struct bptc_unorm_encoding *enc,
+                    int subset, uint32_t mask, int anchor,
+                    float endpoints[2][4])
+{
+   uint8_t palette[16][4];
+   uint32_t error;
+
+   quantize_unorm_endpoints(mode, endpoints, enc, subset);
+   make_unorm_palette(enc->decoded[subset * 2], enc->decoded[subset * 2 + 1],
+                      mode->n_index_bits, palette);
+   error = pick_unorm_indices(block->bytes, mask, palette,
+                              1 << mode->n_index_bits,
+                              mode->n_alpha_bits ? 4 : 3,
+                              enc->indices[0]);
+
+   if (enc->indices[0][anchor] >> (mode->n_index_bits - 1)) {
+      swap_unorm_endpoints(enc, subset, 0, 4, 0, mode->n_index_bits, mask);
+   }
+
+   return error;
+}
+
+/**
+ * Encode the block with a mode whose color and alpha share the indices.
+ */
+static void
+encode_unorm_partition(const struct unorm_block_texels *block,
+                       int mode_num, int partition_num,
+                       enum bptc_quality quality,
+                       struct bptc_unorm_encoding *enc)
+{
+   const struct bptc_unorm_mode *mode = bptc_unorm_modes + mode_num;
+   struct bptc_unorm_encoding refined;
+   float endpoints[2][4];
+   uint32_t mask, error, refined_error;
+   int subset, anchor;
+
+   enc->mode_num = mode_num;
+   enc->partition_num = partition_num;
+   enc->error = 0;
+
+   for (subset = 0; subset < mode->n_subsets; subset++) {
+      mask = get_subset_texels(mode->n_subsets, partition_num, subset);
+      anchor = get_anchor_texel(mode->n_subsets, partition_num, subset);
+
+      fit_line(block->floats, mask, mode->n_alpha_bits ? 4 : 3, endpoints);
+      error = encode_unorm_subset(block, mode, enc, subset, mask, anchor,
+                                  endpoints);
+
+      if (quality == BPTC_QUALITY_BEST && error > 0 &&
+          refine_endpoints(block->floats, mask, enc->indices[0],
+                           mode->n_index_bits, endpoints)) {
+         refined = *enc;
+         refined_error = encode_unorm_subset(block, mode, &refined, subset,
+                                             mask, anchor, endpoints);
+         if (refined_error < error) {
+            *enc = refined;
+            error = refined_error;
+         }
+      }
+
+      enc->error += error;
+   }
+}
+
+/**
+ * Encode the block with mode 4 or 5, which have separate indices for the
+ * color and the alpha.  The encoder does not rotate the components and
+ * always uses the first indices for the color.
+ */
+static void
+encode_unorm_separate_alpha(const struct unorm_block_texels *block,
+                            int mode_num,
+                            struct bptc_unorm_encoding *enc)
+{
+   const struct bptc_unorm_mode *mode = bptc_unorm_modes + mode_num;
+   uint8_t palette[16][4];
+   float endpoints[2][4];
+   int texel;
+
+   enc->mode_num = mode_num;
+   enc->partition_num = 0;
+
+   fit_line(block->floats, 0xffff, 3, endpoints);
+   endpoints[0][3] = 255.0f;
+   endpoints[1][3] = 0.0f;
+   for (texel = 0; texel < BLOCK_SIZE * BLOCK_SIZE; texel++) {
+      endpoints[0][3] = MIN2(endpoints[0][3], block->floats[texel][3]);
+      endpoints[1][3] = MAX2(endpoints[1][3], block->floats[texel][3]);
+   }
+
+   quantize_unorm_endpoints(mode, endpoints, enc, 0);
+
+   make_unorm_palette(enc->decoded[0], enc->decoded[1], mode->n_index_bits,
+                      palette);
+   enc->error = pick_unorm_indices(block->bytes, 0xffff, palette,
+                                   1 << mode->n_index_bits, 3,
+                                   enc->indices[0]);
+   if (enc->indices[0][0] >> (mode->n_index_bits - 1)) {
+      swap_unorm_endpoints(enc, 0, 0, 3, 0, mode->n_index_bits, 0xffff);
+   }
+
+   make_unorm_palette(enc->decoded[0], enc->decoded[1],
+                      mode->n_secondary_index_bits, palette);
+   enc->error += pick_alpha_indices(block->bytes, palette,
+                                    1 << mode->n_secondary_index_bits,
+                                    enc->indices[1]);
+   if (enc->indices[1][0] >> (mode->n_secondary_index_bits - 1)) {
+      swap_unorm_endpoints(enc, 0, 3, 1, 1, mode->n_secondary_index_bits,
+                           0xffff);
+   }
+}
+
+static void
+write_unorm_block(const struct bptc_unorm_encoding *enc, uint8_t *dst)
+{
+   const struct bptc_unorm_mode *mode = bptc_unorm_modes + enc->mode_num;
+   struct bit_writer writer;
+   int component, subset, endpoint, texel, n_bits;
+
+   writer.dst = dst;
+   writer.pos = 0;
+   writer.buf = 0;
+
+   write_bits(&writer, enc->mode_num + 1, 1 << enc->mode_num);
+   write_bits(&writer, mode->n_partition_bits, enc->partition_num);
+   if (mode->has_rotation_bits)
+      write_bits(&writer, 2, 0); /* rotation 0 */
+   if (mode->has_index_selection_bit)
+      write_bits(&writer, 1, 0); /* index selection bit */
+
+   for (component = 0; component < 3; component++) {
+      for (subset = 0; subset < mode->n_subsets; subset++) {
+         for (endpoint = 0; endpoint < 2; endpoint++) {
+            write_bits(&writer, mode->n_color_bits,
+                       enc->endpoints[subset * 2 + endpoint][component]);
+         }
+      }
+   }
+
+   if (mode->n_alpha_bits > 0) {
+      for (subset = 0; subset < mode->n_subsets; subset++) {
+         for (endpoint = 0; endpoint < 2; endpoint++) {
+            write_bits(&writer, mode->n_alpha_bits,
+                       enc->endpoints[subset * 2 + endpoint][3]);
+         }
+      }
+   }
+
+   if (mode->has_endpoint_pbits) {
+      for (subset = 0; subset < mode->n_subsets; subset++) {
+         for (endpoint = 0; endpoint < 2; endpoint++)
+            write_bits(&writer, 1, enc->pbits[subset * 2 + endpoint]);
+      }
+   } else if (mode->has_shared_pbits) {
+      for (subset = 0; subset < mode->n_subsets; subset++)
+         write_bits(&writer, 1, enc->pbits[subset * 2]);
+   }
+
+   for (texel = 0; texel < BLOCK_SIZE * BLOCK_SIZE; texel++) {
+      n_bits = mode->n_index_bits;
+      if (is_anchor(mode->n_subsets, enc->partition_num, texel))
+         n_bits--;
+      write_bits(&writer, n_bits, enc->indices[0][texel]);
+   }
+
+   if (mode->n_secondary_index_bits) {
+      for (texel = 0; texel < BLOCK_SIZE * BLOCK_SIZE; texel++) {
+         n_bits = mode->n_secondary_index_bits - (texel == 0);
+         write_bits(&writer, n_bits, enc->indices[1][texel]);
+      }
+   }
+}
+
+static void
+keep_best_unorm(struct bptc_unorm_encoding *best,
+                const struct bptc_unorm_encoding *enc)
+{
+   if (enc->error < best->error)
+      *best = *enc;
+}
+
+static void
+search_rgba_unorm_block(int src_width, int src_height,
+                        const uint8_t *src, int src_rowstride,
+                        uint8_t *dst,
+                        enum bptc_quality quality)
+{
+   struct unorm_block_texels block;
+   struct bptc_unorm_encoding best, enc;
+   int partitions[N_PARTITIONS];
+   int n_components, n_partitions, x, y, texel, component, i;
+
+   /* Texels outside the image repeat the edge ones */
+   block.opaque = true;
+   for (y = 0; y < BLOCK_SIZE; y++) {
+      for (x = 0; x < BLOCK_SIZE; x++) {
+         texel = y * BLOCK_SIZE + x;
+         memcpy(block.bytes[texel],
+                src + MIN2(y, src_height - 1) * src_rowstride +
+                MIN2(x, src_width - 1) * 4,
+                4);
+         for (component = 0; component < 4; component++)
+            block.floats[texel][component] = block.bytes[texel][component];
+         block.opaque &= block.bytes[texel][3] == 255;
+      }
+   }
+
+   /* Mode 6 has the most precise single subset, for smooth blocks with or
+    * without alpha.
+    */
+   encode_unorm_partition(&block, 6, 0, quality, &best);
+
+   if (best.error == 0)
+      goto done;
+
+   n_components = block.opaque ? 3 : 4;
+   n_partitions = rank_partitions(block.floats, 2, N_PARTITIONS,
+                                  n_components,
+                                  n_tried_partitions[quality][0],
+                                  partitions);
+
+   if (block.opaque) {
+      /* Modes without alpha, with two subsets */
+      for (i = 0; i < n_partitions; i++) {
+         encode_unorm_partition(&block, 1, partitions[i], quality, &enc);
+         keep_best_unorm(&best, &enc);
+         encode_unorm_partition(&block, 3, partitions[i], quality, &enc);
+         keep_best_unorm(&best, &enc);
+      }
+
+      if (quality == BPTC_QUALITY_BEST) {
+         /* Three subsets; mode 0 only has the first 16 partitions */
+         n_partitions = rank_partitions(block.floats, 3, 16, 3,
+                                        n_tried_partitions[quality][1],
+                                        partitions);
+         for (i = 0; i < n_partitions; i++) {
+            encode_unorm_partition(&block, 0, partitions[i], quality, &enc);
+            keep_best_unorm(&best, &enc);
+         }
+
+         n_partitions = rank_partitions(block.floats, 3, N_PARTITIONS, 3,
+                                        n_tried_partitions[quality][1],
+                                        partitions);
+         for (i = 0; i < n_partitions; i++) {
+            encode_unorm_partition(&block, 2, partitions[i], quality, &enc);
+            keep_best_unorm(&best, &enc);
+         }
+      }
+   } else {
+      for (i = 0; i < n_partitions; i++) {
+         encode_unorm_partition(&block, 7, partitions[i], quality, &enc);
+         keep_best_unorm(&best, &enc);
+      }
+
+      /* Alpha that does not follow the color */
+      encode_unorm_separate_alpha(&block, 5, &enc);
+      keep_best_unorm(&best, &enc);
+
+      if (quality == BPTC_QUALITY_BEST) {
+         encode_unorm_separate_alpha(&block, 4, &enc);
+         keep_best_unorm(&best, &enc);
+      }
+   }
+
+done:
+   write_unorm_block(&best, dst);
+}
+
 static void
 compress_rgba_unorm(int width, int height,
                     const uint8_t *src, int src_rowstride,
-                    uint8_t *dst, int dst_rowstride)
+                    uint8_t *dst, int dst_rowstride,
+                    enum bptc_quality quality)
 {
    int dst_row_diff;
    int y, x;
@@ -1260,11 +2167,20 @@ compress_rgba_unorm(int width, int height,
 
    for (y = 0; y < height; y += BLOCK_SIZE) {
       for (x = 0; x < width; x += BLOCK_SIZE) {
-         compress_rgba_unorm_block(MIN2(width - x, BLOCK_SIZE),
-                                   MIN2(height - y, BLOCK_SIZE),
-                                   src + x * 4 + y * src_rowstride,
-                                   src_rowstride,
-                                   dst);
+         if (quality == BPTC_QUALITY_FAST) {
+            compress_rgba_unorm_block(MIN2(width - x, BLOCK_SIZE),
+                                      MIN2(height - y, BLOCK_SIZE),
+                                      src + x * 4 + y * src_rowstride,
+                                      src_rowstride,
+                                      dst);
+         } else {
+            search_rgba_unorm_block(MIN2(width - x, BLOCK_SIZE),
+                                    MIN2(height - y, BLOCK_SIZE),
+                                    src + x * 4 + y * src_rowstride,
+                                    src_rowstride,
+                                    dst,
+                                    quality);
+         }
          dst += BLOCK_BYTES;
       }
       dst += dst_row_diff;
@@ -1308,7 +2224,8 @@ _mesa_texstore_bptc_rgba_unorm(TEXSTORE_PARAMS)
 
    compress_rgba_unorm(srcWidth, srcHeight,
                        pixels, rowstride,
-                       dstSlices[0], dstRowStride);
+                       dstSlices[0], dstRowStride,
+                       get_bptc_quality());
 
    free((void *) tempImage);
 
@@ -1465,7 +2382,11 @@ write_rgb_indices_float(struct bit_writer *writer,
          else if (index > 15)
             index = 15;
 
-         assert(x != 0 || y != 0 || index < 8);
+         /* Rounding in the averages can put the first texel just past the
+          * far endpoint, but its index only has three bits.
+          */
+         if (x == 0 && y == 0 && index > 7)
+            index = 7;
 
          write_bits(writer, (x == 0 && y == 0) ? 3 : 4, index);
 
@@ -1552,11 +2473,330 @@ compress_rgb_float_block(int src_width, int src_height,
                            endpoints);
 }
 
+struct bptc_float_encoding {
+   int mode_num;
+   int partition_num;
+   int32_t endpoints[2 * 2][3];  /**< quantized, before the transform */
+   uint8_t indices[BLOCK_SIZE * BLOCK_SIZE];
+   uint64_t error;
+};
+
+/**
+ * The texels of a block as the values that the interpolated endpoints have
+ * to reach for the decoder to return them, before the final multiply by
+ * 31/64 or 31/32.  The encoders work and measure errors in this space,
+ * which is linear in the bits of the half floats.
+ */
+struct float_block_texels {
+   int32_t values[BLOCK_SIZE * BLOCK_SIZE][3];
+   float floats[BLOCK_SIZE * BLOCK_SIZE][4];
+};
+
+static int32_t
+get_unquantized_value(float value, bool is_signed)
+{
+   uint16_t half;
+   int32_t magnitude;
+
+   /* NaN */
+   if (value != value)
+      value = 0.0f;
+
+   half = _mesa_float_to_half(clamp_value(value, is_signed));
+   magnitude = half & 0x7fff;
+
+   /* Round up so the truncating multiply gives the half back */
+   if (is_signed) {
+      magnitude = (magnitude * 32 + 30) / 31;
+      return (half & 0x8000) ? -magnitude : magnitude;
+   } else {
+      return (magnitude * 64 + 30) / 31;
+   }
+}
+
+static int32_t
+unquantize_float(int32_t value, int n_bits, bool is_signed)
+{
+   if (is_signed)
+      return signed_unquantize(value, n_bits);
+   else
+      return unsigned_unquantize(value, n_bits);
+}
+
+/**
+ * Find the n_bits endpoint value that unquantizes closest to value.
+ */
+static int32_t
+quantize_float(float value, int n_bits, bool is_signed)
+{
+   int32_t max = is_signed ? (1 << (n_bits - 1)) - 1 : (1 << n_bits) - 1;
+   int32_t min = is_signed ? -max : 0;
+   int32_t guess, q, best = 0;
+   float error, best_error = FLT_MAX;
+
+   guess = (int32_t) floorf(value / (1 << (16 - n_bits)) + 0.5f);
+   guess = CLAMP(guess, min, max);
+
+   for (q = MAX2(guess - 1, min); q <= MIN2(guess + 1, max); q++) {
+      error = fabsf(unquantize_float(q, n_bits, is_signed) - value);
+      if (error < best_error) {
+         best_error = error;
+         best = q;
+      }
+   }
+
+   return best;
+}
+
+static void
+make_float_palette(const struct bptc_float_mode *mode,
+                   const struct bptc_float_encoding *enc,
+                   int subset, bool is_signed,
+                   int32_t palette[][3])
+{
+   int32_t e0, e1;
+   int index, component;
+
+   for (component = 0; component < 3; component++) {
+      e0 = unquantize_float(enc->endpoints[subset * 2][component],
+                            mode->n_endpoint_bits, is_signed);
+      e1 = unquantize_float(enc->endpoints[subset * 2 + 1][component],
+                            mode->n_endpoint_bits, is_signed);
+      for (index = 0; index < (1 << mode->n_index_bits); index++) {
+         palette[index][component] = interpolate(e0, e1, index,
+                                                 mode->n_index_bits);
+      }
+   }
+}
+
+/**
+ * Pick the closest palette entry for each texel in mask.  The index of the
+ * anchor texel is kept in the first half of the palette, unless anchor is
+ * -1.  Returns the sum of the squared errors.
+ */
+static uint64_t
+pick_float_indices(const int32_t values[][3], uint32_t mask,
+                   const int32_t palette[][3], int n_entries, int anchor,
+                   uint8_t *indices)
+{
+   uint64_t error = 0, dist, best_dist;
+   int64_t diff;
+   int texel, i, n, component;
+
+   for (; mask; mask &= mask - 1) {
+      texel = ffs(mask) - 1;
+      n = texel == anchor ? n_entries / 2 : n_entries;
+      best_dist = UINT64_MAX;
+
+      for (i = 0; i < n; i++) {
+         dist = 0;
+         for (component = 0; component < 3; component++) {
+            diff = palette[i][component] - values[texel][component];
+            dist += diff * diff;
+         }
+         if (dist < best_dist) {
+            best_dist = dist;
+            indices[texel] = i;
+         }
+      }
+
+      error += best_dist;
+   }
+
+   return error;
+}
+
+static void
+encode_float_partition(const struct float_block_texels *block,
+                       int mode_num, int partition_num, bool is_signed,
+                       struct bptc_float_encoding *enc)
+{
+   const struct bptc_float_mode *mode = bptc_float_modes + mode_num;
+   int n_subsets = mode->n_partition_bits ? 2 : 1;
+   int n_entries = 1 << mode->n_index_bits;
+   int32_t palette[16][3], t, range, delta;
+   float endpoints[2][4];
+   uint32_t masks[2];
+   int anchors[2];
+   int subset, endpoint, component;
+
+   enc->mode_num = mode_num;
+   enc->partition_num = partition_num;
+   enc->error = 0;
+
+   for (subset = 0; subset < n_subsets; subset++) {
+      masks[subset] = get_subset_texels(n_subsets, partition_num, subset);
+      anchors[subset] = get_anchor_texel(n_subsets, partition_num, subset);
+
+      fit_line(block->floats, masks[subset], 3, endpoints);
+      for (endpoint = 0; endpoint < 2; endpoint++) {
+         for (component = 0; component < 3; component++) {
+            enc->endpoints[subset * 2 + endpoint][component] =
+               quantize_float(endpoints[endpoint][component],
+                              mode->n_endpoint_bits, is_signed);
+         }
+      }
+
+      /* Swap the endpoints if the anchor texel would need the top bit */
+      make_float_palette(mode, enc, subset, is_signed, palette);
+      pick_float_indices(block->values, masks[subset], palette, n_entries,
+                         -1, enc->indices);
+      if (enc->indices[anchors[subset]] >> (mode->n_index_bits - 1)) {
+         for (component = 0; component < 3; component++) {
+            t = enc->endpoints[subset * 2][component];
+            enc->endpoints[subset * 2][component] =
+               enc->endpoints[subset * 2 + 1][component];
+            enc->endpoints[subset * 2 + 1][component] = t;
+         }
+      }
+   }
+
+   /* The other endpoints are stored as offsets from the first one, which
+    * might not reach that far.
+    */
+   if (mode->transformed_endpoints) {
+      for (endpoint = 1; endpoint < n_subsets * 2; endpoint++) {
+         for (component = 0; component < 3; component++) {
+            range = 1 << (mode->n_delta_bits[component] - 1);
+            delta = (enc->endpoints[endpoint][component] -
+                     enc->endpoints[0][component]);
+            delta = CLAMP(delta, -range, range - 1);
+            enc->endpoints[endpoint][component] =
+               enc->endpoints[0][component] + delta;
+         }
+      }
+   }
+
+   for (subset = 0; subset < n_subsets; subset++) {
+      make_float_palette(mode, enc, subset, is_signed, palette);
+      enc->error += pick_float_indices(block->values, masks[subset],
+                                       palette, n_entries, anchors[subset],
+                                       enc->indices);
+   }
+}
+
+static void
+write_float_block(const struct bptc_float_encoding *enc, uint8_t *dst)
+{
+   const struct bptc_float_mode *mode = bptc_float_modes + enc->mode_num;
+   const struct bptc_float_bitfield *bitfield;
+   int n_subsets = mode->n_partition_bits ? 2 : 1;
+   int32_t values[2 * 2][3];
+   struct bit_writer writer;
+   int endpoint, component, texel, n_bits, value, reversed, i;
+
+   for (endpoint = 0; endpoint < n_subsets * 2; endpoint++) {
+      for (component = 0; component < 3; component++) {
+         values[endpoint][component] = enc->endpoints[endpoint][component];
+         if (endpoint > 0 && mode->transformed_endpoints)
+            values[endpoint][component] -= enc->endpoints[0][component];
+      }
+   }
+
+   writer.dst = dst;
+   writer.pos = 0;
+   writer.buf = 0;
+
+   if (enc->mode_num < 2) {
+      write_bits(&writer, 2, enc->mode_num);
+   } else {
+      i = enc->mode_num - 2;
+      write_bits(&writer, 5, ((i >> 1) << 2) | 2 | (i & 1));
+   }
+
+   for (bitfield = mode->bitfields; bitfield->endpoint != -1; bitfield++) {
+      value = ((values[bitfield->endpoint][bitfield->component] >>
+                bitfield->offset) &
+               ((1 << bitfield->n_bits) - 1));
+
+      if (bitfield->reverse) {
+         reversed = 0;
+         for (i = 0; i < bitfield->n_bits; i++) {
+            if (value & (1 << i))
+               reversed |= 1 << (bitfield->n_bits - 1 - i);
+         }
+         value = reversed;
+      }
+
+      write_bits(&writer, bitfield->n_bits, value);
+   }
+
+   write_bits(&writer, mode->n_partition_bits, enc->partition_num);
+
+   for (texel = 0; texel < BLOCK_SIZE * BLOCK_SIZE; texel++) {
+      n_bits = mode->n_index_bits;
+      if (is_anchor(n_subsets, enc->partition_num, texel))
+         n_bits--;
+      write_bits(&writer, n_bits, enc->indices[texel]);
+   }
+}
+
+static void
+search_rgb_float_block(int src_width, int src_height,
+                       const float *src, int src_rowstride,
+                       uint8_t *dst,
+                       bool is_signed,
+                       enum bptc_quality quality)
+{
+   struct float_block_texels block;
+   struct bptc_float_encoding best, enc;
+   int partitions[N_PARTITIONS];
+   int n_partitions, mode_num, x, y, texel, component, i;
+   const float *texel_src;
+
+   /* Texels outside the image repeat the edge ones */
+   for (y = 0; y < BLOCK_SIZE; y++) {
+      for (x = 0; x < BLOCK_SIZE; x++) {
+         texel = y * BLOCK_SIZE + x;
+         texel_src = (src + MIN2(y, src_height - 1) * src_rowstride /
+                      sizeof (float) + MIN2(x, src_width - 1) * 3);
+         for (component = 0; component < 3; component++) {
+            block.values[texel][component] =
+               get_unquantized_value(texel_src[component], is_signed);
+            block.floats[texel][component] = block.values[texel][component];
+         }
+         block.floats[texel][3] = 0.0f;
+      }
+   }
+
+   /* BPTC_FLOAT only has the first 32 partitions */
+   n_partitions = rank_partitions(block.floats, 2, N_PARTITIONS / 2, 3,
+                                  n_tried_partitions[quality][0] / 2,
+                                  partitions);
+
+   memset(&best, 0, sizeof best);
+   best.error = UINT64_MAX;
+
+   for (mode_num = 0; mode_num < ARRAY_SIZE(bptc_float_modes); mode_num++) {
+      if (bptc_float_modes[mode_num].reserved)
+         continue;
+
+      if (bptc_float_modes[mode_num].n_partition_bits == 0) {
+         encode_float_partition(&block, mode_num, 0, is_signed, &enc);
+         if (enc.error < best.error)
+            best = enc;
+      } else {
+         for (i = 0; i < n_partitions; i++) {
+            encode_float_partition(&block, mode_num, partitions[i],
+                                   is_signed, &enc);
+            if (enc.error < best.error)
+               best = enc;
+         }
+      }
+
+      if (best.error == 0)
+         break;
+   }
+
+   write_float_block(&best, dst);
+}
+
 static void
 compress_rgb_float(int width, int height,
                    const float *src, int src_rowstride,
                    uint8_t *dst, int dst_rowstride,
-                   bool is_signed)
+                   bool is_signed,
+                   enum bptc_quality quality)
 {
    int dst_row_diff;
    int y, x;
@@ -1568,13 +2808,24 @@ compress_rgb_float(int width, int height,
 
    for (y = 0; y < height; y += BLOCK_SIZE) {
       for (x = 0; x < width; x += BLOCK_SIZE) {
-         compress_rgb_float_block(MIN2(width - x, BLOCK_SIZE),
-                                  MIN2(height - y, BLOCK_SIZE),
-                                  src + x * 3 +
-                                  y * src_rowstride / sizeof (float),
-                                  src_rowstride,
-                                  dst,
-                                  is_signed);
+         if (quality == BPTC_QUALITY_FAST) {
+            compress_rgb_float_block(MIN2(width - x, BLOCK_SIZE),
+                                     MIN2(height - y, BLOCK_SIZE),
+                                     src + x * 3 +
+                                     y * src_rowstride / sizeof (float),
+                                     src_rowstride,
+                                     dst,
+                                     is_signed);
+         } else {
+            search_rgb_float_block(MIN2(width - x, BLOCK_SIZE),
+                                   MIN2(height - y, BLOCK_SIZE),
+                                   src + x * 3 +
+                                   y * src_rowstride / sizeof (float),
+                                   src_rowstride,
+                                   dst,
+                                   is_signed,
+                                   quality);
+         }
          dst += BLOCK_BYTES;
       }
       dst += dst_row_diff;
@@ -1620,7 +2871,8 @@ texstore_bptc_rgb_float(TEXSTORE_PARAMS,
    compress_rgb_float(srcWidth, srcHeight,
                       pixels, rowstride,
                       dstSlices[0], dstRowStride,
-                      is_signed);
+                      is_signed,
+                      get_bptc_quality());
 
    free((void *) tempImage);
 
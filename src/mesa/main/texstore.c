@@ -71,6 +71,7 @@
 #include "texcompress_bptc.h"
 #include "teximage.h"
 #include "texstore.h"
+#include "texstore_threads.h"
 #include "enums.h"
 #include "glformats.h"
 #include "../../gallium/auxiliary/util/u_format_rgb9e5.h"
@@ -583,8 +584,8 @@ _mesa_texstore_z32f_x24s8(TEXSTORE_PARAMS)
    return GL_TRUE;
 }
 
-static GLboolean
-texstore_depth_stencil(TEXSTORE_PARAMS)
+static StoreTexImageFunc
+get_depth_stencil_texstore_func(mesa_format dstFormat)
 {
    static StoreTexImageFunc table[MESA_FORMAT_COUNT];
    static GLboolean initialized = GL_FALSE;
@@ -606,14 +607,11 @@ texstore_depth_stencil(TEXSTORE_PARAMS)
    }
 
    ASSERT(table[dstFormat]);
-   return table[dstFormat](ctx, dims, baseInternalFormat,
-                           dstFormat, dstRowStride, dstSlices,
-                           srcWidth, srcHeight, srcDepth,
-                           srcFormat, srcType, srcAddr, srcPacking);
+   return table[dstFormat];
 }
 
-static GLboolean
-texstore_compressed(TEXSTORE_PARAMS)
+static StoreTexImageFunc
+get_compressed_texstore_func(mesa_format dstFormat)
 {
    static StoreTexImageFunc table[MESA_FORMAT_COUNT];
    static GLboolean initialized = GL_FALSE;
@@ -666,10 +664,7 @@ texstore_compressed(TEXSTORE_PARAMS)
    }
 
    ASSERT(table[dstFormat]);
-   return table[dstFormat](ctx, dims, baseInternalFormat,
-                           dstFormat, dstRowStride, dstSlices,
-                           srcWidth, srcHeight, srcDepth,
-                           srcFormat, srcType, srcAddr, srcPacking);
+   return table[dstFormat];
 }
 
 static GLboolean
@@ -849,6 +844,144 @@ _mesa_texstore_memcpy(TEXSTORE_PARAMS)
                   srcAddr, srcPacking);
    return GL_TRUE;
 }
+
+
+/**
+ * Images with fewer texels per band than this are converted on the calling
+ * thread; waking up the workers would cost more than it saves.
+ */
+#define MIN_TEXSTORE_BAND_TEXELS (128 * 128)
+
+/**
+ * An image being converted in bands of slices or, for images with fewer
+ * slices than bands, of rows of a slice.
+ */
+struct texstore_bands
+{
+   StoreTexImageFunc storeImage;
+
+   struct gl_context *ctx;
+   GLuint dims;
+   GLenum baseInternalFormat;
+   mesa_format dstFormat;
+   GLint dstRowStride;
+   GLubyte **dstSlices;
+   GLint srcWidth, srcHeight, srcDepth;
+   GLenum srcFormat, srcType;
+   const GLvoid *srcAddr;
+   const struct gl_pixelstore_attrib *srcPacking;
+
+   GLint bandDepth;        /**< slices per band, or 0 for bands of rows */
+   GLint bandHeight;       /**< rows per band, a multiple of blockHeight */
+   GLint bandsPerSlice;
+   GLuint blockHeight;
+};
+
+static GLboolean
+texstore_band(void *data, unsigned band)
+{
+   const struct texstore_bands *b = (const struct texstore_bands *) data;
+   struct gl_pixelstore_attrib packing = *b->srcPacking;
+   GLubyte **dstSlices, *dstRows;
+   GLint y = 0, z, height, depth;
+
+   if (b->bandDepth) {
+      z = band * b->bandDepth;
+      depth = MIN2(b->bandDepth, b->srcDepth - z);
+      height = b->srcHeight;
+      dstSlices = b->dstSlices + z;
+   } else {
+      z = band / b->bandsPerSlice;
+      y = band % b->bandsPerSlice * b->bandHeight;
+      depth = 1;
+      height = MIN2(b->bandHeight, b->srcHeight - y);
+      dstRows = b->dstSlices[z] + y / b->blockHeight * b->dstRowStride;
+      dstSlices = &dstRows;
+   }
+
+   if (depth <= 0 || height <= 0)
+      return GL_TRUE;
+
+   /* Point the unpacking at the band, keeping the image stride of the
+    * whole source image.
+    */
+   packing.SkipRows += y;
+   packing.SkipImages += z;
+   if (!packing.ImageHeight)
+      packing.ImageHeight = b->srcHeight;
+
+   return b->storeImage(b->ctx, b->dims, b->baseInternalFormat,
+                        b->dstFormat, b->dstRowStride, dstSlices,
+                        b->srcWidth, height, depth,
+                        b->srcFormat, b->srcType, b->srcAddr, &packing);
+}
+
+/**
+ * Convert a large image on several threads.
+ *
+ * \return GL_FALSE if the image is not worth splitting or can't be split,
+ *         with *success untouched.
+ */
+static GLboolean
+texstore_split(StoreTexImageFunc storeImage, GLboolean *success,
+               TEXSTORE_PARAMS)
+{
+   struct texstore_bands b;
+   GLuint blockWidth, blockHeight;
+   GLint numBands, bandsPerSlice;
+
+   numBands = MIN2(_mesa_texstore_max_bands(),
+                   (GLint64) srcWidth * srcHeight * srcDepth /
+                   MIN_TEXSTORE_BAND_TEXELS);
+   if (numBands < 2)
+      return GL_FALSE;
+
+   /* These convert the whole image to a temporary one first, and inverted
+    * images are addressed from their last row.  Without SKIP_IMAGES the
+    * slices of 1D and 2D images can only be walked from the first one.
+    */
+   if (srcPacking->SwapBytes || srcPacking->Invert ||
+       srcFormat == GL_COLOR_INDEX ||
+       dims < 2 || (dims < 3 && srcDepth > 1))
+      return GL_FALSE;
+
+   _mesa_get_format_block_size(dstFormat, &blockWidth, &blockHeight);
+
+   b.storeImage = storeImage;
+   b.ctx = ctx;
+   b.dims = dims;
+   b.baseInternalFormat = baseInternalFormat;
+   b.dstFormat = dstFormat;
+   b.dstRowStride = dstRowStride;
+   b.dstSlices = dstSlices;
+   b.srcWidth = srcWidth;
+   b.srcHeight = srcHeight;
+   b.srcDepth = srcDepth;
+   b.srcFormat = srcFormat;
+   b.srcType = srcType;
+   b.srcAddr = srcAddr;
+   b.srcPacking = srcPacking;
+   b.blockHeight = blockHeight;
+
+   if (srcDepth >= numBands) {
+      b.bandDepth = CEILING(srcDepth, numBands);
+      b.bandHeight = srcHeight;
+      b.bandsPerSlice = 1;
+      numBands = CEILING(srcDepth, b.bandDepth);
+   } else {
+      bandsPerSlice = CEILING(numBands, srcDepth);
+      b.bandDepth = 0;
+      b.bandHeight = CEILING(CEILING(srcHeight, bandsPerSlice),
+                             blockHeight) * blockHeight;
+      b.bandsPerSlice = CEILING(srcHeight, b.bandHeight);
+      numBands = b.bandsPerSlice * srcDepth;
+   }
+
+   *success = _mesa_texstore_run_bands(texstore_band, &b, numBands);
+   return GL_TRUE;
+}
+
+
 /**
  * Store user data into texture memory.
  * Called via glTex[Sub]Image1/2/3D()
@@ -857,6 +990,9 @@ _mesa_texstore_memcpy(TEXSTORE_PARAMS)
 GLboolean
 _mesa_texstore(TEXSTORE_PARAMS)
 {
+   StoreTexImageFunc storeImage;
+   GLboolean success;
+
    if (_mesa_texstore_memcpy(ctx, dims, baseInternalFormat,
                              dstFormat,
                              dstRowStride, dstSlices,
@@ -866,21 +1002,24 @@ _mesa_texstore(TEXSTORE_PARAMS)
    }
 
    if (_mesa_is_depth_or_stencil_format(baseInternalFormat)) {
-      return texstore_depth_stencil(ctx, dims, baseInternalFormat,
-                                    dstFormat, dstRowStride, dstSlices,
-                                    srcWidth, srcHeight, srcDepth,
-                                    srcFormat, srcType, srcAddr, srcPacking);
+      storeImage = get_depth_stencil_texstore_func(dstFormat);
    } else if (_mesa_is_format_compressed(dstFormat)) {
-      return texstore_compressed(ctx, dims, baseInternalFormat,
-                                 dstFormat, dstRowStride, dstSlices,
-                                 srcWidth, srcHeight, srcDepth,
-                                 srcFormat, srcType, srcAddr, srcPacking);
+      storeImage = get_compressed_texstore_func(dstFormat);
    } else {
-      return texstore_rgba(ctx, dims, baseInternalFormat,
-                           dstFormat, dstRowStride, dstSlices,
-                           srcWidth, srcHeight, srcDepth,
-                           srcFormat, srcType, srcAddr, srcPacking);
+      storeImage = texstore_rgba;
    }
+
+   if (texstore_split(storeImage, &success, ctx, dims, baseInternalFormat,
+                      dstFormat, dstRowStride, dstSlices,
+                      srcWidth, srcHeight, srcDepth,
+                      srcFormat, srcType, srcAddr, srcPacking)) {
+      return success;
+   }
+
+   return storeImage(ctx, dims, baseInternalFormat,
+                     dstFormat, dstRowStride, dstSlices,
+                     srcWidth, srcHeight, srcDepth,
+                     srcFormat, srcType, srcAddr, srcPacking);
 }
 
 
@@ -0,0 +1,208 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2026  agent   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file texstore_threads.c
+ * Worker threads for converting large images in _mesa_texstore().
+ *
+ * Each call adds a batch of bands to a list.  Bands are taken in order by
+ * the workers and by the thread that added the batch, which then waits for
+ * the bands the workers took.
+ */
+
+
+#include <stdlib.h>
+
+#include "c11/threads.h"
+#include "main/glheader.h"
+#include "main/macros.h"
+#include "main/texstore_threads.h"
+#include "main/threadpool.h"
+
+
+struct texstore_batch
+{
+   struct texstore_batch *next;
+
+   texstore_band_func func;
+   void *data;
+
+   unsigned num_bands;
+   unsigned next_band;          /**< first band nobody took */
+   unsigned finished_bands;
+   GLboolean success;
+};
+
+
+static struct
+{
+   struct _mesa_threadpool *threads;
+   struct _mesa_threadpool_client client;
+   cnd_t band_done;
+
+   struct texstore_batch *head;
+   struct texstore_batch **tail;
+
+   unsigned max_threads;        /**< limit set for testing */
+} pool;
+
+static once_flag pool_once = ONCE_FLAG_INIT;
+
+
+/**
+ * Take the next band of the batch.  Called with the mutex held.
+ */
+static unsigned
+take_band(struct texstore_batch *batch)
+{
+   unsigned band = batch->next_band++;
+
+   /* Nothing left for the workers, the batch may be still running though */
+   if (batch->next_band == batch->num_bands) {
+      struct texstore_batch **b = &pool.head;
+
+      while (*b != batch)
+         b = &(*b)->next;
+      *b = batch->next;
+      if (!*b)
+         pool.tail = b;
+   }
+
+   return band;
+}
+
+
+/**
+ * Convert a band with the mutex unlocked.  Called with the mutex held.
+ */
+static void
+run_band(struct texstore_batch *batch, unsigned band)
+{
+   GLboolean success;
+
+   mtx_unlock(&pool.threads->mutex);
+   success = batch->func(batch->data, band);
+   mtx_lock(&pool.threads->mutex);
+
+   if (!success)
+      batch->success = GL_FALSE;
+   if (++batch->finished_bands == batch->num_bands)
+      cnd_broadcast(&pool.band_done);
+}
+
+
+static GLboolean
+texstore_threads_run(struct _mesa_threadpool *threads)
+{
+   struct texstore_batch *batch = pool.head;
+
+   (void) threads;
+
+   if (!batch)
+      return GL_FALSE;
+
+   run_band(batch, take_band(batch));
+   return GL_TRUE;
+}
+
+
+static void
+texstore_threads_init(void)
+{
+   cnd_init(&pool.band_done);
+   pool.tail = &pool.head;
+
+   /* The calling thread converts bands too */
+   pool.threads = _mesa_threadpool_add_client(&pool.client,
+                                              "MESA_TEXSTORE_THREADS", GL_TRUE,
+                                              texstore_threads_run);
+   pool.max_threads = pool.client.num_threads;
+}
+
+
+/**
+ * How many bands are worth splitting an image in: one per thread.
+ */
+unsigned
+_mesa_texstore_max_bands(void)
+{
+   call_once(&pool_once, texstore_threads_init);
+   return MIN2(pool.max_threads, pool.client.num_threads) + 1;
+}
+
+
+/**
+ * Run func for bands 0 to num_bands - 1 and wait for all of them.
+ *
+ * \return GL_FALSE if any band failed.
+ */
+GLboolean
+_mesa_texstore_run_bands(texstore_band_func func, void *data,
+                         unsigned num_bands)
+{
+   struct texstore_batch batch;
+
+   if (_mesa_texstore_max_bands() == 1 || num_bands <= 1) {
+      GLboolean success = GL_TRUE;
+      unsigned i;
+
+      for (i = 0; i < num_bands; i++)
+         success = func(data, i) && success;
+      return success;
+   }
+
+   batch.next = NULL;
+   batch.func = func;
+   batch.data = data;
+   batch.num_bands = num_bands;
+   batch.next_band = 0;
+   batch.finished_bands = 0;
+   batch.success = GL_TRUE;
+
+   mtx_lock(&pool.threads->mutex);
+   *pool.tail = &batch;
+   pool.tail = &batch.next;
+   cnd_broadcast(&pool.threads->has_work);
+
+   while (batch.next_band < batch.num_bands)
+      run_band(&batch, take_band(&batch));
+
+   while (batch.finished_bands != batch.num_bands)
+      cnd_wait(&pool.band_done, &pool.threads->mutex);
+   mtx_unlock(&pool.threads->mutex);
+
+   return batch.success;
+}
+
+
+/**
+ * Use at most the given number of worker threads, for measuring how the
+ * conversion scales.  It can't go above the number of threads started.
+ */
+void
+_mesa_texstore_set_max_threads(unsigned max_threads)
+{
+   call_once(&pool_once, texstore_threads_init);
+   pool.max_threads = max_threads;
+}
@@ -0,0 +1,77 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2026  agent   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file texstore_threads.h
+ * Worker threads for converting large images in _mesa_texstore().
+ *
+ * The caller splits the image in bands of rows or slices and the bands are
+ * converted by the worker threads and the calling thread together.  The
+ * calling thread always takes part, so the bands of nested calls (the
+ * texture compressors call _mesa_texstore() for their temporary images)
+ * never wait for a thread that is busy.
+ *
+ * The number of worker threads is set with MESA_TEXSTORE_THREADS (0 does
+ * everything on the calling thread); by default there is one per CPU
+ * besides the calling thread, up to 7.  They come from the thread pool
+ * shared with the shader queue.
+ */
+
+
+#ifndef TEXSTORE_THREADS_H
+#define TEXSTORE_THREADS_H
+
+
+#include "main/glheader.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * Convert one band.
+ * \return GL_FALSE if out of memory.
+ */
+typedef GLboolean (*texstore_band_func)(void *data, unsigned band);
+
+
+extern unsigned
+_mesa_texstore_max_bands(void);
+
+extern GLboolean
+_mesa_texstore_run_bands(texstore_band_func func, void *data,
+                         unsigned num_bands);
+
+extern void
+_mesa_texstore_set_max_threads(unsigned max_threads);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* TEXSTORE_THREADS_H */
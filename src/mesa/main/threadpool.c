@@ -0,0 +1,172 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2026  agent   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file threadthreadpool.c
+ * Worker threads shared by the shader queue and the threaded texstore.
+ */
+
+
+#include <stdlib.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+#include "main/macros.h"
+#include "main/threadpool.h"
+
+
+static struct _mesa_threadpool threadpool;
+
+static once_flag threadpool_once = ONCE_FLAG_INIT;
+
+
+/**
+ * Run one piece of work of the first client that has some and isn't
+ * running on as many workers as it asked for.  Called with the mutex held.
+ */
+static GLboolean
+threadpool_run(struct _mesa_threadpool *pool)
+{
+   struct _mesa_threadpool_client *client;
+
+   for (client = pool->clients; client; client = client->next) {
+      GLboolean ran;
+
+      if (client->num_running == client->num_threads)
+         continue;
+
+      client->num_running++;
+      ran = client->run(pool);
+      client->num_running--;
+
+      if (ran)
+         return GL_TRUE;
+   }
+
+   return GL_FALSE;
+}
+
+
+static int
+threadpool_thread(void *data)
+{
+   struct _mesa_threadpool *pool = (struct _mesa_threadpool *) data;
+
+   mtx_lock(&pool->mutex);
+   for (;;) {
+      /* Work queued before the shutdown still runs */
+      if (threadpool_run(pool))
+         continue;
+      if (pool->shutdown)
+         break;
+      cnd_wait(&pool->has_work, &pool->mutex);
+   }
+   mtx_unlock(&pool->mutex);
+
+   return 0;
+}
+
+
+/**
+ * Let the threads finish the queued work and join them.
+ */
+static void
+threadpool_destroy(void)
+{
+   unsigned i;
+
+   mtx_lock(&threadpool.mutex);
+   threadpool.shutdown = GL_TRUE;
+   cnd_broadcast(&threadpool.has_work);
+   mtx_unlock(&threadpool.mutex);
+
+   for (i = 0; i < threadpool.num_threads; i++)
+      thrd_join(threadpool.threads[i], NULL);
+   threadpool.num_threads = 0;
+}
+
+
+static void
+threadpool_init(void)
+{
+   mtx_init(&threadpool.mutex, mtx_plain);
+   cnd_init(&threadpool.has_work);
+}
+
+
+/**
+ * Register a user of the pool, starting more threads if it wants more than
+ * there are.  The number it wants is read from \p env_var, or else it is
+ * one per CPU, up to 8, on machines with several CPUs.
+ *
+ * \param caller_helps  whether the threads queueing work also run it, in
+ *                      which case the default is one thread less.
+ * \return the pool, whose mutex protects the client's work list.
+ */
+struct _mesa_threadpool *
+_mesa_threadpool_add_client(struct _mesa_threadpool_client *client,
+                            const char *env_var, GLboolean caller_helps,
+                            GLboolean (*run)(struct _mesa_threadpool *pool))
+{
+   const char *env = getenv(env_var);
+   unsigned num_threads = 0;
+
+   if (env) {
+      num_threads = strtoul(env, NULL, 0);
+   } else {
+#if defined(_SC_NPROCESSORS_ONLN)
+      long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+      if (num_cpus > 1)
+         num_threads = MIN2(num_cpus, 8) - (caller_helps ? 1 : 0);
+#endif
+   }
+   num_threads = MIN2(num_threads, MAX_THREADPOOL_THREADS);
+
+   call_once(&threadpool_once, threadpool_init);
+
+   mtx_lock(&threadpool.mutex);
+
+   /* Registered after _mesa_destroy_shader_compiler(), so this runs first */
+   if (threadpool.num_threads == 0 && num_threads)
+      atexit(threadpool_destroy);
+
+   while (threadpool.num_threads < num_threads) {
+      if (thrd_create(&threadpool.threads[threadpool.num_threads],
+                      threadpool_thread, &threadpool) != thrd_success)
+         break;
+      threadpool.num_threads++;
+   }
+
+   client->run = run;
+   client->num_threads = MIN2(num_threads, threadpool.num_threads);
+   client->num_running = 0;
+   client->next = threadpool.clients;
+   threadpool.clients = client;
+
+   mtx_unlock(&threadpool.mutex);
+
+   return &threadpool;
+}
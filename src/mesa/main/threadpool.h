@@ -0,0 +1,95 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2026  agent   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file threadpool.h
+ * Worker threads shared by the shader queue and the threaded texstore.
+ *
+ * There is one pool for the process.  Its users register as clients; the
+ * pool only owns the threads and the mutex, each client keeps its own work
+ * list and hands out work from its run callback.
+ */
+
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+
+#include "c11/threads.h"
+#include "main/glheader.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define MAX_THREADPOOL_THREADS 16
+
+
+struct _mesa_threadpool;
+
+
+struct _mesa_threadpool_client
+{
+   struct _mesa_threadpool_client *next;
+
+   /**
+    * Called by the workers with the mutex held, to run one piece of work.
+    * It may unlock the mutex while working, but returns with it held.
+    *
+    * \return GL_FALSE if there was nothing to do.
+    */
+   GLboolean (*run)(struct _mesa_threadpool *pool);
+
+   unsigned num_threads;        /**< most workers running this client */
+   unsigned num_running;
+};
+
+
+struct _mesa_threadpool
+{
+   mtx_t mutex;                 /**< also protects the clients' work lists */
+   cnd_t has_work;
+   GLboolean shutdown;
+
+   struct _mesa_threadpool_client *clients;
+
+   unsigned num_threads;
+   thrd_t threads[MAX_THREADPOOL_THREADS];
+};
+
+
+extern struct _mesa_threadpool *
+_mesa_threadpool_add_client(struct _mesa_threadpool_client *client,
+                            const char *env_var, GLboolean caller_helps,
+                            GLboolean (*run)(struct _mesa_threadpool *pool));
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* THREADPOOL_H */
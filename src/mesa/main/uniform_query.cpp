@@ -592,6 +592,52 @@ _mesa_propagate_uniforms_to_driver_storage(struct gl_uniform_storage *uni,
    }
 }
 
+/**
+ * Fast path of _mesa_uniform() for calls matching the uniform's type and
+ * size.  Values equal to the current ones don't flush anything.
+ *
+ * \return false if the call needs the full path.
+ */
+static inline bool
+uniform_fast_path(struct gl_context *ctx, struct gl_shader_program *shProg,
+                  GLint location, GLsizei count, const GLvoid *values,
+                  enum glsl_base_type basicType, unsigned src_components)
+{
+   if (shProg == NULL ||
+       (unsigned) location >= shProg->NumUniformRemapTable ||
+       unlikely(ctx->_Shader->Flags & GLSL_UNIFORMS))
+      return false;
+
+   /* Built by the linker along with the remap table */
+   if (unlikely(shProg->UniformDescriptors == NULL))
+      return false;
+
+   const struct gl_uniform_descriptor *const desc =
+      &shProg->UniformDescriptors[location];
+
+   if (desc->uni == NULL ||
+       desc->base_type != basicType ||
+       desc->components != src_components ||
+       count <= 0 || (unsigned) count > desc->max_count)
+      return false;
+
+   struct gl_uniform_storage *const uni = desc->uni;
+   union gl_constant_value *const dst =
+      &uni->storage[desc->components * desc->array_index];
+   const size_t size = sizeof(dst[0]) * desc->components * count;
+
+   if (memcmp(dst, values, size) != 0) {
+      FLUSH_VERTICES(ctx, _NEW_PROGRAM_CONSTANTS);
+      memcpy(dst, values, size);
+      _mesa_propagate_uniforms_to_driver_storage(uni, desc->array_index,
+                                                 count);
+   }
+
+   uni->initialized = true;
+   return true;
+}
+
+
 /**
  * Called via glUniform*() functions.
  */
@@ -604,6 +650,10 @@ _mesa_uniform(struct gl_context *ctx, struct gl_shader_program *shProg,
 {
    unsigned offset;
 
+   if (uniform_fast_path(ctx, shProg, location, count, values, basicType,
+                         src_components))
+      return;
+
    struct gl_uniform_storage *const uni =
       validate_uniform_parameters(ctx, shProg, location, count,
                                   &offset, "glUniform");
@@ -42,6 +42,7 @@
 #include "ast.h"
 #include "linker.h"
 
+#include "main/errors.h"
 #include "main/mtypes.h"
 #include "main/shaderapi.h"
 #include "main/shaderobj.h"
@@ -3010,15 +3011,16 @@ _mesa_ir_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
 }
 
 /**
- * Link a GLSL shader program.  Called via glLinkProgram().
+ * The GLSL IR part of linking a shader program, whose previous link results
+ * have been released.  This doesn't call into the driver except to create
+ * and delete gl_shader objects, so it can run on a shader queue thread.
  */
 void
-_mesa_glsl_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
+_mesa_glsl_link_shader_ir(struct gl_context *ctx,
+                          struct gl_shader_program *prog)
 {
    unsigned int i;
 
-   _mesa_clear_shader_program_data(prog);
-
    prog->LinkStatus = GL_TRUE;
 
    for (i = 0; i < prog->NumShaders; i++) {
@@ -3031,6 +3033,19 @@ _mesa_glsl_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
       link_shaders(ctx, prog);
    }
 
+   if (prog->LinkStatus && ctx->Driver.LowerLinkedShaders) {
+      ctx->Driver.LowerLinkedShaders(ctx, prog);
+   }
+}
+
+/**
+ * The driver part of linking a shader program, after
+ * _mesa_glsl_link_shader_ir().
+ */
+void
+_mesa_glsl_link_shader_driver(struct gl_context *ctx,
+                              struct gl_shader_program *prog)
+{
    if (prog->LinkStatus) {
       if (!ctx->Driver.LinkShader(ctx, prog)) {
 	 prog->LinkStatus = GL_FALSE;
@@ -3047,6 +3062,24 @@ _mesa_glsl_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
 	 fprintf(stderr, "%s\n", prog->InfoLog);
       }
    }
+
+   if (prog->LinkStatus == GL_FALSE &&
+       (ctx->_Shader->Flags & GLSL_REPORT_ERRORS)) {
+      _mesa_debug(ctx, "Error linking program %u:\n%s\n",
+                  prog->Name, prog->InfoLog);
+   }
+}
+
+/**
+ * Link a GLSL shader program.  Called via glLinkProgram().
+ */
+void
+_mesa_glsl_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
+{
+   _mesa_clear_shader_program_data(prog);
+
+   _mesa_glsl_link_shader_ir(ctx, prog);
+   _mesa_glsl_link_shader_driver(ctx, prog);
 }
 
 } /* extern "C" */
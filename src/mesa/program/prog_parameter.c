@@ -88,6 +88,53 @@ _mesa_free_parameter_list(struct gl_program_parameter_list *paramList)
 }
 
 
+/**
+ * Find the range of parameters whose values differ from a copy, and update
+ * the copy over that range, so that drivers only upload the changed part
+ * of the constants.  Any writer of ParameterValues[] is caught since the
+ * values are compared.
+ *
+ * The copy belongs to the caller, not to the list: a program may be shared
+ * by several contexts, each with its own idea of what it last uploaded.
+ *
+ * \param shadow  copy of the list's NumParameters values
+ * \param first   returns the first changed parameter
+ * \param count   returns the number of parameters from first to the last
+ *                changed one
+ * \return GL_FALSE if no value changed
+ */
+GLboolean
+_mesa_get_parameter_dirty_range(const struct gl_program_parameter_list *list,
+                                gl_constant_value (*shadow)[4],
+                                GLuint *first, GLuint *count)
+{
+   const GLuint num = list->NumParameters;
+   const size_t size = sizeof(list->ParameterValues[0]);
+   GLuint start, end;
+
+   for (start = 0; start < num; start++) {
+      if (memcmp(shadow[start], list->ParameterValues[start], size))
+         break;
+   }
+
+   if (start == num) {
+      *first = *count = 0;
+      return GL_FALSE;
+   }
+
+   for (end = num; end > start + 1; end--) {
+      if (memcmp(shadow[end - 1], list->ParameterValues[end - 1], size))
+         break;
+   }
+
+   memcpy(shadow[start], list->ParameterValues[start], (end - start) * size);
+
+   *first = start;
+   *count = end - start;
+   return GL_TRUE;
+}
+
+
 /**
  * Add a new parameter to a parameter list.
  * Note that parameter values are usually 4-element GLfloat vectors.
@@ -112,6 +112,11 @@ _mesa_num_parameters(const struct gl_program_parameter_list *list)
    return list ? list->NumParameters : 0;
 }
 
+extern GLboolean
+_mesa_get_parameter_dirty_range(const struct gl_program_parameter_list *list,
+                                gl_constant_value (*shadow)[4],
+                                GLuint *first, GLuint *count);
+
 extern GLint
 _mesa_add_parameter(struct gl_program_parameter_list *paramList,
                     gl_register_file type, const char *name,
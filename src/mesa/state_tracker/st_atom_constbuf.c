@@ -37,6 +37,7 @@
 
 #include "pipe/p_context.h"
 #include "pipe/p_defines.h"
+#include "util/u_box.h"
 #include "util/u_inlines.h"
 #include "util/u_upload_mgr.h"
 #include "cso_cache/cso_context.h"
@@ -65,6 +66,8 @@ void st_upload_constants( struct st_context *st,
    if (params && params->NumParameters) {
       struct pipe_constant_buffer cb;
       const uint paramBytes = params->NumParameters * sizeof(GLfloat) * 4;
+      GLuint first = 0, count = params->NumParameters;
+      GLboolean current, recycled;
 
       /* Update the constants which come from fixed-function state, such as
        * transformation matrices, fog factors, etc.  The rest of the values in
@@ -73,20 +76,87 @@ void st_upload_constants( struct st_context *st,
        */
       _mesa_load_state_parameters(st->ctx, params);
 
-      /* We always need to get a new buffer, to keep the drivers simple and
-       * avoid gratuitous rendering synchronization.
-       * Let's use a user buffer to avoid an unnecessary copy.
+      /* Are this list's values bound, as of our copy of them? */
+      current =
+         st->state.constants[shader_type].params == params &&
+         st->state.constants[shader_type].ptr == params->ParameterValues &&
+         st->state.constants[shader_type].size == paramBytes &&
+         st->state.constants[shader_type].shadow_size ==
+            params->NumParameters;
+
+      /* Has the uploader reused memory since our last upload?  The bound
+       * copy may be gone then, even if no value changed.
        */
+      recycled = st->constbuf_uploader &&
+         st->state.constants[shader_type].recycle_count !=
+            u_upload_recycle_count(st->constbuf_uploader);
+
+      if (current) {
+         if (!_mesa_get_parameter_dirty_range(params,
+                                   st->state.constants[shader_type].shadow,
+                                   &first, &count)) {
+            if (!recycled)
+               return;
+            first = 0;
+            count = params->NumParameters;
+         }
+      }
+      else {
+         gl_constant_value (**shadow)[4] =
+            &st->state.constants[shader_type].shadow;
+
+         if (st->state.constants[shader_type].shadow_size !=
+             params->NumParameters) {
+            free(*shadow);
+            *shadow = malloc(paramBytes);
+            st->state.constants[shader_type].shadow_size =
+               *shadow ? params->NumParameters : 0;
+         }
+         if (*shadow)
+            memcpy(*shadow, params->ParameterValues, paramBytes);
+      }
+
       if (st->constbuf_uploader) {
-         cb.buffer = NULL;
+         struct pipe_resource **buf = &st->state.constants[shader_type].buffer;
+         unsigned *offset = &st->state.constants[shader_type].buffer_offset;
+         const unsigned rangeBytes = count * sizeof(params->ParameterValues[0]);
+
+         /* A small changed range is written in place, over the previous
+          * upload of the list, unless the uploader may have reused that
+          * memory since.  Anything else gets a fresh suballocation, as
+          * writing to a buffer the GPU still reads may stall.
+          */
+         if (current && !recycled && *buf && rangeBytes <= paramBytes / 4) {
+            struct pipe_box box;
+
+            u_box_1d(*offset + first * sizeof(params->ParameterValues[0]),
+                     rangeBytes, &box);
+            st->pipe->transfer_inline_write(st->pipe, *buf, 0,
+                                            PIPE_TRANSFER_WRITE |
+                                            PIPE_TRANSFER_DISCARD_RANGE,
+                                            &box,
+                                            params->ParameterValues[first],
+                                            0, 0);
+            st->constbuf_bytes += rangeBytes;
+         }
+         else {
+            u_upload_data(st->constbuf_uploader, 0, paramBytes,
+                          params->ParameterValues, offset, buf);
+            u_upload_unmap(st->constbuf_uploader);
+            st->state.constants[shader_type].recycle_count =
+               u_upload_recycle_count(st->constbuf_uploader);
+            st->constbuf_bytes += paramBytes;
+         }
+
+         cb.buffer = *buf;
          cb.user_buffer = NULL;
-         u_upload_data(st->constbuf_uploader, 0, paramBytes,
-                       params->ParameterValues, &cb.buffer_offset, &cb.buffer);
-         u_upload_unmap(st->constbuf_uploader);
+         cb.buffer_offset = *offset;
       } else {
+         /* Let's use a user buffer to avoid an unnecessary copy. */
          cb.buffer = NULL;
          cb.user_buffer = params->ParameterValues;
          cb.buffer_offset = 0;
+         st->constbuf_bytes += paramBytes;
       }
       cb.buffer_size = paramBytes;
 
@@ -98,15 +168,17 @@ void st_upload_constants( struct st_context *st,
       }
 
       cso_set_constant_buffer(st->cso_context, shader_type, 0, &cb);
-      pipe_resource_reference(&cb.buffer, NULL);
 
       st->state.constants[shader_type].ptr = params->ParameterValues;
       st->state.constants[shader_type].size = paramBytes;
+      st->state.constants[shader_type].params = params;
    }
    else if (st->state.constants[shader_type].ptr) {
       /* Unbind. */
       st->state.constants[shader_type].ptr = NULL;
       st->state.constants[shader_type].size = 0;
+      st->state.constants[shader_type].params = NULL;
+      pipe_resource_reference(&st->state.constants[shader_type].buffer, NULL);
       cso_set_constant_buffer(st->cso_context, shader_type, 0, NULL);
    }
 }
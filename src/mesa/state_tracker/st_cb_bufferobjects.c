@@ -45,6 +45,7 @@
 #include "pipe/p_context.h"
 #include "pipe/p_defines.h"
 #include "util/u_inlines.h"
+#include "cso_cache/cso_context.h"
 
 
 /**
@@ -80,8 +81,11 @@ st_bufferobj_free(struct gl_context *ctx, struct gl_buffer_object *obj)
    assert(obj->RefCount == 0);
    _mesa_buffer_unmap_all_mappings(ctx, obj);
 
-   if (st_obj->buffer)
+   if (st_obj->buffer) {
+      cso_invalidate_index_ranges(st_context(ctx)->cso_context,
+                                  st_obj->buffer);
       pipe_resource_reference(&st_obj->buffer, NULL);
+   }
 
    free(st_obj->Base.Label);
    free(st_obj);
@@ -130,6 +134,7 @@ st_bufferobj_subdata(struct gl_context *ctx,
     * just queue the upload as dma rather than mapping the underlying
     * buffer directly.
     */
+   cso_invalidate_index_ranges(st_context(ctx)->cso_context, st_obj->buffer);
    pipe_buffer_write(st_context(ctx)->pipe,
 		     st_obj->buffer,
 		     offset, size, data);
@@ -196,6 +201,7 @@ st_bufferobj_data(struct gl_context *ctx,
        */
       struct pipe_box box;
 
+      cso_invalidate_index_ranges(st->cso_context, st_obj->buffer);
       u_box_1d(0, size, &box);
       pipe->transfer_inline_write(pipe, st_obj->buffer, 0,
                                   PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE,
@@ -272,6 +278,8 @@ st_bufferobj_data(struct gl_context *ctx,
    if (storageFlags & GL_MAP_COHERENT_BIT)
       pipe_flags |= PIPE_RESOURCE_FLAG_MAP_COHERENT;
 
+   if (st_obj->buffer)
+      cso_invalidate_index_ranges(st->cso_context, st_obj->buffer);
    pipe_resource_reference( &st_obj->buffer, NULL );
 
    if (ST_DEBUG & DEBUG_BUFFER) {
@@ -321,12 +329,15 @@ st_bufferobj_map_range(struct gl_context *ctx,
                        struct gl_buffer_object *obj,
                        gl_map_buffer_index index)
 {
-   struct pipe_context *pipe = st_context(ctx)->pipe;
+   struct st_context *st = st_context(ctx);
+   struct pipe_context *pipe = st->pipe;
    struct st_buffer_object *st_obj = st_buffer_object(obj);
    enum pipe_transfer_usage flags = 0x0;
 
-   if (access & GL_MAP_WRITE_BIT)
+   if (access & GL_MAP_WRITE_BIT) {
       flags |= PIPE_TRANSFER_WRITE;
+      cso_invalidate_index_ranges(st->cso_context, st_obj->buffer);
+   }
 
    if (access & GL_MAP_READ_BIT)
       flags |= PIPE_TRANSFER_READ;
@@ -388,7 +399,8 @@ st_bufferobj_flush_mapped_range(struct gl_context *ctx,
                                 struct gl_buffer_object *obj,
                                 gl_map_buffer_index index)
 {
-   struct pipe_context *pipe = st_context(ctx)->pipe;
+   struct st_context *st = st_context(ctx);
+   struct pipe_context *pipe = st->pipe;
    struct st_buffer_object *st_obj = st_buffer_object(obj);
 
    /* Subrange is relative to mapped range */
@@ -403,6 +415,11 @@ st_bufferobj_flush_mapped_range(struct gl_context *ctx,
    pipe_buffer_flush_mapped_range(pipe, st_obj->transfer[index],
                                   obj->Mappings[index].Offset + offset,
                                   length);
+
+   /* Draws made while the buffer was mapped may have cached index ranges
+    * of what was there before the flushed writes.
+    */
+   cso_invalidate_index_ranges(st->cso_context, st_obj->buffer);
 }
 
 
@@ -413,12 +430,19 @@ static GLboolean
 st_bufferobj_unmap(struct gl_context *ctx, struct gl_buffer_object *obj,
                    gl_map_buffer_index index)
 {
-   struct pipe_context *pipe = st_context(ctx)->pipe;
+   struct st_context *st = st_context(ctx);
+   struct pipe_context *pipe = st->pipe;
    struct st_buffer_object *st_obj = st_buffer_object(obj);
 
    if (obj->Mappings[index].Length)
       pipe_buffer_unmap(pipe, st_obj->transfer[index]);
 
+   /* Draws made while the buffer was mapped may have cached index ranges
+    * of what was there before the last writes through the mapping.
+    */
+   if (obj->Mappings[index].AccessFlags & GL_MAP_WRITE_BIT)
+      cso_invalidate_index_ranges(st->cso_context, st_obj->buffer);
+
    st_obj->transfer[index] = NULL;
    obj->Mappings[index].Pointer = NULL;
    obj->Mappings[index].Offset = 0;
@@ -451,6 +475,7 @@ st_copy_buffer_subdata(struct gl_context *ctx,
 
    u_box_1d(readOffset, size, &box);
 
+   cso_invalidate_index_ranges(st_context(ctx)->cso_context, dstObj->buffer);
    pipe->resource_copy_region(pipe, dstObj->buffer, 0, writeOffset, 0, 0,
                               srcObj->buffer, 0, &box);
 }
@@ -469,6 +494,8 @@ st_clear_buffer_subdata(struct gl_context *ctx,
    struct st_buffer_object *buf = st_buffer_object(bufObj);
    static const char zeros[16] = {0};
 
+   cso_invalidate_index_ranges(st_context(ctx)->cso_context, buf->buffer);
+
    if (!pipe->clear_buffer) {
       _mesa_buffer_clear_subdata(ctx, offset, size,
                                  clearValue, clearValueSize, bufObj);
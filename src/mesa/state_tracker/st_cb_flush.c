@@ -35,6 +35,7 @@
 #include "main/macros.h"
 #include "main/context.h"
 #include "st_context.h"
+#include "st_debug.h"
 #include "st_cb_bitmap.h"
 #include "st_cb_flush.h"
 #include "st_cb_clear.h"
@@ -44,6 +45,7 @@
 #include "pipe/p_defines.h"
 #include "pipe/p_screen.h"
 #include "util/u_gen_mipmap.h"
+#include "util/u_upload_mgr.h"
 
 
 /** Check if we have a front color buffer and if it's been drawn to. */
@@ -75,16 +77,63 @@ display_front_buffer(struct st_context *st)
 }
 
 
+static INLINE boolean
+uploaders_need_fence(struct st_context *st)
+{
+   return u_upload_needs_fence(st->uploader) ||
+          (st->indexbuf_uploader &&
+           u_upload_needs_fence(st->indexbuf_uploader)) ||
+          (st->constbuf_uploader &&
+           u_upload_needs_fence(st->constbuf_uploader));
+}
+
+
+/**
+ * Let the upload rings know when the buffers filled so far can be reused.
+ */
+static void
+fence_uploaders(struct st_context *st, struct pipe_fence_handle *fence)
+{
+   u_upload_fence(st->uploader, fence);
+   if (st->indexbuf_uploader)
+      u_upload_fence(st->indexbuf_uploader, fence);
+   if (st->constbuf_uploader)
+      u_upload_fence(st->constbuf_uploader, fence);
+}
+
+
 void st_flush(struct st_context *st,
               struct pipe_fence_handle **fence,
               unsigned flags)
 {
+   struct pipe_fence_handle *upload_fence = NULL;
+
    FLUSH_VERTICES(st->ctx, 0);
    FLUSH_CURRENT(st->ctx, 0);
 
    st_flush_bitmap_cache(st);
 
-   st->pipe->flush(st->pipe, fence, flags);
+   if (flags & PIPE_FLUSH_END_OF_FRAME) {
+      ST_DBG(DEBUG_CONSTBUF, "constant buffers: %u bytes uploaded\n",
+             st->constbuf_bytes);
+      st->constbuf_bytes = 0;
+   }
+
+   if (!uploaders_need_fence(st)) {
+      st->pipe->flush(st->pipe, fence, flags);
+      return;
+   }
+
+   st->pipe->flush(st->pipe, &upload_fence, flags);
+
+   if (upload_fence)
+      fence_uploaders(st, upload_fence);
+
+   if (fence) {
+      st->pipe->screen->fence_reference(st->pipe->screen, fence,
+                                        upload_fence);
+   }
+   st->pipe->screen->fence_reference(st->pipe->screen, &upload_fence, NULL);
 }
 
 
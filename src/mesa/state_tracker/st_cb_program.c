@@ -242,5 +242,6 @@ st_init_program_functions(struct dd_function_table *functions)
    functions->IsProgramNative = st_is_program_native;
    functions->ProgramStringNotify = st_program_string_notify;
    
+   functions->LowerLinkedShaders = st_lower_linked_shaders;
    functions->LinkShader = st_link_shader;
 }
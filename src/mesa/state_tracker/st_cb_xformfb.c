@@ -203,9 +203,17 @@ st_end_transform_feedback(struct gl_context *ctx,
    struct st_context *st = st_context(ctx);
    struct st_transform_feedback_object *sobj =
          st_transform_feedback_object(obj);
+   unsigned i;
 
    cso_set_stream_outputs(st->cso_context, 0, NULL, NULL);
 
+   /* The buffers may be used as index buffers next */
+   for (i = 0; i < Elements(sobj->targets); i++) {
+      if (sobj->targets[i])
+         cso_invalidate_index_ranges(st->cso_context,
+                                     sobj->targets[i]->buffer);
+   }
+
    pipe_so_target_reference(&sobj->draw_count,
                             st_transform_feedback_get_draw_target(obj));
 }
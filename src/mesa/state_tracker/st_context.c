@@ -168,20 +168,28 @@ st_create_context_priv( struct gl_context *ctx, struct pipe_context *pipe,
 
    /* Create upload manager for vertex data for glBitmap, glDrawPixels,
     * glClear, etc.
+    *
+    * The uploaders recycle a ring of persistently mapped buffers when the
+    * driver supports it; st_flush() hands them the fences.
     */
-   st->uploader = u_upload_create(st->pipe, 65536, 4, PIPE_BIND_VERTEX_BUFFER);
+   st->uploader = u_upload_create_ring(st->pipe, 65536, 4,
+                                       PIPE_BIND_VERTEX_BUFFER,
+                                       ST_UPLOAD_RING_SIZE);
 
    if (!screen->get_param(screen, PIPE_CAP_USER_INDEX_BUFFERS)) {
-      st->indexbuf_uploader = u_upload_create(st->pipe, 128 * 1024, 4,
-                                              PIPE_BIND_INDEX_BUFFER);
+      st->indexbuf_uploader = u_upload_create_ring(st->pipe, 128 * 1024, 4,
+                                                   PIPE_BIND_INDEX_BUFFER,
+                                                   ST_UPLOAD_RING_SIZE);
    }
 
    if (!screen->get_param(screen, PIPE_CAP_USER_CONSTANT_BUFFERS)) {
       unsigned alignment =
          screen->get_param(screen, PIPE_CAP_CONSTANT_BUFFER_OFFSET_ALIGNMENT);
 
-      st->constbuf_uploader = u_upload_create(pipe, 128 * 1024, alignment,
-                                              PIPE_BIND_CONSTANT_BUFFER);
+      st->constbuf_uploader = u_upload_create_ring(pipe, 128 * 1024,
+                                                   alignment,
+                                                   PIPE_BIND_CONSTANT_BUFFER,
+                                                   ST_UPLOAD_RING_SIZE);
    }
 
    st->cso_context = cso_create_context(pipe);
@@ -369,6 +377,8 @@ void st_destroy_context( struct st_context *st )
 
    for (i = 0; i < PIPE_SHADER_TYPES; i++) {
       pipe->set_constant_buffer(pipe, i, 0, NULL);
+      pipe_resource_reference(&st->state.constants[i].buffer, NULL);
+      free(st->state.constants[i].shadow);
    }
 
    _mesa_delete_program_cache(st->ctx, st->pixel_xfer.cache);
@@ -32,6 +32,7 @@
 #include "pipe/p_state.h"
 #include "state_tracker/st_api.h"
 #include "main/fbobject.h"
+#include "program/prog_parameter.h"
 
 
 #ifdef __cplusplus
@@ -59,6 +60,9 @@ struct u_upload_mgr;
 #define ST_NEW_RASTERIZER              (1 << 7)
 #define ST_NEW_UNIFORM_BUFFER          (1 << 8)
 
+/** Number of buffers in the rings of the upload managers */
+#define ST_UPLOAD_RING_SIZE 4
+
 
 struct st_state_flags {
    GLuint mesa;
@@ -83,6 +87,8 @@ struct st_context
 
    struct u_upload_mgr *uploader, *indexbuf_uploader, *constbuf_uploader;
 
+   unsigned constbuf_bytes;  /**< constant bytes uploaded this frame */
+
    struct draw_context *draw;  /**< For selection/feedback/rastpos only */
    struct draw_stage *feedback_stage;  /**< For GL_FEEDBACK rendermode */
    struct draw_stage *selection_stage;  /**< For GL_SELECT rendermode */
@@ -120,6 +126,17 @@ struct st_context
       struct {
          void *ptr;
          unsigned size;
+         /**
+          * Parameters last uploaded, and a copy of their values then.  The
+          * copy is per context, as programs may be shared.
+          */
+         const struct gl_program_parameter_list *params;
+         gl_constant_value (*shadow)[4];
+         GLuint shadow_size;  /**< number of parameters in shadow */
+         /** Upload of the parameters, without user constant buffers */
+         struct pipe_resource *buffer;
+         unsigned buffer_offset;
+         unsigned recycle_count;  /**< of constbuf_uploader at upload time */
       } constants[PIPE_SHADER_TYPES];
       struct pipe_framebuffer_state framebuffer;
       struct pipe_scissor_state scissor[PIPE_MAX_VIEWPORTS];
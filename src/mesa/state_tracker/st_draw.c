@@ -103,6 +103,14 @@ setup_index_buffer(struct st_context *st,
       /* indices are in a real VBO */
       ibuffer->buffer = st_buffer_object(bufobj)->buffer;
       ibuffer->offset = pointer_to_offset(ib->ptr);
+
+      /* Index ranges cached by u_vbuf are only invalidated by writes through
+       * this context, which doesn't see persistent mappings and other
+       * contexts of the share group.
+       */
+      if (st->ctx->Shared->RefCount > 1 ||
+          _mesa_bufferobj_mapped(bufobj, MAP_USER))
+         cso_invalidate_index_ranges(st->cso_context, ibuffer->buffer);
    }
    else if (st->indexbuf_uploader) {
       /* upload indexes from user memory into a real buffer */
@@ -5368,13 +5368,12 @@ get_mesa_program(struct gl_context *ctx,
 extern "C" {
 
 /**
- * Link a shader.
- * Called via ctx->Driver.LinkShader()
- * This actually involves converting GLSL IR into an intermediate TGSI-like IR 
- * with code lowering and other optimizations.
+ * Lower and optimize the GLSL IR of a linked program.
+ * Called via ctx->Driver.LowerLinkedShaders(), possibly on a shader queue
+ * thread, so this only reads constant context and screen state.
  */
-GLboolean
-st_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
+void
+st_lower_linked_shaders(struct gl_context *ctx, struct gl_shader_program *prog)
 {
    struct pipe_screen *pscreen = ctx->st->pipe->screen;
    assert(prog->LinkStatus);
@@ -5454,6 +5453,18 @@ st_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
 
       validate_ir_tree(ir);
    }
+}
+
+/**
+ * Link a shader.
+ * Called via ctx->Driver.LinkShader()
+ * This actually involves converting the GLSL IR, already lowered by
+ * st_lower_linked_shaders(), into an intermediate TGSI-like IR.
+ */
+GLboolean
+st_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
+{
+   assert(prog->LinkStatus);
 
    for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
       struct gl_program *linked_prog;
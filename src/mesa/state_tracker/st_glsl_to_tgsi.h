@@ -61,6 +61,7 @@ void get_bitmap_visitor(struct st_fragment_program *fp,
                         struct glsl_to_tgsi_visitor *original,
                         int samplerIndex);
 
+void st_lower_linked_shaders(struct gl_context *ctx, struct gl_shader_program *prog);
 GLboolean st_link_shader(struct gl_context *ctx, struct gl_shader_program *prog);
 
 void
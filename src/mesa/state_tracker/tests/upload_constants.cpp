@@ -0,0 +1,368 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \name upload_constants.cpp
+ *
+ * Upload constants with st_upload_constants() through a ring of constant
+ * buffers, on a fake driver whose GPU runs a couple of flushes behind, and
+ * check that every binding still reads the values it was given when the
+ * ring wraps around.
+ */
+
+#include <gtest/gtest.h>
+#include <string.h>
+
+extern "C" {
+#include "main/mtypes.h"
+#include "program/prog_parameter.h"
+#include "pipe/p_context.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_state.h"
+#include "cso_cache/cso_context.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "util/u_upload_mgr.h"
+#include "state_tracker/st_context.h"
+#include "state_tracker/st_atom_constbuf.h"
+}
+
+/** Flushes the fake GPU runs behind */
+#define LAG 2
+
+struct pipe_fence_handle {
+   int refcount;
+   unsigned flush;
+};
+
+struct fake_resource {
+   struct pipe_resource base;
+   uint8_t *data;
+};
+
+/** Flushes so far */
+static unsigned num_flushes;
+
+/** Constant buffers bound, as the driver references them */
+static struct pipe_constant_buffer bound[PIPE_SHADER_TYPES];
+
+
+static int
+fake_get_param(struct pipe_screen *screen, enum pipe_cap param)
+{
+   switch (param) {
+   case PIPE_CAP_BUFFER_MAP_PERSISTENT_COHERENT:
+   case PIPE_CAP_USER_VERTEX_BUFFERS:
+      return 1;
+   case PIPE_CAP_CONSTANT_BUFFER_OFFSET_ALIGNMENT:
+      return 256;
+   default:
+      return 0;
+   }
+}
+
+static int
+fake_get_shader_param(struct pipe_screen *screen, unsigned shader,
+                      enum pipe_shader_cap param)
+{
+   return 0;
+}
+
+static boolean
+fake_is_format_supported(struct pipe_screen *screen, enum pipe_format format,
+                         enum pipe_texture_target target,
+                         unsigned sample_count, unsigned bindings)
+{
+   return TRUE;
+}
+
+static struct pipe_resource *
+fake_resource_create(struct pipe_screen *screen,
+                     const struct pipe_resource *templat)
+{
+   struct fake_resource *res = CALLOC_STRUCT(fake_resource);
+
+   res->base = *templat;
+   pipe_reference_init(&res->base.reference, 1);
+   res->base.screen = screen;
+   res->data = (uint8_t *) CALLOC(1, templat->width0);
+   return &res->base;
+}
+
+static void
+fake_resource_destroy(struct pipe_screen *screen, struct pipe_resource *res)
+{
+   FREE(((struct fake_resource *) res)->data);
+   FREE(res);
+}
+
+static void
+fake_fence_reference(struct pipe_screen *screen,
+                     struct pipe_fence_handle **ptr,
+                     struct pipe_fence_handle *fence)
+{
+   if (fence)
+      fence->refcount++;
+   if (*ptr && --(*ptr)->refcount == 0)
+      FREE(*ptr);
+   *ptr = fence;
+}
+
+static boolean
+fake_fence_signalled(struct pipe_screen *screen,
+                     struct pipe_fence_handle *fence)
+{
+   return fence->flush + LAG <= num_flushes;
+}
+
+static boolean
+fake_fence_finish(struct pipe_screen *screen,
+                  struct pipe_fence_handle *fence, uint64_t timeout)
+{
+   return TRUE;
+}
+
+static void *
+fake_transfer_map(struct pipe_context *pipe, struct pipe_resource *res,
+                  unsigned level, unsigned usage, const struct pipe_box *box,
+                  struct pipe_transfer **transfer)
+{
+   struct pipe_transfer *xfer = CALLOC_STRUCT(pipe_transfer);
+
+   pipe_resource_reference(&xfer->resource, res);
+   xfer->usage = (enum pipe_transfer_usage) usage;
+   xfer->box = *box;
+   *transfer = xfer;
+   return ((struct fake_resource *) res)->data + box->x;
+}
+
+static void
+fake_transfer_unmap(struct pipe_context *pipe, struct pipe_transfer *transfer)
+{
+   pipe_resource_reference(&transfer->resource, NULL);
+   FREE(transfer);
+}
+
+static void
+fake_transfer_flush_region(struct pipe_context *pipe,
+                           struct pipe_transfer *transfer,
+                           const struct pipe_box *box)
+{
+}
+
+static void
+fake_transfer_inline_write(struct pipe_context *pipe,
+                           struct pipe_resource *res, unsigned level,
+                           unsigned usage, const struct pipe_box *box,
+                           const void *data, unsigned stride,
+                           unsigned layer_stride)
+{
+   memcpy(((struct fake_resource *) res)->data + box->x, data, box->width);
+}
+
+static void
+fake_set_constant_buffer(struct pipe_context *pipe, uint shader, uint index,
+                         struct pipe_constant_buffer *cb)
+{
+   if (index == 0)
+      util_copy_constant_buffer(&bound[shader], cb);
+}
+
+static void
+fake_bind_state(struct pipe_context *pipe, void *state)
+{
+}
+
+static void
+fake_flush(struct pipe_context *pipe, struct pipe_fence_handle **fence,
+           unsigned flags)
+{
+   if (fence) {
+      struct pipe_fence_handle *f = CALLOC_STRUCT(pipe_fence_handle);
+
+      f->flush = num_flushes;
+      fake_fence_reference(pipe->screen, fence, f);
+   }
+   num_flushes++;
+}
+
+
+class UploadConstants_test : public ::testing::Test {
+public:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   struct gl_program_parameter_list *create_params(unsigned num);
+   void flush();
+   void check_bound(unsigned shader,
+                    const struct gl_program_parameter_list *params);
+
+   struct pipe_screen screen;
+   struct pipe_context pipe;
+   struct st_context *st;
+};
+
+void
+UploadConstants_test::SetUp()
+{
+   num_flushes = 0;
+   memset(bound, 0, sizeof(bound));
+
+   memset(&screen, 0, sizeof(screen));
+   screen.get_param = fake_get_param;
+   screen.get_shader_param = fake_get_shader_param;
+   screen.is_format_supported = fake_is_format_supported;
+   screen.resource_create = fake_resource_create;
+   screen.resource_destroy = fake_resource_destroy;
+   screen.fence_reference = fake_fence_reference;
+   screen.fence_signalled = fake_fence_signalled;
+   screen.fence_finish = fake_fence_finish;
+
+   memset(&pipe, 0, sizeof(pipe));
+   pipe.screen = &screen;
+   pipe.transfer_map = fake_transfer_map;
+   pipe.transfer_unmap = fake_transfer_unmap;
+   pipe.transfer_flush_region = fake_transfer_flush_region;
+   pipe.transfer_inline_write = fake_transfer_inline_write;
+   pipe.set_constant_buffer = fake_set_constant_buffer;
+   pipe.bind_blend_state = fake_bind_state;
+   pipe.bind_rasterizer_state = fake_bind_state;
+   pipe.bind_depth_stencil_alpha_state = fake_bind_state;
+   pipe.bind_fs_state = fake_bind_state;
+   pipe.bind_vs_state = fake_bind_state;
+   pipe.bind_vertex_elements_state = fake_bind_state;
+   pipe.flush = fake_flush;
+
+   st = CALLOC_STRUCT(st_context);
+   st->pipe = &pipe;
+   st->cso_context = cso_create_context(&pipe);
+   /* Few small buffers, so that the ring wraps every few frames */
+   st->constbuf_uploader = u_upload_create_ring(&pipe, 4096, 256,
+                                                PIPE_BIND_CONSTANT_BUFFER, 3);
+}
+
+void
+UploadConstants_test::TearDown()
+{
+   unsigned i;
+
+   for (i = 0; i < PIPE_SHADER_TYPES; i++) {
+      pipe_resource_reference(&bound[i].buffer, NULL);
+      pipe_resource_reference(&st->state.constants[i].buffer, NULL);
+      free(st->state.constants[i].shadow);
+   }
+   cso_destroy_context(st->cso_context);
+   u_upload_destroy(st->constbuf_uploader);
+   FREE(st);
+}
+
+struct gl_program_parameter_list *
+UploadConstants_test::create_params(unsigned num)
+{
+   struct gl_program_parameter_list *params =
+      _mesa_new_parameter_list_sized(num);
+   static const gl_constant_value zero[4] = { { 0.0f } };
+   unsigned i;
+
+   for (i = 0; i < num; i++) {
+      char name[16];
+
+      snprintf(name, sizeof(name), "u%u", i);
+      _mesa_add_parameter(params, PROGRAM_UNIFORM, name, 4, GL_FLOAT_VEC4,
+                          zero, NULL);
+   }
+   return params;
+}
+
+/**
+ * End a frame like st_flush() does.
+ */
+void
+UploadConstants_test::flush()
+{
+   struct pipe_fence_handle *fence = NULL;
+
+   pipe.flush(&pipe, &fence, 0);
+   u_upload_fence(st->constbuf_uploader, fence);
+   screen.fence_reference(&screen, &fence, NULL);
+}
+
+/**
+ * What a draw would read from the shader's constant buffer.
+ */
+void
+UploadConstants_test::check_bound(unsigned shader,
+                                  const struct gl_program_parameter_list *params)
+{
+   const unsigned size = params->NumParameters * sizeof(params->ParameterValues[0]);
+   const struct fake_resource *res =
+      (const struct fake_resource *) bound[shader].buffer;
+
+   ASSERT_TRUE(res != NULL);
+   ASSERT_EQ(size, bound[shader].buffer_size);
+   EXPECT_EQ(0, memcmp(res->data + bound[shader].buffer_offset,
+                       params->ParameterValues, size))
+      << "shader " << shader << " after " << num_flushes << " flushes";
+}
+
+/**
+ * Vertex shader constants set once, fragment shader constants changing
+ * every draw, all of them on even frames and one on odd frames.  The
+ * vertex shader constants are never uploaded again and must survive the
+ * fragment shader uploads wrapping the ring.
+ */
+TEST_F(UploadConstants_test, fs_only_across_ring_wrap)
+{
+   struct gl_program_parameter_list *vs = create_params(16);
+   struct gl_program_parameter_list *fs = create_params(64);
+   unsigned frame, draw, i;
+
+   for (i = 0; i < vs->NumParameters; i++)
+      vs->ParameterValues[i][0].f = 1000.0f + i;
+
+   for (frame = 0; frame < 32; frame++) {
+      for (draw = 0; draw < 4; draw++) {
+         const float value = frame * 4 + draw;
+
+         if (frame % 2 == 0) {
+            for (i = 0; i < fs->NumParameters; i++)
+               fs->ParameterValues[i][0].f = value;
+         }
+         else {
+            fs->ParameterValues[draw][1].f = value;
+         }
+
+         st_upload_constants(st, vs, PIPE_SHADER_VERTEX);
+         st_upload_constants(st, fs, PIPE_SHADER_FRAGMENT);
+         check_bound(PIPE_SHADER_VERTEX, vs);
+         check_bound(PIPE_SHADER_FRAGMENT, fs);
+      }
+      flush();
+   }
+
+   /* The test is moot if no buffer was reused */
+   EXPECT_LT(0u, u_upload_recycle_count(st->constbuf_uploader));
+
+   _mesa_free_parameter_list(vs);
+   _mesa_free_parameter_list(fs);
+}
@@ -83,6 +83,9 @@ struct vbo_save_vertex_list {
 
    struct vbo_save_vertex_store *vertex_store;
    struct vbo_save_primitive_store *prim_store;
+
+   /* Lists merged into this one by glEndList, until it uploads them */
+   struct vbo_save_merge *merge;
 };
 
 /* These buffers should be a reasonable size to support upload to
@@ -394,6 +394,7 @@ _save_compile_vertex_list(struct gl_context *ctx)
    node->prim_count = save->prim_count;
    node->vertex_store = save->vertex_store;
    node->prim_store = save->prim_store;
+   node->merge = NULL;
 
    node->vertex_store->refcount++;
    node->prim_store->refcount++;
@@ -1522,6 +1523,355 @@ vbo_destroy_vertex_list(struct gl_context *ctx, void *data)
 }
 
 
+/**
+ * Vertices and primitives of the lists merged into a vertex list, in the
+ * format of the merged list, until vbo_merge_vertex_lists() uploads them.
+ */
+struct vbo_save_merge {
+   GLfloat *buffer;
+   GLuint size;                 /**< allocated GLfloats */
+   struct _mesa_prim prim[VBO_SAVE_PRIM_SIZE];
+};
+
+
+/**
+ * Convert \p count vertices from the format of \p src_sz to the one of
+ * \p dst_sz, which has all attributes of the former.  The attributes the
+ * source lacks are taken from \p fill.
+ */
+static void
+convert_vertices(GLfloat *dst, const GLubyte *dst_sz, const GLenum *dst_type,
+                 const GLfloat *src, const GLubyte *src_sz, GLuint count,
+                 const GLfloat (*fill)[4])
+{
+   GLfloat attr[4];
+   GLuint i, j;
+
+   for (i = 0; i < count; i++) {
+      for (j = 0; j < VBO_ATTRIB_MAX; j++) {
+         if (!dst_sz[j])
+            continue;
+
+         if (src_sz[j]) {
+            COPY_CLEAN_4V_TYPE_AS_FLOAT(attr, src_sz[j], src, dst_type[j]);
+            src += src_sz[j];
+            COPY_SZ_4V(dst, dst_sz[j], attr);
+         }
+         else {
+            COPY_SZ_4V(dst, dst_sz[j], fill[j]);
+         }
+         dst += dst_sz[j];
+      }
+   }
+}
+
+
+/** Read the vertices of a vertex list back from its vertex store */
+static GLfloat *
+read_vertices(struct gl_context *ctx,
+              const struct vbo_save_vertex_list *node)
+{
+   const GLuint size = node->count * node->vertex_size * sizeof(GLfloat);
+   GLfloat *vertices = malloc(size);
+
+   if (vertices)
+      ctx->Driver.GetBufferSubData(ctx, node->buffer_offset, size, vertices,
+                                   node->vertex_store->bufferobj);
+   return vertices;
+}
+
+
+/**
+ * Upload the vertices merged into \p node to a vertex store of their own,
+ * and update the current values the list sets.
+ */
+static void
+upload_merged_vertices(struct gl_context *ctx,
+                       struct vbo_save_vertex_list *node)
+{
+   struct vbo_save_merge *merge = node->merge;
+   const GLuint size = node->count * node->vertex_size;
+   struct vbo_save_vertex_store *vertex_store =
+      CALLOC_STRUCT(vbo_save_vertex_store);
+   struct vbo_save_primitive_store *prim_store = alloc_prim_store(ctx);
+
+   node->merge = NULL;
+   free(node->current_data);
+   node->current_data = NULL;
+
+   if (vertex_store)
+      vertex_store->bufferobj = ctx->Driver.NewBufferObject(ctx, VBO_BUF_ID);
+
+   if (!vertex_store || !vertex_store->bufferobj || !prim_store ||
+       !ctx->Driver.BufferData(ctx, GL_ARRAY_BUFFER_ARB,
+                               size * sizeof(GLfloat), merge->buffer,
+                               GL_STATIC_DRAW_ARB,
+                               GL_MAP_WRITE_BIT | GL_DYNAMIC_STORAGE_BIT,
+                               vertex_store->bufferobj)) {
+      _mesa_error(ctx, GL_OUT_OF_MEMORY, "glEndList");
+
+      /* Keep the old stores, with nothing to draw from them */
+      if (vertex_store && vertex_store->bufferobj)
+         _mesa_reference_buffer_object(ctx, &vertex_store->bufferobj, NULL);
+      free(vertex_store);
+      free(prim_store);
+      node->prim = node->prim_store->buffer;
+      node->prim_count = 0;
+      node->count = 0;
+      node->current_size = 0;
+      goto out;
+   }
+
+   vertex_store->used = size;
+   vertex_store->refcount = 1;
+   memcpy(prim_store->buffer, merge->prim,
+          node->prim_count * sizeof(struct _mesa_prim));
+   prim_store->used = node->prim_count;
+
+   if (--node->vertex_store->refcount == 0)
+      free_vertex_store(ctx, node->vertex_store);
+   if (--node->prim_store->refcount == 0)
+      free(node->prim_store);
+
+   node->vertex_store = vertex_store;
+   node->prim_store = prim_store;
+   node->prim = prim_store->buffer;
+   node->buffer_offset = 0;
+
+   node->current_size = node->vertex_size - node->attrsz[VBO_ATTRIB_POS];
+   node->current_data = malloc(node->current_size * sizeof(GLfloat));
+   if (node->current_data) {
+      memcpy(node->current_data,
+             merge->buffer + size - node->current_size,
+             node->current_size * sizeof(GLfloat));
+   }
+
+out:
+   free(merge->buffer);
+   free(merge);
+}
+
+
+/**
+ * Called by glEndList to append vertex list \p next_data to \p data when
+ * only glColor, glNormal and such were compiled between them.
+ *
+ * If the lists have the same format and their vertices follow each other
+ * in the vertex store, this just adds the primitives of the second list to
+ * the first.  Otherwise the vertices are read back and converted to a
+ * format with the attributes of both lists and those set between them,
+ * which the vertices that didn't have them take from the known current
+ * values.  The result is uploaded when \p next_data is NULL.
+ */
+static GLboolean
+vbo_merge_vertex_lists(struct gl_context *ctx, void *data, void *next_data,
+                       const struct gl_list_attribs *before,
+                       const struct gl_list_attribs *current)
+{
+   struct vbo_save_vertex_list *node = (struct vbo_save_vertex_list *) data;
+   struct vbo_save_vertex_list *next =
+      (struct vbo_save_vertex_list *) next_data;
+   GLubyte attrsz[VBO_ATTRIB_MAX];
+   GLenum attrtype[VBO_ATTRIB_MAX];
+   GLfloat node_fill[VBO_ATTRIB_MAX][4], next_fill[VBO_ATTRIB_MAX][4];
+   GLbitfield64 from_last = 0;
+   struct vbo_save_merge *merge;
+   GLfloat *node_vertices = NULL, *next_vertices = NULL, *buffer;
+   GLuint vertex_size = 0, size, i;
+
+   if (!next) {
+      if (node->merge)
+         upload_merged_vertices(ctx, node);
+      return GL_TRUE;
+   }
+
+   /* Both lists must draw whole primitives and set the current values */
+   if (node->count == 0 || next->count == 0 ||
+       node->current_size == 0 || next->current_size == 0 ||
+       node->dangling_attr_ref || next->dangling_attr_ref ||
+       next->wrap_count ||
+       !node->prim[node->prim_count - 1].end || !next->prim[0].begin ||
+       node->prim_count + next->prim_count > VBO_SAVE_PRIM_SIZE)
+      return GL_FALSE;
+
+   for (i = 0; i < VBO_ATTRIB_MAX; i++) {
+      const GLbitfield64 bit = i < VERT_ATTRIB_MAX ? VERT_BIT(i) : 0;
+
+      attrsz[i] = MAX2(node->attrsz[i], next->attrsz[i]);
+      attrtype[i] = node->attrsz[i] ? node->attrtype[i] : next->attrtype[i];
+
+      if (node->attrsz[i] && next->attrsz[i]) {
+         if (node->attrtype[i] != next->attrtype[i])
+            return GL_FALSE;
+      }
+      else if (next->attrsz[i]) {
+         /* Unchanged since before node */
+         if (!(before->Known & bit))
+            return GL_FALSE;
+         COPY_4V(node_fill[i], before->Values[i]);
+      }
+      else if (node->attrsz[i]) {
+         if (current->Known & bit)
+            COPY_4V(next_fill[i], current->Values[i]);
+         else
+            from_last |= BITFIELD64_BIT(i);
+      }
+      else if ((current->Known & bit) &&
+               (!(before->Known & bit) ||
+                memcmp(before->Values[i], current->Values[i],
+                       sizeof(current->Values[i])) != 0)) {
+         /* Set between the lists */
+         if (!(before->Known & bit))
+            return GL_FALSE;
+         attrsz[i] = MAX2(before->Sizes[i], current->Sizes[i]);
+         attrtype[i] = GL_FLOAT;
+         COPY_4V(node_fill[i], before->Values[i]);
+         COPY_4V(next_fill[i], current->Values[i]);
+      }
+
+      vertex_size += attrsz[i];
+   }
+
+   if (!node->merge &&
+       node->vertex_store == next->vertex_store &&
+       node->prim_store == next->prim_store &&
+       next->buffer_offset == node->buffer_offset +
+                              node->count * node->vertex_size *
+                              sizeof(GLfloat) &&
+       memcmp(attrsz, node->attrsz, sizeof(attrsz)) == 0 &&
+       memcmp(attrsz, next->attrsz, sizeof(attrsz)) == 0) {
+      /* The vertices are already in place, and the slots up to the end
+       * of next's primitives belong to the two lists.
+       */
+      assert(next->prim >= node->prim + node->prim_count);
+      memmove(node->prim + node->prim_count, next->prim,
+              next->prim_count * sizeof(struct _mesa_prim));
+      goto merge_prims;
+   }
+
+   /* Read back the vertices of next, and of node unless it has them */
+   size = (node->count + next->count) * vertex_size;
+   merge = node->merge;
+   if (!merge) {
+      merge = CALLOC_STRUCT(vbo_save_merge);
+      if (!merge)
+         return GL_FALSE;
+   }
+
+   next_vertices = read_vertices(ctx, next);
+   if (!next_vertices)
+      goto fail;
+
+   if (merge->buffer && memcmp(attrsz, node->attrsz, sizeof(attrsz)) == 0) {
+      if (size > merge->size) {
+         buffer = realloc(merge->buffer, 2 * size * sizeof(GLfloat));
+         if (!buffer)
+            goto fail;
+         merge->buffer = buffer;
+         merge->size = 2 * size;
+      }
+   }
+   else {
+      /* The format grows, convert what there is */
+      buffer = malloc(2 * size * sizeof(GLfloat));
+      if (!merge->buffer)
+         node_vertices = read_vertices(ctx, node);
+      if (!buffer || (!merge->buffer && !node_vertices)) {
+         free(buffer);
+         goto fail;
+      }
+
+      convert_vertices(buffer, attrsz, attrtype,
+                       merge->buffer ? merge->buffer : node_vertices,
+                       node->attrsz, node->count,
+                       (const GLfloat (*)[4]) node_fill);
+      free(merge->buffer);
+      free(node_vertices);
+      merge->buffer = buffer;
+      merge->size = 2 * size;
+   }
+
+   /* What next takes from the last vertex of node */
+   if (from_last) {
+      const GLfloat *last = merge->buffer + (node->count - 1) * vertex_size;
+
+      for (i = 0; i < VBO_ATTRIB_MAX; i++) {
+         if (from_last & BITFIELD64_BIT(i))
+            COPY_CLEAN_4V_TYPE_AS_FLOAT(next_fill[i], attrsz[i], last,
+                                        attrtype[i]);
+         last += attrsz[i];
+      }
+   }
+
+   convert_vertices(merge->buffer + node->count * vertex_size,
+                    attrsz, attrtype, next_vertices, next->attrsz,
+                    next->count, (const GLfloat (*)[4]) next_fill);
+   free(next_vertices);
+
+   if (!node->merge) {
+      memcpy(merge->prim, node->prim,
+             node->prim_count * sizeof(struct _mesa_prim));
+      node->prim = merge->prim;
+      node->merge = merge;
+   }
+   memcpy(node->prim + node->prim_count, next->prim,
+          next->prim_count * sizeof(struct _mesa_prim));
+
+   memcpy(node->attrsz, attrsz, sizeof(attrsz));
+   memcpy(node->attrtype, attrtype, sizeof(attrtype));
+   node->vertex_size = vertex_size;
+
+merge_prims:
+   for (i = 0; i < next->prim_count; i++)
+      node->prim[node->prim_count + i].start += node->count;
+
+   node->prim_count += next->prim_count;
+   node->count += next->count;
+   merge_prims(ctx, node->prim, &node->prim_count);
+
+   /* The current values after the merged list are next's */
+   free(node->current_data);
+   node->current_data = next->current_data;
+   next->current_data = NULL;
+
+   vbo_destroy_vertex_list(ctx, next);
+   return GL_TRUE;
+
+fail:
+   free(next_vertices);
+   if (!node->merge)
+      free(merge);
+   return GL_FALSE;
+}
+
+
+/**
+ * The current attributes replaying the vertex list sets without reading
+ * them: all but the position, unless the list doesn't update the current
+ * values or needs some from before the list.
+ */
+static GLbitfield64
+vbo_vertex_list_overwrites(struct gl_context *ctx, void *data)
+{
+   const struct vbo_save_vertex_list *node =
+      (const struct vbo_save_vertex_list *) data;
+   GLbitfield64 mask = 0;
+   GLuint i;
+   (void) ctx;
+
+   if (node->count == 0 || node->current_size == 0 ||
+       node->dangling_attr_ref)
+      return 0;
+
+   for (i = VBO_ATTRIB_POS + 1; i <= VBO_ATTRIB_GENERIC15; i++) {
+      if (node->attrsz[i])
+         mask |= VERT_BIT(i - VBO_ATTRIB_POS);
+   }
+
+   return mask;
+}
+
+
 static void
 vbo_print_vertex_list(struct gl_context *ctx, void *data, FILE *f)
 {
@@ -1589,7 +1939,9 @@ vbo_save_api_init(struct vbo_save_context *save)
                                sizeof(struct vbo_save_vertex_list),
                                vbo_save_playback_vertex_list,
                                vbo_destroy_vertex_list,
-                               vbo_print_vertex_list);
+                               vbo_print_vertex_list,
+                               vbo_merge_vertex_lists,
+                               vbo_vertex_list_overwrites);
 
    ctx->Driver.NotifySaveBegin = vbo_save_NotifyBegin;
 